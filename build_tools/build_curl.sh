@@ -83,8 +83,7 @@ function build_curl(){
                 --without-librtmp \
                 --without-brotli \
                 --without-libidn \
-                --without-zstd \
-                --without-nghttp2"
+                --without-zstd"
     local build_dir="${CWD}/build/curl/$1/$2"
     local install_dir="${CWD}/install/curl/$1/$2"
 
@@ -101,11 +100,18 @@ function build_curl(){
             local resolver_opt="--enable-threaded-resolver"
         fi
 
+        # the requests to a host are multiplexed on one connection with HTTP/2
+        if [ -d "${NGHTTP2_INSTALL_DIR}" ];then
+            local http2_opt="--with-nghttp2=${NGHTTP2_INSTALL_DIR}"
+        else
+            local http2_opt="--without-nghttp2"
+        fi
+
         if [ -d "${LIBRTMP_INSTALL_DIR}" ];then
             local rtmp_opt="--with-librtmp=${LIBRTMP_INSTALL_DIR}"
         fi
 
-        ${CURL_SOURCE_DIR}/configure -host=${CROSS_COMPILE} CC="${CC}" ${ssl_opt} ${resolver_opt} ${config} ${rtmp_opt} --prefix=${install_dir} ${LIBSDEPEND} || exit 1
+        ${CURL_SOURCE_DIR}/configure -host=${CROSS_COMPILE} CC="${CC}" ${ssl_opt} ${resolver_opt} ${http2_opt} ${config} ${rtmp_opt} --prefix=${install_dir} ${LIBSDEPEND} || exit 1
         make -j8 install V=1 || exit 1
         cd -
     fi
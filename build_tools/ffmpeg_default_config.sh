@@ -7,7 +7,7 @@
 ffmpeg_config_add_decoders libfdk_aac h264
 
 
-ffmpeg_config_add_encoders aac
+ffmpeg_config_add_encoders aac mjpeg png
 
 
 #ffmpeg_config_add_demuxers flv
@@ -0,0 +1,136 @@
+#include <WebAssemblyPlayer/bitStreamAnalyzer.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <unistd.h>
+#include <utils/CicadaJSON.h>
+#include <utils/frame_work_log.h>
+
+using namespace Cicada;
+using namespace std;
+
+// print the stats as json lines, a line for a frame and a line for a file
+class jsonPrinter : public bitStreamAnalyzer::Listener {
+public:
+    explicit jsonPrinter(bool printFrames) : mPrintFrames(printFrames)
+    {}
+
+    void onFrameStats(const string &file, const bitStreamAnalyzer::FrameStats &stats) override
+    {
+        if (!mPrintFrames) {
+            return;
+        }
+
+        CicadaJSONItem json;
+        json.addValue("file", file);
+        json.addValue("type", stats.video ? "video" : "audio");
+        json.addValue("pts", (double) stats.pts);
+        json.addValue("decodeTime", stats.decodeTime);
+        json.addValue("key", stats.key);
+
+        if (stats.video) {
+            json.addValue("pictType", string(1, stats.pictType));
+            json.addValue("qp", stats.qp);
+        }
+
+        json.addValue("ptsJitter", (double) stats.ptsJitter);
+
+        if (stats.avDrift != INT64_MIN) {
+            json.addValue("avDrift", (double) stats.avDrift);
+        }
+
+        print(json);
+    }
+
+    void onFileStats(const string &file, const bitStreamAnalyzer::FileStats &stats) override
+    {
+        CicadaJSONItem json;
+        json.addValue("file", file);
+        json.addValue("error", stats.error);
+        json.addValue("videoFrames", (double) stats.videoFrames);
+        json.addValue("audioFrames", (double) stats.audioFrames);
+        json.addValue("decodeTime", (double) stats.decodeTime);
+        json.addValue("maxPtsJitter", (double) stats.maxPtsJitter);
+        json.addValue("maxAVDrift", (double) stats.maxAVDrift);
+        json.addValue("costTime", (double) stats.costTime);
+        print(json);
+    }
+
+private:
+    void print(const CicadaJSONItem &json)
+    {
+        string line = json.printJSON();
+        std::lock_guard<std::mutex> lock(mMutex);
+        fprintf(stdout, "%s\n", line.c_str());
+    }
+
+private:
+    bool mPrintFrames;
+    std::mutex mMutex;
+};
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-j threads] [-m cache MB per file] [-f] [-l file list] files...\n", name);
+    fprintf(stderr, "  -f  print the stats of every frame\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = 0;
+    int64_t cacheSize = 0;
+    bool printFrames = false;
+    vector<string> files{};
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:m:fl:h")) != -1) {
+        switch (opt) {
+            case 'j':
+                threads = atoi(optarg);
+                break;
+
+            case 'm':
+                cacheSize = atoll(optarg) * 1024 * 1024;
+                break;
+
+            case 'f':
+                printFrames = true;
+                break;
+
+            case 'l': {
+                ifstream list(optarg);
+                string line;
+
+                while (getline(list, line)) {
+                    if (!line.empty()) {
+                        files.push_back(line);
+                    }
+                }
+
+                break;
+            }
+
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    for (int i = optind; i < argc; i++) {
+        files.emplace_back(argv[i]);
+    }
+
+    if (files.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    log_set_level(AF_LOG_LEVEL_WARNING, 1);
+    jsonPrinter printer(printFrames);
+    bitStreamAnalyzer analyzer(printer);
+    analyzer.setThreadCount(threads);
+    analyzer.setMaxCacheSize(cacheSize);
+    int failed = analyzer.run(files);
+    return failed > 0 ? 2 : 0;
+}
@@ -0,0 +1,262 @@
+#define LOG_TAG "bitStreamAnalyzer"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+#ifdef AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS
+#include <libavutil/video_enc_params.h>
+#endif
+};
+
+#include "bitStreamAnalyzer.h"
+#include "bitStreamDecoder.h"
+#include <algorithm>
+#include <base/media/AVAFPacket.h>
+#include <cstdlib>
+#include <data_source/dataSourcePrototype.h>
+#include <memory>
+#include <thread>
+#include <utils/AFUtils.h>
+#include <utils/frame_work_log.h>
+#include <utils/timer.h>
+
+#define DEFAULT_MAX_CACHE_SIZE (8 * 1024 * 1024)
+
+using namespace std;
+
+namespace Cicada {
+    static int io_read(void *arg, uint8_t *buffer, int size)
+    {
+        return static_cast<IDataSource *>(arg)->Read(buffer, size);
+    }
+
+    static int64_t io_seek(void *arg, int64_t offset, int whence)
+    {
+        return static_cast<IDataSource *>(arg)->Seek(offset, whence);
+    }
+
+    class analyzerListener : public bitStreamDecoder::eventListener {
+    public:
+        analyzerListener(bitStreamAnalyzer::Listener &listener, const string &file, bitStreamAnalyzer::FileStats &fileStats)
+            : mListener(listener), mFile(file), mFileStats(fileStats), mCounter(fileStats)
+        {}
+
+        void onError(int error) override
+        {
+            mFileStats.error = error;
+        }
+
+        void onEOS(enum bitStreamDecoder::eosType type) override
+        {
+            if (type == bitStreamDecoder::eosTypeDemuxer) {
+                mReadEOS = true;
+            }
+        }
+
+        void onFrame(IAFFrame *frame, int consumeTime) override
+        {
+            bitStreamAnalyzer::FrameStats stats{};
+            const IAFFrame::AFFrameInfo &info = frame->getInfo();
+            AVFrame *avFrame = getAVFrame(frame);
+            int64_t duration = info.duration;
+
+            stats.video = frame->getType() == IAFFrame::FrameTypeVideo;
+            stats.pts = info.pts;
+            stats.decodeTime = consumeTime;
+            stats.key = info.key;
+
+            if (stats.video) {
+                if (avFrame) {
+                    stats.pictType = av_get_picture_type_char(avFrame->pict_type);
+                    stats.qp = bitStreamAnalyzer::getFrameQp(avFrame);
+                }
+
+                mFileStats.videoFrames++;
+            } else {
+                if (info.audio.sample_rate > 0) {
+                    duration = (int64_t) info.audio.nb_samples * 1000000 / info.audio.sample_rate;
+                }
+
+                mFileStats.audioFrames++;
+            }
+
+            mCounter.add(stats, duration);
+            mFileStats.decodeTime += consumeTime;
+            mListener.onFrameStats(mFile, stats);
+        }
+
+        void onStreamMeta(const Stream_meta *meta) override
+        {}
+
+        bool isReadEOS() const
+        {
+            return mReadEOS;
+        }
+
+    private:
+        bitStreamAnalyzer::Listener &mListener;
+        const string &mFile;
+        bitStreamAnalyzer::FileStats &mFileStats;
+        bitStreamAnalyzer::StatsCounter mCounter;
+        bool mReadEOS{false};
+    };
+
+    void bitStreamAnalyzer::StatsCounter::add(FrameStats &stats, int64_t duration)
+    {
+        streamState &state = stats.video ? mVideo : mAudio;
+
+        if (stats.pts != INT64_MIN && state.lastPts != INT64_MIN) {
+            int64_t delta = stats.pts - state.lastPts;
+            // the frame duration is unknown in some containers, expect the same distance as the last one
+            int64_t expected = state.lastDuration > 0 ? state.lastDuration : state.lastDelta;
+
+            if (expected > 0) {
+                stats.ptsJitter = delta - expected;
+            }
+
+            state.lastDelta = delta;
+        }
+
+        if (stats.pts != INT64_MIN) {
+            state.lastPts = stats.pts;
+            state.lastDuration = duration;
+        }
+
+        if (stats.video && stats.pts != INT64_MIN && mAudio.lastPts != INT64_MIN) {
+            stats.avDrift = stats.pts - (mAudio.lastPts + max(mAudio.lastDuration, (int64_t) 0));
+            mFileStats.maxAVDrift = max(mFileStats.maxAVDrift, abs(stats.avDrift));
+        }
+
+        mFileStats.maxPtsJitter = max(mFileStats.maxPtsJitter, abs(stats.ptsJitter));
+    }
+
+    int bitStreamAnalyzer::getFrameQp(const AVFrame *frame)
+    {
+#ifdef AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS
+        AVFrameSideData *sideData = av_frame_get_side_data(frame, AV_FRAME_DATA_VIDEO_ENC_PARAMS);
+
+        if (sideData == nullptr) {
+            return -1;
+        }
+
+        auto *params = reinterpret_cast<AVVideoEncParams *>(sideData->data);
+
+        if (params->nb_blocks == 0) {
+            return params->qp;
+        }
+
+        // the block qps weighted by the area of the blocks
+        int64_t sum = 0;
+        int64_t area = 0;
+
+        for (unsigned i = 0; i < params->nb_blocks; i++) {
+            AVVideoBlockParams *block = av_video_enc_params_block(params, i);
+            int64_t blockArea = (int64_t) block->w * block->h;
+            sum += (params->qp + block->delta_qp) * blockArea;
+            area += blockArea;
+        }
+
+        return area > 0 ? static_cast<int>(sum / area) : params->qp;
+#else
+        return -1;
+#endif
+    }
+
+    bitStreamAnalyzer::bitStreamAnalyzer(Listener &listener) : mListener(listener), mMaxCacheSize(DEFAULT_MAX_CACHE_SIZE)
+    {}
+
+    int bitStreamAnalyzer::run(const vector<string> &files)
+    {
+        int count = mThreadCount > 0 ? mThreadCount : max(AFGetCpuCount(), 1);
+        count = min(count, static_cast<int>(files.size()));
+        mNextFile = 0;
+        mFailedCount = 0;
+        mInterrupted = false;
+        vector<thread> workers{};
+
+        for (int i = 0; i < count; i++) {
+            workers.emplace_back([this, &files]() { workerRun(files); });
+        }
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        return mFailedCount;
+    }
+
+    void bitStreamAnalyzer::workerRun(const vector<string> &files)
+    {
+        while (!mInterrupted) {
+            size_t i = mNextFile++;
+
+            if (i >= files.size()) {
+                break;
+            }
+
+            FileStats fileStats{};
+            int64_t startTime = af_gettime_relative();
+            int ret = analyzeFile(files[i], fileStats);
+
+            if (ret < 0) {
+                fileStats.error = ret;
+            }
+
+            if (fileStats.error < 0) {
+                mFailedCount++;
+            }
+
+            fileStats.costTime = af_gettime_relative() - startTime;
+            mListener.onFileStats(files[i], fileStats);
+        }
+    }
+
+    int bitStreamAnalyzer::analyzeFile(const string &file, FileStats &fileStats)
+    {
+        unique_ptr<IDataSource> source(dataSourcePrototype::create(file));
+
+        if (source == nullptr) {
+            return -ENOSYS;
+        }
+
+        int ret = source->Open(0);
+
+        if (ret < 0) {
+            AF_LOGE("open %s error %d\n", file.c_str(), ret);
+            return ret;
+        }
+
+        analyzerListener listener(mListener, file, fileStats);
+        bitStreamDecoder decoder(io_read, listener, source.get());
+        decoder.setSeekCallback(io_seek);
+        decoder.setMaxCacheSize(mMaxCacheSize);
+        decoder.setDecoderFlags(DECFLAG_EXPORT_QP);
+        ret = decoder.prepare();
+
+        if (ret < 0) {
+            AF_LOGE("prepare %s error %d\n", file.c_str(), ret);
+            return ret;
+        }
+
+        while (!decoder.isEOS() && !mInterrupted) {
+            // keep the cache full, a packet is decoded after a packet is read
+            if (!listener.isReadEOS() && decoder.getCacheSize() < mMaxCacheSize) {
+                ret = decoder.readPacket();
+
+                if (ret < 0 && ret != -EAGAIN) {
+                    AF_LOGE("read %s error %d\n", file.c_str(), ret);
+                    return ret;
+                }
+
+                if (ret > 0 && decoder.getCacheSize() < mMaxCacheSize) {
+                    continue;
+                }
+            }
+
+            decoder.pull_once();
+        }
+
+        return 0;
+    }
+}// namespace Cicada
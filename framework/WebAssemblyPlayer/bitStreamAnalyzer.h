@@ -0,0 +1,128 @@
+#ifndef FRAMEWORK_BITSTREAMANALYZER_H
+#define FRAMEWORK_BITSTREAMANALYZER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct AVFrame;
+
+namespace Cicada {
+    /*
+     * Decode the local files by bitStreamDecoder as fast as possible for the quality check, and report
+     * the stats of every frame decoded.
+     *
+     * The files are decoded in a pool of worker threads, one file by a thread at a time, the packets
+     * cached of a file are bounded by the max cache size. The decoder threads of the files share the
+     * DecoderThreadBudget, the cores are used by the files instead of the frame threads of a file.
+     */
+    class bitStreamAnalyzer {
+    public:
+        struct FrameStats {
+            bool video{false};
+            int64_t pts{INT64_MIN};
+            // us, sending the packet and getting the frame
+            int decodeTime{0};
+            bool key{false};
+            // 'I', 'P', 'B' ... of the video frames, 0 for the audio frames
+            char pictType{0};
+            // the average qp of the video frame, -1 if the decoder doesn't export it
+            int qp{-1};
+            // us, the pts distance to the previous frame minus the frame duration
+            int64_t ptsJitter{0};
+            // us, the video pts minus the end of the audio decoded, INT64_MIN for the audio frames or no audio
+            int64_t avDrift{INT64_MIN};
+        };
+
+        struct FileStats {
+            int error{0};
+            int64_t videoFrames{0};
+            int64_t audioFrames{0};
+            int64_t decodeTime{0};
+            int64_t maxPtsJitter{0};
+            int64_t maxAVDrift{0};
+            // us, the wall time of the file
+            int64_t costTime{0};
+        };
+
+        // the pts jitter and the av drift of the frames of a file, in the decoder output order
+        class StatsCounter {
+        public:
+            explicit StatsCounter(FileStats &fileStats) : mFileStats(fileStats)
+            {}
+
+            // fill ptsJitter and avDrift of stats, duration (us) of the frame, <= 0 if unknown
+            void add(FrameStats &stats, int64_t duration);
+
+        private:
+            struct streamState {
+                int64_t lastPts{INT64_MIN};
+                int64_t lastDuration{0};
+                int64_t lastDelta{0};
+            };
+
+            FileStats &mFileStats;
+            streamState mVideo{};
+            streamState mAudio{};
+        };
+
+        // called in the worker threads
+        class Listener {
+        public:
+            virtual ~Listener() = default;
+
+            virtual void onFrameStats(const std::string &file, const FrameStats &stats)
+            {}
+
+            virtual void onFileStats(const std::string &file, const FileStats &stats) = 0;
+        };
+
+    public:
+        explicit bitStreamAnalyzer(Listener &listener);
+
+        ~bitStreamAnalyzer() = default;
+
+        // <= 0 for the cpu count
+        void setThreadCount(int count)
+        {
+            mThreadCount = count;
+        }
+
+        // bytes of the packets cached by a file
+        void setMaxCacheSize(int64_t size)
+        {
+            if (size > 0) {
+                mMaxCacheSize = size;
+            }
+        }
+
+        // decode the files and return the number of the files failed
+        int run(const std::vector<std::string> &files);
+
+        // the files not started are skipped
+        void interrupt()
+        {
+            mInterrupted = true;
+        }
+
+        // the average qp of the video encoding parameters exported by the decoder, -1 if none
+        static int getFrameQp(const AVFrame *frame);
+
+    private:
+        void workerRun(const std::vector<std::string> &files);
+
+        int analyzeFile(const std::string &file, FileStats &fileStats);
+
+    private:
+        Listener &mListener;
+        int mThreadCount{0};
+        int64_t mMaxCacheSize;
+        std::atomic<size_t> mNextFile{0};
+        std::atomic<int> mFailedCount{0};
+        std::atomic_bool mInterrupted{false};
+    };
+}// namespace Cicada
+
+
+#endif//FRAMEWORK_BITSTREAMANALYZER_H
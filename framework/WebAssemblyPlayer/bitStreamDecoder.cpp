@@ -11,8 +11,9 @@
 
 namespace Cicada {
 
-    bitStreamDecoder::bitStreamDecoder(data_callback_read func, eventListener &listener)
+    bitStreamDecoder::bitStreamDecoder(data_callback_read func, eventListener &listener, void *arg)
         : mPRead(func),
+          mArg(arg),
           mListener(listener)
     {
     }
@@ -24,7 +25,7 @@ namespace Cicada {
 
     int bitStreamDecoder::prepare()
     {
-        mDemuxer.SetDataCallBack(mPRead, nullptr, nullptr, nullptr, nullptr);
+        mDemuxer.SetDataCallBack(mPRead, mPSeek, nullptr, nullptr, mArg);
         int ret = mDemuxer.Open();
 
         if (ret < 0) {
@@ -65,7 +66,7 @@ namespace Cicada {
     void bitStreamDecoder::addStream(const Stream_meta &meta, int i)
     {
         mDecoders[i] = unique_ptr<avcodecDecoder>(new avcodecDecoder());
-        mDecoders[i]->open(&meta, nullptr, 0);
+        mDecoders[i]->open(&meta, nullptr, mDecoderFlags);
         mPacketQues[i];
         mStatisInfo[i];
         mDemuxer.OpenStream(i);
@@ -123,7 +124,14 @@ namespace Cicada {
         int ret = mDemuxer.ReadPacket(pkt, 0);
 
         if (ret > 0) {
-            mPacketQues[pkt->getInfo().streamIndex].push(move(pkt));
+            auto queue = mPacketQues.find(pkt->getInfo().streamIndex);
+
+            if (queue == mPacketQues.end()) {
+                return ret;
+            }
+
+            mCacheSize += pkt->getSize();
+            queue->second.push(move(pkt));
         } else if (ret == 0) {
             inPutEOS = true;
             mListener.onEOS(eosTypeDemuxer);
@@ -141,7 +149,7 @@ namespace Cicada {
 
         for (auto &item : mPacketQues) {
             if (item.second.empty()) {
-                assert(inPutEOS);
+                assert(inPutEOS || isCacheFull());
                 continue;
             }
 
@@ -173,7 +181,7 @@ namespace Cicada {
 #if !AF_HAVE_PTHREAD
 
         if (mPacketQues[stream].empty()) {
-            assert(inPutEOS);
+            assert(inPutEOS || isCacheFull());
             stream = getMinPacketPTSStream();
         }
 
@@ -183,13 +191,17 @@ namespace Cicada {
 
         if (stream == -1) {
             AF_LOGD("PacketQues is empty\n");
-            assert(inPutEOS);
-            flushDecoders();
+
+            if (inPutEOS) {
+                flushDecoders();
+            }
+
             return;
         }
 
         pkt = move(mPacketQues[stream].front());
         mPacketQues[stream].pop();
+        mCacheSize -= pkt->getSize();
 
         do {
             ret = decode(pkt);
@@ -244,7 +256,7 @@ namespace Cicada {
 
     bool bitStreamDecoder::needRead() const
     {
-        if (inPutEOS) {
+        if (inPutEOS || isCacheFull()) {
             return false;
         }
 
@@ -257,6 +269,11 @@ namespace Cicada {
         return false;
     }
 
+    bool bitStreamDecoder::isCacheFull() const
+    {
+        return mMaxCacheSize > 0 && mCacheSize >= mMaxCacheSize;
+    }
+
     void bitStreamDecoder::flush()
     {
         for (auto &item : mPacketQues) {
@@ -265,6 +282,7 @@ namespace Cicada {
             }
         }
 
+        mCacheSize = 0;
         mDemuxer.flush();
 
         for (auto &item : mDecoders) {
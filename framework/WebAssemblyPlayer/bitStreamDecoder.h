@@ -43,7 +43,7 @@ namespace Cicada{
 
     public:
 
-        bitStreamDecoder(data_callback_read func, eventListener &listener);
+        bitStreamDecoder(data_callback_read func, eventListener &listener, void *arg = nullptr);
 
         ~bitStreamDecoder();
 
@@ -57,6 +57,38 @@ namespace Cicada{
 
         int getCacheDuration();
 
+        // the random access input, the mp4 files have the moov at the end need it
+        void setSeekCallback(demuxer_callback_seek func)
+        {
+            mPSeek = func;
+        }
+
+        /*
+         * bytes, the packets of the other streams are decoded once the packets cached are over it, even
+         * if a stream has no packet cached, so the packets cached don't grow with a stream ended early.
+         * 0 for no limit
+         */
+        void setMaxCacheSize(int64_t size)
+        {
+            mMaxCacheSize = size;
+        }
+
+        // the DECFLAG_XXX the decoders opened with
+        void setDecoderFlags(uint64_t flags)
+        {
+            mDecoderFlags = flags;
+        }
+
+        int64_t getCacheSize() const
+        {
+            return mCacheSize;
+        }
+
+        bool isEOS() const
+        {
+            return decoderEOS;
+        }
+
     private:
         struct StatisticsInfo {
             int32_t decoderTimeSend{};
@@ -72,6 +104,8 @@ namespace Cicada{
         typedef std::queue<std::unique_ptr<IAFPacket>> packetQueue;
         avFormatDemuxer mDemuxer{};
         data_callback_read mPRead{};
+        demuxer_callback_seek mPSeek{};
+        void *mArg{};
 
         std::map<int, packetQueue> mPacketQues{};
 
@@ -82,11 +116,16 @@ namespace Cicada{
         bool inPutEOS{};
         bool decodersFlushed{};
         bool decoderEOS{};
+        int64_t mCacheSize{0};
+        int64_t mMaxCacheSize{0};
+        uint64_t mDecoderFlags{0};
 
         eventListener &mListener;
 
         bool needRead() const;
 
+        bool isCacheFull() const;
+
         int getMinFramePTSStream() const;
 
         int getMinPacketPTSStream() const;
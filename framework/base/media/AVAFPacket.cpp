@@ -77,6 +77,20 @@ unique_ptr<IAFPacket> AVAFPacket::clone() const
     return unique_ptr<IAFPacket>(new AVAFPacket(mpkt, mIsProtected));
 }
 
+int AVAFPacket::reference(const AVAFPacket &packet)
+{
+    av_packet_unref(mpkt);
+    int ret = av_packet_ref(mpkt, packet.mpkt);
+
+    if (ret < 0) {
+        return ret;
+    }
+
+    mIsProtected = packet.mIsProtected;
+    copyInfo();
+    return 0;
+}
+
 int64_t AVAFPacket::getSize()
 {
     return mpkt->size;
@@ -43,6 +43,9 @@ public:
 
     std::unique_ptr<IAFPacket> clone() const override;
 
+    // drop the data held and reference the data of packet, the buffer is shared, not copied
+    int reference(const AVAFPacket &packet);
+
     int64_t getSize() override;
 
     AVPacket *ToAVPacket();
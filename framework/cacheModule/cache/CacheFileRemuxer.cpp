@@ -14,6 +14,7 @@
 #include <utils/frame_work_log.h>
 #include <utils/stringUtil.h>
 #include <utils/mediaFrame.h>
+#include <base/media/AVAFPacket.h>
 
 using namespace Cicada;
 
@@ -21,6 +22,11 @@ CacheFileRemuxer::CacheFileRemuxer(const string &destFilePath, const string &des
 {
     mDestFilePath = destFilePath;
     mDescription = description;
+
+    for (int i = 0; i < FRAME_RING_INIT_SIZE; i++) {
+        mFrameRing.push_back(std::unique_ptr<FrameInfo>(new FrameInfo()));
+    }
+
     AF_LOGD("mDestFilePath = %s", mDestFilePath.c_str());
 }
 
@@ -38,7 +44,7 @@ CacheFileRemuxer::~CacheFileRemuxer()
         mDestFileCntl = nullptr;
     }
 
-    mFrameInfoQueue.clear();
+    mFrameRing.clear();
 }
 
 void CacheFileRemuxer::addFrame(const IAFPacket *frame, StreamType type)
@@ -47,16 +53,50 @@ void CacheFileRemuxer::addFrame(const IAFPacket *frame, StreamType type)
         mFrameEof = true;
     } else {
         mFrameEof = false;
+        std::unique_lock<mutex> lock(mQueueMutex);
 
-        FrameInfo *info = new FrameInfo();
-        info->frame = frame->clone();
-        info->type = type;
-        {
-            std::unique_lock<mutex> lock(mQueueMutex);
-            mFrameInfoQueue.push_back(std::unique_ptr<FrameInfo>(info));
-            mQueueCondition.notify_one();
+        if (mRingSize == mFrameRing.size()) {
+            growRing();
         }
+
+        FrameInfo &info = *mFrameRing[(mRingHead + mRingSize) % mFrameRing.size()];
+        fillFrame(info, frame);
+        info.type = type;
+        mRingSize++;
+        mQueueCondition.notify_one();
+    }
+}
+
+void CacheFileRemuxer::fillFrame(FrameInfo &info, const IAFPacket *frame)
+{
+    auto *src = dynamic_cast<const AVAFPacket *>(frame);
+    auto *dst = dynamic_cast<AVAFPacket *>(info.frame.get());
+
+    if (src != nullptr && dst != nullptr && dst->reference(*src) >= 0) {
+        return;
     }
+
+    info.frame = frame->clone();
+}
+
+void CacheFileRemuxer::growRing()
+{
+    size_t size = mFrameRing.size();
+    vector<std::unique_ptr<FrameInfo>> ring;
+    ring.reserve(size * 2);
+
+    // the head may be muxing now, it is moved to 0 with mRingHead
+    for (size_t i = 0; i < size; i++) {
+        ring.push_back(move(mFrameRing[(mRingHead + i) % size]));
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        ring.push_back(std::unique_ptr<FrameInfo>(new FrameInfo()));
+    }
+
+    mFrameRing.swap(ring);
+    mRingHead = 0;
+    AF_LOGI("frame ring grow to %d", (int) mFrameRing.size());
 }
 
 
@@ -136,10 +176,11 @@ int CacheFileRemuxer::muxThreadRun()
     bool hasError = false;
 
     while (true) {
+        FrameInfo *frameInfo = nullptr;
         {
             std::unique_lock<mutex> lock(mQueueMutex);
 
-            if (mFrameInfoQueue.empty()) {
+            if (mRingSize == 0) {
 
                 if (mFrameEof) {
                     AF_LOGW("muxThreadRun() mFrameEof...");
@@ -150,19 +191,27 @@ int CacheFileRemuxer::muxThreadRun()
                                          [this]() { return this->mInterrupt || this->mWantStop || this->mFrameEof; });
 
             } else {
-                unique_ptr<FrameInfo> &frameInfo = mFrameInfoQueue.front();
-                int ret = mMuxer->muxPacket(move(frameInfo->frame));
-                mFrameInfoQueue.pop_front();
-
-                if (ret < 0) {
-                    AF_LOGW("muxThreadRun() mMuxer error ret = %d ", ret);
-
-                    //no space error .
-                    if (ENOSPC == errno) {
-                        hasError = true;
-                        sendError(CACHE_ERROR_NO_SPACE);
-                        break;
-                    }
+                frameInfo = mFrameRing[mRingHead].get();
+            }
+        }
+
+        if (frameInfo != nullptr) {
+            // mux out of the lock, addFrame never touches the head slot
+            int ret = mMuxer->muxPacket(frameInfo->frame.get());
+            {
+                std::unique_lock<mutex> lock(mQueueMutex);
+                mRingHead = (mRingHead + 1) % mFrameRing.size();
+                mRingSize--;
+            }
+
+            if (ret < 0) {
+                AF_LOGW("muxThreadRun() mMuxer error ret = %d ", ret);
+
+                //no space error .
+                if (ENOSPC == errno) {
+                    hasError = true;
+                    sendError(CACHE_ERROR_NO_SPACE);
+                    break;
                 }
             }
         }
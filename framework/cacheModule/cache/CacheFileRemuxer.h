@@ -23,12 +23,15 @@
 
 using namespace std;
 
+// a slot of the frame ring, the packet is kept and refilled by the next frame put in the slot
 class FrameInfo {
 public:
     std::unique_ptr<IAFPacket> frame;
     StreamType type = ST_TYPE_UNKNOWN;
 };
 
+#define FRAME_RING_INIT_SIZE 256
+
 class CacheFileRemuxer {
 
 public:
@@ -58,6 +61,12 @@ private :
 
     void initMuxer();
 
+    // reference the data of frame in the slot, no allocation when the slot has a packet already
+    static void fillFrame(FrameInfo &info, const IAFPacket *frame);
+
+    // double the ring, called with mQueueMutex locked, the slots keep their addresses
+    void growRing();
+
     int muxThreadRun();
 
     static int64_t io_seek(void *opaque, int64_t offset, int whence);
@@ -71,7 +80,10 @@ private :
 private:
     string mDestFilePath;
     string mDescription;
-    deque<std::unique_ptr<FrameInfo>> mFrameInfoQueue;
+    // the frames from mRingHead to mRingHead + mRingSize are waiting for mux
+    vector<std::unique_ptr<FrameInfo>> mFrameRing;
+    size_t mRingHead = 0;
+    size_t mRingSize = 0;
     condition_variable mQueueCondition;
 
     std::atomic_bool mInterrupt{false};
@@ -0,0 +1,179 @@
+#define LOG_TAG "TimeShiftReader"
+
+#include "TimeShiftReader.h"
+#include <algorithm>
+#include <data_source/dataSourcePrototype.h>
+#include <utils/frame_work_log.h>
+
+using namespace std;
+
+namespace Cicada {
+    TimeShiftReader::TimeShiftReader(TimeShiftRecorder &recorder) : mRecorder(recorder)
+    {}
+
+    TimeShiftReader::~TimeShiftReader()
+    {
+        close();
+    }
+
+    void TimeShiftReader::open(int64_t pts)
+    {
+        close();
+        mStartPts = pts;
+        // set to the key frame found
+        mVideoStartPts = mAudioStartPts = INT64_MAX;
+        mAfterDts = false;
+    }
+
+    void TimeShiftReader::open(int64_t videoDts, int64_t audioDts)
+    {
+        close();
+
+        // the dts is at or before the pts, the chunk has the key frame before it has the packet as well
+        if (videoDts == INT64_MIN) {
+            mStartPts = audioDts;
+        } else if (audioDts == INT64_MIN) {
+            mStartPts = videoDts;
+        } else {
+            mStartPts = min(videoDts, audioDts);
+        }
+
+        // the b frames after the last packet in decoding order may have the smaller pts, so compare the dts
+        mVideoStartPts = videoDts == INT64_MIN ? INT64_MIN : videoDts + 1;
+        mAudioStartPts = audioDts == INT64_MIN ? INT64_MIN : audioDts + 1;
+        mAfterDts = true;
+    }
+
+    void TimeShiftReader::close()
+    {
+        closeChunk();
+        mChunkId = -1;
+    }
+
+    int TimeShiftReader::getNextChunk(TimeShiftRecorder::Chunk &chunk)
+    {
+        if (mChunkId >= 0) {
+            return mRecorder.nextChunk(mChunkId, chunk);
+        }
+
+        int64_t keyPts = INT64_MIN;
+        int ret = mRecorder.findChunk(mStartPts, chunk, keyPts);
+
+        if (ret == -ENOENT) {
+            // out of the window, from the oldest one
+            ret = mRecorder.nextChunk(-1, chunk);
+            keyPts = chunk.startPts;
+        }
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        if (mVideoStartPts == INT64_MAX) {
+            mVideoStartPts = mAudioStartPts = keyPts;
+        }
+
+        return 0;
+    }
+
+    int TimeShiftReader::openChunk(const TimeShiftRecorder::Chunk &chunk)
+    {
+        mChunkId = chunk.id;
+        mDataSource = dataSourcePrototype::create(chunk.path);
+
+        if (mDataSource == nullptr) {
+            return -ENOSYS;
+        }
+
+        int ret = mDataSource->Open(0);
+
+        if (ret < 0) {
+            AF_LOGE("open chunk %s error %d\n", chunk.path.c_str(), ret);
+            closeChunk();
+            return ret;
+        }
+
+        mDemuxer = unique_ptr<demuxer_service>(new demuxer_service(mDataSource));
+        ret = mDemuxer->initOpen();
+
+        if (ret < 0) {
+            AF_LOGE("demux chunk %s error %d\n", chunk.path.c_str(), ret);
+            closeChunk();
+            return ret;
+        }
+
+        int count = min(mDemuxer->GetNbStreams(), mRecorder.getStreamCount());
+
+        for (int i = 0; i < count; i++) {
+            mDemuxer->OpenStream(i);
+        }
+
+        return 0;
+    }
+
+    void TimeShiftReader::closeChunk()
+    {
+        if (mDemuxer) {
+            mDemuxer->close();
+            mDemuxer = nullptr;
+        }
+
+        delete mDataSource;
+        mDataSource = nullptr;
+    }
+
+    int TimeShiftReader::readPacket(unique_ptr<IAFPacket> &packet)
+    {
+        while (true) {
+            if (mDemuxer == nullptr) {
+                TimeShiftRecorder::Chunk chunk{};
+                int ret = getNextChunk(chunk);
+
+                if (ret < 0) {
+                    return ret;
+                }
+
+                // a removed or broken chunk is skipped
+                if (openChunk(chunk) < 0) {
+                    continue;
+                }
+            }
+
+            int ret = mDemuxer->readPacket(packet);
+
+            if (packet == nullptr) {
+                if (ret == 0) {
+                    closeChunk();
+                    continue;
+                }
+
+                return ret;
+            }
+
+            int i = packet->getInfo().streamIndex;
+
+            if (i < 0 || i >= mRecorder.getStreamCount()) {
+                packet = nullptr;
+                continue;
+            }
+
+            int64_t pts = packet->getInfo().pts;
+            int64_t time = mAfterDts && packet->getInfo().dts != INT64_MIN ? packet->getInfo().dts : pts;
+            int64_t startPts = mRecorder.getStreamType(i) == ST_TYPE_VIDEO ? mVideoStartPts : mAudioStartPts;
+
+            if (time != INT64_MIN && startPts != INT64_MIN && time < startPts) {
+                packet = nullptr;
+                continue;
+            }
+
+            packet->getInfo().streamIndex = mRecorder.getStreamIndex(i);
+            int64_t ptsOffset = mRecorder.getPtsOffset();
+
+            if (pts != INT64_MIN && ptsOffset != INT64_MIN) {
+                packet->getInfo().timePosition = pts - ptsOffset;
+            }
+
+            return ret;
+        }
+    }
+}// namespace Cicada
@@ -0,0 +1,56 @@
+#ifndef CICADA_PLAYER_TIMESHIFTREADER_H
+#define CICADA_PLAYER_TIMESHIFTREADER_H
+
+#include "TimeShiftRecorder.h"
+#include <data_source/IDataSource.h>
+#include <demuxer/demuxer_service.h>
+#include <memory>
+
+namespace Cicada {
+    /*
+     * Read the packets back from the chunks of a TimeShiftRecorder, chunk by chunk as a continuous stream.
+     *
+     * The packets have the stream indexes and the timestamps of the live stream recorded, the time
+     * positions are rebuilt from the pts offset of the recorder.
+     * Reaching the chunk in recording is -EAGAIN, the read goes on after the chunk is finished, and
+     * a reader fell out of the window goes on from the oldest chunk.
+     */
+    class TimeShiftReader {
+    public:
+        explicit TimeShiftReader(TimeShiftRecorder &recorder);
+
+        ~TimeShiftReader();
+
+        // play from the key frame at or before pts
+        void open(int64_t pts);
+
+        // play after the packets played already, the dts of the last video and audio packets, INT64_MIN if none
+        void open(int64_t videoDts, int64_t audioDts);
+
+        int readPacket(std::unique_ptr<IAFPacket> &packet);
+
+        void close();
+
+    private:
+        int openChunk(const TimeShiftRecorder::Chunk &chunk);
+
+        void closeChunk();
+
+        int getNextChunk(TimeShiftRecorder::Chunk &chunk);
+
+    private:
+        TimeShiftRecorder &mRecorder;
+        IDataSource *mDataSource{nullptr};
+        std::unique_ptr<demuxer_service> mDemuxer{};
+        int64_t mChunkId{-1};
+
+        // the chunk to start is found by mStartPts, then the packets before the start pts (dts if mAfterDts) are dropped
+        int64_t mStartPts{INT64_MIN};
+        int64_t mVideoStartPts{INT64_MIN};
+        int64_t mAudioStartPts{INT64_MIN};
+        bool mAfterDts{false};
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_TIMESHIFTREADER_H
@@ -0,0 +1,519 @@
+#define LOG_TAG "TimeShiftRecorder"
+
+#include "TimeShiftRecorder.h"
+#include <algorithm>
+#include <base/media/AVAFPacket.h>
+#include <cerrno>
+#include <muxer/IMuxerPrototype.h>
+#include <utils/file/FileUtils.h>
+#include <utils/frame_work_log.h>
+
+#define DEFAULT_CHUNK_DURATION (4 * 1000 * 1000)
+#define MAX_QUEUE_BYTES (8 * 1024 * 1024)
+
+using namespace std;
+
+namespace Cicada {
+    TimeShiftRecorder::TimeShiftRecorder(const string &dir, const string &description)
+        : mDir(dir), mDescription(description), mChunkDuration(DEFAULT_CHUNK_DURATION)
+    {}
+
+    TimeShiftRecorder::~TimeShiftRecorder()
+    {
+        stop();
+    }
+
+    void TimeShiftRecorder::setWindow(int64_t duration, int64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mChunkMutex);
+        mWindowDuration = duration;
+        mWindowBytes = bytes;
+    }
+
+    void TimeShiftRecorder::setChunkDuration(int64_t duration)
+    {
+        if (duration > 0) {
+            mChunkDuration = duration;
+        }
+    }
+
+    void TimeShiftRecorder::setStreamMetas(vector<unique_ptr<streamMeta>> metas)
+    {
+        mMetaHolder.clear();
+        mStreamMetas.clear();
+        mStreamIndexes.clear();
+        mStreamTypes.clear();
+        mHasVideo = false;
+
+        for (auto &item : metas) {
+            auto *meta = (Stream_meta *) (item.get());
+
+            if (meta->type == STREAM_TYPE_VIDEO) {
+                mStreamTypes.push_back(ST_TYPE_VIDEO);
+                mHasVideo = true;
+            } else if (meta->type == STREAM_TYPE_AUDIO) {
+                mStreamTypes.push_back(ST_TYPE_AUDIO);
+            } else {
+                continue;
+            }
+
+            mStreamIndexes.push_back(meta->index);
+            // the packets are muxed by the order of the stream in chunks
+            meta->index = static_cast<int>(mStreamMetas.size());
+            mStreamMetas.push_back(meta);
+            mMetaHolder.push_back(move(item));
+        }
+    }
+
+    void TimeShiftRecorder::switchStream(unique_ptr<streamMeta> meta)
+    {
+        auto *info = (Stream_meta *) (meta.get());
+
+        if (info->type != STREAM_TYPE_VIDEO && info->type != STREAM_TYPE_AUDIO) {
+            return;
+        }
+
+        StreamType type = info->type == STREAM_TYPE_VIDEO ? ST_TYPE_VIDEO : ST_TYPE_AUDIO;
+        int i = streamOfType(type);
+
+        if (i < 0) {
+            return;
+        }
+
+        AF_LOGI("switch %s stream %d to %d\n", type == ST_TYPE_VIDEO ? "video" : "audio", mStreamIndexes[i], info->index);
+        mStreamIndexes[i] = info->index;
+        info->index = i;
+
+        if (mStopped) {
+            mStreamMetas[i] = info;
+            mMetaHolder[i] = move(meta);
+            return;
+        }
+
+        // in order with the frames, the frames of the old stream are muxed with the old meta
+        Frame item{};
+        item.type = type;
+        item.meta = move(meta);
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        mFrameQueue.push_back(move(item));
+        mQueueCondition.notify_one();
+    }
+
+    int TimeShiftRecorder::streamOfType(StreamType type) const
+    {
+        auto it = find(mStreamTypes.begin(), mStreamTypes.end(), type);
+        return it == mStreamTypes.end() ? -1 : static_cast<int>(it - mStreamTypes.begin());
+    }
+
+    int TimeShiftRecorder::start()
+    {
+        if (mStreamMetas.empty()) {
+            return -EINVAL;
+        }
+
+        if (FileUtils::isDirExist(mDir.c_str()) != FILE_TRUE && FileUtils::mkdirs(mDir.c_str()) != FILE_TRUE) {
+            AF_LOGE("can't create time shift dir %s\n", mDir.c_str());
+            return -EACCES;
+        }
+
+        stop();
+        mStopped = false;
+        mError = false;
+        mWriteError = 0;
+        mMuxThread = NEW_AF_THREAD(muxThreadRun);
+        mMuxThread->start();
+        return 0;
+    }
+
+    void TimeShiftRecorder::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            mStopped = true;
+            mQueueCondition.notify_one();
+        }
+
+        if (mMuxThread) {
+            mMuxThread->stop();
+            delete mMuxThread;
+            mMuxThread = nullptr;
+        }
+
+        closeChunk();
+        {
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            clearQueue();
+        }
+        std::lock_guard<std::mutex> lock(mChunkMutex);
+
+        for (auto &chunk : mChunks) {
+            FileUtils::rmrf(chunk.path.c_str());
+        }
+
+        mChunks.clear();
+        mPtsOffset = INT64_MIN;
+    }
+
+    void TimeShiftRecorder::addFrame(const IAFPacket *frame, StreamType type)
+    {
+        if (frame == nullptr || mStopped || mError) {
+            return;
+        }
+
+        int i = streamOfType(type);
+
+        if (i < 0) {
+            return;
+        }
+
+        std::unique_ptr<IAFPacket> packet = frame->clone();
+
+        if (packet->getInfo().streamIndex != mStreamIndexes[i]) {
+            return;
+        }
+
+        // the muxer takes the stream of the AVPacket
+        packet->getInfo().streamIndex = i;
+        AVPacket *pkt = getAVPacket(packet.get());
+
+        if (pkt) {
+            pkt->stream_index = i;
+        }
+
+        if (mPtsOffset == INT64_MIN && packet->getInfo().pts != INT64_MIN && packet->getInfo().timePosition >= 0) {
+            mPtsOffset = packet->getInfo().pts - packet->getInfo().timePosition;
+        }
+
+        int64_t size = packet->getSize();
+        bool chunkStart = (type == ST_TYPE_VIDEO && (packet->getInfo().flags & AF_PKT_FLAG_KEY)) || !mHasVideo;
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+
+        if (mQueueBytes + size > MAX_QUEUE_BYTES) {
+            if (!mDropping) {
+                AF_LOGW("time shift can't keep up, drop to the next key frame\n");
+                mDropping = true;
+            }
+
+            return;
+        }
+
+        Frame item{};
+
+        if (mDropping) {
+            // the chunk has a gap, the frames after it are in a new chunk from a key frame
+            if (!chunkStart) {
+                return;
+            }
+
+            mDropping = false;
+            item.restart = true;
+        }
+
+        item.packet = move(packet);
+        item.type = type;
+        mQueueBytes += size;
+        mFrameQueue.push_back(move(item));
+        mQueueCondition.notify_one();
+    }
+
+    int TimeShiftRecorder::muxThreadRun()
+    {
+        Frame frame{};
+        {
+            std::unique_lock<std::mutex> lock(mQueueMutex);
+            mQueueCondition.wait_for(lock, std::chrono::milliseconds(10), [this]() { return mStopped || !mFrameQueue.empty(); });
+
+            if (mStopped) {
+                return -1;
+            }
+
+            if (mFrameQueue.empty()) {
+                return 0;
+            }
+
+            frame = move(mFrameQueue.front());
+            mFrameQueue.pop_front();
+
+            if (frame.packet) {
+                mQueueBytes -= frame.packet->getSize();
+            }
+        }
+
+        if (frame.meta) {
+            // wait for a key frame to start the chunk with the new stream
+            closeChunk();
+            int i = ((Stream_meta *) (frame.meta.get()))->index;
+            mStreamMetas[i] = (Stream_meta *) (frame.meta.get());
+            mMetaHolder[i] = move(frame.meta);
+            return 0;
+        }
+
+        if (frame.restart) {
+            closeChunk();
+        }
+
+        if (muxFrame(frame) < 0) {
+            mError = true;
+            closeChunk();
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            clearQueue();
+            return -1;
+        }
+
+        return 0;
+    }
+
+    void TimeShiftRecorder::clearQueue()
+    {
+        mFrameQueue.clear();
+        mQueueBytes = 0;
+        mDropping = false;
+    }
+
+    int TimeShiftRecorder::muxFrame(Frame &frame)
+    {
+        // the muxer rescales the timestamps in packet
+        int64_t pts = frame.packet->getInfo().pts;
+        int64_t duration = frame.packet->getInfo().duration;
+        bool key = (frame.packet->getInfo().flags & AF_PKT_FLAG_KEY) && frame.type == ST_TYPE_VIDEO;
+
+        if (pts == INT64_MIN) {
+            pts = frame.packet->getInfo().dts;
+        }
+
+        bool chunkStart = key || (!mHasVideo && pts != INT64_MIN);
+
+        if (chunkStart) {
+            int64_t startPts = INT64_MIN;
+
+            if (mMuxer) {
+                std::lock_guard<std::mutex> lock(mChunkMutex);
+                startPts = mChunks.back().startPts;
+            }
+
+            if (mMuxer == nullptr || pts - startPts >= mChunkDuration) {
+                closeChunk();
+                int ret = openChunk(pts);
+
+                if (ret < 0) {
+                    return ret;
+                }
+            }
+        }
+
+        // wait for a key frame to start
+        if (mMuxer == nullptr) {
+            return 0;
+        }
+
+        int ret = mMuxer->muxPacket(frame.packet.get());
+
+        // the muxer buffers the writes, a write error may be returned by a later packet or not at all
+        if (ret == -ENOSPC || mWriteError == -ENOSPC) {
+            AF_LOGE("no space for time shift, stop recording\n");
+            return -ENOSPC;
+        }
+
+        if (ret < 0) {
+            AF_LOGW("mux packet error %d\n", ret);
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> lock(mChunkMutex);
+        Chunk &chunk = mChunks.back();
+
+        if (pts != INT64_MIN) {
+            chunk.endPts = max(chunk.endPts, pts + max(duration, (int64_t) 0));
+        }
+
+        if (key) {
+            chunk.keyPts.push_back(pts);
+        }
+
+        return 0;
+    }
+
+    int TimeShiftRecorder::openChunk(int64_t pts)
+    {
+        Chunk chunk{};
+        chunk.id = mNextChunkId++;
+        chunk.path = mDir + "/timeshift_" + to_string(chunk.id) + ".ts";
+        chunk.startPts = pts;
+        chunk.endPts = pts;
+        FileUtils::rmrf(chunk.path.c_str());
+
+        mMuxer.reset(IMuxerPrototype::create(chunk.path, "mpegts", mDescription));
+
+        if (mMuxer == nullptr) {
+            return -ENOSYS;
+        }
+
+        mFileCntl = unique_ptr<FileCntl>(new FileCntl(chunk.path));
+        mChunkBytes = 0;
+        // the chunks are read back with the live timestamps
+        mMuxer->setCopyPts(true);
+        mMuxer->setOpenFunc([this]() -> void { mFileCntl->openFile(); });
+        mMuxer->setCloseFunc([this]() -> void { mFileCntl->closeFile(); });
+        mMuxer->setWritePacketCallback(io_write, this);
+        mMuxer->setWriteDataTypeCallback(io_write_data_type, this);
+        mMuxer->setSeekCallback(io_seek, this);
+        mMuxer->setStreamMetas(&mStreamMetas);
+        {
+            std::lock_guard<std::mutex> lock(mChunkMutex);
+            mChunks.push_back(chunk);
+        }
+        int ret = mMuxer->open();
+
+        if (ret < 0) {
+            AF_LOGE("open chunk %s error %d\n", chunk.path.c_str(), ret);
+            mMuxer.reset();
+            mFileCntl.reset();
+            std::lock_guard<std::mutex> lock(mChunkMutex);
+            mChunks.pop_back();
+            FileUtils::rmrf(chunk.path.c_str());
+            return ret;
+        }
+
+        return 0;
+    }
+
+    void TimeShiftRecorder::closeChunk()
+    {
+        if (mMuxer == nullptr) {
+            return;
+        }
+
+        mMuxer->close();
+        mMuxer.reset();
+        mFileCntl.reset();
+        std::lock_guard<std::mutex> lock(mChunkMutex);
+        Chunk &chunk = mChunks.back();
+        chunk.bytes = mChunkBytes;
+        chunk.finished = true;
+        AF_LOGD("chunk %lld finished, %lld bytes, %lld us\n", (long long) chunk.id, (long long) chunk.bytes,
+                (long long) (chunk.endPts - chunk.startPts));
+        trimChunks();
+    }
+
+    void TimeShiftRecorder::trimChunks()
+    {
+        // the chunk just finished is kept always
+        while (mChunks.size() > 1) {
+            int64_t bytes = 0;
+
+            for (auto &chunk : mChunks) {
+                bytes += chunk.bytes;
+            }
+
+            bool overDuration = mWindowDuration > 0 && mChunks.back().endPts - mChunks.front().startPts > mWindowDuration;
+            bool overBytes = mWindowBytes > 0 && bytes > mWindowBytes;
+
+            if (!overDuration && !overBytes) {
+                break;
+            }
+
+            // a reader has the file opened can read it to the end
+            FileUtils::rmrf(mChunks.front().path.c_str());
+            mChunks.pop_front();
+        }
+    }
+
+    bool TimeShiftRecorder::getRange(int64_t &startPts, int64_t &endPts)
+    {
+        std::lock_guard<std::mutex> lock(mChunkMutex);
+        startPts = endPts = INT64_MIN;
+
+        for (auto &chunk : mChunks) {
+            if (!chunk.finished) {
+                break;
+            }
+
+            if (startPts == INT64_MIN) {
+                startPts = chunk.startPts;
+            }
+
+            endPts = chunk.endPts;
+        }
+
+        return startPts != INT64_MIN;
+    }
+
+    int TimeShiftRecorder::findChunk(int64_t pts, Chunk &chunk, int64_t &keyPts)
+    {
+        std::lock_guard<std::mutex> lock(mChunkMutex);
+
+        if (mChunks.empty() || pts < mChunks.front().startPts) {
+            return -ENOENT;
+        }
+
+        for (auto it = mChunks.rbegin(); it != mChunks.rend(); ++it) {
+            if (it->startPts > pts) {
+                continue;
+            }
+
+            if (!it->finished) {
+                return -EAGAIN;
+            }
+
+            chunk = *it;
+            keyPts = chunk.startPts;
+
+            for (int64_t key : chunk.keyPts) {
+                if (key > pts) {
+                    break;
+                }
+
+                keyPts = key;
+            }
+
+            return 0;
+        }
+
+        return -ENOENT;
+    }
+
+    int TimeShiftRecorder::nextChunk(int64_t id, Chunk &chunk)
+    {
+        std::lock_guard<std::mutex> lock(mChunkMutex);
+
+        for (auto &item : mChunks) {
+            if (item.id <= id) {
+                continue;
+            }
+
+            if (!item.finished) {
+                return -EAGAIN;
+            }
+
+            chunk = item;
+            return 0;
+        }
+
+        return -EAGAIN;
+    }
+
+    int TimeShiftRecorder::io_write(void *opaque, uint8_t *buf, int size)
+    {
+        auto *recorder = static_cast<TimeShiftRecorder *>(opaque);
+        int ret = recorder->mFileCntl->writeFile(buf, size);
+
+        if (ret < 0) {
+            recorder->mWriteError = -errno;
+            return recorder->mWriteError;
+        }
+
+        recorder->mChunkBytes += ret;
+        return ret;
+    }
+
+    int TimeShiftRecorder::io_write_data_type(void *opaque, uint8_t *buf, int size, IMuxer::DataType type, int64_t time)
+    {
+        return io_write(opaque, buf, size);
+    }
+
+    int64_t TimeShiftRecorder::io_seek(void *opaque, int64_t offset, int whence)
+    {
+        auto *recorder = static_cast<TimeShiftRecorder *>(opaque);
+        return recorder->mFileCntl->seekFile(offset, whence);
+    }
+}// namespace Cicada
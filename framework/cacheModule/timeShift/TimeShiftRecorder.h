@@ -0,0 +1,184 @@
+#ifndef CICADA_PLAYER_TIMESHIFTRECORDER_H
+#define CICADA_PLAYER_TIMESHIFTRECORDER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <base/media/IAFPacket.h>
+#include <native_cicada_player_def.h>
+#include <muxer/IMuxer.h>
+#include <utils/afThread.h>
+#include <utils/file/FileCntl.h>
+#include <utils/mediaTypeInternal.h>
+
+namespace Cicada {
+    /*
+     * Record a live stream to a ring of mpegts chunks on disk, for playing back the last minutes of it
+     * by TimeShiftReader.
+     *
+     * The packets are muxed by IMuxer in a thread, a new chunk is started at the first video key frame
+     * after the chunk duration (any packet for the audio only streams), so every chunk starts with a key
+     * frame and can be played alone. The pts of the key frames in the chunks are kept as the seek index.
+     *
+     * The oldest chunks are removed once the chunks are longer than the window duration or bigger than
+     * the window bytes, the disk and the memory used don't grow with the recording time.
+     *
+     * The chunk in recording is not given to the readers, the time shifted play is behind the live edge
+     * by a chunk duration at least.
+     *
+     * The streams in chunks are kept by type, a track or bitrate switch of the live stream goes on in a
+     * new chunk with the new stream meta. The frames queued to mux are bounded by bytes, the frames are
+     * dropped to the next key frame when the disk can't keep up, and a new chunk is started there.
+     */
+    class TimeShiftRecorder {
+    public:
+        struct Chunk {
+            int64_t id{-1};
+            std::string path{};
+            int64_t startPts{INT64_MIN};
+            int64_t endPts{INT64_MIN};
+            int64_t bytes{0};
+            bool finished{false};
+            // the key frames in the chunk, the first one starts the chunk
+            std::vector<int64_t> keyPts{};
+        };
+
+    public:
+        TimeShiftRecorder(const std::string &dir, const std::string &description);
+
+        ~TimeShiftRecorder();
+
+        // us and bytes, the oldest chunk is removed when over any of them, <= 0 for no limit
+        void setWindow(int64_t duration, int64_t bytes);
+
+        // us
+        void setChunkDuration(int64_t duration);
+
+        // the streams recorded, the meta index is the stream index of the packets, in the order of the streams in chunks
+        void setStreamMetas(std::vector<std::unique_ptr<streamMeta>> metas);
+
+        // the stream of the same type is switched to the meta, from the next key frame in a new chunk
+        void switchStream(std::unique_ptr<streamMeta> meta);
+
+        bool hasStreamIndex(int index) const
+        {
+            return std::find(mStreamIndexes.begin(), mStreamIndexes.end(), index) != mStreamIndexes.end();
+        }
+
+        int start();
+
+        // stop recording and remove the chunks
+        void stop();
+
+        void addFrame(const IAFPacket *frame, StreamType type);
+
+        // the pts can be played from the finished chunks, false if none
+        bool getRange(int64_t &startPts, int64_t &endPts);
+
+        /*
+         * the finished chunk has the last key frame at or before pts, keyPts is the key frame.
+         * -EAGAIN if pts is after the finished chunks, -ENOENT if it's before the window
+         */
+        int findChunk(int64_t pts, Chunk &chunk, int64_t &keyPts);
+
+        // the first finished chunk after the chunk id, -EAGAIN if it's in recording
+        int nextChunk(int64_t id, Chunk &chunk);
+
+        // pts - timePosition of the packets recorded, INT64_MIN before the first packet
+        int64_t getPtsOffset() const
+        {
+            return mPtsOffset;
+        }
+
+        int getStreamCount() const
+        {
+            return static_cast<int>(mStreamIndexes.size());
+        }
+
+        // the stream index of packets and the type of the ith stream in chunks
+        int getStreamIndex(int i) const
+        {
+            return mStreamIndexes[i];
+        }
+
+        StreamType getStreamType(int i) const
+        {
+            return mStreamTypes[i];
+        }
+
+    private:
+        struct Frame {
+            std::unique_ptr<IAFPacket> packet;
+            StreamType type;
+            // start a new chunk from it, after the frames dropped
+            bool restart{false};
+            // no packet, switch the stream of the type to it
+            std::unique_ptr<streamMeta> meta{};
+        };
+
+        int muxThreadRun();
+
+        int muxFrame(Frame &frame);
+
+        // called with mQueueMutex locked
+        void clearQueue();
+
+        int openChunk(int64_t pts);
+
+        int streamOfType(StreamType type) const;
+
+        void closeChunk();
+
+        // remove the oldest chunks out of the window, called with mChunkMutex locked
+        void trimChunks();
+
+        static int io_write(void *opaque, uint8_t *buf, int size);
+
+        static int io_write_data_type(void *opaque, uint8_t *buf, int size, IMuxer::DataType type, int64_t time);
+
+        static int64_t io_seek(void *opaque, int64_t offset, int whence);
+
+    private:
+        std::string mDir;
+        std::string mDescription;
+        int64_t mWindowDuration{0};
+        int64_t mWindowBytes{0};
+        int64_t mChunkDuration;
+
+        std::vector<std::unique_ptr<streamMeta>> mMetaHolder{};
+        std::vector<Stream_meta *> mStreamMetas{};
+        std::vector<int> mStreamIndexes{};
+        std::vector<StreamType> mStreamTypes{};
+        bool mHasVideo{false};
+        std::atomic<int64_t> mPtsOffset{INT64_MIN};
+
+        std::mutex mQueueMutex;
+        std::condition_variable mQueueCondition;
+        std::deque<Frame> mFrameQueue{};
+        int64_t mQueueBytes{0};
+        bool mDropping{false};
+
+        afThread *mMuxThread{nullptr};
+        std::atomic_bool mStopped{true};
+        std::atomic_bool mError{false};
+
+        // used in the mux thread only
+        std::unique_ptr<IMuxer> mMuxer{};
+        std::unique_ptr<FileCntl> mFileCntl{};
+        int64_t mChunkBytes{0};
+        int mWriteError{0};
+
+        std::mutex mChunkMutex;
+        std::deque<Chunk> mChunks{};
+        int64_t mNextChunkId{0};
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_TIMESHIFTRECORDER_H
@@ -70,6 +70,16 @@ protected:
 
     void enqueueError(int ret, int64_t pts);
 
+    // the frames decoded and not taken by getFrame at most
+    int getMaxOutputFrames() const
+    {
+#if AF_HAVE_PTHREAD
+        return maxOutQueueSize;
+#else
+        return 1;
+#endif
+    }
+
 #if AF_HAVE_PTHREAD
 
     int decode_func();
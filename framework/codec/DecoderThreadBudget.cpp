@@ -0,0 +1,119 @@
+#define LOG_TAG "DecoderThreadBudget"
+
+#include "DecoderThreadBudget.h"
+#include <algorithm>
+#include <utils/AFUtils.h>
+#include <utils/frame_work_log.h>
+
+// 720p 25fps, for the streams without the size or fps in meta
+#define DEFAULT_PIXELS (1280 * 720)
+#define DEFAULT_FPS 25
+
+namespace Cicada {
+    DecoderThreadBudget DecoderThreadBudget::sInstance{};
+
+    DecoderThreadBudget *DecoderThreadBudget::Instance()
+    {
+        return &sInstance;
+    }
+
+    void DecoderThreadBudget::setMaxThreads(int count)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mMaxThreads = count;
+    }
+
+    void DecoderThreadBudget::setEnable(bool enable)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEnable = enable;
+    }
+
+    int DecoderThreadBudget::getCores() const
+    {
+        if (mMaxThreads > 0) {
+            return mMaxThreads;
+        }
+
+        return std::max(AFGetCpuCount(), 1);
+    }
+
+    int DecoderThreadBudget::getShare(const Entry &entry) const
+    {
+        if (!mEnable) {
+            return std::max(AFGetCpuCount(), 1) + 1;
+        }
+
+        if (entry.background) {
+            return 1;
+        }
+
+        int64_t totalWeight = 0;
+        int foregroundCount = 0;
+
+        for (const auto &item : mDecoders) {
+            if (!item.second.background) {
+                totalWeight += item.second.weight;
+                foregroundCount++;
+            }
+        }
+
+        int cores = getCores();
+
+        // alone, keep the ffmpeg default, one more thread than cores to hide the io wait
+        if (foregroundCount <= 1 || totalWeight <= 0) {
+            return cores + 1;
+        }
+
+        auto share = static_cast<int>((cores * entry.weight + totalWeight / 2) / totalWeight);
+        return std::min(std::max(share, 1), cores + 1);
+    }
+
+    int DecoderThreadBudget::acquire(const void *decoder, int width, int height, double fps)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Entry entry{};
+        entry.weight = width > 0 && height > 0 ? (int64_t) width * height : DEFAULT_PIXELS;
+        entry.weight *= fps > 1 ? static_cast<int64_t>(fps + 0.5) : DEFAULT_FPS;
+        entry.background = false;
+        mDecoders[decoder] = entry;
+        int share = getShare(entry);
+        AF_LOGI("decoder %p %dx%d@%.2f acquire %d threads, %d decoders", decoder, width, height, fps, share,
+                (int) mDecoders.size());
+        return share;
+    }
+
+    void DecoderThreadBudget::release(const void *decoder)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDecoders.erase(decoder);
+    }
+
+    void DecoderThreadBudget::setBackground(const void *decoder, bool background)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto item = mDecoders.find(decoder);
+
+        if (item != mDecoders.end()) {
+            item->second.background = background;
+        }
+    }
+
+    int DecoderThreadBudget::getThreadCount(const void *decoder)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto item = mDecoders.find(decoder);
+
+        if (item == mDecoders.end()) {
+            return 0;
+        }
+
+        return getShare(item->second);
+    }
+
+    int DecoderThreadBudget::getDecoderCount()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return static_cast<int>(mDecoders.size());
+    }
+}// namespace Cicada
@@ -0,0 +1,68 @@
+#ifndef CICADA_PLAYER_DECODERTHREADBUDGET_H
+#define CICADA_PLAYER_DECODERTHREADBUDGET_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace Cicada {
+    /*
+     * Process wide thread budget of the software video decoders.
+     *
+     * Each decoder opened alone gets cpu count + 1 threads as before, when several players decode
+     * at the same time (picture in picture, feed previews, multi view), the cores are shared by
+     * the weight of the decoders, width * height * fps, a decoder in background only keeps one
+     * thread and doesn't take part in the share.
+     *
+     * The ffmpeg thread count can't be changed after the codec opened, a decoder picks up the
+     * share on open, and if its share changed much, on flush or at the next key frame by draining
+     * and reopening the codec.
+     */
+    class DecoderThreadBudget {
+    public:
+        static DecoderThreadBudget *Instance();
+
+        // the threads shared by all the decoders, <= 0 to use the cpu count
+        void setMaxThreads(int count);
+
+        // disabled, each decoder gets cpu count + 1 threads as without the budget
+        void setEnable(bool enable);
+
+        // register a decoder, return the thread count it should use
+        int acquire(const void *decoder, int width, int height, double fps);
+
+        void release(const void *decoder);
+
+        void setBackground(const void *decoder, bool background);
+
+        // the current share of the decoder, 0 if not registered
+        int getThreadCount(const void *decoder);
+
+        int getDecoderCount();
+
+    private:
+        struct Entry {
+            int64_t weight;
+            bool background;
+        };
+
+    private:
+        DecoderThreadBudget() = default;
+
+        ~DecoderThreadBudget() = default;
+
+        int getShare(const Entry &entry) const;
+
+        int getCores() const;
+
+    private:
+        static DecoderThreadBudget sInstance;
+        std::mutex mMutex;
+        std::map<const void *, Entry> mDecoders;
+        int mMaxThreads{0};
+        bool mEnable{true};
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_DECODERTHREADBUDGET_H
@@ -0,0 +1,345 @@
+#define LOG_TAG "FrameBufferPool"
+
+#include "FrameBufferPool.h"
+#include <algorithm>
+#include <utils/frame_work_log.h>
+#include <utils/timer.h>
+#include <vector>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+// the references of a codec not telling them, the dpb of hevc
+#define MAX_CODEC_REFERENCES 16
+// the free buffers not used longer are freed
+#define BUFFER_IDLE_TIME (2 * 1000 * 1000)
+
+namespace Cicada {
+    std::atomic<int64_t> FrameBufferPool::sTotalBytes{0};
+    std::atomic<int64_t> FrameBufferPool::sTotalPeakBytes{0};
+
+    // the buffers of a frame layout, deleted with the last buffer after detached from the pool
+    struct FrameBufferPool::Planes {
+        int format;
+        int width;
+        int height;
+        int lineSize[4];
+        int offset[4];
+        int size;
+
+        std::mutex mutex;
+        // the buffers and the times they were released, the last released at the back
+        std::vector<std::pair<uint8_t *, int64_t>> freeBuffers;
+        int allocated{0};
+        bool attached{true};
+    };
+
+    static void updatePeak(std::atomic<int64_t> &peak, int64_t value)
+    {
+        int64_t old = peak.load();
+
+        while (value > old && !peak.compare_exchange_weak(old, value)) {
+        }
+    }
+
+    FrameBufferPool::FrameBufferPool(int align) : mAlign(align)
+    {}
+
+    FrameBufferPool::~FrameBufferPool()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        releasePlanes();
+    }
+
+    void FrameBufferPool::setOutputFrames(int frames)
+    {
+        mOutputFrames = frames;
+    }
+
+    void FrameBufferPool::trim()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (mPlanes) {
+            trimPlanes(mPlanes, 0);
+        }
+    }
+
+    void FrameBufferPool::attach(AVCodecContext *ctx)
+    {
+        if (ctx->codec == nullptr || !(ctx->codec->capabilities & AV_CODEC_CAP_DR1)) {
+            return;
+        }
+
+        ctx->opaque = this;
+        ctx->get_buffer2 = getBuffer2;
+#if FF_API_THREAD_SAFE_CALLBACKS
+        // get_buffer2 is called by the frame threads at the same time, it's locked
+        ctx->thread_safe_callbacks = 1;
+#endif
+    }
+
+    FrameBufferPool::Stats FrameBufferPool::getStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Stats stats{};
+        stats.bytes = mBytes;
+        stats.peakBytes = mPeakBytes;
+        stats.overflowFrames = mOverflowFrames;
+
+        if (mPlanes) {
+            std::lock_guard<std::mutex> planesLock(mPlanes->mutex);
+            stats.frames = mPlanes->allocated;
+        }
+
+        return stats;
+    }
+
+    int64_t FrameBufferPool::getTotalBytes()
+    {
+        return sTotalBytes.load();
+    }
+
+    int64_t FrameBufferPool::getTotalPeakBytes()
+    {
+        return sTotalPeakBytes.load();
+    }
+
+    int FrameBufferPool::getBuffer2(AVCodecContext *ctx, AVFrame *frame, int flags)
+    {
+        auto *pool = static_cast<FrameBufferPool *>(ctx->opaque);
+
+        if (pool == nullptr || ctx->hw_frames_ctx || ctx->codec_type != AVMEDIA_TYPE_VIDEO) {
+            return avcodec_default_get_buffer2(ctx, frame, flags);
+        }
+
+        return pool->getBuffer(ctx, frame, flags);
+    }
+
+    int FrameBufferPool::getBuffer(AVCodecContext *ctx, AVFrame *frame, int flags)
+    {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+
+        if (desc == nullptr || (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+            return avcodec_default_get_buffer2(ctx, frame, flags);
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if (mPlanes == nullptr || mPlanes->format != frame->format || mPlanes->width != frame->width || mPlanes->height != frame->height) {
+            releasePlanes();
+
+            if (updatePlanes(ctx, frame) < 0) {
+                lock.unlock();
+                return avcodec_default_get_buffer2(ctx, frame, flags);
+            }
+        }
+
+        Planes *planes = mPlanes;
+        int capacity = getCapacity(ctx);
+        uint8_t *data = takeBuffer(planes, capacity);
+
+        if (data == nullptr) {
+            // held out of the counted queues, by a snapshot or a frame callback, never fail the decoding for it
+            mOverflowFrames++;
+            lock.unlock();
+            return avcodec_default_get_buffer2(ctx, frame, flags);
+        }
+
+        trimPlanes(planes, BUFFER_IDLE_TIME);
+        frame->buf[0] = av_buffer_create(data, planes->size, releaseBuffer, planes, 0);
+
+        if (frame->buf[0] == nullptr) {
+            std::lock_guard<std::mutex> planesLock(planes->mutex);
+            planes->freeBuffers.emplace_back(data, af_gettime_relative());
+            return AVERROR(ENOMEM);
+        }
+
+        for (int i = 0; i < 4; i++) {
+            frame->data[i] = planes->lineSize[i] ? data + planes->offset[i] : nullptr;
+            frame->linesize[i] = planes->lineSize[i];
+        }
+
+        frame->extended_data = frame->data;
+        return 0;
+    }
+
+    int FrameBufferPool::getCapacity(AVCodecContext *ctx) const
+    {
+        int references;
+
+        switch (ctx->codec_id) {
+            case AV_CODEC_ID_H264:
+                // of the sps
+                references = std::max(ctx->refs, 1);
+                break;
+
+            case AV_CODEC_ID_VP8:
+                references = 3;
+                break;
+
+            case AV_CODEC_ID_VP9:
+            case AV_CODEC_ID_AV1:
+                references = 8;
+                break;
+
+            default:
+                references = MAX_CODEC_REFERENCES;
+                break;
+        }
+
+        // the reordered ones and the one being decoded
+        int frames = references + ctx->has_b_frames + 1;
+
+        if (ctx->active_thread_type & FF_THREAD_FRAME) {
+            // a frame thread holds a frame more
+            frames += ctx->thread_count;
+        }
+
+        return frames + mOutputFrames;
+    }
+
+    uint8_t *FrameBufferPool::takeBuffer(Planes *planes, int capacity)
+    {
+        std::lock_guard<std::mutex> planesLock(planes->mutex);
+        uint8_t *data = nullptr;
+
+        if (!planes->freeBuffers.empty()) {
+            data = planes->freeBuffers.back().first;
+            planes->freeBuffers.pop_back();
+        } else if (planes->allocated < capacity) {
+            data = static_cast<uint8_t *>(av_malloc(planes->size));
+
+            if (data) {
+                planes->allocated++;
+                mBytes += planes->size;
+                mPeakBytes = std::max(mPeakBytes, mBytes);
+                updatePeak(sTotalPeakBytes, sTotalBytes += planes->size);
+            }
+        }
+
+        return data;
+    }
+
+    void FrameBufferPool::trimPlanes(Planes *planes, int64_t idleTime)
+    {
+        std::lock_guard<std::mutex> planesLock(planes->mutex);
+        int64_t now = af_gettime_relative();
+        auto end = planes->freeBuffers.begin();
+
+        // the first released is the longest idle
+        while (end != planes->freeBuffers.end() && now - end->second >= idleTime) {
+            av_free(end->first);
+            ++end;
+        }
+
+        auto count = static_cast<int>(end - planes->freeBuffers.begin());
+
+        if (count == 0) {
+            return;
+        }
+
+        planes->freeBuffers.erase(planes->freeBuffers.begin(), end);
+        planes->allocated -= count;
+        mBytes -= static_cast<int64_t>(count) * planes->size;
+        sTotalBytes -= static_cast<int64_t>(count) * planes->size;
+    }
+
+    int FrameBufferPool::updatePlanes(AVCodecContext *ctx, AVFrame *frame)
+    {
+        auto format = static_cast<AVPixelFormat>(frame->format);
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+        int width = frame->width;
+        int height = frame->height;
+        int lineSizeAlign[AV_NUM_DATA_POINTERS];
+        // the padding the codec needs around the picture
+        avcodec_align_dimensions2(ctx, &width, &height, lineSizeAlign);
+        int lineSize[4] = {0};
+        int ret = av_image_fill_linesizes(lineSize, format, FFALIGN(width, mAlign));
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        auto *planes = new Planes();
+        planes->format = frame->format;
+        planes->width = frame->width;
+        planes->height = frame->height;
+        int64_t size = 0;
+
+        for (int i = 0; i < 4; i++) {
+            planes->lineSize[i] = FFALIGN(lineSize[i], mAlign);
+            planes->offset[i] = static_cast<int>(size);
+            int shift = (i == 1 || i == 2) ? desc->log2_chroma_h : 0;
+            size += FFALIGN(static_cast<int64_t>(planes->lineSize[i]) * AV_CEIL_RSHIFT(height, shift), mAlign);
+        }
+
+        // simd reads over the end of the last line
+        size += 16 + mAlign;
+
+        if (size > INT32_MAX) {
+            delete planes;
+            return AVERROR(EINVAL);
+        }
+
+        planes->size = static_cast<int>(size);
+        mPlanes = planes;
+        AF_LOGI("frame pool %s %dx%d, %d bytes a frame, capacity %d\n", av_get_pix_fmt_name(format), frame->width, frame->height,
+                planes->size, getCapacity(ctx));
+        return 0;
+    }
+
+    void FrameBufferPool::releasePlanes()
+    {
+        if (mPlanes == nullptr) {
+            return;
+        }
+
+        Planes *planes = mPlanes;
+        mPlanes = nullptr;
+        bool remove;
+        {
+            std::lock_guard<std::mutex> lock(planes->mutex);
+            planes->attached = false;
+
+            for (auto &item : planes->freeBuffers) {
+                av_free(item.first);
+            }
+
+            sTotalBytes -= static_cast<int64_t>(planes->freeBuffers.size()) * planes->size;
+            planes->allocated -= static_cast<int>(planes->freeBuffers.size());
+            planes->freeBuffers.clear();
+            // the buffers in frames are not counted in the pool any more
+            mBytes = 0;
+            remove = planes->allocated == 0;
+        }
+
+        if (remove) {
+            delete planes;
+        }
+    }
+
+    void FrameBufferPool::releaseBuffer(void *opaque, uint8_t *data)
+    {
+        auto *planes = static_cast<Planes *>(opaque);
+        bool remove;
+        {
+            std::lock_guard<std::mutex> lock(planes->mutex);
+
+            if (planes->attached) {
+                planes->freeBuffers.emplace_back(data, af_gettime_relative());
+                return;
+            }
+
+            av_free(data);
+            sTotalBytes -= planes->size;
+            remove = --planes->allocated == 0;
+        }
+
+        if (remove) {
+            delete planes;
+        }
+    }
+}// namespace Cicada
@@ -0,0 +1,95 @@
+#ifndef CICADA_PLAYER_FRAMEBUFFERPOOL_H
+#define CICADA_PLAYER_FRAMEBUFFERPOOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace Cicada {
+    /*
+     * The picture buffers of a software video decoder, given to avcodec by get_buffer2.
+     *
+     * The planes come from av buffer pools, a decoded frame holds the refs of its planes till the
+     * render releases it, then the planes go back to the pool for the next frame instead of the
+     * heap. The lines are aligned to mAlign bytes for simd and texture upload.
+     *
+     * The capacity is the frames alive at a time, the ones the codec holds, taken from the codec context,
+     * and the output frames, set by the decoder from the depth of its output queue and of the queues after it.
+     * The frames over the capacity, held out of the counted queues by a snapshot, a frame callback or a filter,
+     * are allocated by avcodec as before and counted as overflow, the decoder never waits or fails for them.
+     * The free buffers idle for a while are freed, so a pool shrinks back after a peak.
+     *
+     * The buffers can live longer than the decoder, they are freed with the last frame.
+     */
+    class FrameBufferPool {
+    public:
+        struct Stats {
+            // allocated by the pool, in use or free
+            int64_t bytes;
+            int64_t peakBytes;
+            int frames;
+            // the frames found the pool full, allocated by avcodec out of the pool
+            int overflowFrames;
+        };
+
+    public:
+        explicit FrameBufferPool(int align = 64);
+
+        ~FrameBufferPool();
+
+        // the frames held out of the codec at most, added to the frames the codec holds for the capacity
+        void setOutputFrames(int frames);
+
+        // free the free buffers
+        void trim();
+
+        // use the pool in the codec context, before avcodec_open2
+        void attach(AVCodecContext *ctx);
+
+        Stats getStats();
+
+        // of all the pools in process
+        static int64_t getTotalBytes();
+
+        static int64_t getTotalPeakBytes();
+
+    private:
+        struct Planes;
+
+        static int getBuffer2(AVCodecContext *ctx, AVFrame *frame, int flags);
+
+        static void releaseBuffer(void *opaque, uint8_t *data);
+
+        int getBuffer(AVCodecContext *ctx, AVFrame *frame, int flags);
+
+        int getCapacity(AVCodecContext *ctx) const;
+
+        // take a free buffer or allocate a new one under the capacity, nullptr if all are in use
+        uint8_t *takeBuffer(Planes *planes, int capacity);
+
+        void trimPlanes(Planes *planes, int64_t idleTime);
+
+        int updatePlanes(AVCodecContext *ctx, AVFrame *frame);
+
+        void releasePlanes();
+
+    private:
+        int mAlign;
+        std::atomic_int mOutputFrames{0};
+        std::mutex mMutex;
+        Planes *mPlanes{nullptr};
+        int64_t mBytes{0};
+        int64_t mPeakBytes{0};
+        int mOverflowFrames{0};
+
+        static std::atomic<int64_t> sTotalBytes;
+        static std::atomic<int64_t> sTotalPeakBytes;
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_FRAMEBUFFERPOOL_H
@@ -176,6 +176,14 @@ namespace Cicada {
         {
             return true;
         }
+
+        /*
+         * the frames held after the decoder at most, by the player and the render,
+         * for the decoders allocate the frames themselves
+         */
+        virtual void setHeldFrames(int frames)
+        {
+        }
         
         void setRequireDrmHandlerCallback(std::function<DrmHandler*(const DrmInfo& drmInfo)> callback){
             mRequireDrmHandlerCallback  = callback;
@@ -14,9 +14,11 @@ extern "C" {
 #include <utils/frame_work_log.h>
 #include <utils/mediaFrame.h>
 #include <utils/ffmpeg_utils.h>
+#include <algorithm>
 #include <cassert>
 #include <deque>
 #include "avcodecDecoder.h"
+#include "DecoderThreadBudget.h"
 #include "base/media/AVAFPacket.h"
 #include <utils/errors/framework_error.h>
 
@@ -69,6 +71,11 @@ namespace Cicada {
             return;
         }
 
+        if (mUseThreadBudget) {
+            DecoderThreadBudget::Instance()->release(this);
+            mUseThreadBudget = false;
+        }
+
 #ifdef ENABLE_HWDECODER
 
         if (mPDecoder->pHWHandle) {
@@ -90,6 +97,17 @@ namespace Cicada {
             mPDecoder->codecCont = nullptr;
         }
 
+        mDrainedFrames.clear();
+
+        if (mFramePool) {
+            // the frames of the codec are back, the ones still in render keep their buffers
+            mFramePool->trim();
+            FrameBufferPool::Stats stats = mFramePool->getStats();
+            AF_LOGI("frame pool %lld bytes in %d frames, peak %lld bytes, overflow %d frames\n", (long long) stats.bytes, stats.frames,
+                    (long long) stats.peakBytes, stats.overflowFrames);
+            mFramePool = nullptr;
+        }
+
         mPDecoder->codec = nullptr;
         av_frame_free(&mPDecoder->avFrame);
         delete mPDecoder;
@@ -160,15 +178,45 @@ namespace Cicada {
         av_opt_set_int(mPDecoder->codecCont, "refcounted_frames", 1, 0);
         int threadcount = (AFGetCpuCount() > 0 ? AFGetCpuCount() + 1 : 0);
 
+        if (!isAudio && !(flags & DECFLAG_THUMBNAIL)) {
+            // share the cores with the other video decoders in process
+            threadcount = DecoderThreadBudget::Instance()->acquire(this, meta->width, meta->height, meta->avg_fps);
+            mUseThreadBudget = true;
+        }
+
         if ((flags & DECFLAG_OUTPUT_FRAME_ASAP)
                 && ((0 == threadcount) || (threadcount > 2))) {
             // set too much thread need more video buffer in ffmpeg
             threadcount = 2;
         }
 
+        if (flags & DECFLAG_THUMBNAIL) {
+            // a single key frame is decoded each time, the frame threads only add delay
+            threadcount = 1;
+            mPDecoder->codecCont->skip_frame = AVDISCARD_NONKEY;
+            mPDecoder->codecCont->skip_loop_filter = AVDISCARD_ALL;
+            // not all the codecs support lowres, h264 and hevc don't
+            mPDecoder->codecCont->lowres = std::min(2, (int) mPDecoder->codec->max_lowres);
+        }
+
+#ifdef AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS
+        if (!isAudio && (flags & DECFLAG_EXPORT_QP)) {
+            mPDecoder->codecCont->export_side_data |= AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS;
+        }
+#endif
+
         AF_LOGI("set decoder thread as :%d\n", threadcount);
         mPDecoder->codecCont->thread_count = threadcount;
 
+        if (!isAudio && !(flags & DECFLAG_THUMBNAIL)) {
+            // the frames held by the codec are added by the pool
+            mFramePool = unique_ptr<FrameBufferPool>(new FrameBufferPool());
+            mFramePool->setOutputFrames(getMaxOutputFrames() + mHeldFrames);
+            mFramePool->attach(mPDecoder->codecCont);
+        }
+        mThreadCount = threadcount;
+        mOutputFrameASAP = (flags & DECFLAG_OUTPUT_FRAME_ASAP) != 0;
+
         if (avcodec_open2(mPDecoder->codecCont, mPDecoder->codec, nullptr) < 0) {
             AF_LOGE("could not open codec\n");
             avcodec_free_context(&mPDecoder->codecCont);
@@ -221,10 +269,220 @@ namespace Cicada {
     void avcodecDecoder::flush_decoder()
     {
         avcodec_flush_buffers(mPDecoder->codecCont);
+        mDrainedFrames.clear();
+        // nothing in decoder now, a cheap point to pick up the new share
+        int threadcount = getRetuneThreadCount();
+
+        if (threadcount > 0) {
+            reopen_decoder(threadcount);
+        }
+    }
+
+    int avcodecDecoder::getRetuneThreadCount()
+    {
+        if (!mUseThreadBudget) {
+            return 0;
+        }
+
+        int threadcount = DecoderThreadBudget::Instance()->getThreadCount(this);
+
+        if (mOutputFrameASAP) {
+            threadcount = std::min(threadcount, 2);
+        }
+
+        // ignore the small changes, reopen is not free
+        if (threadcount > 0 && (threadcount * 4 < mThreadCount * 3 || threadcount * 3 > mThreadCount * 4)) {
+            return threadcount;
+        }
+
+        return 0;
+    }
+
+    void avcodecDecoder::retune_decoder(int threadcount)
+    {
+        // the frames before the key frame still come out, in order
+        avcodec_send_packet(mPDecoder->codecCont, nullptr);
+
+        while (avcodec_receive_frame(mPDecoder->codecCont, mPDecoder->avFrame) >= 0) {
+            unique_ptr<IAFFrame> frame = takeFrame();
+
+            if (frame) {
+                mDrainedFrames.push_back(move(frame));
+            }
+        }
+
+        // the old context is at eof, it must be usable again if reopen failed
+        avcodec_flush_buffers(mPDecoder->codecCont);
+        reopen_decoder(threadcount);
+    }
+
+    bool avcodecDecoder::isRetunePoint(const AVPacket *pkt, bool key) const
+    {
+        // the parameters changed, the codec reinits itself at it
+        if (av_packet_get_side_data(pkt, AV_PKT_DATA_NEW_EXTRADATA, nullptr) || av_packet_get_side_data(pkt, AV_PKT_DATA_PARAM_CHANGE, nullptr)) {
+            return true;
+        }
+
+        if (!key) {
+            return false;
+        }
+
+        AVCodecContext *codecCont = mPDecoder->codecCont;
+
+        switch (codecCont->codec_id) {
+            case AV_CODEC_ID_H264:
+            case AV_CODEC_ID_HEVC: {
+                // the open gop, cra and recovery point frames are key too, the leading frames after them reference the frames before
+                int lengthSize = 0;
+                const uint8_t *extradata = codecCont->extradata;
+
+                if (extradata && extradata[0] == 1) {
+                    if (codecCont->codec_id == AV_CODEC_ID_H264 && codecCont->extradata_size >= 7) {
+                        lengthSize = (extradata[4] & 0x03) + 1;
+                    } else if (codecCont->codec_id == AV_CODEC_ID_HEVC && codecCont->extradata_size >= 23) {
+                        lengthSize = (extradata[21] & 0x03) + 1;
+                    }
+                }
+
+                return isIdrPacket(codecCont->codec_id, pkt->data, pkt->size, lengthSize);
+            }
+
+            case AV_CODEC_ID_VP8:
+            case AV_CODEC_ID_VP9:
+                // a key frame resets all the references
+                return true;
+
+            default:
+                // not known, only at flush
+                return false;
+        }
+    }
+
+    bool avcodecDecoder::isIdrPacket(enum AVCodecID codec, const uint8_t *data, int size, int lengthSize)
+    {
+        int pos = 0;
+
+        while (pos < size) {
+            uint32_t nalSize = 0;
+
+            if (lengthSize > 0) {
+                if (size - pos < lengthSize) {
+                    return false;
+                }
+
+                for (int i = 0; i < lengthSize; i++) {
+                    nalSize = (nalSize << 8) | data[pos++];
+                }
+
+                if (nalSize == 0 || nalSize > static_cast<uint32_t>(size - pos)) {
+                    return false;
+                }
+            } else {
+                // the nal after the next start code
+                while (pos + 3 <= size && !(data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1)) {
+                    pos++;
+                }
+
+                pos += 3;
+
+                if (pos >= size) {
+                    return false;
+                }
+            }
+
+            uint8_t header = data[pos];
+
+            if (codec == AV_CODEC_ID_H264) {
+                int type = header & 0x1f;
+
+                // the first slice
+                if (type >= 1 && type <= 5) {
+                    return type == 5;
+                }
+            } else {
+                int type = (header >> 1) & 0x3f;
+
+                // the first slice, IDR_W_RADL or IDR_N_LP
+                if (type < 32) {
+                    return type == 19 || type == 20;
+                }
+            }
+
+            if (lengthSize > 0) {
+                pos += nalSize;
+            }
+        }
+
+        return false;
+    }
+
+    void avcodecDecoder::reopen_decoder(int threadcount)
+    {
+        AVCodecParameters *par = avcodec_parameters_alloc();
+
+        if (par == nullptr) {
+            return;
+        }
+
+        AVCodecContext *codecCont = nullptr;
+
+        if (avcodec_parameters_from_context(par, mPDecoder->codecCont) < 0
+                || (codecCont = avcodec_alloc_context3(mPDecoder->codec)) == nullptr
+                || avcodec_parameters_to_context(codecCont, par) < 0) {
+            AF_LOGE("reopen decoder error\n");
+            avcodec_parameters_free(&par);
+            avcodec_free_context(&codecCont);
+            return;
+        }
+
+        avcodec_parameters_free(&par);
+        av_opt_set_int(codecCont, "refcounted_frames", 1, 0);
+        codecCont->pkt_timebase = mPDecoder->codecCont->pkt_timebase;
+        codecCont->thread_count = threadcount;
+
+        if (mFramePool) {
+            mFramePool->attach(codecCont);
+        }
+
+        if (avcodec_open2(codecCont, mPDecoder->codec, nullptr) < 0) {
+            // keep working with the old one
+            AF_LOGE("could not reopen codec\n");
+            avcodec_free_context(&codecCont);
+            return;
+        }
+
+        AF_LOGI("reset decoder thread %d --> %d\n", mThreadCount, threadcount);
+        avcodec_free_context(&mPDecoder->codecCont);
+        mPDecoder->codecCont = codecCont;
+        mThreadCount = threadcount;
+    }
+
+    bool avcodecDecoder::enterBackground(bool back)
+    {
+        if (mUseThreadBudget) {
+            DecoderThreadBudget::Instance()->setBackground(this, back);
+        }
+
+        return IDecoder::enterBackground(back);
+    }
+
+    void avcodecDecoder::setHeldFrames(int frames)
+    {
+        mHeldFrames = frames;
+
+        if (mFramePool) {
+            mFramePool->setOutputFrames(getMaxOutputFrames() + mHeldFrames);
+        }
     }
 
     int avcodecDecoder::dequeue_decoder(unique_ptr<IAFFrame> &pFrame)
     {
+        if (!mDrainedFrames.empty()) {
+            pFrame = move(mDrainedFrames.front());
+            mDrainedFrames.pop_front();
+            return 0;
+        }
+
         int ret = avcodec_receive_frame(mPDecoder->codecCont, mPDecoder->avFrame);
 
         if (ret < 0) {
@@ -235,9 +493,21 @@ namespace Cicada {
             return ret;
         }
 
+        pFrame = takeFrame();
+
+        if (pFrame == nullptr) {
+            return -EAGAIN;
+        }
+
+        return ret;
+    };
+
+    unique_ptr<IAFFrame> avcodecDecoder::takeFrame()
+    {
         if (mPDecoder->avFrame->decode_error_flags || mPDecoder->avFrame->flags) {
             AF_LOGW("get a error frame\n");
-            return -EAGAIN;
+            av_frame_unref(mPDecoder->avFrame);
+            return nullptr;
         }
 
 #ifdef ENABLE_HWDECODER
@@ -254,10 +524,10 @@ namespace Cicada {
                 timePosition = atoll(t->value);
             }
         }
-        pFrame = unique_ptr<IAFFrame>(new AVAFFrame(mPDecoder->avFrame));
-        pFrame->getInfo().timePosition = timePosition;
-        return ret;
-    };
+        unique_ptr<IAFFrame> frame = unique_ptr<IAFFrame>(new AVAFFrame(mPDecoder->avFrame));
+        frame->getInfo().timePosition = timePosition;
+        return frame;
+    }
 
     int avcodecDecoder::enqueue_decoder(unique_ptr<IAFPacket> &pPacket)
     {
@@ -280,6 +550,13 @@ namespace Cicada {
 
         if (pkt == nullptr) {
             AF_LOGD("send null to decoder\n");
+        } else if (isRetunePoint(pkt, pPacket->getInfo().flags & AF_PKT_FLAG_KEY)) {
+            // the share changed since open (a player came, went or went to background), take it on here
+            int threadcount = getRetuneThreadCount();
+
+            if (threadcount > 0) {
+                retune_decoder(threadcount);
+            }
         }
 
         if (pkt){
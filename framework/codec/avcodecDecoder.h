@@ -11,6 +11,9 @@
 #include <codec/IDecoder.h>
 #include "base/media/AVAFPacket.h"
 #include "codecPrototype.h"
+#include "FrameBufferPool.h"
+#include <deque>
+#include <memory>
 
 //#define ENABLE_HWDECODER
 
@@ -53,10 +56,20 @@ namespace Cicada{
 
         static bool is_supported(enum AFCodecID codec);
 
+        /*
+         * the first picture of the h264 or hevc packet is an idr, no frame after it references a frame before it.
+         * lengthSize is the nal length size of the avcC/hvcC packet, 0 for annex b
+         */
+        static bool isIdrPacket(enum AVCodecID codec, const uint8_t *data, int size, int lengthSize);
+
         void setEOF() override
         {
         }
 
+        bool enterBackground(bool back) override;
+
+        void setHeldFrames(int frames) override;
+
     private:
         explicit avcodecDecoder(int dummy)
         {
@@ -99,8 +112,29 @@ namespace Cicada{
         };
         virtual bool supportReuse() override;
 
+        void reopen_decoder(int threadcount);
+
+        // the share of the thread budget when it changed much from the threads in use, 0 to keep them
+        int getRetuneThreadCount();
+
+        // drain the codec to the drained frames and reopen it with threadcount threads
+        void retune_decoder(int threadcount);
+
+        // no reference crosses the packet, the codec can be reopened before it
+        bool isRetunePoint(const AVPacket *pkt, bool key) const;
+
+        // the frame in avFrame, nullptr for a broken one
+        std::unique_ptr<IAFFrame> takeFrame();
+
     private:
         decoder_handle_v *mPDecoder = nullptr;
+        bool mUseThreadBudget{false};
+        bool mOutputFrameASAP{false};
+        int mThreadCount{0};
+        int mHeldFrames{0};
+        // the frames left in the codec when it was reopened, output before the new ones
+        std::deque<std::unique_ptr<IAFFrame>> mDrainedFrames{};
+        std::unique_ptr<FrameBufferPool> mFramePool{};
     };
 }
 
@@ -111,6 +111,7 @@ namespace Cicada {
         }
 
         item.addValue("customHeaders", headerStr);
+        item.addValue("priority", (int) priority);
         return item.printJSON();
     }
 }
@@ -44,6 +44,9 @@ namespace Cicada {
         public:
             enum IpResolveType { IpResolveWhatEver, IpResolveV4, IpResolveV6 };
 
+            // the requests of higher priority are sent first when the network engine is busy
+            enum Priority { PriorityPlaylist, PriorityKey, PrioritySegment, PriorityPrefetch };
+
         public:
             int low_speed_limit{1};
             int low_speed_time_ms{15000};
@@ -56,6 +59,7 @@ namespace Cicada {
             std::vector<std::string> customHeaders;
             Listener *listener = nullptr;
             IpResolveType resolveType{IpResolveWhatEver};
+            Priority priority{PrioritySegment};
 
             std::string toString();
         };
@@ -0,0 +1,299 @@
+#define LOG_TAG "LocalFileDataSource"
+
+#include "LocalFileDataSource.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utils/CicadaJSON.h>
+#include <utils/CicadaUtils.h>
+#include <utils/frame_work_log.h>
+#include <utils/property.h>
+
+// the read ahead window grows from MIN to MAX by doubling
+#define MIN_READ_AHEAD_WINDOW (256 * 1024)
+#define MAX_READ_AHEAD_WINDOW (32 * 1024 * 1024)
+// don't map the big files in 32 bits address space
+#define MAX_MAP_SIZE_32 (512 * 1024 * 1024)
+
+using namespace std;
+
+namespace Cicada {
+    LocalFileDataSource LocalFileDataSource::se(0);
+
+    bool LocalFileDataSource::probe(const string &path)
+    {
+        if (strcmp(getProperty("localFileSource.disable"), "1") == 0) {
+            return false;
+        }
+
+        string file = path;
+
+        if (CicadaUtils::startWith(file, {"file://"})) {
+            file = file.substr(7);
+        } else if (file.find("://") != string::npos) {
+            return false;
+        }
+
+        struct stat st {};
+        // pipes and devices are left to avio
+        return stat(file.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+    }
+
+    LocalFileDataSource::LocalFileDataSource(const string &url) : IDataSource(url)
+    {}
+
+    LocalFileDataSource::~LocalFileDataSource()
+    {
+        Close();
+    }
+
+    string LocalFileDataSource::getPath() const
+    {
+        if (CicadaUtils::startWith(mUri, {"file://"})) {
+            return mUri.substr(7);
+        }
+
+        return mUri;
+    }
+
+    int LocalFileDataSource::Open(int flags)
+    {
+        Close();
+        mFd = ::open(getPath().c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (mFd < 0) {
+            int ret = -errno;
+            AF_LOGE("open %s error %d(%s)\n", mUri.c_str(), errno, strerror(errno));
+            return ret;
+        }
+
+        struct stat st {};
+
+        if (fstat(mFd, &st) < 0) {
+            int ret = -errno;
+            Close();
+            return ret;
+        }
+
+        mFileSize = st.st_size;
+
+        if (strcmp(getProperty("localFileSource.mmap"), "1") != 0 || map() < 0) {
+#if defined(__linux__)
+            posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        }
+
+        mPosition = rangeStart != INT64_MIN ? rangeStart : 0;
+        mReadAheadPos = mPosition;
+        mWindow = MIN_READ_AHEAD_WINDOW;
+        readAhead(0);
+        return 0;
+    }
+
+    void LocalFileDataSource::Close()
+    {
+        unmap();
+
+        if (mFd >= 0) {
+            ::close(mFd);
+            mFd = -1;
+        }
+
+        if (mReadBytes > 0) {
+            AF_LOGI("read %lld bytes, %lld seeks, window %lld\n", (long long) mReadBytes, (long long) mSeekCount, (long long) mWindow);
+        }
+
+        mReadBytes = 0;
+        mSeekCount = 0;
+    }
+
+    int LocalFileDataSource::map()
+    {
+        if (mFileSize <= 0 || (sizeof(void *) < 8 && mFileSize > MAX_MAP_SIZE_32)) {
+            return -EINVAL;
+        }
+
+        void *addr = mmap(nullptr, static_cast<size_t>(mFileSize), PROT_READ, MAP_SHARED, mFd, 0);
+
+        if (addr == MAP_FAILED) {
+            return -errno;
+        }
+
+        mMap = static_cast<uint8_t *>(addr);
+        mMapSize = mFileSize;
+        madvise(mMap, static_cast<size_t>(mMapSize), MADV_SEQUENTIAL);
+        return 0;
+    }
+
+    void LocalFileDataSource::unmap()
+    {
+        if (mMap) {
+            munmap(mMap, static_cast<size_t>(mMapSize));
+            mMap = nullptr;
+            mMapSize = 0;
+        }
+    }
+
+    int64_t LocalFileDataSource::available()
+    {
+        int64_t end = mMap ? mMapSize : mFileSize;
+
+        if (mPosition >= end) {
+            struct stat st {};
+
+            if (fstat(mFd, &st) == 0 && st.st_size > mFileSize) {
+                mFileSize = st.st_size;
+
+                if (mMap) {
+                    unmap();
+                    map();
+                }
+            }
+
+            end = mMap ? mMapSize : mFileSize;
+        }
+
+        if (rangeEnd != INT64_MIN) {
+            end = std::min(end, rangeEnd);
+        }
+
+        return std::max(end - mPosition, (int64_t) 0);
+    }
+
+    void LocalFileDataSource::readAhead(size_t consumed)
+    {
+        mReadBytes += consumed;
+
+        // more than half of the window is still ahead
+        if (mReadAheadPos - mPosition > mWindow / 2) {
+            return;
+        }
+
+        // the window is consumed sequentially, it's not enough for the demuxer
+        if (consumed > 0) {
+            mWindow = std::min(mWindow * 2, (int64_t) MAX_READ_AHEAD_WINDOW);
+        }
+
+        int64_t start = std::max(mReadAheadPos, mPosition);
+        int64_t end = std::min(mPosition + mWindow, mMap ? mMapSize : mFileSize);
+
+        if (end <= start) {
+            return;
+        }
+
+        if (mMap) {
+            int64_t pageSize = sysconf(_SC_PAGESIZE);
+            int64_t alignedStart = start / pageSize * pageSize;
+            madvise(mMap + alignedStart, static_cast<size_t>(end - alignedStart), MADV_WILLNEED);
+        } else {
+#if defined(__linux__)
+            posix_fadvise(mFd, start, end - start, POSIX_FADV_WILLNEED);
+#elif defined(__APPLE__)
+            struct radvisory advisory {};
+            advisory.ra_offset = start;
+            advisory.ra_count = static_cast<int>(end - start);
+            fcntl(mFd, F_RDADVISE, &advisory);
+#endif
+        }
+
+        mReadAheadPos = end;
+    }
+
+    int64_t LocalFileDataSource::Seek(int64_t offset, int whence)
+    {
+        if (mFd < 0) {
+            return -EINVAL;
+        }
+
+        int64_t position;
+
+        switch (whence) {
+            case SEEK_SIZE: {
+                struct stat st {};
+
+                if (fstat(mFd, &st) == 0) {
+                    mFileSize = st.st_size;
+                }
+
+                return mFileSize;
+            }
+
+            case SEEK_SET:
+                position = offset;
+                break;
+
+            case SEEK_CUR:
+                position = mPosition + offset;
+                break;
+
+            case SEEK_END:
+                position = mFileSize + offset;
+                break;
+
+            default:
+                return -EINVAL;
+        }
+
+        if (position < 0) {
+            return -EINVAL;
+        }
+
+        if (position != mPosition) {
+            mPosition = position;
+            mSeekCount++;
+            // start over from the new position
+            mReadAheadPos = mPosition;
+            mWindow = MIN_READ_AHEAD_WINDOW;
+            readAhead(0);
+        }
+
+        return mPosition;
+    }
+
+    int LocalFileDataSource::Read(void *buf, size_t nbyte)
+    {
+        if (mFd < 0) {
+            return -EINVAL;
+        }
+
+        nbyte = static_cast<size_t>(std::min((int64_t) std::min(nbyte, (size_t) INT32_MAX), available()));
+
+        if (nbyte == 0) {
+            return 0;
+        }
+
+        if (mMap) {
+            memcpy(buf, mMap + mPosition, nbyte);
+        } else {
+            ssize_t ret = pread(mFd, buf, nbyte, mPosition);
+
+            if (ret < 0) {
+                return -errno;
+            }
+
+            nbyte = static_cast<size_t>(ret);
+        }
+
+        mPosition += nbyte;
+        readAhead(nbyte);
+        return static_cast<int>(nbyte);
+    }
+
+    string LocalFileDataSource::GetOption(const string &key)
+    {
+        if (key == "readAhead") {
+            CicadaJSONItem json;
+            json.addValue("mapped", mMap != nullptr);
+            json.addValue("window", (double) mWindow);
+            json.addValue("readBytes", (double) mReadBytes);
+            json.addValue("seeks", (double) mSeekCount);
+            return json.printJSON();
+        }
+
+        return IDataSource::GetOption(key);
+    }
+}// namespace Cicada
@@ -0,0 +1,95 @@
+#ifndef CICADA_PLAYER_LOCALFILEDATASOURCE_H
+#define CICADA_PLAYER_LOCALFILEDATASOURCE_H
+
+#include "IDataSource.h"
+#include "dataSourcePrototype.h"
+#include <cstdint>
+
+namespace Cicada {
+    /*
+     * The local regular files, read by pread(2) instead of avio.
+     *
+     * The pages after the read position are asked from the kernel in a read ahead window by
+     * posix_fadvise (F_RDADVISE on apple). The window grows while the reads go on sequentially
+     * and are consumed, and falls back to the minimum on a seek, so the slow storages (network
+     * mounts, sd cards) are read ahead of the demuxer by the size it actually consumes. A file
+     * growing while playing (a cache file being written) is read on when its size grows.
+     *
+     * The property "localFileSource.mmap" set to "1" maps the files instead, a read is then a copy
+     * from the map with madvise hints. Only for the files never truncated while playing, a read
+     * from the pages cut off raises SIGBUS.
+     *
+     * The property "localFileSource.disable" set to "1" gives the local files back to avio, pipes
+     * and devices are always left to avio.
+     */
+    class LocalFileDataSource : public IDataSource, private dataSourcePrototype {
+    public:
+        static bool probe(const std::string &path);
+
+        explicit LocalFileDataSource(const std::string &url);
+
+        ~LocalFileDataSource() override;
+
+        int Open(int flags) override;
+
+        void Close() override;
+
+        int64_t Seek(int64_t offset, int whence) override;
+
+        int Read(void *buf, size_t nbyte) override;
+
+        std::string GetOption(const std::string &key) override;
+
+    private:
+        explicit LocalFileDataSource(int dummy) : IDataSource("")
+        {
+            addPrototype(this);
+        }
+
+        Cicada::IDataSource *clone(const std::string &uri) override
+        {
+            return new LocalFileDataSource(uri);
+        };
+
+        bool is_supported(const std::string &uri) override
+        {
+            return probe(uri);
+        };
+
+        int probeScore(const std::string &uri, const Cicada::options *opts) override
+        {
+            // before ffmpegDataSource
+            return probe(uri) ? SUPPORT_DEFAULT + 1 : SUPPORT_NOT;
+        }
+
+        static LocalFileDataSource se;
+
+    private:
+        std::string getPath() const;
+
+        int map();
+
+        void unmap();
+
+        // the bytes can be read from mPosition, remap if the file grew
+        int64_t available();
+
+        void readAhead(size_t consumed);
+
+    private:
+        int mFd{-1};
+        uint8_t *mMap{nullptr};
+        int64_t mMapSize{0};
+        int64_t mFileSize{0};
+        int64_t mPosition{0};
+
+        // the read ahead window is [mReadAheadPos, mReadAheadPos + mWindow)
+        int64_t mReadAheadPos{0};
+        int64_t mWindow{0};
+        int64_t mReadBytes{0};
+        int64_t mSeekCount{0};
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_LOCALFILEDATASOURCE_H
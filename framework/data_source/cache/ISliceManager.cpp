@@ -6,6 +6,7 @@
 #include <utils/frame_work_log.h>
 #include "ISliceManager.h"
 #include <utils/property.h>
+#include <utils/MemoryGovernor.h>
 #include <string>
 #include <cassert>
 #include <mutex>
@@ -98,6 +99,7 @@ namespace Cicada {
         std::unique_lock<std::mutex> lock(mSliceLock);
         memPoolSlice *slice = new memPoolSlice(capacity, position, buffer, release);
         mSliceQueue.push_back(slice);
+        MemoryGovernor::Instance()->setUsage(nullptr, MemoryGovernor::ComponentCache, (int64_t) mSliceQueue.size() * mSliceSize);
         return slice;
     }
 
@@ -137,6 +139,7 @@ namespace Cicada {
                 mBufferPool->releaseBuffer(slice->getBuffer());
                 item = mSliceQueue.erase(item);
                 delete slice;
+                MemoryGovernor::Instance()->setUsage(nullptr, MemoryGovernor::ComponentCache, (int64_t) mSliceQueue.size() * mSliceSize);
                 break;
             } else {
                 item++;
@@ -8,6 +8,7 @@
 #include <cerrno>
 #include <utils/errors/framework_error.h>
 #include <utils/timer.h>
+#include <utils/MemoryGovernor.h>
 #include "CURLConnection.h"
 #include "CURLShareInstance.h"
 #include <cassert>
@@ -22,8 +23,6 @@ using namespace Cicada;
 
 #define MIN_SO_RCVBUF_SIZE 1024*64
 
-#define SOCKET_ERROR (-1)
-
 #define FITS_INT(a) (((a) <= INT_MAX) && ((a) >= INT_MIN))
 
 #define FALSE 0L
@@ -51,12 +50,14 @@ Cicada::CURLConnection::CURLConnection(Cicada::IDataSource::SourceConfig *pConfi
 {
     mHttp_handle = curl_easy_init();
     pRbuf = RingBufferCreate(RINGBUFFER_SIZE + RINGBUFFER_BACK_SIZE);
+    MemoryGovernor::Instance()->addUsage(nullptr, MemoryGovernor::ComponentNetwork, RINGBUFFER_SIZE + RINGBUFFER_BACK_SIZE);
     RingBufferSetBackSize(pRbuf, RINGBUFFER_BACK_SIZE);
     m_bFirstLoop = 1;
     mPConfig = pConfig;
 
     if (pConfig) {
         so_rcv_size = pConfig->so_rcv_size;
+        mPriority = pConfig->priority;
         string &http_proxy = pConfig->http_proxy;
 
         if (!http_proxy.empty()) {
@@ -112,7 +113,6 @@ Cicada::CURLConnection::CURLConnection(Cicada::IDataSource::SourceConfig *pConfi
     curl_easy_setopt(mHttp_handle, CURLOPT_SOCKOPTFUNCTION, sockopt_callback);
     curl_easy_setopt(mHttp_handle, CURLOPT_SOCKOPTDATA, this);
     esayHandle_set_common_opt();
-    multi_handle = curl_multi_init();
 }
 
 void CURLConnection::setSSLBackEnd(curl_sslbackend sslbackend)
@@ -128,9 +128,7 @@ void CURLConnection::setSSLBackEnd(curl_sslbackend sslbackend)
 
 Cicada::CURLConnection::~CURLConnection()
 {
-    if (multi_handle && mHttp_handle) {
-        curl_multi_remove_handle(multi_handle, mHttp_handle);
-    }
+    CURLMultiEngine::Instance()->removeTransfer(this);
 
     if (mHttp_handle) {
         curl_easy_cleanup(mHttp_handle);
@@ -138,6 +136,7 @@ Cicada::CURLConnection::~CURLConnection()
 
     if (pRbuf) {
         RingBufferDestroy(pRbuf);
+        MemoryGovernor::Instance()->addUsage(nullptr, MemoryGovernor::ComponentNetwork, -(RINGBUFFER_SIZE + RINGBUFFER_BACK_SIZE));
     }
 
     if (pOverflowBuffer) {
@@ -148,21 +147,29 @@ Cicada::CURLConnection::~CURLConnection()
         free(response);
     }
 
-    if (multi_handle) {
-        curl_multi_cleanup(multi_handle);
-    }
-
     if (reSolveList) {
         curl_slist_free_all(reSolveList);
     }
 }
 
-void Cicada::CURLConnection::disconnect()
+std::string Cicada::CURLConnection::getResponse()
 {
-    if (multi_handle && mHttp_handle) {
-        curl_multi_remove_handle(multi_handle, mHttp_handle);
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (response == nullptr) {
+        return "";
     }
 
+    return response;
+}
+
+void Cicada::CURLConnection::disconnect()
+{
+    CURLMultiEngine::Instance()->removeTransfer(this);
+    std::unique_lock<std::mutex> lock(mMutex);
+    mRunning = false;
+    mDone = false;
+    mPaused = false;
     RingBufferClear(pRbuf);
     responseSize = 0;
     overflowSize = 0;
@@ -176,6 +183,11 @@ size_t Cicada::CURLConnection::write_callback(char *buffer, size_t size, size_t
 {
     CURLConnection *pHandle = (CURLConnection *) userp;
     uint32_t amount = (uint32_t) (size * nitems);
+    std::unique_lock<std::mutex> lock(pHandle->mMutex);
+
+    if (!pHandle->mInfoCaptured) {
+        pHandle->captureInfo();
+    }
 
     if (pHandle->overflowSize) {
         // we have our overflow buffer - first get rid of as much as we can
@@ -194,6 +206,12 @@ size_t Cicada::CURLConnection::write_callback(char *buffer, size_t size, size_t
         }
     }
 
+    // the reader is slow, curl keeps the data until resumed, the overflow buffer is one write at most
+    if (pHandle->overflowSize || RingBuffergetMaxWriteSize(pHandle->pRbuf) == 0) {
+        pHandle->mPaused = true;
+        return CURL_WRITEFUNC_PAUSE;
+    }
+
     uint32_t maxWriteable = std::min(RingBuffergetMaxWriteSize(pHandle->pRbuf), amount);
 
     if (maxWriteable) {
@@ -218,6 +236,7 @@ size_t Cicada::CURLConnection::write_callback(char *buffer, size_t size, size_t
         pHandle->overflowSize += amount;
     }
 
+    pHandle->mCondition.notify_all();
     return size * nitems;
 }
 
@@ -244,6 +263,8 @@ void Cicada::CURLConnection::debugHeader(bool in, char *data, size_t size)
 size_t Cicada::CURLConnection::write_response(void *ptr, size_t size, size_t nmemb, void *data)
 {
     auto *pHandle = (CURLConnection *) data;
+    // in the engine thread, read by getResponse in the others
+    std::unique_lock<std::mutex> lock(pHandle->mMutex);
 
     if (pHandle->response == nullptr) {
         pHandle->response = (char *) malloc(MAX_RESPONSE_SIZE);
@@ -378,6 +399,9 @@ int Cicada::CURLConnection::esayHandle_set_common_opt()
     curl_easy_setopt(mHttp_handle, CURLOPT_DEBUGDATA, this);
     curl_easy_setopt(mHttp_handle, CURLOPT_HEADERFUNCTION, write_response);
     curl_easy_setopt(mHttp_handle, CURLOPT_HEADERDATA, this);
+    // multiplex the requests to a host on one connection if the server supports HTTP/2
+    curl_easy_setopt(mHttp_handle, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(mHttp_handle, CURLOPT_PIPEWAIT, 1L);
     return 0;
 }
 
@@ -389,6 +413,12 @@ void CURLConnection::setInterrupt(std::atomic_bool *inter)
 void CURLConnection::SetResume(int64_t pos)
 {
     mFilePos = pos;
+}
+
+void CURLConnection::start()
+{
+    // the options can't be changed when the transfer is running
+    CURLMultiEngine::Instance()->removeTransfer(this);
 
     if (sendRange && this->mFilePos == 0) {
         curl_easy_setopt(mHttp_handle, CURLOPT_RANGE, "0-");
@@ -398,20 +428,118 @@ void CURLConnection::SetResume(int64_t pos)
     }
 
     curl_easy_setopt(mHttp_handle, CURLOPT_RESUME_FROM_LARGE, (curl_off_t) mFilePos);
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mRunning = true;
+        mDone = false;
+        mPaused = false;
+        mResult = CURLE_OK;
+        mInfoCaptured = false;
+    }
+    CURLMultiEngine::Instance()->addTransfer(this, mPriority);
 }
 
-void CURLConnection::start()
+void CURLConnection::captureInfo()
+{
+    double length;
+    char *location = nullptr;
+    char *ipstr = nullptr;
+
+    if (CURLE_OK == curl_easy_getinfo(mHttp_handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &length)) {
+        mContentLength = length;
+    }
+
+    if (CURLE_OK == curl_easy_getinfo(mHttp_handle, CURLINFO_EFFECTIVE_URL, &location) && location) {
+        mEffectiveUrl = location;
+    }
+
+    if (CURLE_OK == curl_easy_getinfo(mHttp_handle, CURLINFO_PRIMARY_IP, &ipstr)) {
+        mPrimaryIp = ipstr ? ipstr : "";
+    }
+
+    curl_easy_getinfo(mHttp_handle, CURLINFO_RESPONSE_CODE, &mResponseCode);
+    mInfoCaptured = true;
+}
+
+void CURLConnection::onTransferDone(CURLcode result, const CURLMultiEngine::TransferTiming &timing)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (!mInfoCaptured) {
+        captureInfo();
+    }
+
+    mDone = true;
+    mResult = result;
+    mTiming = timing;
+    AF_LOGD("%s done %d, queue %lld dns %lld connect %lld tls %lld first byte %lld total %lld us, %lld bytes, http version %ld%s",
+            uri.c_str(), result, (long long) timing.queue, (long long) timing.nameLookup, (long long) timing.connect,
+            (long long) timing.appConnect, (long long) timing.startTransfer, (long long) timing.total, (long long) timing.bytes,
+            timing.httpVersion, timing.reused ? ", reused" : "");
+    mCondition.notify_all();
+}
+
+CURLMultiEngine::TransferTiming CURLConnection::getTiming()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    return mTiming;
+}
+
+int CURLConnection::checkResult(CURLcode result, CURLcode &retryResult)
 {
-    curl_multi_add_handle(multi_handle, mHttp_handle);
+    if (result == CURLE_OK) {
+        return 1;
+    }
+
+    if (result == CURLE_HTTP_RETURNED_ERROR) {
+        AF_LOGE("FillBuffer - Failed: HTTP returned error %ld", mResponseCode);
+    } else {
+        AF_LOGE("FillBuffer - Failed: %s(%d)", curl_easy_strerror(result), result);
+    }
+
+    // We need to check the result here as we don't want to retry on every error
+    if ((result == CURLE_OPERATION_TIMEDOUT ||
+            result == CURLE_PARTIAL_FILE ||
+            result == CURLE_COULDNT_CONNECT ||
+            result == CURLE_RECV_ERROR ||
+            result == CURLE_COULDNT_RESOLVE_HOST) /*&&
+              !pEasyHandle->m_bFirstLoop*/) {
+        retryResult = result;
+        return 0;
+    }
+
+    if ((result == CURLE_HTTP_RANGE_ERROR ||
+            result == CURLE_HTTP_RETURNED_ERROR) &&
+            m_bFirstLoop &&
+            mFilePos == 0 &&
+            sendRange) {
+        // If server returns a range or http error, retry with range disabled
+        retryResult = result;
+        sendRange = 0;
+        return 0;
+    }
+
+    //TODO: return the right errno
+    switch (result) {
+        case CURLE_RANGE_ERROR:
+            return gen_framework_errno(error_class_network, network_errno_http_range);
+
+        case CURLE_UNSUPPORTED_PROTOCOL:
+            return gen_framework_errno(error_class_network, network_errno_unsupported);
+
+        case CURLE_OUT_OF_MEMORY:
+            return FRAMEWORK_ERR(ENOMEM);
+
+        default:
+            return FRAMEWORK_ERR(EIO);
+    }
 }
 
 int CURLConnection::FillBuffer(uint32_t want)
 {
-    fd_set fdread;
-    fd_set fdwrite;
-    fd_set fdexcep;
     int64_t starTime = af_getsteady_ms();
     bool reConnect = false;
+    std::unique_lock<std::mutex> lock(mMutex);
 
     while (RingBuffergetMaxReadSize(pRbuf) < want &&
             RingBuffergetMaxWriteSize(pRbuf) > 0) {
@@ -443,81 +571,34 @@ int CURLConnection::FillBuffer(uint32_t want)
             continue;
         }
 
-        CURLMcode result = curl_multi_perform(multi_handle, &still_running);
+        if (mPaused) {
+            mPaused = false;
+            lock.unlock();
+            CURLMultiEngine::Instance()->resumeTransfer(this);
+            lock.lock();
+            continue;
+        }
 
-        if (!still_running) {
-            if (result != CURLM_OK) {
-                AF_LOGE("FRAMEWORK_NET_ERR_UNKNOWN");
-                return FRAMEWORK_NET_ERR_UNKNOWN;
-            }
+        if (!mRunning) {
+            AF_LOGW("assume a abnormal eos\n");
+            return 0;
+        }
 
+        if (mDone) {
             /* if we still have stuff in buffer, we are fine */
             if (RingBuffergetMaxReadSize(pRbuf)) {
                 return 0;
             }
 
             /* verify that we are actually okey */
-            int msgs;
             CURLcode CURLResult = CURLE_OK;
-            CURLMsg *msg;
-
-            while ((msg = curl_multi_info_read(multi_handle, &msgs))) {
-                if (msg->msg == CURLMSG_DONE) {
-                    if (msg->data.result == CURLE_OK) {
-                        return 0;
-                    }
-
-                    if (msg->data.result == CURLE_HTTP_RETURNED_ERROR) {
-                        long httpCode;
-                        curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &httpCode);
-                        AF_LOGE("FillBuffer - Failed: HTTP returned error %ld", httpCode);
-                    } else {
-                        AF_LOGE("FillBuffer - Failed: %s(%d)", curl_easy_strerror(msg->data.result), msg->data.result);
-                    }
-
-                    // We need to check the result here as we don't want to retry on every error
-                    if ((msg->data.result == CURLE_OPERATION_TIMEDOUT ||
-                            msg->data.result == CURLE_PARTIAL_FILE ||
-                            msg->data.result == CURLE_COULDNT_CONNECT ||
-                            msg->data.result == CURLE_RECV_ERROR ||
-                            msg->data.result == CURLE_COULDNT_RESOLVE_HOST) /*&&
-                              !pEasyHandle->m_bFirstLoop*/) {
-                        CURLResult = msg->data.result;
-                    } else if ((msg->data.result == CURLE_HTTP_RANGE_ERROR ||
-                                msg->data.result == CURLE_HTTP_RETURNED_ERROR) &&
-                               m_bFirstLoop &&
-                               mFilePos == 0 &&
-                               sendRange) {
-                        // If server returns a range or http error, retry with range disabled
-                        CURLResult = msg->data.result;
-                        sendRange = 0;
-                    } else {
-                        //TODO: return the right errno
-                        //   AF_LOGE("url is %s\n", curlContext.location.c_str());
-                        switch (msg->data.result) {
-                            case CURLE_RANGE_ERROR:
-                                return gen_framework_errno(error_class_network, network_errno_http_range);
-
-                            case CURLE_UNSUPPORTED_PROTOCOL:
-                                return gen_framework_errno(error_class_network, network_errno_unsupported);
-
-                            case CURLE_OUT_OF_MEMORY:
-                                return FRAMEWORK_ERR(ENOMEM);
-
-                            default:
-                                return FRAMEWORK_ERR(EIO);
-                        }
-                    }
-                }
-            }
+            int ret = checkResult(mResult, CURLResult);
 
-            // Don't retry when we didn't "see" any error
-            if (CURLResult == CURLE_OK) {
-                // we assume eof
-                AF_LOGW("assume a abnormal eos\n");
-                return 0;
+            if (ret != 0) {
+                return ret > 0 ? 0 : ret;
             }
 
+            lock.unlock();
             // Close handle
             disconnect();
 
@@ -540,39 +621,27 @@ int CURLConnection::FillBuffer(uint32_t want)
                 AF_LOGE("FillBuffer - Reconnect failed!");
                 // Reset the rest of the variables like we would in Disconnect()
                 mFilePos = 0;
-                // TODO: file size
-                // m_fileSize = 0;
-                // m_bufferSize = 0;
                 //TODO: return the right errno
                 return getErrorCode(CURLResult);
             }
 
-            //    (curlContext.reTryCount)++;
-            // AF_LOGE("FillBuffer - Reconnect, (re)try %i", curlContext.reTryCount);
             //TODO need change this solution: report to user.
             //sleep 10ms ， then retry connect..
             af_msleep(10);
-//            std::unique_lock<std::mutex> uMutex(curlContext.mSleepMutex);
-//            (curlContext.mSleepCondition).wait_for(uMutex, std::chrono::milliseconds(10),
-//                                                   [pConnection]() { return pInterrupted->load(); });
             // Connect + seek to current position (again)
-            SetResume(mFilePos);
-            curl_multi_add_handle(multi_handle, mHttp_handle);
+            start();
+            lock.lock();
             // Return to the beginning of the loop:
             continue;
         }
 
-        if (reConnect || m_bFirstLoop) {
-            double length;
-
-            if (curl_easy_getinfo(mHttp_handle, CURLINFO_SIZE_DOWNLOAD, &length) == CURLE_OK) {
-                if (length > 0) {
-                    reConnect = false;
+        if ((reConnect || m_bFirstLoop) && RingBuffergetMaxReadSize(pRbuf) > 0) {
+            reConnect = false;
 
-                    if (mPConfig && mPConfig->listener) {
-                        mPConfig->listener->onNetWorkConnected();
-                    }
-                }
+            if (mPConfig && mPConfig->listener) {
+                lock.unlock();
+                mPConfig->listener->onNetWorkConnected();
+                lock.lock();
             }
         }
 
@@ -581,73 +650,15 @@ int CURLConnection::FillBuffer(uint32_t want)
             m_bFirstLoop = 0;
         }
 
-        switch (result) {
-            case CURLM_OK: {
-                int maxfd = -1;
-                FD_ZERO(&fdread);
-                FD_ZERO(&fdwrite);
-                FD_ZERO(&fdexcep);
-                // get file descriptors from the transfers
-                curl_multi_fdset(multi_handle, &fdread, &fdwrite, &fdexcep, &maxfd);
-                long timeout = 0;
-
-                if (CURLM_OK != curl_multi_timeout(multi_handle, &timeout) || timeout == -1 ||
-                        timeout < 200) {
-                    timeout = 200;
-                }
-
-                //    XbmcThreads::EndTime endTime(timeout);
-                // TODO: count time
-                int rc;
-                int count = 10;
-
-                do {
-                    //  unsigned int time_left = endTime.MillisLeft();
-                    //  struct timeval t = { (int)time_left / 1000, ((int)time_left % 1000) * 1000 };
-                    struct timeval t = {0, 10000};
-                    // Wait until data is available or a timeout occurs.
-                    rc = select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &t);
-                    count--;
-                } while (rc == SOCKET_ERROR && errno == EINTR && count > 0);
-
-                if (rc == SOCKET_ERROR) {
-#ifndef WIN32
-                    char const *str = strerror(errno);
-                    AF_LOGE("Failed with socket error:%s", str);
-                    return FRAMEWORK_ERR(errno);
-#endif
-                }
-            }
-            break;
-
-            case CURLM_CALL_MULTI_PERFORM: {
-                // we don't keep calling here as that can easily overwrite our buffer which we want to avoid
-                // docs says we should call it soon after, but aslong as we are reading data somewhere
-                // this aught to be soon enough. should stay in socket otherwise
-                continue;
-            }
-
-            default: {
-                AF_LOGE("FillBuffer - Multi perform failed with code %d, aborting", result);
-                return FRAMEWORK_NET_ERR_UNKNOWN;
-            }
-        }
+        // the engine thread notifies on data or done, wake up to check the interrupt
+        mCondition.wait_for(lock, std::chrono::milliseconds(10));
     }
 
-    if (mFileSize < 0) {
-        double length;
-
-        if (CURLE_OK ==
-                curl_easy_getinfo(mHttp_handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &length)) {
-            if (length > 0.0) {
-                mFileSize = mFilePos + (int64_t) length;
-                //           AF_LOGE(TAG,"file size is %lld\n",curlContext.fileSize);
-            } else {
-                mFileSize = 0;
-            }
-
-//        if (curlContext.fileSize == 0)
-//            curlContext.hd->is_streamed = 1;
+    if (mFileSize < 0 && mInfoCaptured) {
+        if (mContentLength > 0.0) {
+            mFileSize = mFilePos + (int64_t) mContentLength;
+        } else {
+            mFileSize = 0;
         }
     }
 
@@ -659,6 +670,7 @@ int CURLConnection::short_seek(int64_t off)
     uint32_t m_bufferSize = 1024 * 64;
     int ret;
     int64_t delta = off - mFilePos;
+    std::unique_lock<std::mutex> lock(mMutex);
 
     if (delta < 0) {
         if (RingBufferSkipBytes(pRbuf, (int) delta)) {
@@ -682,7 +694,11 @@ int CURLConnection::short_seek(int64_t off)
             RingBufferSkipBytes(pRbuf, len);
         }
 
-        if ((ret = FillBuffer(m_bufferSize)) < 0) {
+        lock.unlock();
+        ret = FillBuffer(m_bufferSize);
+        lock.lock();
+
+        if (ret < 0) {
             if (len && !RingBufferSkipBytes(pRbuf, -len)) {
                 AF_LOGE("%s - Failed to restore position after failed fill", __FUNCTION__);
             } else {
@@ -715,19 +731,23 @@ int CURLConnection::short_seek(int64_t off)
 
 int CURLConnection::readBuffer(void *buf, size_t size)
 {
-    //   double downloadSpeed;
-    //   CURLcode re = curl_easy_getinfo(pEasyHandle->http_handle, CURLINFO_SPEED_DOWNLOAD, &downloadSpeed);
-    /*if (re == CURLE_OK)
-        av_log(mCurlhttpContext.hd,AV_LOG_DEBUG,"download speed is %f\n",downloadSpeed);*/
+    std::unique_lock<std::mutex> lock(mMutex);
     uint32_t want = std::min(RingBuffergetMaxReadSize(pRbuf), (uint32_t) size);
 
     if (want > 0 && RingBufferReadData(pRbuf, (char *) buf, want) == want) {
         mFilePos += want;
+
+        if (mPaused) {
+            mPaused = false;
+            lock.unlock();
+            CURLMultiEngine::Instance()->resumeTransfer(this);
+        }
+
         return want;
     }
 
     /* check if we finished prematurely */
-    if (!still_running &&
+    if (mDone &&
             (mFileSize > 0 && mFilePos != mFileSize)) {
         AF_LOGE("%s - Transfer ended before entire file was retrieved pos %lld, size %lld",
                 __FUNCTION__, mFilePos, mFileSize);
@@ -8,8 +8,11 @@
 #include <curl/curl.h>
 #include <utils/ringBuffer.h>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <data_source/IDataSource.h>
+#include "CURLMultiEngine.h"
 
 namespace Cicada {
     class CURLConnection {
@@ -47,15 +50,47 @@ namespace Cicada {
 
         int readBuffer(void *buf, size_t size);
 
-        const char * getResponse(){
-            return response;
-        }
+        // a copy of the response headers received
+        std::string getResponse();
 
         CURL *getCurlHandle(){
             return mHttp_handle;
         }
 
+        // the info of the response, valid after FillBuffer
+        double getContentLength() const
+        {
+            return mContentLength;
+        }
+
+        const std::string &getEffectiveUrl() const
+        {
+            return mEffectiveUrl;
+        }
+
+        const std::string &getPrimaryIp() const
+        {
+            return mPrimaryIp;
+        }
+
+        long getResponseCode() const
+        {
+            return mResponseCode;
+        }
+
+        // the timing of the last transfer done
+        CURLMultiEngine::TransferTiming getTiming();
+
+        // called by CURLMultiEngine in the engine thread
+        void onTransferDone(CURLcode result, const CURLMultiEngine::TransferTiming &timing);
+
     private:
+        // 1 for done, 0 for retry with retryResult, < 0 for error
+        int checkResult(CURLcode result, CURLcode &retryResult);
+
+        // in the engine thread
+        void captureInfo();
+
         int esayHandle_set_common_opt();
 
         static int sockopt_callback(void *clientp, curl_socket_t curlfd, curlsocktype purpose);
@@ -84,11 +119,24 @@ namespace Cicada {
         Cicada::IDataSource::SourceConfig *mPConfig = nullptr;
         int64_t mFilePos = 0;
         int64_t mFileSize = -1;
-        CURLM *multi_handle = nullptr;
         CURL *mHttp_handle = nullptr;
         RingBuffer *pRbuf = nullptr;
-        int still_running = 0;
         char *response = nullptr;
+        int mPriority = IDataSource::SourceConfig::PrioritySegment;
+
+        // the ring buffer is written by the engine thread
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        bool mRunning = false;
+        bool mDone = false;
+        bool mPaused = false;
+        CURLcode mResult = CURLE_OK;
+        bool mInfoCaptured = false;
+        double mContentLength = -1;
+        std::string mEffectiveUrl;
+        std::string mPrimaryIp;
+        long mResponseCode = 0;
+        CURLMultiEngine::TransferTiming mTiming;
     };
 };
 
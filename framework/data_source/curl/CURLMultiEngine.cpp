@@ -0,0 +1,251 @@
+#define LOG_TAG "CURLMultiEngine"
+
+#include "CURLMultiEngine.h"
+#include "CURLConnection.h"
+#include <algorithm>
+#include <utils/frame_work_log.h>
+#include <utils/timer.h>
+
+#define POLL_TIMEOUT_MS 1000
+
+using namespace std;
+
+namespace Cicada {
+    CURLMultiEngine CURLMultiEngine::sInstance{};
+
+    // playlist > key > segment > prefetch, see IDataSource::SourceConfig::Priority
+    static const long streamWeights[] = {256, 128, 32, 8};
+
+    CURLMultiEngine *CURLMultiEngine::Instance()
+    {
+        return &sInstance;
+    }
+
+    CURLMultiEngine::~CURLMultiEngine()
+    {
+        if (mThread) {
+            mThread->prePause();
+            curl_multi_wakeup(mMulti);
+            delete mThread;
+        }
+
+        if (mMulti) {
+            curl_multi_cleanup(mMulti);
+        }
+    }
+
+    void CURLMultiEngine::addTransfer(CURLConnection *connection, int priority)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        if (mMulti == nullptr) {
+            mMulti = curl_multi_init();
+            curl_multi_setopt(mMulti, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+            mThread = NEW_AF_THREAD(loop);
+            mThread->start();
+        }
+
+        Transfer transfer{connection, priority, af_gettime_relative()};
+        auto item = find_if(mPending.begin(), mPending.end(), [priority](const Transfer &t) { return t.priority > priority; });
+        mPending.insert(item, transfer);
+        curl_multi_wakeup(mMulti);
+    }
+
+    void CURLMultiEngine::removeTransfer(CURLConnection *connection)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        CURL *handle = connection->getCurlHandle();
+        mResuming.erase(remove(mResuming.begin(), mResuming.end(), handle), mResuming.end());
+        auto item = find_if(mPending.begin(), mPending.end(), [connection](const Transfer &t) { return t.connection == connection; });
+
+        if (item != mPending.end()) {
+            mPending.erase(item);
+            return;
+        }
+
+        if (mRunning.find(handle) == mRunning.end()) {
+            return;
+        }
+
+        // the engine may be using the handle, wait for its ack, not only for the end of the transfer
+        mRemoving.push_back(handle);
+        curl_multi_wakeup(mMulti);
+        mCondition.wait(lock, [this, handle]() { return mRemoved.find(handle) != mRemoved.end(); });
+        mRemoved.erase(handle);
+    }
+
+    void CURLMultiEngine::resumeTransfer(CURLConnection *connection)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        CURL *handle = connection->getCurlHandle();
+
+        if (mRunning.find(handle) != mRunning.end()) {
+            mResuming.push_back(handle);
+            curl_multi_wakeup(mMulti);
+        }
+    }
+
+    void CURLMultiEngine::ackRemoveLocked(CURL *handle)
+    {
+        mRunning.erase(handle);
+        auto item = find(mRemoving.begin(), mRemoving.end(), handle);
+
+        if (item != mRemoving.end()) {
+            mRemoving.erase(item);
+            mRemoved.insert(handle);
+        }
+
+        mResuming.erase(remove(mResuming.begin(), mResuming.end(), handle), mResuming.end());
+        mCondition.notify_all();
+    }
+
+    void CURLMultiEngine::getStatistics(uint64_t &requests, uint64_t &connections)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        requests = mRequests;
+        connections = mConnections;
+    }
+
+    int CURLMultiEngine::loop()
+    {
+        processCommands();
+        int running = 0;
+        CURLMcode ret = curl_multi_perform(mMulti, &running);
+
+        if (ret != CURLM_OK) {
+            AF_LOGE("curl_multi_perform error %s", curl_multi_strerror(ret));
+        }
+
+        processDone();
+        curl_multi_poll(mMulti, nullptr, 0, POLL_TIMEOUT_MS, nullptr);
+        return 0;
+    }
+
+    void CURLMultiEngine::processCommands()
+    {
+        vector<CURL *> removing;
+        vector<CURL *> resuming;
+        vector<Transfer> adding;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            // the removes stay in mRemoving until acked, the waiters are not woken before
+            removing = mRemoving;
+            resuming.swap(mResuming);
+            int64_t now = af_gettime_relative();
+
+            // a paused transfer keeps its connection, so no limit of the running ones, only the order
+            while (!mPending.empty()) {
+                Transfer &transfer = mPending.front();
+                mRunning[transfer.connection->getCurlHandle()] = Running{transfer.connection, now - transfer.addTime};
+                adding.push_back(transfer);
+                mPending.pop_front();
+            }
+        }
+
+        /*
+         * the callbacks lock the connection, never call curl with mMutex locked.
+         * A handle in mRunning is not freed before its remove is acked by this thread, and only this thread
+         * erases it from mRunning, so a handle found in mRunning is valid until the curl call returns.
+         */
+        for (auto handle : removing) {
+            curl_multi_remove_handle(mMulti, handle);
+            std::unique_lock<std::mutex> lock(mMutex);
+            ackRemoveLocked(handle);
+        }
+
+        for (auto handle : resuming) {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+
+                if (mRunning.find(handle) == mRunning.end()) {
+                    continue;
+                }
+            }
+
+            curl_easy_pause(handle, CURLPAUSE_CONT);
+        }
+
+        for (auto &transfer : adding) {
+            CURL *handle = transfer.connection->getCurlHandle();
+            int priority = std::max(0, std::min(transfer.priority, (int) (sizeof(streamWeights) / sizeof(streamWeights[0])) - 1));
+            curl_easy_setopt(handle, CURLOPT_PRIVATE, transfer.connection);
+            curl_easy_setopt(handle, CURLOPT_STREAM_WEIGHT, streamWeights[priority]);
+            curl_multi_add_handle(mMulti, handle);
+        }
+    }
+
+    void CURLMultiEngine::processDone()
+    {
+        CURLMsg *msg;
+        int msgs;
+
+        while ((msg = curl_multi_info_read(mMulti, &msgs))) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            CURL *handle = msg->easy_handle;
+            CURLcode result = msg->data.result;
+            CURLConnection *connection = nullptr;
+            curl_easy_getinfo(handle, CURLINFO_PRIVATE, (char **) &connection);
+            TransferTiming timing{};
+            curl_off_t value = 0;
+            long connects = 0;
+
+            if (curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &value) == CURLE_OK) {
+                timing.nameLookup = value;
+            }
+
+            if (curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &value) == CURLE_OK) {
+                timing.connect = value;
+            }
+
+            if (curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &value) == CURLE_OK) {
+                timing.appConnect = value;
+            }
+
+            if (curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &value) == CURLE_OK) {
+                timing.startTransfer = value;
+            }
+
+            if (curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &value) == CURLE_OK) {
+                timing.total = value;
+            }
+
+            if (curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD_T, &value) == CURLE_OK) {
+                timing.bytes = value;
+            }
+
+            curl_easy_getinfo(handle, CURLINFO_HTTP_VERSION, &timing.httpVersion);
+            curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+            timing.reused = connects == 0;
+            curl_multi_remove_handle(mMulti, handle);
+
+            if (connection == nullptr) {
+                std::unique_lock<std::mutex> lock(mMutex);
+                ackRemoveLocked(handle);
+                continue;
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                auto item = mRunning.find(handle);
+
+                if (item != mRunning.end()) {
+                    timing.queue = item->second.queue;
+                }
+
+                mRequests++;
+                mConnections += connects;
+            }
+
+            // the connection is alive until it is erased from mRunning
+            connection->onTransferDone(result, timing);
+            {
+                // a remove asked meanwhile is done, the handle is out of the multi handle already
+                std::unique_lock<std::mutex> lock(mMutex);
+                ackRemoveLocked(handle);
+            }
+        }
+    }
+}// namespace Cicada
@@ -0,0 +1,106 @@
+#ifndef CICADAMEDIA_CURLMULTIENGINE_H
+#define CICADAMEDIA_CURLMULTIENGINE_H
+
+#include <condition_variable>
+#include <curl/curl.h>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <utils/afThread.h>
+
+namespace Cicada {
+    class CURLConnection;
+
+    /*
+     * One curl multi handle and one thread for the transfers of all the CURLConnections.
+     *
+     * The connection cache of the multi handle is shared, so the playlists, keys and segments of a host
+     * reuse the connections, and are multiplexed as HTTP/2 streams when the server and libcurl support it.
+     * The transfers added in one loop of the engine thread are started by priority, a transfer started is
+     * never held back for one of a higher priority added later. Then the priority is the HTTP/2 stream weight,
+     * so a playlist or a key is not behind the segments on a multiplexed connection.
+     *
+     * The callbacks of the easy handles are called in the engine thread, the multi handle is only used
+     * in the engine thread, the other threads post the commands and wake it up.
+     */
+    class CURLMultiEngine {
+    public:
+        // the time of a transfer, in us, from the request added to the engine
+        struct TransferTiming {
+            int64_t queue{0};
+            int64_t nameLookup{0};
+            int64_t connect{0};
+            int64_t appConnect{0};
+            int64_t startTransfer{0};
+            int64_t total{0};
+            int64_t bytes{0};
+            long httpVersion{0};
+            // no new connection made for the transfer
+            bool reused{false};
+        };
+
+        static CURLMultiEngine *Instance();
+
+        void addTransfer(CURLConnection *connection, int priority);
+
+        // no callback of the connection is called after return
+        void removeTransfer(CURLConnection *connection);
+
+        // continue a transfer paused by the write callback
+        void resumeTransfer(CURLConnection *connection);
+
+        void getStatistics(uint64_t &requests, uint64_t &connections);
+
+    private:
+        CURLMultiEngine() = default;
+
+        ~CURLMultiEngine();
+
+        int loop();
+
+        void processCommands();
+
+        void processDone();
+
+        // with mMutex locked
+        void ackRemoveLocked(CURL *handle);
+
+    private:
+        class Transfer {
+        public:
+            CURLConnection *connection;
+            int priority;
+            int64_t addTime;
+        };
+
+        static CURLMultiEngine sInstance;
+
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        // sorted by priority, FIFO in a priority, all started in the next loop
+        std::list<Transfer> mPending;
+        class Running {
+        public:
+            CURLConnection *connection;
+            // the time in mPending
+            int64_t queue;
+        };
+
+        // the commands are keyed by the easy handle, a handle is used by the engine only while it's in mRunning
+        std::map<CURL *, Running> mRunning;
+        std::vector<CURL *> mRemoving;
+        std::vector<CURL *> mResuming;
+        // the removes done by the engine, waited by removeTransfer
+        std::set<CURL *> mRemoved;
+
+        CURLM *mMulti{nullptr};
+        afThread *mThread{nullptr};
+        uint64_t mRequests{0};
+        uint64_t mConnections{0};
+    };
+}// namespace Cicada
+
+
+#endif//CICADAMEDIA_CURLMULTIENGINE_H
@@ -9,11 +9,15 @@
 #include "CURLShareInstance.h"
 #include <mutex>
 #include <cassert>
+#include <utils/MetaCache.h>
 
 extern "C" {
 #include <libavformat/avformat.h>
 };
 
+// the cdn nodes change, keep the ip for hours only
+#define LAST_IP_TTL (6 * 3600)
+
 namespace Cicada {
     CURLShareInstance CURLShareInstance::sInstance{};
 
@@ -31,11 +35,8 @@ namespace Cicada {
     }
 
 
-    curl_slist *CURLShareInstance::getHosts(const string &url, CURLSH **sh)
+    string CURLShareInstance::getHostName(const string &url)
     {
-        std::unique_lock<std::mutex> uMutex(globalSettings::getSetting()->getMutex());
-        const globalSettings::type_resolve &resolve = globalSettings::getSetting()->getResolve();
-        curl_slist *host = nullptr;
         char proto[256];
         char hostname[256];
         int port = 0;
@@ -53,10 +54,28 @@ namespace Cicada {
         assert(port > 0);
         string hostName = hostname;
         hostName += ":" + to_string(port);
+        return hostName;
+    }
+
+    curl_slist *CURLShareInstance::getHosts(const string &url, CURLSH **sh)
+    {
+        string hostName = getHostName(url);
+        std::unique_lock<std::mutex> uMutex(globalSettings::getSetting()->getMutex());
+        const globalSettings::type_resolve &resolve = globalSettings::getSetting()->getResolve();
+        curl_slist *host = nullptr;
         auto resolveItem = resolve.find(hostName);
         *sh = (CURLSH *) (*mShare);
 
         if (resolveItem == resolve.end() || (*resolveItem).second.empty()) {
+            string ip;
+            // the meta cache reads the properties in the settings
+            uMutex.unlock();
+
+            // not in the dns cache shared, a wrong ip affects this connection only
+            if (MetaCache::Instance()->get("dns", hostName, ip)) {
+                host = curl_slist_append(nullptr, (hostName + ":" + (ip.find(':') != string::npos ? "[" + ip + "]" : ip)).c_str());
+            }
+
             return host;
         }
 
@@ -78,5 +97,17 @@ namespace Cicada {
         return host;
     }
 
+    void CURLShareInstance::setLastIp(const string &url, const string &ip)
+    {
+        if (!ip.empty()) {
+            MetaCache::Instance()->put("dns", getHostName(url), ip, LAST_IP_TTL);
+        }
+    }
+
+    void CURLShareInstance::removeLastIp(const string &url)
+    {
+        MetaCache::Instance()->remove("dns", getHostName(url));
+    }
+
 }// namespace Cicada
 
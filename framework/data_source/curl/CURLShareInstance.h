@@ -21,6 +21,16 @@ namespace Cicada{
         static CURLShareInstance *Instance();
 
         curl_slist *getHosts(const string &url, CURLSH **sh);
+
+        // the last ip connected of the host, used to connect without a dns lookup after a restart
+        void setLastIp(const string &url, const string &ip);
+
+        // the last ip failed to connect
+        void removeLastIp(const string &url);
+
+    private:
+        static string getHostName(const string &url);
+
     private:
         CURLShareInstance();
 
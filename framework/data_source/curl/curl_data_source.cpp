@@ -59,60 +59,40 @@ CURLConnection *CurlDataSource::initConnection()
 int CurlDataSource::curl_connect(CURLConnection *pConnection, int64_t filePos)
 {
     int ret;
-    char *location = nullptr;
-    char *ipstr = nullptr;
-    double length;
-    long response;
     AF_LOGD("start connect %lld\n", filePos);
     pConnection->SetResume(filePos);
     pConnection->start();
 
     if ((ret = pConnection->FillBuffer(1)) < 0) {
         AF_LOGE("Connect, didn't get any data from stream.");
+        // maybe the last ip cached is out of service, look up it next time
+        if (!mInterrupt) {
+            CURLShareInstance::Instance()->removeLastIp(mLocation);
+        }
         return ret;
     }
 
     AF_LOGD("connected\n");
+    double length = pConnection->getContentLength();
 
-    if (CURLE_OK ==
-            curl_easy_getinfo(pConnection->getCurlHandle(), CURLINFO_CONTENT_LENGTH_DOWNLOAD, &length)) {
-        if (length < 0) {
-            length = 0.0;
-        }
-
-        if (length > 0.0) {
-            mFileSize = pConnection->tell() + (int64_t) length;
-            //AF_LOGE("file size is %lld\n",mFileSize);
-        } else {
-            mFileSize = 0;
-        }
-
-//        if (curlContext.fileSize == 0)
-//            curlContext.hd->is_streamed = 1;
-    }
-
-    if (CURLE_OK ==
-            curl_easy_getinfo(pConnection->getCurlHandle(), CURLINFO_EFFECTIVE_URL, &location)) {
-        if (location) {
-            mLocation = location;
-        }
+    if (length > 0.0) {
+        mFileSize = pConnection->tell() + (int64_t) length;
+        //AF_LOGE("file size is %lld\n",mFileSize);
+    } else {
+        mFileSize = 0;
     }
 
-    if (CURLE_OK == curl_easy_getinfo(pConnection->getCurlHandle(), CURLINFO_PRIMARY_IP, &ipstr)) {
-        if (ipstr) {
-            mIpStr = ipstr;
-        } else {
-            mIpStr = "";
-        }
+    if (!pConnection->getEffectiveUrl().empty()) {
+        mLocation = pConnection->getEffectiveUrl();
     }
 
-    if (CURLE_OK ==
-            curl_easy_getinfo(pConnection->getCurlHandle(), CURLINFO_RESPONSE_CODE, &response)) {
-        AF_LOGI("CURLINFO_RESPONSE_CODE is %d", response);
+    mIpStr = pConnection->getPrimaryIp();
+    CURLShareInstance::Instance()->setLastIp(mLocation, mIpStr);
+    long response = pConnection->getResponseCode();
+    AF_LOGI("CURLINFO_RESPONSE_CODE is %d", response);
 
-        if (response >= 400) {
-            return gen_framework_http_errno((int) response);
-        }
+    if (response >= 400) {
+        return gen_framework_http_errno((int) response);
     }
 
     return 0;
@@ -466,9 +446,11 @@ string CurlDataSource::GetOption(const string &key)
     std::lock_guard<std::mutex> lock(mMutex);
 
     if (key == "responseInfo") {
-        if (mPConnection && mPConnection->getResponse()) {
+        string response = mPConnection ? mPConnection->getResponse() : "";
+
+        if (!response.empty()) {
             CicadaJSONItem Json;
-            Json.addValue("response", mPConnection->getResponse());
+            Json.addValue("response", response);
             return Json.printJSON();
         } else {
             return "";
@@ -479,6 +461,25 @@ string CurlDataSource::GetOption(const string &key)
         return mConnectInfo;
     }
 
+    if (key == "transferTiming") {
+        if (mPConnection == nullptr) {
+            return "";
+        }
+
+        CURLMultiEngine::TransferTiming timing = mPConnection->getTiming();
+        CicadaJSONItem Json;
+        Json.addValue("queue", (double) timing.queue);
+        Json.addValue("nameLookup", (double) timing.nameLookup);
+        Json.addValue("connect", (double) timing.connect);
+        Json.addValue("appConnect", (double) timing.appConnect);
+        Json.addValue("startTransfer", (double) timing.startTransfer);
+        Json.addValue("total", (double) timing.total);
+        Json.addValue("bytes", (double) timing.bytes);
+        Json.addValue("httpVersion", (int) timing.httpVersion);
+        Json.addValue("reused", timing.reused);
+        return Json.printJSON();
+    }
+
     return IDataSource::GetOption(key);
 }
 
@@ -491,8 +492,9 @@ void CurlDataSource::fillConnectInfo()
     Json.addValue("openCost", (int) mOpenTimeMS);
     Json.addValue("ip", mIpStr);
 
-    if (mPConnection->getResponse()) {
-        const std::string strResponse = mPConnection->getResponse();
+    const std::string strResponse = mPConnection->getResponse();
+
+    if (!strResponse.empty()) {
         std::string theValue = DataSourceUtils::getPropertryOfResponse(strResponse, "EagleId:");
 
         if (!theValue.empty()) {
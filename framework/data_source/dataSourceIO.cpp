@@ -80,6 +80,11 @@ namespace Cicada {
         return len;
     }
 
+    int dataSourceIO::read(uint8_t *buf, int size)
+    {
+        return avio_read(mPb, buf, size);
+    }
+
     int64_t dataSourceIO::seek(int64_t offset, int whence)
     {
         return avio_seek(mPb, offset, whence);
@@ -23,6 +23,8 @@ namespace Cicada{ ;
 
         int get_line(char *buf, int maxlen);
 
+        int read(uint8_t *buf, int size);
+
         int64_t seek(int64_t offset, int whence);
 
         bool isEOF();
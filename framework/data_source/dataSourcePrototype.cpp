@@ -8,6 +8,9 @@
 #endif
 #include "../../plugin/BiDataSource.h"
 #include "ffmpeg_data_source.h"
+#ifndef WIN32
+#include "LocalFileDataSource.h"
+#endif
 
 using namespace Cicada;
 
@@ -47,6 +50,13 @@ Cicada::IDataSource *dataSourcePrototype::create(const std::string &uri, const C
         source = new CurlDataSource(uri);
     }
 
+#endif
+#ifndef WIN32
+    // also keeps the prototype of LocalFileDataSource linked from the static library
+    else if (LocalFileDataSource::probe(uri)) {
+        source = new LocalFileDataSource(uri);
+    }
+
 #endif
     else {
         source = new ffmpegDataSource(uri);
@@ -12,6 +12,7 @@ extern "C" {
 #include "AVBSF.h"
 #include "utils/ffmpeg_utils.h"
 #include "AdtsBSF.h"
+#include "AnnexbBSF.h"
 
 namespace Cicada {
     AVBSF::AVBSF()
@@ -194,6 +195,8 @@ namespace Cicada {
     {
         if (name == "h26xAnnexb2xVcc") {
             return new AFAVBSF();
+        } else if (name == "h26xVcc2Annexb") {
+            return new AnnexbBSF();
         }else if(name == "latm2Adts") {
             return new AdtsBSF();
         }
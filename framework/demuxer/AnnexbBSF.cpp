@@ -0,0 +1,306 @@
+#define LOG_TAG "AnnexbBSF"
+
+#include "AnnexbBSF.h"
+#include <cstring>
+#include <libavutil/intreadwrite.h>
+#include <utils/frame_work_log.h>
+
+#define START_CODE_SIZE 4
+
+using namespace Cicada;
+
+AnnexbBSF::AnnexbBSF()
+{
+    mPkt = av_packet_alloc();
+}
+
+AnnexbBSF::~AnnexbBSF()
+{
+    av_packet_free(&mPkt);
+}
+
+int AnnexbBSF::init(const std::string &name, AVCodecParameters *codecpar)
+{
+    if (name != "h26xVcc2Annexb") {
+        return -EINVAL;
+    }
+
+    int ret;
+
+    if (codecpar->codec_id == AV_CODEC_ID_H264) {
+        ret = parseAvcC(codecpar->extradata, codecpar->extradata_size);
+    } else if (codecpar->codec_id == AV_CODEC_ID_HEVC) {
+        ret = parseHvcC(codecpar->extradata, codecpar->extradata_size);
+    } else {
+        return -EINVAL;
+    }
+
+    if (ret < 0) {
+        AF_LOGW("invalid extra data of codec %d\n", codecpar->codec_id);
+        return ret;
+    }
+
+    mCodecId = codecpar->codec_id;
+    mRequiredParameterSets = mCodecId == AV_CODEC_ID_H264 ? (1u << 7 | 1u << 8) : (1u << 0 | 1u << 1 | 1u << 2);
+    // the decoder is opened with the parameter sets in annex b, as the ffmpeg bsf does
+    auto *extradata = static_cast<uint8_t *>(av_mallocz(mParameterSets.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+
+    if (extradata == nullptr) {
+        return -ENOMEM;
+    }
+
+    memcpy(extradata, mParameterSets.data(), mParameterSets.size());
+    av_free(codecpar->extradata);
+    codecpar->extradata = extradata;
+    codecpar->extradata_size = static_cast<int>(mParameterSets.size());
+    return 0;
+}
+
+int AnnexbBSF::parseAvcC(const uint8_t *data, int size)
+{
+    if (data == nullptr || size < 7 || data[0] != 1) {
+        return -EINVAL;
+    }
+
+    mLengthSize = (data[4] & 0x03) + 1;
+
+    if (mLengthSize == 3) {
+        return -EINVAL;
+    }
+
+    int pos = 5;
+
+    // the sps and then the pps
+    for (int i = 0; i < 2; i++) {
+        if (pos >= size) {
+            return -EINVAL;
+        }
+
+        int count = i == 0 ? data[pos] & 0x1f : data[pos];
+        pos++;
+
+        for (int j = 0; j < count; j++) {
+            if (pos + 2 > size) {
+                return -EINVAL;
+            }
+
+            int length = AV_RB16(data + pos);
+            pos += 2;
+
+            if (pos + length > size) {
+                return -EINVAL;
+            }
+
+            appendParameterSet(data + pos, length);
+            pos += length;
+        }
+    }
+
+    return 0;
+}
+
+int AnnexbBSF::parseHvcC(const uint8_t *data, int size)
+{
+    if (data == nullptr || size < 23 || AV_RB24(data) == 0x000001 || AV_RB32(data) == 0x00000001) {
+        return -EINVAL;
+    }
+
+    mLengthSize = (data[21] & 0x03) + 1;
+
+    if (mLengthSize == 3) {
+        return -EINVAL;
+    }
+
+    int arrays = data[22];
+    int pos = 23;
+
+    for (int i = 0; i < arrays; i++) {
+        if (pos + 3 > size) {
+            return -EINVAL;
+        }
+
+        // the nal type of the array
+        pos++;
+        int count = AV_RB16(data + pos);
+        pos += 2;
+
+        for (int j = 0; j < count; j++) {
+            if (pos + 2 > size) {
+                return -EINVAL;
+            }
+
+            int length = AV_RB16(data + pos);
+            pos += 2;
+
+            if (pos + length > size) {
+                return -EINVAL;
+            }
+
+            appendParameterSet(data + pos, length);
+            pos += length;
+        }
+    }
+
+    return 0;
+}
+
+void AnnexbBSF::appendParameterSet(const uint8_t *data, int size)
+{
+    uint8_t startCode[START_CODE_SIZE] = {0, 0, 0, 1};
+    mParameterSets.insert(mParameterSets.end(), startCode, startCode + START_CODE_SIZE);
+    mParameterSets.insert(mParameterSets.end(), data, data + size);
+}
+
+uint32_t AnnexbBSF::parameterSetBit(uint8_t header) const
+{
+    int type;
+
+    if (mCodecId == AV_CODEC_ID_H264) {
+        // sps or pps
+        type = header & 0x1f;
+        return type == 7 || type == 8 ? 1u << type : 0;
+    }
+
+    // vps, sps or pps
+    type = (header >> 1) & 0x3f;
+    return type >= 32 && type <= 34 ? 1u << (type - 32) : 0;
+}
+
+uint32_t AnnexbBSF::readLength(const uint8_t *data) const
+{
+    switch (mLengthSize) {
+        case 1:
+            return data[0];
+
+        case 2:
+            return AV_RB16(data);
+
+        default:
+            return AV_RB32(data);
+    }
+}
+
+int AnnexbBSF::push(AVPacket *pkt)
+{
+    if (pkt == nullptr) {
+        bEof = true;
+        return 0;
+    }
+
+    if (bEof) {
+        return -EINVAL;
+    }
+
+    if (mPkt->data || mPkt->side_data_elems) {
+        return -EAGAIN;
+    }
+
+    av_packet_move_ref(mPkt, pkt);
+    return 0;
+}
+
+int AnnexbBSF::pull(AVPacket *pkt)
+{
+    if (mPkt->data == nullptr) {
+        return bEof ? 0 : -EAGAIN;
+    }
+
+    const uint8_t *data = mPkt->data;
+    int size = mPkt->size;
+    int64_t outSize = 0;
+    uint32_t parameterSets = 0;
+
+    for (int pos = 0; pos < size;) {
+        if (size - pos < mLengthSize) {
+            av_packet_unref(mPkt);
+            return AVERROR_INVALIDDATA;
+        }
+
+        uint32_t length = readLength(data + pos);
+        pos += mLengthSize;
+
+        if (length > static_cast<uint32_t>(size - pos)) {
+            AF_LOGW("invalid nal length %u\n", length);
+            av_packet_unref(mPkt);
+            return AVERROR_INVALIDDATA;
+        }
+
+        if (length > 0) {
+            parameterSets |= parameterSetBit(data[pos]);
+        }
+
+        outSize += START_CODE_SIZE + length;
+        pos += length;
+    }
+
+    // a key frame with only some of them in band, an sps without the pps, gets all of them inserted
+    bool insertParameterSets = (mPkt->flags & AV_PKT_FLAG_KEY) && (parameterSets & mRequiredParameterSets) != mRequiredParameterSets;
+
+    if (mLengthSize == START_CODE_SIZE && !insertParameterSets) {
+        // the packets read by avformat are not shared, it's copied only if the buffer is not writable
+        if (mPkt->buf == nullptr || !av_buffer_is_writable(mPkt->buf)) {
+            mCopiedBytes += size;
+        }
+
+        int ret = av_packet_make_writable(mPkt);
+
+        if (ret < 0) {
+            av_packet_unref(mPkt);
+            return ret;
+        }
+
+        for (int pos = 0; pos < size;) {
+            uint32_t length = AV_RB32(mPkt->data + pos);
+            AV_WB32(mPkt->data + pos, 1);
+            pos += START_CODE_SIZE + length;
+        }
+
+        av_packet_move_ref(pkt, mPkt);
+        return pkt->size;
+    }
+
+    size_t total = static_cast<size_t>(outSize) + (insertParameterSets ? mParameterSets.size() : 0);
+
+    if (total > (size_t) (INT32_MAX - AV_INPUT_BUFFER_PADDING_SIZE)) {
+        av_packet_unref(mPkt);
+        return AVERROR_INVALIDDATA;
+    }
+
+    auto *out = static_cast<uint8_t *>(av_malloc(total + AV_INPUT_BUFFER_PADDING_SIZE));
+
+    if (out == nullptr) {
+        av_packet_unref(mPkt);
+        return -ENOMEM;
+    }
+
+    uint8_t *p = out;
+
+    if (insertParameterSets) {
+        memcpy(p, mParameterSets.data(), mParameterSets.size());
+        p += mParameterSets.size();
+    }
+
+    for (int pos = 0; pos < size;) {
+        uint32_t length = readLength(data + pos);
+        pos += mLengthSize;
+        AV_WB32(p, 1);
+        p += START_CODE_SIZE;
+        memcpy(p, data + pos, length);
+        p += length;
+        pos += length;
+    }
+
+    memset(out + total, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    int ret = av_packet_from_data(pkt, out, static_cast<int>(total));
+
+    if (ret < 0) {
+        av_free(out);
+        av_packet_unref(mPkt);
+        return ret;
+    }
+
+    av_packet_copy_props(pkt, mPkt);
+    av_packet_unref(mPkt);
+    mCopiedBytes += total;
+    return pkt->size;
+}
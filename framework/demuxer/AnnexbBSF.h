@@ -0,0 +1,61 @@
+#ifndef SOURCE_ANNEXBBSF_H
+#define SOURCE_ANNEXBBSF_H
+
+#include "AVBSF.h"
+#include <cstdint>
+#include <vector>
+
+namespace Cicada {
+    /*
+     * h264 and hevc in avcC/hvcC to annex b, in place of h264_mp4toannexb and hevc_mp4toannexb, which copy
+     * every packet to a new buffer.
+     *
+     * The packets are converted in place if the nal length size is 4, the packet is copied only to
+     * insert the parameter sets at the key frames not having them in band, or to make room for the
+     * start codes if the nal length size is smaller, with a single allocation.
+     */
+    class AnnexbBSF : public IAVBSF {
+    public:
+        AnnexbBSF();
+
+        ~AnnexbBSF() override;
+
+        int init(const std::string &name, AVCodecParameters *codecpar) override;
+
+        int push(AVPacket *pkt) override;
+
+        int pull(AVPacket *pkt) override;
+
+        // the bytes copied to the new packets, for the statistics
+        int64_t getCopiedBytes() const
+        {
+            return mCopiedBytes;
+        }
+
+    private:
+        int parseAvcC(const uint8_t *data, int size);
+
+        int parseHvcC(const uint8_t *data, int size);
+
+        void appendParameterSet(const uint8_t *data, int size);
+
+        // the bit of the sps/pps/vps in the mask of the parameter sets, 0 for the other nals
+        uint32_t parameterSetBit(uint8_t header) const;
+
+        uint32_t readLength(const uint8_t *data) const;
+
+    private:
+        AVPacket *mPkt{};
+        bool bEof{};
+        AVCodecID mCodecId{AV_CODEC_ID_NONE};
+        // the parameter sets a key frame must carry to be decoded without the inserted ones
+        uint32_t mRequiredParameterSets{0};
+        int mLengthSize{4};
+        // annex b, start code and nal of every sps/pps/vps
+        std::vector<uint8_t> mParameterSets{};
+        int64_t mCopiedBytes{0};
+    };
+}// namespace Cicada
+
+
+#endif//SOURCE_ANNEXBBSF_H
@@ -4,6 +4,7 @@
 
 #include "IDemuxer.h"
 
+#include <cerrno>
 #include <utility>
 
 namespace Cicada {
@@ -30,6 +31,30 @@ namespace Cicada {
         mInterruptCb = inter;
     }
 
+    int IDemuxer::ReadPackets(unique_ptr<IAFPacket> *packets, int &count, int index)
+    {
+        int max = count;
+        int ret = -EINVAL;
+        count = 0;
+
+        while (count < max) {
+            ret = ReadPacket(packets[count], index);
+
+            if (packets[count] == nullptr) {
+                break;
+            }
+
+            count++;
+
+            // an error or the end of stream
+            if (ret <= 0) {
+                break;
+            }
+        }
+
+        return ret;
+    }
+
     int IDemuxer::GetStreamMeta(unique_ptr<streamMeta> &meta, int index, bool sub) const
     {
         Stream_meta Meta;
@@ -70,6 +70,15 @@ namespace Cicada {
 
         virtual int ReadPacket(std::unique_ptr<IAFPacket> &packet, int index) = 0;
 
+        /**
+         * read the packets in a batch, as ReadPacket one by one, stop at the first read without a packet or returned <= 0
+         * @param packets at least count of them
+         * @param count in the max count to read, out the count of the packets read
+         * @param index
+         * @return the result of the last read
+         */
+        virtual int ReadPackets(std::unique_ptr<IAFPacket> *packets, int &count, int index);
+
         virtual void Close() = 0;
 
         virtual void Start() = 0;
@@ -0,0 +1,61 @@
+#include "SubtitleCueIndex.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace Cicada {
+    int64_t SubtitleCueIndex::getEnd(IAFPacket *cue)
+    {
+        return cue->getInfo().pts + max(cue->getInfo().duration, 0);
+    }
+
+    void SubtitleCueIndex::add(std::unique_ptr<IAFPacket> cue)
+    {
+        if (cue == nullptr) {
+            return;
+        }
+
+        int64_t start = cue->getInfo().pts;
+        auto pos = mCues.end();
+
+        if (start < lastStart()) {
+            pos = upper_bound(mCues.begin(), mCues.end(), start,
+                              [](int64_t pts, const unique_ptr<IAFPacket> &item) { return pts < item->getInfo().pts; });
+        }
+
+        auto index = static_cast<size_t>(pos - mCues.begin());
+        mCues.insert(pos, move(cue));
+        mMaxEnd.resize(mCues.size());
+
+        for (size_t i = index; i < mCues.size(); i++) {
+            int64_t end = getEnd(mCues[i].get());
+            mMaxEnd[i] = i > 0 ? max(mMaxEnd[i - 1], end) : end;
+        }
+    }
+
+    size_t SubtitleCueIndex::seek(int64_t pts) const
+    {
+        return static_cast<size_t>(lower_bound(mMaxEnd.begin(), mMaxEnd.end(), pts) - mMaxEnd.begin());
+    }
+
+    IAFPacket *SubtitleCueIndex::at(size_t index) const
+    {
+        return index < mCues.size() ? mCues[index].get() : nullptr;
+    }
+
+    size_t SubtitleCueIndex::size() const
+    {
+        return mCues.size();
+    }
+
+    int64_t SubtitleCueIndex::lastStart() const
+    {
+        return mCues.empty() ? INT64_MIN : mCues.back()->getInfo().pts;
+    }
+
+    void SubtitleCueIndex::clear()
+    {
+        mCues.clear();
+        mMaxEnd.clear();
+    }
+}// namespace Cicada
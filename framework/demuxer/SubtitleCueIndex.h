@@ -0,0 +1,44 @@
+#ifndef CICADA_PLAYER_SUBTITLECUEINDEX_H
+#define CICADA_PLAYER_SUBTITLECUEINDEX_H
+
+#include <base/media/IAFPacket.h>
+#include <memory>
+#include <vector>
+
+namespace Cicada {
+    /*
+     * The cues of a subtitle track, ordered by the start time.
+     *
+     * The cues can overlap and share a start time, a cue added with the start time of a cue in the index
+     * is put after it. mMaxEnd[i] is the latest end time of the cues 0..i, it is not decreasing, so the
+     * first cue not ended at a time is found by a binary search on it, even if a long cue overlaps
+     * the following ones.
+     */
+    class SubtitleCueIndex {
+    public:
+        // the cues come in the start order mostly, an early one is inserted to its place
+        void add(std::unique_ptr<IAFPacket> cue);
+
+        // the index of the first cue in the start order not ended at pts, size() if none
+        size_t seek(int64_t pts) const;
+
+        IAFPacket *at(size_t index) const;
+
+        size_t size() const;
+
+        // the start time of the last cue, INT64_MIN if empty
+        int64_t lastStart() const;
+
+        void clear();
+
+    private:
+        static int64_t getEnd(IAFPacket *cue);
+
+    private:
+        std::vector<std::unique_ptr<IAFPacket>> mCues;
+        std::vector<int64_t> mMaxEnd;
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_SUBTITLECUEINDEX_H
@@ -493,6 +493,16 @@ namespace Cicada {
 #if AF_HAVE_PTHREAD
             std::lock_guard<std::mutex> uLock(mCtxMutex);
 #endif
+            // convert in place by ourselves, fall back to the ffmpeg bsf if the extra data is not supported
+            if (bsfName == "h264_mp4toannexb" || bsfName == "hevc_mp4toannexb") {
+                mStreamCtxMap[index]->bsf = unique_ptr<IAVBSF>(IAVBSFFactory::create("h26xVcc2Annexb"));
+                ret = mStreamCtxMap[index]->bsf->init("h26xVcc2Annexb", mCtx->streams[index]->codecpar);
+
+                if (ret >= 0) {
+                    return ret;
+                }
+            }
+
             mStreamCtxMap[index]->bsf = unique_ptr<IAVBSF>(IAVBSFFactory::create(bsfName));
             ret = mStreamCtxMap[index]->bsf->init(bsfName, mCtx->streams[index]->codecpar);
 
@@ -725,6 +735,41 @@ namespace Cicada {
 #endif
     }
 
+    int avFormatDemuxer::ReadPackets(std::unique_ptr<IAFPacket> *packets, int &count, int index)
+    {
+#if AF_HAVE_PTHREAD
+
+        if (mPthread->getStatus() != afThread::THREAD_STATUS_IDLE && count > 0) {
+            int max = count;
+            count = 0;
+            // take the packets read ahead under one lock
+            std::unique_lock<std::mutex> waitLock(mQueLock);
+
+            while (count < max && !mPacketQueue.empty()) {
+                packets[count++] = std::move(mPacketQueue.front());
+                mPacketQueue.pop_front();
+            }
+
+            if (count > 0) {
+                mQueCond.notify_one();
+                return static_cast<int>(packets[count - 1]->getSize());
+            }
+
+            if (bEOS) {
+                return 0;
+            }
+
+            if (mError < 0) {
+                return mError;
+            }
+
+            return -EAGAIN;
+        }
+
+#endif
+        return IDemuxer::ReadPackets(packets, count, index);
+    }
+
     const std::string avFormatDemuxer::GetProperty(int index, const string &key) const
     {
         if (key == "probeInfo") {
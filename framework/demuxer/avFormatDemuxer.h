@@ -74,6 +74,8 @@ namespace Cicada {
 
         int ReadPacket(std::unique_ptr<IAFPacket> &packet, int index) override;
 
+        int ReadPackets(std::unique_ptr<IAFPacket> *packets, int &count, int index) override;
+
         virtual const std::string GetProperty(int index, const string &key) const override;
 
         bool isRealTimeStream(int index) override;
@@ -9,6 +9,7 @@
 
 #include <utils/errors/framework_error.h>
 #include <base/media/AVAFPacket.h>
+#include <algorithm>
 
 namespace Cicada {
     avFormatSubtitleDemuxer avFormatSubtitleDemuxer::se(0);
@@ -69,11 +70,6 @@ namespace Cicada {
         }
 
         bOpened = true;
-
-        do {
-            ret = readPacketInternal();
-        } while (ret >= 0);
-
         return 0;
     }
 
@@ -137,7 +133,6 @@ namespace Cicada {
             mPInPutPb = nullptr;
         }
 
-        mPacketMap.clear();
         bOpened = false;
     }
 
@@ -152,52 +147,31 @@ namespace Cicada {
 
     int64_t avFormatSubtitleDemuxer::Seek(int64_t us, int flags, int index)
     {
-        mSeekPTS = us;
-        return 0;
+        if (!bOpened) {
+            return -EINVAL;
+        }
+
+        // the subtitle demuxers of ffmpeg seek in the cues parsed
+        return avformat_seek_file(mCtx, -1, INT64_MIN, us, us, 0);
     }
 
     int avFormatSubtitleDemuxer::ReadPacket(std::unique_ptr<IAFPacket> &packet, int index)
     {
-        // TODO: EOF
-        if (mPacketMap.empty()) {
-            return -EAGAIN;
-        }
-
-        if (mSeekPTS != INT64_MIN) {
-            map::iterator item;
-
-            for (item = mPacketMap.begin(); item != mPacketMap.end(); ++item) {
-                if (item->second->getInfo().pts + item->second->getInfo().duration >= mSeekPTS) {
-                    mCurrent = item;
-                    break;
-                }
-            }
-
-            if (item == mPacketMap.end()) {
-                AF_LOGE("seek error\n");
-                return -EINVAL;
-            }
-
-            mSeekPTS = INT64_MIN;
-        }
+        int ret = readPacketInternal(packet);
 
-        if (mCurrentPts == INT64_MIN) {
-            mCurrent = mPacketMap.begin();
-            mCurrentPts = (*(mCurrent)).second->getInfo().pts;
+        if (ret == AVERROR_EOF) {
+            return 0;
         }
 
-        if (mCurrent != mPacketMap.end()) {
-            packet = ((*(mCurrent)).second->clone());
-            mCurrentPts = packet->getInfo().pts;
-            mCurrent++;
-        } else {
-            return 0;
+        if (ret < 0) {
+            return ret;
         }
 
-        return static_cast<int>(packet->getSize());
+        // 0 is the end of stream, an empty cue is returned as 1 byte
+        return std::max(static_cast<int>(packet->getSize()), 1);
     }
 
-    int avFormatSubtitleDemuxer::readPacketInternal()
+    int avFormatSubtitleDemuxer::readPacketInternal(std::unique_ptr<IAFPacket> &packet)
     {
         if (!bOpened) {
             return -EINVAL;
@@ -260,15 +234,8 @@ namespace Cicada {
         pkt->pts = av_rescale_q(pkt->pts, mCtx->streams[pkt->stream_index]->time_base, av_get_time_base_q());
         pkt->dts = av_rescale_q(pkt->dts, mCtx->streams[pkt->stream_index]->time_base, av_get_time_base_q());
         pkt->duration = av_rescale_q(pkt->duration, mCtx->streams[pkt->stream_index]->time_base, av_get_time_base_q());
-        int64_t pts = pkt->pts;
-
-        if (!mPacketMap[pts]) {
-            mPacketMap[pts] = unique_ptr<IAFPacket>(new AVAFPacket(&pkt));
-            mPacketMap[pts]->getInfo().timePosition = mPacketMap[pts]->getInfo().pts;
-        } else {
-            av_packet_free(&pkt);
-        }
-
+        packet = unique_ptr<IAFPacket>(new AVAFPacket(&pkt));
+        packet->getInfo().timePosition = packet->getInfo().pts;
         return err;
     }
 
@@ -8,13 +8,16 @@
 #include "IDemuxer.h"
 #include "demuxerPrototype.h"
 #include "utils/ffmpeg_utils.h"
-#include <map>
 
 extern "C" {
 #include <libavformat/avformat.h>
 };
 
 namespace Cicada {
+    /*
+     * Read the cues of a text subtitle file in the pts order, one by one, the cues are kept by the user,
+     * see SubtitleCueIndex.
+     */
     class avFormatSubtitleDemuxer : public IDemuxer, private demuxerPrototype {
 
         static const int INITIAL_BUFFER_SIZE = 32768;
@@ -75,18 +78,13 @@ namespace Cicada {
     private:
         static int interrupt_cb(void *opaque);
 
-        int readPacketInternal();
+        int readPacketInternal(std::unique_ptr<IAFPacket> &packet);
 
     private:
-        using map  = std::map<int64_t, std::unique_ptr<IAFPacket>>;
         bool bOpened{false};
         AVFormatContext *mCtx = nullptr;
         AVIOContext *mPInPutPb = nullptr;
         bool mInterrupted{false};
-        map mPacketMap;
-        map::iterator mCurrent = mPacketMap.end();
-        int64_t mCurrentPts = INT64_MIN;
-        int64_t mSeekPTS = INT64_MIN;
     };
 }
 
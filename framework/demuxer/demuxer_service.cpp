@@ -169,6 +169,16 @@ namespace Cicada {
         return ret;
     }
 
+    int demuxer_service::readPackets(std::unique_ptr<IAFPacket> *packets, int &count, int index)
+    {
+        if (mDemuxerPtr == nullptr) {
+            count = 0;
+            return -1;
+        }
+
+        return mDemuxerPtr->ReadPackets(packets, count, index);
+    }
+
     void demuxer_service::close()
     {
         AF_TRACE;
@@ -54,6 +54,9 @@ namespace Cicada {
 
         int readPacket(std::unique_ptr<IAFPacket> &packet, int index = -1);
 
+        // count in the max count to read, out the count of the packets read, return the result of the last read
+        int readPackets(std::unique_ptr<IAFPacket> *packets, int &count, int index = -1);
+
         void close();
 
         void flush();
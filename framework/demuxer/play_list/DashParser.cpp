@@ -0,0 +1,742 @@
+#define LOG_TAG "DashParser"
+
+#include "DashParser.h"
+#include "Helper.h"
+#include "SegmentTemplate.h"
+#include "playList_demuxer.h"
+#include <cstdlib>
+#include <cstring>
+#include <libxml/xmlreader.h>
+#include <utils/af_string.h>
+#include <utils/frame_work_log.h>
+#include <vector>
+
+#define CLOCK_FREQ INT64_C(1000000)
+#define READ_SIZE (32 * 1024)
+#define DEFAULT_RELOAD_INTERVAL (2 * CLOCK_FREQ)
+
+namespace Cicada {
+
+    namespace {
+        /*
+         * A pull reader for the mpd on the libxml2 xmlTextReader, no dom is built, so the big timelines
+         * are stored only once, in SegmentTemplate.
+         */
+        class MpdReader {
+        public:
+            enum Token { TOKEN_START, TOKEN_END, TOKEN_TEXT, TOKEN_DONE, TOKEN_ERROR };
+
+            MpdReader(const char *data, size_t size)
+            {
+                mReader = xmlReaderForMemory(data, static_cast<int>(size), nullptr, nullptr, XML_PARSE_NONET | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+            }
+
+            ~MpdReader()
+            {
+                if (mReader) {
+                    xmlFreeTextReader(mReader);
+                }
+            }
+
+            Token next()
+            {
+                if (mReader == nullptr) {
+                    return TOKEN_ERROR;
+                }
+
+                if (mSelfClosed) {
+                    mSelfClosed = false;
+                    return TOKEN_END;
+                }
+
+                while (true) {
+                    int ret = xmlTextReaderRead(mReader);
+
+                    if (ret == 0) {
+                        return TOKEN_DONE;
+                    } else if (ret < 0) {
+                        return TOKEN_ERROR;
+                    }
+
+                    switch (xmlTextReaderNodeType(mReader)) {
+                        case XML_READER_TYPE_ELEMENT:
+                            mName = toString(xmlTextReaderConstLocalName(mReader));
+                            mSelfClosed = xmlTextReaderIsEmptyElement(mReader) == 1;
+                            return TOKEN_START;
+
+                        case XML_READER_TYPE_END_ELEMENT:
+                            mName = toString(xmlTextReaderConstLocalName(mReader));
+                            return TOKEN_END;
+
+                        case XML_READER_TYPE_TEXT:
+                        case XML_READER_TYPE_CDATA:
+                            mText = toString(xmlTextReaderConstValue(mReader));
+                            return TOKEN_TEXT;
+
+                        default:
+                            break;
+                    }
+                }
+            }
+
+            // the local name, the namespace prefix removed
+            const std::string &name() const
+            {
+                return mName;
+            }
+
+            const std::string &text() const
+            {
+                return mText;
+            }
+
+            std::string attribute(const char *name, const std::string &defaultValue) const
+            {
+                xmlChar *value = xmlTextReaderGetAttribute(mReader, reinterpret_cast<const xmlChar *>(name));
+
+                if (value == nullptr) {
+                    return defaultValue;
+                }
+
+                std::string ret = toString(value);
+                xmlFree(value);
+                return ret;
+            }
+
+            int64_t attribute(const char *name, int64_t defaultValue) const
+            {
+                std::string value = attribute(name, std::string());
+                return !value.empty() ? strtoll(value.c_str(), nullptr, 10) : defaultValue;
+            }
+
+        private:
+            static std::string toString(const xmlChar *str)
+            {
+                return str ? std::string(reinterpret_cast<const char *>(str)) : std::string();
+            }
+
+        private:
+            xmlTextReaderPtr mReader{nullptr};
+            std::string mName;
+            std::string mText;
+            bool mSelfClosed{false};
+        };
+
+        // the SegmentTemplate attributes inherited from Period and AdaptationSet
+        struct TemplateInfo {
+            bool present{false};
+            std::string media;
+            std::string initialization;
+            int64_t timescale{-1};
+            int64_t startNumber{-1};
+            int64_t duration{-1};
+            int64_t presentationTimeOffset{-1};
+            std::shared_ptr<SegmentTemplate> timeline{nullptr};
+
+            void inherit(const TemplateInfo &parent)
+            {
+                if (!parent.present) {
+                    return;
+                }
+
+                present = true;
+
+                if (media.empty()) {
+                    media = parent.media;
+                }
+
+                if (initialization.empty()) {
+                    initialization = parent.initialization;
+                }
+
+                if (timescale < 0) {
+                    timescale = parent.timescale;
+                }
+
+                if (startNumber < 0) {
+                    startNumber = parent.startNumber;
+                }
+
+                if (duration < 0) {
+                    duration = parent.duration;
+                }
+
+                if (presentationTimeOffset < 0) {
+                    presentationTimeOffset = parent.presentationTimeOffset;
+                }
+
+                if (timeline == nullptr) {
+                    timeline = parent.timeline;
+                }
+            }
+        };
+
+        struct SegmentListInfo {
+            bool present{false};
+            std::string initialization;
+            int64_t timescale{-1};
+            int64_t duration{-1};
+            int64_t startNumber{-1};
+            std::vector<std::string> urls;
+        };
+
+        // the attributes of AdaptationSet and Representation
+        struct StreamInfo {
+            std::string id;
+            std::string mimeType;
+            std::string contentType;
+            std::string lang;
+            std::string label;
+            uint64_t bandwidth{0};
+            int width{0};
+            int height{0};
+            std::string baseUrl;
+            TemplateInfo segTemplate;
+            SegmentListInfo segList;
+
+            void read(const MpdReader &reader)
+            {
+                id = reader.attribute("id", id);
+                mimeType = reader.attribute("mimeType", mimeType);
+                contentType = reader.attribute("contentType", contentType);
+                lang = reader.attribute("lang", lang);
+                label = reader.attribute("label", label);
+                bandwidth = static_cast<uint64_t>(reader.attribute("bandwidth", static_cast<int64_t>(bandwidth)));
+                width = static_cast<int>(reader.attribute("width", static_cast<int64_t>(width)));
+                height = static_cast<int>(reader.attribute("height", static_cast<int64_t>(height)));
+            }
+        };
+
+        class MpdBuilder {
+        public:
+            MpdBuilder(playList *pList, const std::string &url) : mPlayList(pList), mUrl(url)
+            {}
+
+            ~MpdBuilder()
+            {
+                for (auto period : mPeriods) {
+                    delete period;
+                }
+
+                delete mAdaptSet;
+                delete mPeriod;
+            }
+
+            bool build(MpdReader &reader);
+
+        private:
+            void onStart(const MpdReader &reader);
+
+            void onEnd(const std::string &name);
+
+            void readTemplate(const MpdReader &reader, TemplateInfo &info);
+
+            void addRepresentation();
+
+            std::string getBaseUrl() const;
+
+            Stream_type getStreamType() const;
+
+        private:
+            playList *mPlayList;
+            std::string mUrl;
+            std::vector<std::string> mStack;
+
+            bool mDynamic{false};
+            int64_t mDuration{INT64_MIN};
+            int64_t mAvailabilityStartTime{INT64_MIN};
+            int64_t mTimeShiftBufferDepth{INT64_MIN};
+            int64_t mReloadInterval{INT64_MIN};
+            std::string mMpdBaseUrl;
+
+            std::vector<Period *> mPeriods;
+            Period *mPeriod{nullptr};
+            int64_t mPeriodStart{0};
+            int64_t mPeriodDuration{INT64_MIN};
+            std::string mPeriodBaseUrl;
+            TemplateInfo mPeriodTemplate;
+
+            AdaptationSet *mAdaptSet{nullptr};
+            StreamInfo mSetInfo;
+            StreamInfo mRepInfo;
+            bool mInRepresentation{false};
+        };
+
+        bool MpdBuilder::build(MpdReader &reader)
+        {
+            bool gotMpd = false;
+
+            while (true) {
+                MpdReader::Token token = reader.next();
+
+                if (token == MpdReader::TOKEN_DONE) {
+                    break;
+                } else if (token == MpdReader::TOKEN_ERROR) {
+                    AF_LOGE("bad mpd xml");
+                    return false;
+                } else if (token == MpdReader::TOKEN_START) {
+                    if (mStack.empty() && reader.name() != "MPD") {
+                        AF_LOGE("not a mpd, root is %s", reader.name().c_str());
+                        return false;
+                    }
+
+                    gotMpd = true;
+                    mStack.push_back(reader.name());
+                    onStart(reader);
+                } else if (token == MpdReader::TOKEN_END) {
+                    if (mStack.empty()) {
+                        return false;
+                    }
+
+                    onEnd(mStack.back());
+                    mStack.pop_back();
+                } else if (token == MpdReader::TOKEN_TEXT) {
+                    if (!mStack.empty() && mStack.back() == "BaseURL") {
+                        std::string url = reader.text();
+                        AfString::trimString(url);
+                        const std::string &parent = mStack[mStack.size() - 2];
+
+                        if (parent == "MPD") {
+                            mMpdBaseUrl = url;
+                        } else if (parent == "Period") {
+                            mPeriodBaseUrl = url;
+                        } else if (parent == "AdaptationSet") {
+                            mSetInfo.baseUrl = url;
+                        } else if (parent == "Representation") {
+                            mRepInfo.baseUrl = url;
+                        }
+                    }
+                }
+            }
+
+            if (!gotMpd || mPeriods.empty()) {
+                AF_LOGE("no period in mpd");
+                return false;
+            }
+
+            // HLSManager plays one period
+            size_t index = mDynamic ? mPeriods.size() - 1 : 0;
+
+            if (mPeriods.size() > 1) {
+                AF_LOGW("%d periods, only play the %s one", (int) mPeriods.size(), mDynamic ? "last" : "first");
+            }
+
+            mPlayList->addPeriod(mPeriods[index]);
+            mPeriods.erase(mPeriods.begin() + index);
+
+            if (mDynamic) {
+                mPlayList->setDuration(0);
+            } else if (mDuration != INT64_MIN) {
+                mPlayList->setDuration(mDuration);
+            } else if (mPeriodDuration != INT64_MIN) {
+                mPlayList->setDuration(mPeriodStart + mPeriodDuration);
+            }
+
+            return true;
+        }
+
+        void MpdBuilder::readTemplate(const MpdReader &reader, TemplateInfo &info)
+        {
+            info = TemplateInfo();
+            info.present = true;
+            info.media = reader.attribute("media", std::string());
+            info.initialization = reader.attribute("initialization", std::string());
+            info.timescale = reader.attribute("timescale", (int64_t) -1);
+            info.startNumber = reader.attribute("startNumber", (int64_t) -1);
+            info.duration = reader.attribute("duration", (int64_t) -1);
+            info.presentationTimeOffset = reader.attribute("presentationTimeOffset", (int64_t) -1);
+        }
+
+        void MpdBuilder::onStart(const MpdReader &reader)
+        {
+            const std::string &name = reader.name();
+            const std::string &parent = mStack.size() > 1 ? mStack[mStack.size() - 2] : std::string();
+
+            if (name == "MPD") {
+                mDynamic = reader.attribute("type", std::string("static")) == "dynamic";
+                mDuration = DashParser::parseDuration(reader.attribute("mediaPresentationDuration", std::string()));
+                mAvailabilityStartTime = DashParser::parseDateTime(reader.attribute("availabilityStartTime", std::string()));
+                mTimeShiftBufferDepth = DashParser::parseDuration(reader.attribute("timeShiftBufferDepth", std::string()));
+                mReloadInterval = DashParser::parseDuration(reader.attribute("minimumUpdatePeriod", std::string()));
+
+                if (mReloadInterval <= 0) {
+                    mReloadInterval = DashParser::parseDuration(reader.attribute("maxSegmentDuration", std::string()));
+                }
+
+                if (mDynamic && mAvailabilityStartTime == INT64_MIN) {
+                    AF_LOGW("dynamic mpd without availabilityStartTime");
+                    mAvailabilityStartTime = 0;
+                }
+            } else if (name == "Period") {
+                mPeriod = new Period(mPlayList);
+                int64_t start = DashParser::parseDuration(reader.attribute("start", std::string()));
+                int64_t duration = DashParser::parseDuration(reader.attribute("duration", std::string()));
+
+                if (start == INT64_MIN) {
+                    // follows the previous one
+                    start = mPeriodDuration != INT64_MIN ? mPeriodStart + mPeriodDuration : 0;
+                }
+
+                if (duration == INT64_MIN && !mDynamic && mDuration != INT64_MIN) {
+                    duration = mDuration - start;
+                }
+
+                mPeriodStart = start;
+                mPeriodDuration = duration;
+                mPeriodBaseUrl.clear();
+                mPeriodTemplate = TemplateInfo();
+            } else if (name == "AdaptationSet" && mPeriod) {
+                mAdaptSet = new AdaptationSet(mPeriod);
+                mSetInfo = StreamInfo();
+                mSetInfo.read(reader);
+            } else if (name == "Representation" && mAdaptSet) {
+                mInRepresentation = true;
+                mRepInfo = mSetInfo;
+                mRepInfo.id.clear();
+                mRepInfo.baseUrl.clear();
+                mRepInfo.segTemplate = TemplateInfo();
+                mRepInfo.segList = SegmentListInfo();
+                mRepInfo.read(reader);
+            } else if (name == "SegmentTemplate") {
+                if (parent == "Representation") {
+                    readTemplate(reader, mRepInfo.segTemplate);
+                } else if (parent == "AdaptationSet") {
+                    readTemplate(reader, mSetInfo.segTemplate);
+                } else if (parent == "Period") {
+                    readTemplate(reader, mPeriodTemplate);
+                }
+            } else if (name == "S" && mStack.size() > 3 && mStack[mStack.size() - 3] == "SegmentTemplate") {
+                const std::string &level = mStack[mStack.size() - 4];
+                TemplateInfo *info = level == "Representation" ? &mRepInfo.segTemplate
+                                                               : level == "AdaptationSet" ? &mSetInfo.segTemplate : &mPeriodTemplate;
+
+                if (info->timeline == nullptr) {
+                    info->timeline = std::make_shared<SegmentTemplate>();
+                }
+
+                info->timeline->addTimelineEntry(reader.attribute("t", (int64_t) -1), static_cast<uint64_t>(reader.attribute("d", (int64_t) 0)),
+                                                 reader.attribute("r", (int64_t) 0));
+            } else if (name == "SegmentList") {
+                SegmentListInfo &info = parent == "Representation" ? mRepInfo.segList : mSetInfo.segList;
+                info = SegmentListInfo();
+                info.present = true;
+                info.timescale = reader.attribute("timescale", (int64_t) -1);
+                info.duration = reader.attribute("duration", (int64_t) -1);
+                info.startNumber = reader.attribute("startNumber", (int64_t) -1);
+            } else if (name == "Initialization" && (parent == "SegmentList" || parent == "SegmentBase")) {
+                SegmentListInfo &info = mInRepresentation ? mRepInfo.segList : mSetInfo.segList;
+                info.initialization = reader.attribute("sourceURL", std::string());
+            } else if (name == "SegmentURL" && parent == "SegmentList") {
+                SegmentListInfo &info = mInRepresentation ? mRepInfo.segList : mSetInfo.segList;
+                info.urls.push_back(reader.attribute("media", std::string()));
+            }
+        }
+
+        void MpdBuilder::onEnd(const std::string &name)
+        {
+            if (name == "Representation") {
+                if (mInRepresentation) {
+                    addRepresentation();
+                }
+
+                mInRepresentation = false;
+            } else if (name == "AdaptationSet" && mAdaptSet) {
+                if (!mAdaptSet->getRepresentations().empty()) {
+                    std::string desc = !mSetInfo.label.empty() ? mSetInfo.label : mSetInfo.lang;
+
+                    if (!desc.empty()) {
+                        mAdaptSet->setDescription(desc);
+                    }
+
+                    mPeriod->addAdaptationSet(mAdaptSet);
+                } else {
+                    delete mAdaptSet;
+                }
+
+                mAdaptSet = nullptr;
+            } else if (name == "Period" && mPeriod) {
+                mPeriods.push_back(mPeriod);
+                mPeriod = nullptr;
+            }
+        }
+
+        std::string MpdBuilder::getBaseUrl() const
+        {
+            std::string url;
+
+            for (const std::string *part : {&mMpdBaseUrl, &mPeriodBaseUrl, &mSetInfo.baseUrl, &mRepInfo.baseUrl}) {
+                if (!part->empty()) {
+                    url = url.empty() ? *part : Helper::combinePaths(url, *part);
+                }
+            }
+
+            return url;
+        }
+
+        Stream_type MpdBuilder::getStreamType() const
+        {
+            const std::string &type = !mRepInfo.contentType.empty() ? mRepInfo.contentType : mRepInfo.mimeType;
+
+            if (type.compare(0, 5, "video") == 0) {
+                return STREAM_TYPE_VIDEO;
+            } else if (type.compare(0, 5, "audio") == 0) {
+                return STREAM_TYPE_AUDIO;
+            } else if (type.compare(0, 4, "text") == 0 || type == "application/ttml+xml") {
+                return STREAM_TYPE_SUB;
+            }
+
+            return STREAM_TYPE_MIXED;
+        }
+
+        void MpdBuilder::addRepresentation()
+        {
+            auto *rep = new Representation(mAdaptSet);
+            rep->setId(mRepInfo.id);
+            rep->setBandwidth(mRepInfo.bandwidth);
+            rep->setWidth(mRepInfo.width);
+            rep->setHeight(mRepInfo.height);
+            rep->setPlaylistUrl(mUrl);
+            rep->setBaseUrl(getBaseUrl());
+            rep->mPlayListType = playList_demuxer::playList_type_dash;
+            rep->mStreamType = getStreamType();
+            rep->mLang = mRepInfo.lang;
+            rep->b_live = mDynamic;
+            rep->targetDuration = static_cast<time_t>(mReloadInterval > 0 ? mReloadInterval : DEFAULT_RELOAD_INTERVAL);
+
+            auto *sList = new SegmentList(rep);
+            TemplateInfo info = mRepInfo.segTemplate;
+            info.inherit(mSetInfo.segTemplate);
+            info.inherit(mPeriodTemplate);
+
+            if (info.present && !info.media.empty()) {
+                auto *segTemplate = new SegmentTemplate();
+                segTemplate->setRepresentation(mRepInfo.id, mRepInfo.bandwidth);
+                segTemplate->setMedia(info.media);
+                segTemplate->setInitialization(info.initialization);
+                segTemplate->setTimescale(static_cast<uint64_t>(info.timescale > 0 ? info.timescale : 1));
+                segTemplate->setStartNumber(static_cast<uint64_t>(info.startNumber >= 0 ? info.startNumber : 1));
+                segTemplate->setDuration(static_cast<uint64_t>(info.duration > 0 ? info.duration : 0));
+                segTemplate->setPresentationTimeOffset(static_cast<uint64_t>(info.presentationTimeOffset > 0 ? info.presentationTimeOffset : 0));
+                segTemplate->setPeriod(mPeriodStart, mPeriodDuration);
+
+                if (mDynamic) {
+                    segTemplate->setAvailability(mAvailabilityStartTime, mTimeShiftBufferDepth);
+                }
+
+                if (info.timeline) {
+                    segTemplate->shareTimeline(*info.timeline);
+                }
+
+                sList->setSegmentTemplate(segTemplate);
+            } else {
+                const SegmentListInfo &listInfo = mRepInfo.segList.present ? mRepInfo.segList : mSetInfo.segList;
+                int64_t timescale = listInfo.timescale > 0 ? listInfo.timescale : 1;
+                uint64_t number = listInfo.startNumber >= 0 ? static_cast<uint64_t>(listInfo.startNumber) : 1;
+                std::shared_ptr<segment> initSegment = nullptr;
+
+                if (!listInfo.initialization.empty()) {
+                    initSegment = std::make_shared<segment>(0);
+                    initSegment->setSourceUrl(listInfo.initialization);
+                    sList->addInitSegment(initSegment);
+                }
+
+                if (listInfo.urls.empty()) {
+                    // SegmentBase or only a BaseURL, the whole file is one segment
+                    auto seg = std::make_shared<segment>(number);
+                    seg->startTime = 0;
+                    seg->duration = mPeriodDuration != INT64_MIN ? mPeriodDuration : -1;
+                    seg->init_section = initSegment;
+                    sList->addSegment(seg);
+                } else {
+                    int64_t duration = listInfo.duration > 0 ? listInfo.duration * CLOCK_FREQ / timescale : -1;
+
+                    for (auto &url : listInfo.urls) {
+                        auto seg = std::make_shared<segment>(number++);
+                        seg->setSourceUrl(url);
+                        seg->startTime = UINT64_MAX;
+                        seg->duration = duration;
+                        seg->init_section = initSegment;
+                        sList->addSegment(seg);
+                    }
+                }
+            }
+
+            rep->SetSegmentList(sList);
+            mAdaptSet->addRepresentation(rep);
+        }
+    }// namespace
+
+    DashParser::DashParser(const char *uri)
+    {
+        mUrl = uri;
+    }
+
+    DashParser::~DashParser()
+    {
+        if (mUseCallBack) {
+            delete mDataSourceIO;
+        }
+    }
+
+    int DashParser::probe(const uint8_t *buffer, int size)
+    {
+        static const char tag[] = "<MPD";
+        const int len = sizeof(tag) - 1;
+
+        for (int i = 0; i + len <= size; i++) {
+            if (memcmp(buffer + i, tag, len) == 0) {
+                return 100;
+            }
+        }
+
+        return 0;
+    }
+
+    playList *DashParser::parse(const std::string &playlisturl)
+    {
+        if (mDataSourceIO == nullptr) {
+            mDataSourceIO = new dataSourceIO(mReadCb, mSeekCb, mCBArg);
+        }
+
+        std::vector<char> data;
+        int ret;
+
+        do {
+            size_t size = data.size();
+            data.resize(size + READ_SIZE);
+            ret = mDataSourceIO->read(reinterpret_cast<uint8_t *>(data.data() + size), READ_SIZE);
+            data.resize(size + (ret > 0 ? ret : 0));
+        } while (ret > 0);
+
+        if (data.empty()) {
+            AF_LOGE("read mpd error %d", ret);
+            return nullptr;
+        }
+
+        return parse(data.data(), data.size(), playlisturl);
+    }
+
+    playList *DashParser::parse(const char *data, size_t size, const std::string &playlisturl)
+    {
+        auto *playlist = new playList();
+
+        if (!playlisturl.empty()) {
+            playlist->setPlaylistUrl(Helper::getDirectoryPath(playlisturl).append("/"));
+        }
+
+        MpdReader reader(data, size);
+        MpdBuilder builder(playlist, playlisturl);
+
+        if (!builder.build(reader)) {
+            delete playlist;
+            return nullptr;
+        }
+
+        return playlist;
+    }
+
+    Representation *DashParser::findRepresentation(playList *pList, const std::string &id)
+    {
+        for (auto &period : pList->GetPeriods()) {
+            for (auto &adaptSet : period->GetAdaptSets()) {
+                for (auto &rep : adaptSet->getRepresentations()) {
+                    if (rep->getId() == id) {
+                        return rep;
+                    }
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    int64_t DashParser::parseDuration(const std::string &value)
+    {
+        const char *p = value.c_str();
+
+        if (*p != 'P') {
+            return INT64_MIN;
+        }
+
+        p++;
+        bool inTime = false;
+        double seconds = 0;
+
+        while (*p) {
+            if (*p == 'T') {
+                inTime = true;
+                p++;
+                continue;
+            }
+
+            char *end = nullptr;
+            double number = strtod(p, &end);
+
+            if (end == p || *end == 0) {
+                return INT64_MIN;
+            }
+
+            switch (*end) {
+                case 'Y':
+                    seconds += number * 365 * 86400;
+                    break;
+
+                case 'M':
+                    seconds += inTime ? number * 60 : number * 30 * 86400;
+                    break;
+
+                case 'W':
+                    seconds += number * 7 * 86400;
+                    break;
+
+                case 'D':
+                    seconds += number * 86400;
+                    break;
+
+                case 'H':
+                    seconds += number * 3600;
+                    break;
+
+                case 'S':
+                    seconds += number;
+                    break;
+
+                default:
+                    return INT64_MIN;
+            }
+
+            p = end + 1;
+        }
+
+        return static_cast<int64_t>(seconds * CLOCK_FREQ);
+    }
+
+    int64_t DashParser::parseDateTime(const std::string &value)
+    {
+        int year, month, day, hour, minute;
+        double second = 0;
+        int consumed = 0;
+
+        if (sscanf(value.c_str(), "%d-%d-%dT%d:%d:%lf%n", &year, &month, &day, &hour, &minute, &second, &consumed) < 6) {
+            return INT64_MIN;
+        }
+
+        // days from 1970-01-01 of the civil date
+        int y = month <= 2 ? year - 1 : year;
+        int era = (y >= 0 ? y : y - 399) / 400;
+        int yoe = y - era * 400;
+        int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        int64_t days = static_cast<int64_t>(era) * 146097 + doe - 719468;
+        int64_t offset = 0;
+        const char *zone = value.c_str() + consumed;
+
+        if (*zone == '+' || *zone == '-') {
+            int zoneHour = 0, zoneMinute = 0;
+            sscanf(zone + 1, "%d:%d", &zoneHour, &zoneMinute);
+            offset = (zoneHour * 3600 + zoneMinute * 60) * (*zone == '+' ? 1 : -1);
+        }
+
+        return ((days * 86400 + hour * 3600 + minute * 60 - offset) * CLOCK_FREQ) + static_cast<int64_t>(second * CLOCK_FREQ);
+    }
+}// namespace Cicada
@@ -0,0 +1,43 @@
+#ifndef FRAMEWORK_DASHPARSER_H
+#define FRAMEWORK_DASHPARSER_H
+
+#include "playListParser.h"
+#include "../../data_source/dataSourceIO.h"
+#include <string>
+
+namespace Cicada {
+    class Representation;
+
+    /*
+     * Parse a dash mpd into the playList model.
+     *
+     * A SegmentTemplate (with @duration or a SegmentTimeline) is kept by a SegmentTemplate in the
+     * SegmentList, the segments are computed on demand, a SegmentList is materialized as the hls
+     * segments, a representation with only a BaseURL is one segment.
+     * HLSManager plays one period, the first one of a static mpd, the last one of a dynamic mpd.
+     */
+    class DashParser : public playListParser {
+    public:
+        explicit DashParser(const char *uri);
+
+        ~DashParser() override;
+
+        static int probe(const uint8_t *buffer, int size);
+
+        playList *parse(const std::string &playlisturl) override;
+
+        playList *parse(const char *data, size_t size, const std::string &playlisturl);
+
+        // the representation with @id in a reloaded mpd
+        static Representation *findRepresentation(playList *pList, const std::string &id);
+
+        // xs:duration, PT1H2M3.5S, in us
+        static int64_t parseDuration(const std::string &value);
+
+        // xs:dateTime, 2020-08-10T01:02:03.5Z, in utc us
+        static int64_t parseDateTime(const std::string &value);
+    };
+}// namespace Cicada
+
+
+#endif//FRAMEWORK_DASHPARSER_H
@@ -11,9 +11,16 @@
 #include "../../utils/frame_work_log.h"
 #include "../../utils/mediaFrame.h"
 #include <cerrno>
+#include <utils/CicadaJSON.h>
 #include <utils/errors/framework_error.h>
+#include <utils/timer.h>
 #include <cassert>
 
+// us, the packets read ahead by a rendition of the master playlist
+#define RENDITION_LOOK_AHEAD (3 * 1000 * 1000)
+// us, the packets returned after the last packet of a starved stream
+#define MAX_STARVED_SKEW (500 * 1000)
+
 namespace Cicada {
 
     HLSManager::HLSManager(playList *pList)
@@ -48,7 +55,9 @@ namespace Cicada {
                 auto representList = ait->getRepresentations();
 
                 for (auto &rit : representList) {
-                    rit->mPlayListType = playList_demuxer::playList_type_hls;
+                    if (rit->mPlayListType == playList_demuxer::playList_type_unknown) {
+                        rit->mPlayListType = playList_demuxer::playList_type_hls;
+                    }
                     auto *pTracker = new SegmentTracker(rit, mSourceConfig);
                     pTracker->setOptions(mOpts);
                     auto *info = new HLSStreamInfo();
@@ -61,6 +70,13 @@ namespace Cicada {
             }
         }
 
+        if (mStreamInfoList.size() > 1) {
+            // the renditions are fetched in parallel and merged by dts
+            for (auto &i : mStreamInfoList) {
+                i->mPStream->setLookAhead(RENDITION_LOOK_AHEAD);
+            }
+        }
+
         if (mStreamInfoList.size() == 1) {
             // mediaPlayList
             ret = (*mStreamInfoList.begin())->mPStream->open();
@@ -165,8 +181,6 @@ namespace Cicada {
 
     int HLSManager::ReadPacket(unique_ptr<IAFPacket> &packet, int index)
     {
-        IAFPacket *pFrameOut{};
-
         if (mMuxedStream) { //mediaPlayList
             int ret = mMuxedStream->read(packet);
 
@@ -177,7 +191,52 @@ namespace Cicada {
             return ret;
         }
 
-        // TODO: detect eos
+        int ret = readStreamHeads();
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        HLSStreamInfo *out = nullptr;
+
+        if (index != -1) {
+            for (auto &i : mStreamInfoList) {
+                if (i->mPFrame && i->mPFrame->getInfo().streamIndex == index) {
+                    out = i;
+                    break;
+                }
+            }
+        } else {
+            out = getMinDtsStream();
+        }
+
+        if (out == nullptr) {
+            for (auto &i : mStreamInfoList) {
+                if (i->mPStream->isOpened() && i->selected && !i->eos) {
+                    return -EAGAIN;
+                }
+            }
+
+            AF_LOGD("EOS");
+            return 0;
+        }
+
+        packet = move(out->mPFrame);
+
+        if (packet->getInfo().dts != INT64_MIN) {
+            out->lastDts = packet->getInfo().dts;
+        }
+
+        if (packet->getSize() == 0) {
+            AF_LOGD("EOS");
+            return 0;
+        }
+
+        return packet->getSize();
+    }
+
+    int HLSManager::readStreamHeads()
+    {
         int ret;
 
         for (auto &i : mStreamInfoList) {
@@ -186,10 +245,14 @@ namespace Cicada {
 
                 // AF_LOGD("CurSegNum is %llu", i.mPStream->getCurSegNum());
                 if (ret > 0) {
-//                    i.mPFrame->streamIndex = i->mPStream->getId();
                     // subId *100 + streamID
                     i->mPFrame->getInfo().streamIndex = GEN_STREAM_ID(i->mPStream->getId(),
                                                         i->mPFrame->getInfo().streamIndex);
+
+                    if (i->starved) {
+                        i->starvedTime += af_gettime_relative() - i->starvedStartTime;
+                        i->starved = false;
+                    }
                 } else if (ret == 0) {
                     // TODO: don't block here
                     AF_LOGD("EOF %d\n", i->mPStream->getId());
@@ -203,6 +266,8 @@ namespace Cicada {
                                 j->selected = true;
                                 j->stopOnSegEnd = false;
                                 j->toStreamId = -1;
+                                // the merge goes on from the switched stream
+                                j->lastDts = i->lastDts;
 
                                 if (i->mPStream->isLive()) {
                                     uint64_t targetPosition = i->mPStream->getCurSegPosition() + 1;
@@ -220,6 +285,7 @@ namespace Cicada {
 
                         i->stopOnSegEnd = false;
                         i->mPStream->stopOnSegEnd(false);
+                        resetStreamHead(i);
                         OpenStream(i->toStreamId);
                         AF_LOGD("change stream %d -> %d", i->mPStream->getId(), i->toStreamId);
                         i->toStreamId = -1;
@@ -227,68 +293,82 @@ namespace Cicada {
                     } else {
                         i->eos = true;
                     }
-                } else {
-                    if (ret == FRAMEWORK_ERR_FORMAT_NOT_SUPPORT) {
-                        AF_LOGE("read error %s\n", framework_err2_string(ret));
-                        i->eos = true;
-                        i->mPStream->stop();
-                    } else if (ret != -EAGAIN) {
-                        AF_LOGE("read error %d\n", ret);
-                    }
-
+                } else if (ret == FRAMEWORK_ERR_FORMAT_NOT_SUPPORT) {
+                    AF_LOGE("read error %s\n", framework_err2_string(ret));
+                    i->eos = true;
+                    i->mPStream->stop();
+                    return ret;
+                } else if (ret != -EAGAIN) {
+                    AF_LOGE("read error %d\n", ret);
                     return ret;
                 }
+
+                // no packet of the stream yet, the other streams are read still
             }
+        }
 
-            if (i->mPFrame) {
-                if (pFrameOut == nullptr) {
-                    pFrameOut = i->mPFrame.get();
-                } else if (i->mPFrame->getInfo().dts < pFrameOut->getInfo().dts) {
-                    pFrameOut = i->mPFrame.get();
-                }
+        return 0;
+    }
+
+    HLSManager::HLSStreamInfo *HLSManager::getMinDtsStream()
+    {
+        HLSStreamInfo *out = nullptr;
+
+        for (auto &i : mStreamInfoList) {
+            if (i->mPFrame && (out == nullptr || i->mPFrame->getInfo().dts < out->mPFrame->getInfo().dts)) {
+                out = i;
             }
         }
 
-        if (index != -1) {
-            pFrameOut = nullptr;
+        if (out == nullptr || out->mPFrame->getInfo().dts == INT64_MIN) {
+            return out;
+        }
 
-            for (auto &i : mStreamInfoList) {
-                if (i->mPStream->isOpened() && i->selected && i->mPFrame == nullptr && !i->eos) {
-                    if (i->mPFrame->getInfo().streamIndex == index) {
-                        pFrameOut = i->mPFrame.get();
-                        packet = move(i->mPFrame);
-                        break;
-                    }
-                }
+        int64_t dts = out->mPFrame->getInfo().dts;
+        bool wait = false;
+
+        for (auto &i : mStreamInfoList) {
+            if (!i->mPStream->isOpened() || !i->selected || i->mPFrame != nullptr || i->eos) {
+                continue;
             }
-        } else {
-            for (auto &i : mStreamInfoList) {
-                if (i->mPFrame) {
-//                    if (i->mPStream->getStreamType() == STREAM_TYPE_SUB) {
-//                        AF_LOGD("(%s)i->mPFrame->streamIndex is %x, pts is %lld %s\n", getStreamTypeName(i->mPStream),
-//                                i->mPFrame->streamIndex,
-//                                i->mPFrame->pts, i->mPFrame->pBuffer);
-//                    } else
-//                        AF_LOGD("(%s)i->mPFrame->streamIndex is %x, pts is %lld\n", getStreamTypeName(i->mPStream),
-//                                i->mPFrame->streamIndex,
-//                                i->mPFrame->pts);
-                }
 
-                if (pFrameOut == i->mPFrame.get()) {
-                    packet = move(i->mPFrame);
-                    break;
-                }
+            int type = i->mPStream->getStreamType();
+
+            // the subtitles are sparse, don't wait for them
+            if (type != STREAM_TYPE_VIDEO && type != STREAM_TYPE_AUDIO && type != STREAM_TYPE_MIXED) {
+                continue;
             }
 
-//            AF_LOGD("\n");
-        }
+            /*
+             * the next packet of the starved stream may be earlier than dts, so the packets of the others are
+             * returned up to the max skew after its last packet only, the others are fetched in the look ahead
+             */
+            if (i->lastDts != INT64_MIN && dts <= i->lastDts + MAX_STARVED_SKEW) {
+                continue;
+            }
 
-        if (pFrameOut == nullptr || pFrameOut->getSize() == 0) {
-            AF_LOGD("EOS");
-            return 0;
+            wait = true;
+
+            if (!i->starved && i->lastDts != INT64_MIN) {
+                i->starvedStartTime = af_gettime_relative();
+                i->starved = true;
+                i->starvedCount++;
+                AF_LOGI("stream %d starved at %lld\n", i->mPStream->getId(), (long long) i->lastDts);
+            }
         }
 
-        return packet->getSize();
+        return wait ? nullptr : out;
+    }
+
+    void HLSManager::resetStreamHead(HLSStreamInfo *info)
+    {
+        info->mPFrame = nullptr;
+        info->lastDts = INT64_MIN;
+
+        if (info->starved) {
+            info->starvedTime += af_gettime_relative() - info->starvedStartTime;
+            info->starved = false;
+        }
     }
 
     int HLSManager::OpenStream(int index)
@@ -335,6 +415,19 @@ namespace Cicada {
     {
         for (auto &i : mStreamInfoList) {
             if (i->mPStream->getId() == index) {
+                if (key == "starvation") {
+                    int64_t time = i->starvedTime;
+
+                    if (i->starved) {
+                        time += af_gettime_relative() - i->starvedStartTime;
+                    }
+
+                    CicadaJSONItem json;
+                    json.addValue("count", (double) i->starvedCount);
+                    json.addValue("time", (double) time);
+                    return json.printJSON();
+                }
+
                 return i->mPStream->GetProperty(key);
             }
         }
@@ -372,7 +465,7 @@ namespace Cicada {
                 // TODO: close the hlsStream? close at release
                 //  if (mStarted)
                 i->mPStream->stop();
-                i->mPFrame = nullptr;
+                resetStreamHead(i);
                 break;
             }
         }
@@ -486,7 +579,7 @@ namespace Cicada {
                     AF_LOGD("second seeked time is %lld --> %lld", us, seekedUs);
                 }
 
-                i->mPFrame = nullptr;
+                resetStreamHead(i);
             }
 
             return 0;
@@ -519,6 +612,7 @@ namespace Cicada {
         for (auto &i : mStreamInfoList) {
             if (i->mPStream->getId() == index) {
                 i->eos = false;
+                resetStreamHead(i);
                 return i->mPStream->seek(us, flags);
             }
         }
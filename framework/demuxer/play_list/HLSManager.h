@@ -7,6 +7,7 @@
 
 #include "PlaylistManager.h"
 #include "HLSStream.h"
+#include <atomic>
 #include <queue>
 
 namespace Cicada{
@@ -20,6 +21,14 @@ namespace Cicada{
             bool stopOnSegEnd = false;
             int toStreamId = -1;
             bool eos = false;
+            // the dts of the last packet returned
+            int64_t lastDts = INT64_MIN;
+            // the times and the us the merge waited for the stream
+            // read by GetProperty from the other threads
+            std::atomic_bool starved{false};
+            std::atomic<int64_t> starvedStartTime{INT64_MIN};
+            std::atomic<uint64_t> starvedCount{0};
+            std::atomic<int64_t> starvedTime{0};
         };
 
     public:
@@ -59,6 +68,15 @@ namespace Cicada{
 
         int64_t getTargetDuration() override;
 
+    private:
+        // read the heads of the streams, return < 0 on the errors to be returned
+        int readStreamHeads();
+
+        // the stream has the head to be returned by dts, nullptr if a stream of it is starved
+        HLSStreamInfo *getMinDtsStream();
+
+        static void resetStreamHead(HLSStreamInfo *info);
+
     private:
         std::list<HLSStreamInfo*> mStreamInfoList{};
         HLSStream *mMuxedStream = nullptr;
@@ -12,6 +12,8 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
+#include <thread>
 #include <data_source/dataSourcePrototype.h>
 #include <demuxer/DemuxerMeta.h>
 #include <demuxer/play_list/segment_decrypt/AES_128Decrypter.h>
@@ -19,12 +21,17 @@
 #include <utils/errors/framework_error.h>
 #include <utils/timer.h>
 #include <utils/DrmUtils.h>
+#include <utils/MetaCache.h>
 
 // TODO support active and no active mode
 
 namespace Cicada {
 
     static const int defaultInitSegSize = 1024 * 1024;
+    // the packets without timestamp don't grow the look ahead for ever
+    static const size_t maxLookAheadPackets = 2048;
+    // seconds, the content of an init section url doesn't change
+    static const int64_t initSectionCacheTTL = 24 * 3600;
 
     const char *HLSStream::hls_id3 = "id3v2_priv.com.apple.streaming.transportStreamTimestamp";
 
@@ -253,6 +260,100 @@ namespace Cicada {
         return 0;
     }
 
+    int HLSStream::fetchInitSection(const std::shared_ptr<segment> &initSeg, uint8_t **buffer, int64_t *size)
+    {
+        int64_t startTime = af_getsteady_ms();
+        string uri = Helper::combinePaths(mPTracker->getBaseUri(), initSeg->getDownloadUrl());
+        AF_LOGI("fetchInitSection: %s\n", uri.c_str());
+        string cacheKey = uri + "@" + to_string(initSeg->rangeStart) + "-" + to_string(initSeg->rangeEnd);
+        string cached;
+
+        if (MetaCache::Instance()->get("initSection", cacheKey, cached)) {
+            auto *data = static_cast<uint8_t *>(malloc(cached.size()));
+            memcpy(data, cached.data(), cached.size());
+            *buffer = data;
+            *size = static_cast<int64_t>(cached.size());
+            addStartupEvent("initSection", startTime, 0);
+            return 0;
+        }
+
+        IDataSource *source = dataSourcePrototype::create(uri, mOpts);
+        source->Set_config(mSourceConfig);
+        source->Interrupt(mInterrupted);
+        {
+            std::lock_guard<std::mutex> lock(mHLSMutex);
+            mInitSegSource = source;
+        }
+        int retryTimes = 0;
+        int ret;
+
+        do {
+            source->setRange(initSeg->rangeStart, initSeg->rangeEnd);
+            ret = retryTimes == 0 ? source->Open(0) : source->Open(uri);
+            retryTimes++;
+
+            if (!isHttpError(ret) || retryTimes > 2) {
+                break;
+            }
+
+            af_msleep(20);
+        } while (!mInterrupted);
+
+        if (ret >= 0) {
+            int64_t bufferSize = source->Seek(0, SEEK_SIZE);
+
+            if (bufferSize <= 0) {
+                bufferSize = defaultInitSegSize;
+            }
+
+            auto *data = static_cast<uint8_t *>(malloc(bufferSize));
+            int64_t readSize = 0;
+
+            while (readSize < bufferSize) {
+                int len = source->Read(data + readSize, (size_t) (bufferSize - readSize));
+
+                if (len <= 0) {
+                    break;
+                }
+
+                readSize += len;
+            }
+
+            *buffer = data;
+            *size = readSize;
+
+            if (readSize > 0) {
+                MetaCache::Instance()->put("initSection", cacheKey, string(reinterpret_cast<char *>(data), readSize), initSectionCacheTTL);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mHLSMutex);
+            openInfoArray.addJSON(CicadaJSONItem(source->GetOption("connectInfo")));
+            mInitSegSource = nullptr;
+        }
+        source->Close();
+        delete source;
+        addStartupEvent("initSection", startTime, ret);
+        return ret;
+    }
+
+    void HLSStream::addStartupEvent(const char *name, int64_t startTime, int ret)
+    {
+        if (mStartupFinished) {
+            return;
+        }
+
+        CicadaJSONItem item;
+        item.addValue("name", name);
+        item.addValue("streamId", mId);
+        item.addValue("start", (double) startTime);
+        item.addValue("end", (double) af_getsteady_ms());
+        item.addValue("ret", ret);
+        std::lock_guard<std::mutex> lock(mHLSMutex);
+        mStartupTimeline.addJSON(item);
+    }
+
     static inline uint64_t getSize(const uint8_t *data, unsigned int len, unsigned int shift)
     {
         uint64_t size(0);
@@ -270,8 +371,14 @@ namespace Cicada {
         int ret;
         AF_LOGD("mPTracker type is %d\n", mPTracker->getStreamType());
         //  mPTracker->setCurSegNum(0);
+        bool loadPlayList = !mPTracker->isInited();
+        int64_t startTime = af_getsteady_ms();
         ret = mPTracker->init();
 
+        if (loadPlayList) {
+            addStartupEvent("playList", startTime, ret);
+        }
+
         if (ret < 0) {
             AF_TRACE;
             return ret;
@@ -340,17 +447,58 @@ namespace Cicada {
                 }
             }
 
-            ret = upDateInitSection();
+            std::shared_ptr<segment> initSeg = mCurSeg->init_section;
+            /*
+             * the init section and the segment are independent requests, fetch the init section
+             * by another connection while opening the segment, rather than one after the other.
+             * a decrypter or an external data source is bound to a single source, do it serially.
+             */
+            bool parallelInitSeg = initSeg != nullptr && initSeg != mCurInitSeg && mExtDataSource == nullptr &&
+                                   mSegDecrypter == nullptr;
+            std::thread initSegThread;
+            uint8_t *initSegBuffer = nullptr;
+            int64_t initSegSize = 0;
+            int initSegRet = 0;
+
+            if (parallelInitSeg) {
+                initSegThread = std::thread([this, &initSeg, &initSegBuffer, &initSegSize, &initSegRet]() {
+                    initSegRet = fetchInitSection(initSeg, &initSegBuffer, &initSegSize);
+                });
+            } else {
+                ret = upDateInitSection();
 
-            if (ret < 0) {
-                return ret;
+                if (ret < 0) {
+                    return ret;
+                }
             }
 
             string uri;
             uri = Helper::combinePaths(mPTracker->getBaseUri(),
                                        mCurSeg->getDownloadUrl());
             AF_LOGD("open uri is %s seq is %llu\n", uri.c_str(), mCurSeg->sequence);
+            startTime = af_getsteady_ms();
             ret = tryOpenSegment(uri, mCurSeg->rangeStart, mCurSeg->rangeEnd);
+            addStartupEvent("segment", startTime, ret);
+
+            if (parallelInitSeg) {
+                initSegThread.join();
+
+                if (initSegRet < 0) {
+                    AF_LOGE("fetch init section error %d\n", initSegRet);
+                    free(initSegBuffer);
+                    resetSource();
+                    return initSegRet;
+                }
+
+                if (mInitSegBuffer) {
+                    free(mInitSegBuffer);
+                }
+
+                mInitSegBuffer = initSegBuffer;
+                mInitSegSize = initSegSize;
+                mInitSegPtr = 0;
+                mCurInitSeg = initSeg;
+            }
 
             if (isHttpError(ret)) {
                 resetSource();
@@ -374,10 +522,13 @@ namespace Cicada {
             return FRAMEWORK_ERR_EXIT;
         }
 
+        startTime = af_getsteady_ms();
         ret = createDemuxer();
+        addStartupEvent("probe", startTime, ret);
 
         if (ret >= 0) {
             mIsOpened_internal = true;
+            mStartupFinished = true;
         } else {
             AF_LOGE("open demuxer error %d\n", ret);
             return ret;
@@ -618,7 +769,9 @@ namespace Cicada {
             std::lock_guard<std::mutex> lock(mHLSMutex);
             delete mSegKeySource;
             mSegKeySource = dataSourcePrototype::create(keyUrl, mOpts);
-            mSegKeySource->Set_config(mSourceConfig);
+            IDataSource::SourceConfig config = mSourceConfig;
+            config.priority = IDataSource::SourceConfig::PriorityKey;
+            mSegKeySource->Set_config(config);
         }
         int ret = mSegKeySource->Open(0);
 
@@ -759,6 +912,11 @@ namespace Cicada {
         mIsOpened = false;
         mIsOpened_internal = false;
         openInfoArray.reset();
+        {
+            std::lock_guard<std::mutex> lock(mHLSMutex);
+            mStartupTimeline.reset();
+        }
+        mStartupFinished = false;
     }
 
     int HLSStream::read_thread()
@@ -805,7 +963,7 @@ namespace Cicada {
         {
             std::unique_lock<std::mutex> waitLock(mDataMutex);
             bool waitResult = mWaitCond.wait_for(waitLock, std::chrono::milliseconds(10), [this]() {
-                return mQueue.size() <= 1 || mInterrupted || mSwitchNeedBreak;
+                return needReadAhead() || mInterrupted || mSwitchNeedBreak;
             });
 
             if (!waitResult || mInterrupted || mSwitchNeedBreak) {
@@ -847,6 +1005,32 @@ namespace Cicada {
         return 0;
     }
 
+    bool HLSStream::needReadAhead() const
+    {
+        if (mQueue.size() <= 1) {
+            return true;
+        }
+
+        if (mLookAhead <= 0 || mQueue.size() >= maxLookAheadPackets) {
+            return false;
+        }
+
+        int64_t first = mQueue.front()->getInfo().dts;
+        int64_t last = mQueue.back()->getInfo().dts;
+
+        if (first == INT64_MIN || last == INT64_MIN) {
+            first = mQueue.front()->getInfo().pts;
+            last = mQueue.back()->getInfo().pts;
+        }
+
+        // no timestamp to measure, keep the two packets only
+        if (first == INT64_MIN || last == INT64_MIN) {
+            return false;
+        }
+
+        return last - first < mLookAhead;
+    }
+
     int HLSStream::read(unique_ptr<IAFPacket> &packet)
     {
         int ret;
@@ -1217,6 +1401,14 @@ namespace Cicada {
         return INT64_MIN;
     }
 
+    int64_t HLSStream::getPartTargetDuration()
+    {
+        if (mPTracker) {
+            return mPTracker->getPartTargetDuration();
+        }
+        return INT64_MIN;
+    }
+
     int HLSStream::start()
     {
 //        demuxer_msg::StartReq start;
@@ -1491,6 +1683,10 @@ namespace Cicada {
                 mSegKeySource->Interrupt(static_cast<bool>(inter));
             }
 
+            if (mInitSegSource) {
+                mInitSegSource->Interrupt(static_cast<bool>(inter));
+            }
+
             if (mPdataSource) {
                 mPdataSource->Interrupt(static_cast<bool>(inter));
             }
@@ -1532,6 +1728,13 @@ namespace Cicada {
             }
         } else if ("keyUrl" == key) {
             return mCurrentEncryption.keyUrl;
+        } else if ("startupTimeline" == key) {
+            std::lock_guard<std::mutex> lock(mHLSMutex);
+            return mStartupTimeline.printJSON();
+        } else if ("targetDuration" == key) {
+            return AfString::to_string(getTargetDuration());
+        } else if ("partTargetDuration" == key) {
+            return AfString::to_string(getPartTargetDuration());
         }
 
         return "";
@@ -101,7 +101,20 @@ namespace Cicada {
 
         int64_t getTargetDuration();
 
+        int64_t getPartTargetDuration();
+
+        /*
+         * us, the packets read ahead by the read thread, the renditions of a master playlist are fetched in
+         * parallel up to it. 0 for two packets only
+         */
+        void setLookAhead(int64_t duration)
+        {
+            mLookAhead = duration;
+        }
+
     private:
+        // called with mDataMutex locked
+        bool needReadAhead() const;
 
         static const char *hls_id3;
 
@@ -136,6 +149,10 @@ namespace Cicada {
 
         CicadaJSONArray openInfoArray;
 
+        // steady time(ms) of the requests made before the first packet, to evaluate the startup
+        CicadaJSONArray mStartupTimeline;
+        std::atomic_bool mStartupFinished{false};
+
         int openSegment(const string &uri, int64_t start = INT64_MIN, int64_t end = INT64_MIN);
 
         int tryOpenSegment(const string &uri, int64_t start, int64_t end);
@@ -148,6 +165,10 @@ namespace Cicada {
 
         int upDateInitSection();
 
+        int fetchInitSection(const std::shared_ptr<segment> &initSeg, uint8_t **buffer, int64_t *size);
+
+        void addStartupEvent(const char *name, int64_t startTime, int ret);
+
         int64_t seekSegment(off_t offset, int whence);
 
         int updateSegment();
@@ -188,7 +209,9 @@ namespace Cicada {
         std::mutex mDataMutex;
         std::condition_variable mWaitCond;
         std::deque<unique_ptr<IAFPacket>> mQueue;
+        std::atomic<int64_t> mLookAhead{0};
         IDataSource *mSegKeySource = nullptr;
+        IDataSource *mInitSegSource = nullptr;
         mutable std::mutex mHLSMutex;
 
         int read_thread();
@@ -50,6 +50,16 @@ namespace Cicada{
 
         void setHeight(int height);
 
+        void setId(const std::string &id)
+        {
+            mId = id;
+        }
+
+        const std::string &getId()
+        {
+            return mId;
+        }
+
         void print();
 
         int getStreamInfo(int *width, int *height, uint64_t *bandwidth, std::string &language);
@@ -70,7 +80,7 @@ namespace Cicada{
 
     private:
         SegmentList *mPSegList = nullptr;
-        int id = -1;
+        std::string mId = "";
         AdaptationSet *mAdapt = nullptr;
         std::string mBaseUrl = "";
         std::string mPlaylistUrl;
@@ -28,6 +28,11 @@ namespace Cicada {
         int i = 0;
         std::lock_guard<std::mutex> uMutex(segmetsMuxtex);
 
+        if (mTemplate) {
+            uint64_t last = mTemplate->getLastNumber();
+            return mTemplate->getSegmentCount() > 0 && last > number ? static_cast<int>(last - number) : 0;
+        }
+
         for (auto &segment : segments) {
             if (segment->sequence > number) {
                 ++i;
@@ -41,6 +46,10 @@ namespace Cicada {
     {
         std::lock_guard<std::mutex> uMutex(segmetsMuxtex);
 
+        if (mTemplate) {
+            return mTemplate->getSegmentByNumber(number);
+        }
+
         for (auto &segment : segments) {
             if (segment->getSequenceNumber() >= number) {
                 return segment;
@@ -85,6 +94,10 @@ namespace Cicada {
         uint64_t duration = 0;
         std::lock_guard<std::mutex> uMutex(segmetsMuxtex);
 
+        if (mTemplate) {
+            return mTemplate->getSegmentNumberByTime(time, num);
+        }
+
         for (auto &i : segments) {
             duration += i->duration;
 
@@ -101,6 +114,17 @@ namespace Cicada {
 
     int SegmentList::merge(SegmentList *pSList)
     {
+        if (pSList->mTemplate) {
+            std::lock_guard<std::mutex> uMutex(segmetsMuxtex);
+
+            if (mTemplate) {
+                mTemplate->updateTimeline(*pSList->mTemplate);
+            }
+
+            delete pSList;
+            return 0;
+        }
+
         int seqNum = static_cast<int>(mLastSeqNum);
         auto &sList = pSList->getSegments();
         int size = sList.size();
@@ -136,10 +160,20 @@ namespace Cicada {
 
     uint64_t SegmentList::getFirstSeqNum() const
     {
+        if (mTemplate) {
+            std::lock_guard<std::mutex> uMutex(segmetsMuxtex);
+            return mTemplate->getFirstNumber();
+        }
+
         return static_cast<uint64_t>(mFirstSeqNum);
     }
     uint64_t SegmentList::getLastSeqNum() const
     {
+        if (mTemplate) {
+            std::lock_guard<std::mutex> uMutex(segmetsMuxtex);
+            return mTemplate->getLastNumber();
+        }
+
         return static_cast<uint64_t>(mLastSeqNum);
     }
 
@@ -183,4 +217,21 @@ namespace Cicada {
         }
         return mRep->targetDuration;
     }
+
+    uint64_t SegmentList::getSegmentCount()
+    {
+        std::lock_guard<std::mutex> uMutex(segmetsMuxtex);
+
+        if (mTemplate) {
+            return mTemplate->getSegmentCount();
+        }
+
+        return segments.size();
+    }
+
+    void SegmentList::setSegmentTemplate(SegmentTemplate *segTemplate)
+    {
+        std::lock_guard<std::mutex> uMutex(segmetsMuxtex);
+        mTemplate = std::unique_ptr<SegmentTemplate>(segTemplate);
+    }
 }// namespace Cicada
@@ -8,6 +8,7 @@
 #include <list>
 #include "segment.h"
 #include "Representation.h"
+#include "SegmentTemplate.h"
 #include <mutex>
 #include <memory>
 
@@ -46,12 +47,22 @@ namespace Cicada{
 
         int64_t getTargetDuration();
 
+        uint64_t getSegmentCount();
+
+        // the segments are computed by the template instead of kept in the list, takes the ownership
+        void setSegmentTemplate(SegmentTemplate *segTemplate);
+
+        SegmentTemplate *getSegmentTemplate()
+        {
+            return mTemplate.get();
+        }
+
     private:
         void updateLastLHLSSegment(const std::shared_ptr<segment> &seg);
         
         std::list<std::shared_ptr<segment>> segments;
 
-        std::mutex segmetsMuxtex;
+        mutable std::mutex segmetsMuxtex;
         Representation *mRep = nullptr;
 
         int64_t mFirstSeqNum = -1;
@@ -61,6 +72,8 @@ namespace Cicada{
 
         std::vector<std::shared_ptr<segment>> initSegment;
 
+        std::unique_ptr<SegmentTemplate> mTemplate{nullptr};
+
     };
 }
 
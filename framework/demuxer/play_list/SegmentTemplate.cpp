@@ -0,0 +1,416 @@
+#define LOG_TAG "SegmentTemplate"
+
+#include "SegmentTemplate.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <utils/frame_work_log.h>
+#include <utils/timer.h>
+
+#define CLOCK_FREQ INT64_C(1000000)
+#define OPEN_COUNT UINT64_MAX
+
+namespace Cicada {
+
+    void SegmentTemplate::setInitialization(const std::string &initialization)
+    {
+        if (initialization.empty()) {
+            mInitSegment = nullptr;
+            return;
+        }
+
+        mInitSegment = std::make_shared<segment>(0);
+        mInitSegment->setSourceUrl(formatUrl(initialization, mRepId, mBandwidth, 0, 0));
+    }
+
+    std::vector<SegmentTemplate::TimelineEntry> &SegmentTemplate::writableTimeline()
+    {
+        if (mTimeline == nullptr) {
+            mTimeline = std::make_shared<std::vector<TimelineEntry>>();
+        } else if (mTimeline.use_count() > 1) {
+            mTimeline = std::make_shared<std::vector<TimelineEntry>>(*mTimeline);
+        }
+
+        return *mTimeline;
+    }
+
+    void SegmentTemplate::addTimelineEntry(int64_t t, uint64_t d, int64_t r)
+    {
+        if (d == 0) {
+            AF_LOGW("drop a S without duration");
+            return;
+        }
+
+        std::vector<TimelineEntry> &timeline = writableTimeline();
+        TimelineEntry entry{};
+        entry.duration = d;
+        entry.count = r < 0 ? OPEN_COUNT : static_cast<uint64_t>(r) + 1;
+
+        if (timeline.empty()) {
+            entry.time = t >= 0 ? static_cast<uint64_t>(t) : 0;
+            entry.index = 0;
+        } else {
+            TimelineEntry &prev = timeline.back();
+
+            if (prev.count == OPEN_COUNT) {
+                // r = -1 repeats until the @t of the next S
+                if (t >= 0 && static_cast<uint64_t>(t) > prev.time) {
+                    prev.count = (static_cast<uint64_t>(t) - prev.time + prev.duration - 1) / prev.duration;
+                } else {
+                    prev.count = 1;
+                }
+            }
+
+            entry.time = t >= 0 ? static_cast<uint64_t>(t) : prev.time + prev.duration * prev.count;
+            entry.index = prev.index + prev.count;
+        }
+
+        timeline.push_back(entry);
+        mLastSegment = nullptr;
+    }
+
+    int64_t SegmentTemplate::getNow() const
+    {
+        return af_gettime();
+    }
+
+    int64_t SegmentTemplate::toUs(uint64_t time) const
+    {
+        return static_cast<int64_t>(time / mTimescale * CLOCK_FREQ + time % mTimescale * CLOCK_FREQ / mTimescale);
+    }
+
+    uint64_t SegmentTemplate::fromUs(int64_t us) const
+    {
+        if (us <= 0) {
+            return 0;
+        }
+
+        return static_cast<uint64_t>(us / CLOCK_FREQ) * mTimescale + static_cast<uint64_t>(us % CLOCK_FREQ) * mTimescale / CLOCK_FREQ;
+    }
+
+    uint64_t SegmentTemplate::getEntryCount(size_t index) const
+    {
+        const TimelineEntry &entry = (*mTimeline)[index];
+
+        if (entry.count != OPEN_COUNT) {
+            return entry.count;
+        }
+
+        uint64_t end;
+
+        if (mPeriodDuration != INT64_MIN) {
+            end = mPresentationTimeOffset + fromUs(mPeriodDuration);
+
+            if (end <= entry.time) {
+                return 1;
+            }
+
+            return (end - entry.time + entry.duration - 1) / entry.duration;
+        }
+
+        if (!isLive()) {
+            return 1;
+        }
+
+        // only the segments ended before now are available
+        end = mPresentationTimeOffset + fromUs(getNow() - mAvailabilityStartTime - mPeriodStart);
+        return end > entry.time ? (end - entry.time) / entry.duration : 0;
+    }
+
+    uint64_t SegmentTemplate::getDurationSegmentCount() const
+    {
+        if (mDuration == 0) {
+            return 0;
+        }
+
+        uint64_t periodCount = OPEN_COUNT;
+
+        if (mPeriodDuration != INT64_MIN) {
+            periodCount = (fromUs(mPeriodDuration) + mDuration - 1) / mDuration;
+        }
+
+        if (!isLive()) {
+            return periodCount == OPEN_COUNT ? 0 : periodCount;
+        }
+
+        uint64_t count = fromUs(getNow() - mAvailabilityStartTime - mPeriodStart) / mDuration;
+        return std::min(count, periodCount);
+    }
+
+    void SegmentTemplate::getAvailableRange(uint64_t &first, uint64_t &last) const
+    {
+        first = 1;
+        last = 0;
+
+        if (hasTimeline()) {
+            size_t lastEntry = mTimeline->size() - 1;
+            uint64_t count = getEntryCount(lastEntry);
+
+            if (count == 0 && lastEntry == 0) {
+                return;
+            }
+
+            first = mTimeline->front().index;
+            last = count > 0 ? (*mTimeline)[lastEntry].index + count - 1 : (*mTimeline)[lastEntry].index - 1;
+
+            if (first > last || !isLive() || mTimeShiftBufferDepth == INT64_MIN) {
+                return;
+            }
+
+            // the segments start in the time shift buffer before the end of the last one
+            uint64_t end = getSegmentTime(last) + getSegmentDuration(last);
+            uint64_t depth = fromUs(mTimeShiftBufferDepth);
+
+            if (end > depth) {
+                uint64_t start = end - depth;
+                size_t index = findEntryByTime(start);
+                const TimelineEntry &entry = (*mTimeline)[index];
+                uint64_t number = entry.index;
+
+                if (start > entry.time && entry.duration > 0) {
+                    number += std::min((start - entry.time + entry.duration - 1) / entry.duration, getEntryCount(index));
+                }
+
+                first = std::min(std::max(first, number), last);
+            }
+
+            return;
+        }
+
+        uint64_t count = getDurationSegmentCount();
+
+        if (count == 0) {
+            return;
+        }
+
+        first = 0;
+        last = count - 1;
+
+        if (isLive() && mTimeShiftBufferDepth != INT64_MIN) {
+            uint64_t depth = std::max(fromUs(mTimeShiftBufferDepth) / mDuration, (uint64_t) 1);
+
+            if (count > depth) {
+                first = count - depth;
+            }
+        }
+    }
+
+    uint64_t SegmentTemplate::getFirstNumber() const
+    {
+        uint64_t first, last;
+        getAvailableRange(first, last);
+        return mStartNumber + (first <= last ? first : 0);
+    }
+
+    uint64_t SegmentTemplate::getLastNumber() const
+    {
+        uint64_t first, last;
+        getAvailableRange(first, last);
+        return mStartNumber + (first <= last ? last : 0);
+    }
+
+    uint64_t SegmentTemplate::getSegmentCount() const
+    {
+        uint64_t first, last;
+        getAvailableRange(first, last);
+        return first <= last ? last - first + 1 : 0;
+    }
+
+    size_t SegmentTemplate::findEntryByIndex(uint64_t index) const
+    {
+        auto it = std::upper_bound(mTimeline->begin(), mTimeline->end(), index,
+                                   [](uint64_t value, const TimelineEntry &entry) { return value < entry.index; });
+        return it == mTimeline->begin() ? 0 : static_cast<size_t>(it - mTimeline->begin() - 1);
+    }
+
+    size_t SegmentTemplate::findEntryByTime(uint64_t time) const
+    {
+        auto it = std::upper_bound(mTimeline->begin(), mTimeline->end(), time,
+                                   [](uint64_t value, const TimelineEntry &entry) { return value < entry.time; });
+        return it == mTimeline->begin() ? 0 : static_cast<size_t>(it - mTimeline->begin() - 1);
+    }
+
+    uint64_t SegmentTemplate::getSegmentTime(uint64_t index) const
+    {
+        if (hasTimeline()) {
+            const TimelineEntry &entry = (*mTimeline)[findEntryByIndex(index)];
+            return entry.time + (index - entry.index) * entry.duration;
+        }
+
+        return mPresentationTimeOffset + index * mDuration;
+    }
+
+    uint64_t SegmentTemplate::getSegmentDuration(uint64_t index) const
+    {
+        if (hasTimeline()) {
+            return (*mTimeline)[findEntryByIndex(index)].duration;
+        }
+
+        return mDuration;
+    }
+
+    std::shared_ptr<segment> SegmentTemplate::getSegmentByNumber(uint64_t number)
+    {
+        uint64_t first, last;
+        getAvailableRange(first, last);
+
+        if (first > last) {
+            return nullptr;
+        }
+
+        uint64_t index = number > mStartNumber ? number - mStartNumber : 0;
+        index = std::max(index, first);
+
+        if (index > last) {
+            return nullptr;
+        }
+
+        if (mLastSegment && mLastSegment->sequence == mStartNumber + index) {
+            return mLastSegment;
+        }
+
+        uint64_t time = getSegmentTime(index);
+        auto seg = std::make_shared<segment>(mStartNumber + index);
+        seg->setSourceUrl(formatUrl(mMedia, mRepId, mBandwidth, mStartNumber + index, time));
+        seg->startTime = static_cast<uint64_t>(toUs(time > mPresentationTimeOffset ? time - mPresentationTimeOffset : 0));
+        seg->duration = toUs(getSegmentDuration(index));
+        seg->init_section = mInitSegment;
+        mLastSegment = seg;
+        return seg;
+    }
+
+    bool SegmentTemplate::getSegmentNumberByTime(uint64_t &time, uint64_t &num) const
+    {
+        uint64_t first, last;
+        getAvailableRange(first, last);
+
+        if (first > last) {
+            return false;
+        }
+
+        uint64_t base = getSegmentTime(first);
+        uint64_t target = base + fromUs(static_cast<int64_t>(time));
+        uint64_t index;
+
+        if (hasTimeline()) {
+            size_t i = findEntryByTime(target);
+            const TimelineEntry &entry = (*mTimeline)[i];
+            uint64_t offset = target > entry.time ? (target - entry.time) / entry.duration : 0;
+            // a time in the gap between two S goes to the last segment before it
+            index = entry.index + std::min(offset, std::max(getEntryCount(i), (uint64_t) 1) - 1);
+        } else {
+            index = target > mPresentationTimeOffset ? (target - mPresentationTimeOffset) / mDuration : 0;
+        }
+
+        index = std::max(index, first);
+
+        if (index > last) {
+            AF_LOGE("num not found");
+            return false;
+        }
+
+        num = mStartNumber + index;
+        time = static_cast<uint64_t>(toUs(getSegmentTime(index) - base));
+        return true;
+    }
+
+    void SegmentTemplate::updateTimeline(const SegmentTemplate &from)
+    {
+        mPeriodDuration = from.mPeriodDuration;
+        mAvailabilityStartTime = from.mAvailabilityStartTime;
+        mTimeShiftBufferDepth = from.mTimeShiftBufferDepth;
+        mLastSegment = nullptr;
+
+        if (!from.hasTimeline()) {
+            mDuration = from.mDuration;
+            return;
+        }
+
+        auto timeline = std::make_shared<std::vector<TimelineEntry>>(*from.mTimeline);
+        const TimelineEntry &front = timeline->front();
+        // the numbers of the new mpd if the timelines are not overlapped
+        int64_t shift = static_cast<int64_t>(from.mStartNumber) - static_cast<int64_t>(mStartNumber);
+
+        if (hasTimeline()) {
+            size_t i = findEntryByTime(front.time);
+            const TimelineEntry &entry = (*mTimeline)[i];
+
+            if (front.time >= entry.time && (front.time - entry.time) % entry.duration == 0) {
+                uint64_t offset = (front.time - entry.time) / entry.duration;
+
+                if (offset < getEntryCount(i) || i == mTimeline->size() - 1) {
+                    shift = static_cast<int64_t>(entry.index + offset) - static_cast<int64_t>(front.index);
+                }
+            }
+        }
+
+        if (shift < 0 && static_cast<uint64_t>(-shift) > front.index) {
+            shift = -static_cast<int64_t>(front.index);
+        }
+
+        for (auto &entry : *timeline) {
+            entry.index = static_cast<uint64_t>(static_cast<int64_t>(entry.index) + shift);
+        }
+
+        mTimeline = timeline;
+    }
+
+    static void appendValue(std::string &out, uint64_t value, const std::string &format)
+    {
+        char buffer[32];
+        // $Number%05d$, only the width is used
+        int width = format.size() > 1 ? atoi(format.c_str() + 1) : 0;
+
+        if (width < 0 || width > 20) {
+            width = 0;
+        }
+
+        snprintf(buffer, sizeof(buffer), "%0*" PRIu64, width, value);
+        out += buffer;
+    }
+
+    std::string SegmentTemplate::formatUrl(const std::string &pattern, const std::string &id, uint64_t bandwidth, uint64_t number,
+                                           uint64_t time)
+    {
+        std::string out;
+        size_t pos = 0;
+
+        while (pos < pattern.size()) {
+            size_t start = pattern.find('$', pos);
+            size_t end = start == std::string::npos ? std::string::npos : pattern.find('$', start + 1);
+
+            if (end == std::string::npos) {
+                out.append(pattern, pos, std::string::npos);
+                break;
+            }
+
+            out.append(pattern, pos, start - pos);
+            pos = end + 1;
+            std::string identifier = pattern.substr(start + 1, end - start - 1);
+            std::string format;
+            size_t formatPos = identifier.find('%');
+
+            if (formatPos != std::string::npos) {
+                format = identifier.substr(formatPos);
+                identifier.resize(formatPos);
+            }
+
+            if (identifier.empty()) {
+                out += '$';
+            } else if (identifier == "RepresentationID") {
+                out += id;
+            } else if (identifier == "Number") {
+                appendValue(out, number, format);
+            } else if (identifier == "Time") {
+                appendValue(out, time, format);
+            } else if (identifier == "Bandwidth") {
+                appendValue(out, bandwidth, format);
+            } else {
+                out.append(pattern, start, end - start + 1);
+            }
+        }
+
+        return out;
+    }
+}// namespace Cicada
@@ -0,0 +1,180 @@
+#ifndef FRAMEWORK_SEGMENTTEMPLATE_H
+#define FRAMEWORK_SEGMENTTEMPLATE_H
+
+#include "segment.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Cicada {
+
+    /*
+     * The segments of a dash SegmentTemplate, computed from the number or the time when asked for.
+     *
+     * A template with @duration needs no storage for its segments, a SegmentTimeline keeps one entry
+     * per S element, a "r" repeated run is one entry, so a 24 hours live dvr window uses constant
+     * memory, and the lookup of a number or a time is O(1) for @duration, O(log(S count)) for a timeline.
+     *
+     * All the times in the api are in us, relative to the period start, the times in the
+     * mpd (timeline, @duration, @presentationTimeOffset) are in @timescale.
+     */
+    class SegmentTemplate {
+    public:
+        // one S element, "count" segments from "time", "index" is the index of the first one from @startNumber
+        struct TimelineEntry {
+            uint64_t time;
+            uint64_t duration;
+            uint64_t count;
+            uint64_t index;
+        };
+
+        SegmentTemplate() = default;
+
+        ~SegmentTemplate() = default;
+
+        void setMedia(const std::string &media)
+        {
+            mMedia = media;
+        }
+
+        // call after setRepresentation
+        void setInitialization(const std::string &initialization);
+
+        // the values of $RepresentationID$ and $Bandwidth$
+        void setRepresentation(const std::string &id, uint64_t bandwidth)
+        {
+            mRepId = id;
+            mBandwidth = bandwidth;
+        }
+
+        void setTimescale(uint64_t timescale)
+        {
+            mTimescale = timescale > 0 ? timescale : 1;
+        }
+
+        void setStartNumber(uint64_t number)
+        {
+            mStartNumber = number;
+        }
+
+        void setDuration(uint64_t duration)
+        {
+            mDuration = duration;
+        }
+
+        void setPresentationTimeOffset(uint64_t offset)
+        {
+            mPresentationTimeOffset = offset;
+        }
+
+        /*
+         * add a S element, t < 0 if no @t, r < 0 repeats until the next S or the period end.
+         * the timeline shared with other templates is copied before changed
+         */
+        void addTimelineEntry(int64_t t, uint64_t d, int64_t r);
+
+        // share the timeline of the template in the adaptation set
+        void shareTimeline(const SegmentTemplate &from)
+        {
+            mTimeline = from.mTimeline;
+        }
+
+        void setPeriod(int64_t startUs, int64_t durationUs)
+        {
+            mPeriodStart = startUs;
+            mPeriodDuration = durationUs;
+        }
+
+        // for a dynamic mpd, the segments out of the time shift buffer are not available
+        void setAvailability(int64_t availabilityStartTimeUs, int64_t timeShiftBufferDepthUs)
+        {
+            mAvailabilityStartTime = availabilityStartTimeUs;
+            mTimeShiftBufferDepth = timeShiftBufferDepthUs;
+        }
+
+        bool isLive() const
+        {
+            return mAvailabilityStartTime != INT64_MIN;
+        }
+
+        bool hasTimeline() const
+        {
+            return mTimeline != nullptr && !mTimeline->empty();
+        }
+
+        uint64_t getFirstNumber() const;
+
+        // valid only if getSegmentCount() > 0
+        uint64_t getLastNumber() const;
+
+        // the count of the available segments
+        uint64_t getSegmentCount() const;
+
+        // the first segment whose number >= number, nullptr if no one
+        std::shared_ptr<segment> getSegmentByNumber(uint64_t number);
+
+        // time is the offset from the first segment, changed to the start of the segment found
+        bool getSegmentNumberByTime(uint64_t &time, uint64_t &num) const;
+
+        std::shared_ptr<segment> getInitSegment() const
+        {
+            return mInitSegment;
+        }
+
+        // take the timeline of a reloaded mpd, keep the numbers of the segments already known
+        void updateTimeline(const SegmentTemplate &from);
+
+        static std::string formatUrl(const std::string &pattern, const std::string &id, uint64_t bandwidth, uint64_t number,
+                                     uint64_t time);
+
+    private:
+        int64_t getNow() const;
+
+        // the count of the entry, an open entry (r = -1) ends at the period end or the live edge
+        uint64_t getEntryCount(size_t index) const;
+
+        // the number of the segments end before the period end or the live edge, for @duration
+        uint64_t getDurationSegmentCount() const;
+
+        // the first and the last index of the available segments, first > last if no one
+        void getAvailableRange(uint64_t &first, uint64_t &last) const;
+
+        // the last entry whose first index (time) <= index (time)
+        size_t findEntryByIndex(uint64_t index) const;
+
+        size_t findEntryByTime(uint64_t time) const;
+
+        uint64_t getSegmentTime(uint64_t index) const;
+
+        uint64_t getSegmentDuration(uint64_t index) const;
+
+        int64_t toUs(uint64_t time) const;
+
+        uint64_t fromUs(int64_t us) const;
+
+        std::vector<TimelineEntry> &writableTimeline();
+
+    private:
+        std::string mMedia;
+        std::string mRepId;
+        uint64_t mBandwidth{0};
+        uint64_t mTimescale{1};
+        uint64_t mStartNumber{1};
+        uint64_t mDuration{0};
+        uint64_t mPresentationTimeOffset{0};
+        std::shared_ptr<std::vector<TimelineEntry>> mTimeline{nullptr};
+
+        int64_t mPeriodStart{0};
+        int64_t mPeriodDuration{INT64_MIN};
+        int64_t mAvailabilityStartTime{INT64_MIN};
+        int64_t mTimeShiftBufferDepth{INT64_MIN};
+
+        std::shared_ptr<segment> mInitSegment{nullptr};
+        // SegmentTracker asks the current segment again and again, return the same one
+        std::shared_ptr<segment> mLastSegment{nullptr};
+    };
+}// namespace Cicada
+
+
+#endif//FRAMEWORK_SEGMENTTEMPLATE_H
@@ -6,19 +6,42 @@
 
 #include "SegmentTracker.h"
 #include "Helper.h"
+#include "DashParser.h"
 #include "HlsParser.h"
 #include "playList_demuxer.h"
 #include "utils/timer.h"
 #include <algorithm>
+#include <cstring>
 #include <data_source/dataSourcePrototype.h>
 #include <utility>
 #include <utils/errors/framework_error.h>
 #include <utils/frame_work_log.h>
+#include <utils/MetaCache.h>
 
 #define IS_LIVE (mRep && mRep->b_live)
+// the vod playlists are kept across the restarts for a while, the urls may be signed with an expire time
+#define PLAYLIST_CACHE_TTL 1800
 
 
 namespace Cicada {
+    struct memoryReader {
+        const string *data;
+        size_t pos;
+    };
+
+    static int readMemory(void *arg, uint8_t *buffer, int size)
+    {
+        auto *reader = static_cast<memoryReader *>(arg);
+        size_t len = std::min((size_t) size, reader->data->size() - reader->pos);
+
+        if (len == 0) {
+            return AVERROR_EOF;
+        }
+
+        memcpy(buffer, reader->data->data() + reader->pos, len);
+        reader->pos += len;
+        return static_cast<int>(len);
+    }
 
     SegmentTracker::SegmentTracker(Representation *rep, const IDataSource::SourceConfig &sourceConfig)
         : mRep(rep), mSourceConfig(sourceConfig)
@@ -191,12 +214,25 @@ namespace Cicada {
 
         AF_LOGD("uri is [%s]\n", pUri->c_str());
 
-        if (mRep->mPlayListType == playList_demuxer::playList_type_hls) {
-            if (mPDataSource == nullptr) {
+        if (mRep->mPlayListType == playList_demuxer::playList_type_hls || mRep->mPlayListType == playList_demuxer::playList_type_dash) {
+            bool isDash = mRep->mPlayListType == playList_demuxer::playList_type_dash;
+            string content;
+            string cached;
+            // only the first load, a reloaded playlist is live
+            bool fromCache = mPPlayList == nullptr && MetaCache::Instance()->get("playlist", *pUri, cached);
+
+            if (fromCache) {
+                // the effective url after the redirects, and the playlist
+                size_t split = cached.find('\n');
+                mLocation = cached.substr(0, split);
+                content = split != string::npos ? cached.substr(split + 1) : "";
+            } else if (mPDataSource == nullptr) {
                 {
                     std::unique_lock<std::recursive_mutex> locker(mMutex);
                     mPDataSource = dataSourcePrototype::create(*pUri, mOpts);
-                    mPDataSource->Set_config(mSourceConfig);
+                    IDataSource::SourceConfig config = mSourceConfig;
+                    config.priority = IDataSource::SourceConfig::PriorityPlaylist;
+                    mPDataSource->Set_config(config);
                     mPDataSource->Interrupt(mInterrupted);
                 }
                 ret = mPDataSource->Open(0);
@@ -204,28 +240,60 @@ namespace Cicada {
                 ret = mPDataSource->Open(*pUri);
             }
 
-            AF_LOGD("ret is %d\n", ret);
+            if (!fromCache) {
+                AF_LOGD("ret is %d\n", ret);
 
-            if (ret < 0) {
-                AF_LOGE("open url error %s\n", framework_err2_string(ret));
-                return ret;
+                if (ret < 0) {
+                    AF_LOGE("open url error %s\n", framework_err2_string(ret));
+                    return ret;
+                }
+
+                if (mLocation.empty()) {
+                    std::string location("location");
+                    mLocation = mPDataSource->GetOption(location);
+                }
+
+                ret = readPlayList(content);
+
+                if (ret < 0) {
+                    AF_LOGE("read playlist error %s\n", framework_err2_string(ret));
+                    return ret;
+                }
             }
 
-            if (mLocation.empty()) {
-                std::string location("location");
-                mLocation = mPDataSource->GetOption(location);
+            playListParser *parser;
+
+            if (isDash) {
+                parser = new DashParser(pUri->c_str());
+            } else {
+                parser = new HlsParser(pUri->c_str());
             }
 
-            auto *parser = new HlsParser(pUri->c_str());
-            dataSourceIO *dio = new dataSourceIO(mPDataSource);
+            memoryReader reader{&content, 0};
+            auto *dio = new dataSourceIO(readMemory, nullptr, &reader);
             parser->setDataSourceIO(dio);
             playList *pPlayList = parser->parse(*pUri);
+            Representation *rep = nullptr;
+
+            if (pPlayList != nullptr) {
+                if (isDash) {
+                    // the whole mpd reloaded, take the same representation
+                    rep = DashParser::findRepresentation(pPlayList, mRep->getId());
+
+                    if (rep == nullptr) {
+                        AF_LOGW("representation %s not in the reloaded mpd", mRep->getId().c_str());
+                        delete pPlayList;
+                        pPlayList = nullptr;
+                    }
+                } else {
+                    // mediaPlayList only have one Representation
+                    rep = (*(*(*pPlayList->GetPeriods().begin())->GetAdaptSets().begin())->getRepresentations().begin());
+                }
+            }
 
             //  mPPlayList->dump();
-            // mediaPlayList only have one Representation
             if (pPlayList != nullptr) {
                 std::unique_lock<std::recursive_mutex> locker(mMutex);
-                Representation *rep = (*(*(*pPlayList->GetPeriods().begin())->GetAdaptSets().begin())->getRepresentations().begin());
                 SegmentList *sList = rep->GetSegmentList();
                 SegmentList *pList = mRep->GetSegmentList();
                 mTargetDuration = rep->targetDuration;
@@ -244,12 +312,16 @@ namespace Cicada {
                 // update is live
                 mRep->b_live = rep->b_live;
 
-                if (pPlayList->getDuration() > 0) {
+                if (pPlayList->getDuration() > 0 && mPDataSource) {
                     mPDataSource->Close();
                     delete mPDataSource;
                     mPDataSource = nullptr;
                 }
 
+                if (!fromCache && !mRep->b_live && pPlayList->getDuration() > 0) {
+                    MetaCache::Instance()->put("playlist", *pUri, mLocation + '\n' + content, PLAYLIST_CACHE_TTL);
+                }
+
                 if (mPPlayList == nullptr) { //save the first playList
                     mPPlayList = pPlayList;
                     playListOwnedByMe = true;
@@ -268,6 +340,32 @@ namespace Cicada {
         return 0;
     }
 
+    int SegmentTracker::readPlayList(string &content)
+    {
+        uint8_t buffer[4096];
+
+        while (!mInterrupted) {
+            int ret = mPDataSource->Read(buffer, sizeof(buffer));
+
+            if (ret < 0) {
+                return ret;
+            }
+
+            if (ret == 0) {
+                break;
+            }
+
+            content.append(reinterpret_cast<const char *>(buffer), ret);
+        }
+
+        // the content is partial, not to be parsed or cached
+        if (mInterrupted) {
+            return FRAMEWORK_ERR_EXIT;
+        }
+
+        return 0;
+    }
+
     int SegmentTracker::init()
     {
         int ret = 0;
@@ -291,6 +389,11 @@ namespace Cicada {
                 std::unique_lock<std::recursive_mutex> locker(mMutex);
                 mPPlayList = mRep->getPlaylist();
                 playListOwnedByMe = false;
+
+                if (mRep->mPlayListType == playList_demuxer::playList_type_dash) {
+                    // the reload interval of a dynamic mpd
+                    mTargetDuration = mRep->targetDuration;
+                }
             }
 
             if (mRep != nullptr && mRep->GetSegmentList() != nullptr) {
@@ -406,7 +509,7 @@ namespace Cicada {
     uint64_t SegmentTracker::getSegSize()
     {
         std::unique_lock<std::recursive_mutex> locker(mMutex);
-        return mRep->GetSegmentList()->getSegments().size();
+        return mRep->GetSegmentList()->getSegmentCount();
     }
 
     int SegmentTracker::threadFunction()
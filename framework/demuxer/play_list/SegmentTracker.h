@@ -91,9 +91,17 @@ namespace Cicada {
 
         int64_t getTargetDuration();
 
+        int64_t getPartTargetDuration()
+        {
+            return mPartTargetDuration;
+        }
+
     private:
         int loadPlayList();
 
+        // the whole playlist of mPDataSource
+        int readPlayList(std::string &content);
+
         int threadFunction();
 
     private:
@@ -18,6 +18,8 @@ namespace Cicada {
     {
         if (type == playList_type_hls) {
             mParser = new HlsParser(path.c_str());
+        } else if (type == playList_type_dash) {
+            mParser = new DashParser(path.c_str());
         }
 
         mType = type;
@@ -50,7 +52,8 @@ namespace Cicada {
             return -EINVAL;
         }
 
-        if (mType == playList_type_hls) {
+        // the dash representations are played by the hls streams too, the segments are fmp4
+        if (mType == playList_type_hls || mType == playList_type_dash) {
             playlistManager = new HLSManager(mPPlayList);
         }
 
@@ -15,6 +15,7 @@ using namespace std;
 #include "playListParser.h"
 #include "PlaylistManager.h"
 #include "HlsParser.h"
+#include "DashParser.h"
 
 namespace Cicada{
 
@@ -24,6 +25,7 @@ namespace Cicada{
         enum playList_type {
             playList_type_unknown = 0,
             playList_type_hls,
+            playList_type_dash,
 
         };
 
@@ -103,7 +105,10 @@ namespace Cicada{
             *type = playList_type_hls;
             if (ret > 0)
                 return true;
-            return false;
+
+            ret = DashParser::probe(buffer, static_cast<int>(size));
+            *type = playList_type_dash;
+            return ret > 0;
         }
 
         int getType() override
@@ -51,6 +51,9 @@ public:
 
     virtual int muxPacket(std::unique_ptr<IAFPacket> packet) = 0;
 
+    // the packet is not owned, its data may be taken by the muxer, refill it before use it again
+    virtual int muxPacket(IAFPacket *packet) = 0;
+
     virtual void setWritePacketCallback(writePacketCallback callback, void *opaque) = 0;
 
     virtual void setSeekCallback(seekCallback callback, void *opaque) = 0;
@@ -143,14 +143,14 @@ void FfmpegMuxer::insertStreamInfo(const AVStream *st, const Stream_meta *meta)
     mStreamInfoMap.insert(pair<int, StreamInfo>(meta->index, streamInfo));
 }
 
-int FfmpegMuxer::writeFrame(unique_ptr<IAFPacket> packetPtr)
+int FfmpegMuxer::writeFrame(IAFPacket *packet)
 {
     if (mDestFormatContext == nullptr) {
         AF_LOGE("mDestFormatContext is null..");
         return -1;
     }
 
-    AVPacket *pkt = getAVPacket(packetPtr.get());
+    AVPacket *pkt = getAVPacket(packet);
 
     if (pkt == nullptr) {
         AF_LOGE("muxer packet is null..");
@@ -216,7 +216,12 @@ int FfmpegMuxer::writeFrame(unique_ptr<IAFPacket> packetPtr)
 
 int FfmpegMuxer::muxPacket(unique_ptr<IAFPacket> packet)
 {
-    return writeFrame(move(packet));
+    return writeFrame(packet.get());
+}
+
+int FfmpegMuxer::muxPacket(IAFPacket *packet)
+{
+    return writeFrame(packet);
 }
 
 int FfmpegMuxer::close()
@@ -47,6 +47,8 @@ public:
 
     int muxPacket(std::unique_ptr<IAFPacket> packet) override;
 
+    int muxPacket(IAFPacket *packet) override;
+
     int close() override;
 
     static bool is_supported(const std::string &destPath, const std::string &destFormat, const std::string &description)
@@ -106,7 +108,7 @@ private:
     static int io_write_data_type(void *opaque, uint8_t *buf, int size,
                                   enum AVIODataMarkerType type, int64_t time);
 
-    int writeFrame(std::unique_ptr<IAFPacket> packetPtr);
+    int writeFrame(IAFPacket *packet);
 
     void check_codec_tag(const AVStream *stream);
 
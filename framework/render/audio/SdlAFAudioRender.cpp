@@ -8,6 +8,7 @@
 #include <base/media/AVAFPacket.h>
 #include <utils/ffmpeg_utils.h>
 #include <utils/frame_work_log.h>
+#include <utils/pcm_utils.h>
 
 namespace Cicada {
 
@@ -119,7 +120,7 @@ namespace Cicada {
                 if (!mMute && !rendered) {
                     copyPCMData(getAVFrame(filter_frame.get()), pcmBuffer);
                 } else {
-                    memset(pcmBuffer, 0, pcmDataLength);
+                    fillPCMSilence(pcmBuffer, (enum AFSampleFormat) filter_frame->getInfo().audio.format, pcmDataLength);
                 }
                 SDL_QueueAudio(mDevID, pcmBuffer, pcmDataLength);
                 mPlayedDuration += (uint64_t) origin_samples * 1000000 / filter_frame->getInfo().audio.sample_rate;
@@ -143,7 +144,7 @@ namespace Cicada {
         if (!mMute && !rendered) {
             copyPCMData(getAVFrame(frame.get()), pcmBuffer);
         } else {
-            memset(pcmBuffer, 0, pcmDataLength);
+            fillPCMSilence(pcmBuffer, (enum AFSampleFormat) frame->getInfo().audio.format, pcmDataLength);
         }
         SDL_QueueAudio(mDevID, pcmBuffer, pcmDataLength);
         assert(frame->getInfo().duration > 0);
@@ -5,10 +5,14 @@
 #define LOG_TAG "SdlAFAudioRender2"
 
 #include "SdlAFAudioRender2.h"
+#include <algorithm>
 #include <assert.h>
 #include <base/media/AVAFPacket.h>
 #include <utils/ffmpeg_utils.h>
 #include <utils/frame_work_log.h>
+#include <utils/pcm_utils.h>
+
+#define SILENCE_CHUNK_SIZE 4096
 
 namespace Cicada {
 
@@ -100,7 +104,10 @@ namespace Cicada {
     }
 
     void SdlAFAudioRender2::device_setVolume(float gain)
-    {}
+    {
+        // sdl has no volume of a device, the gain is applied to the pcm
+        mVolume = gain;
+    }
 
     int64_t SdlAFAudioRender2::device_get_position()
     {
@@ -122,10 +129,15 @@ namespace Cicada {
         if (mRenderingCb) {
             rendered = mRenderingCb(mRenderingCbUserData, frame.get());
         }
+        auto format = (enum AFSampleFormat) frame->getInfo().audio.format;
         if (!mMute && !rendered) {
             copyPCMData(getAVFrame(frame.get()), mPcmBuffer);
+            float volume = mVolume;
+            if (volume != 1.0f) {
+                applyPCMGain(mPcmBuffer, format, frame->getInfo().audio.nb_samples * frame->getInfo().audio.channels, volume);
+            }
         } else {
-            memset(mPcmBuffer, 0, pcmDataLength);
+            fillPCMSilence(mPcmBuffer, format, pcmDataLength);
         }
         SDL_QueueAudio(mDevID, mPcmBuffer, pcmDataLength);
 
@@ -142,13 +154,18 @@ namespace Cicada {
     void SdlAFAudioRender2::device_mute(bool bMute)
     {
         mMute = bMute;
-        // mute all queued audio buffer
+        if (!bMute) {
+            return;
+        }
+        // mute all queued audio buffer, the silence of s16 and f32 is 0
+        static const uint8_t silence[SILENCE_CHUNK_SIZE] = {0};
         uint32_t queuedAudioSize = SDL_GetQueuedAudioSize(mDevID);
-        uint8_t *muteAudioBuffer = (uint8_t *) malloc(queuedAudioSize);
-        memset(muteAudioBuffer, 0, queuedAudioSize);
         SDL_ClearQueuedAudio(mDevID);
-        SDL_QueueAudio(mDevID, muteAudioBuffer, queuedAudioSize);
-        free(muteAudioBuffer);
+        while (queuedAudioSize > 0) {
+            uint32_t size = std::min(queuedAudioSize, (uint32_t) SILENCE_CHUNK_SIZE);
+            SDL_QueueAudio(mDevID, silence, size);
+            queuedAudioSize -= size;
+        }
     }
 
     uint64_t SdlAFAudioRender2::device_get_que_duration()
@@ -171,7 +188,8 @@ namespace Cicada {
 
     uint64_t SdlAFAudioRender2::device_get_ability()
     {
-        return 0;
+        // the volume up to 1 by applyPCMGain, above 1 by the filter
+        return A_FILTER_FLAG_VOLUME;
     }
 
 }// namespace Cicada
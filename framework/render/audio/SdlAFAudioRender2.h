@@ -37,6 +37,7 @@ namespace Cicada {
         uint8_t *mPcmBuffer = nullptr;
         int mPcmBufferSize = 0;
         std::atomic<bool> mMute{false};
+        std::atomic<float> mVolume{1.0f};
         SDL_AudioSpec mSpec{0};
     };
 }// namespace Cicada
@@ -117,6 +117,14 @@ public:
      */
     virtual int renderFrame(std::unique_ptr<IAFFrame> &frame) = 0;
 
+    /**
+     * the frames the render holds at most, queued and on the screen.
+     */
+    virtual int getMaxHeldFrames()
+    {
+        return 2;
+    }
+
     /**
      * NOTE: will callback in render thread.
      * @param renderedCallback
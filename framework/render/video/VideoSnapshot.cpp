@@ -0,0 +1,460 @@
+#define LOG_TAG "VideoSnapshot"
+
+#include "VideoSnapshot.h"
+#include <algorithm>
+#include <base/media/AVAFPacket.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <utils/ColorConvert.h>
+#include <utils/frame_work_log.h>
+#include <utils/timer.h>
+#include <vector>
+
+#ifdef __APPLE__
+#include <base/media/PBAFFrame.h>
+#endif
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/pixdesc.h>
+}
+
+// a request waits for the next rendered frame no longer than
+#define FRAME_WAIT_TIMEOUT (1000 * 1000)
+
+using namespace std;
+
+namespace Cicada {
+    namespace {
+        struct Plane {
+            const uint8_t *data;
+            int stride;
+            int width;
+            int height;
+        };
+
+        uint8_t *scalePlane(const Plane &src, int width, int height, int channels, vector<uint8_t> &buffer)
+        {
+            buffer.resize(width * height * channels);
+            ColorConvert::Scale(src.data, src.stride, src.width, src.height, buffer.data(), width * channels, width, height, channels);
+            return buffer.data();
+        }
+
+        int encodeImage(AVCodecID codecId, AVPixelFormat format, uint8_t **data, int *lineSize, int width, int height,
+                        VideoSnapshot::Result &result)
+        {
+            AVCodec *codec = avcodec_find_encoder(codecId);
+
+            if (codec == nullptr) {
+                AF_LOGE("no encoder for %s\n", avcodec_get_name(codecId));
+                return -ENOSYS;
+            }
+
+            AVCodecContext *ctx = avcodec_alloc_context3(codec);
+
+            if (ctx == nullptr) {
+                return -ENOMEM;
+            }
+
+            ctx->width = width;
+            ctx->height = height;
+            ctx->pix_fmt = format;
+            ctx->time_base = {1, 25};
+
+            if (codecId == AV_CODEC_ID_MJPEG) {
+                // limited range yuv is not in the baseline of jpeg
+                ctx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
+                ctx->flags |= AV_CODEC_FLAG_QSCALE;
+                ctx->global_quality = FF_QP2LAMBDA * 3;
+            }
+
+            AVFrame *frame = av_frame_alloc();
+            AVPacket *packet = av_packet_alloc();
+            int ret = avcodec_open2(ctx, codec, nullptr);
+
+            if (ret >= 0 && frame && packet) {
+                frame->format = format;
+                frame->width = width;
+                frame->height = height;
+                frame->quality = ctx->global_quality;
+
+                for (int i = 0; i < 4; i++) {
+                    frame->data[i] = data[i];
+                    frame->linesize[i] = lineSize[i];
+                }
+
+                ret = avcodec_send_frame(ctx, frame);
+
+                if (ret >= 0) {
+                    ret = avcodec_receive_packet(ctx, packet);
+                }
+
+                if (ret >= 0) {
+                    result.data = static_cast<uint8_t *>(malloc(packet->size));
+                    memcpy(result.data, packet->data, packet->size);
+                    result.size = packet->size;
+                }
+            } else if (ret >= 0) {
+                ret = -ENOMEM;
+            }
+
+            av_packet_free(&packet);
+            av_frame_free(&frame);
+            avcodec_free_context(&ctx);
+            return ret;
+        }
+
+        int toRGBA(AVFrame *frame, int width, int height, VideoSnapshot::Result &result)
+        {
+            auto format = static_cast<AVPixelFormat>(frame->format);
+            ColorConvert::Matrix matrix = frame->colorspace == AVCOL_SPC_BT709 ? ColorConvert::MatrixBT709 : ColorConvert::MatrixBT601;
+            bool fullRange = frame->color_range == AVCOL_RANGE_JPEG || format == AV_PIX_FMT_YUVJ420P;
+            int stride = frame->width * 4;
+            vector<uint8_t> rgba;
+
+            if (format == AV_PIX_FMT_RGBA) {
+                rgba.resize(stride * frame->height);
+
+                for (int i = 0; i < frame->height; i++) {
+                    memcpy(rgba.data() + i * stride, frame->data[0] + i * frame->linesize[0], stride);
+                }
+            } else if (format == AV_PIX_FMT_YUV420P || format == AV_PIX_FMT_YUVJ420P) {
+                rgba.resize(stride * frame->height);
+                ColorConvert::I420ToRGBA(frame->data[0], frame->linesize[0], frame->data[1], frame->linesize[1], frame->data[2],
+                                         frame->linesize[2], rgba.data(), stride, frame->width, frame->height, matrix, fullRange);
+            } else if (format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_NV21) {
+                rgba.resize(stride * frame->height);
+                ColorConvert::NV12ToRGBA(frame->data[0], frame->linesize[0], frame->data[1], frame->linesize[1],
+                                         format == AV_PIX_FMT_NV21, rgba.data(), stride, frame->width, frame->height, matrix, fullRange);
+            } else {
+                AF_LOGE("snapshot not support pixel format %s\n", av_get_pix_fmt_name(format));
+                return -ENOSYS;
+            }
+
+            result.size = width * height * 4;
+            result.data = static_cast<uint8_t *>(malloc(result.size));
+
+            if (width == frame->width && height == frame->height) {
+                memcpy(result.data, rgba.data(), result.size);
+            } else {
+                ColorConvert::Scale(rgba.data(), stride, frame->width, frame->height, result.data, width * 4, width, height, 4);
+            }
+
+            return 0;
+        }
+
+        int toJPEG(AVFrame *frame, int width, int height, VideoSnapshot::Result &result)
+        {
+            auto format = static_cast<AVPixelFormat>(frame->format);
+            int chromaWidth = (frame->width + 1) / 2;
+            int chromaHeight = (frame->height + 1) / 2;
+            Plane planes[3];
+            vector<uint8_t> u, v;
+
+            if (format == AV_PIX_FMT_YUV420P || format == AV_PIX_FMT_YUVJ420P) {
+                for (int i = 0; i < 3; i++) {
+                    planes[i] = {frame->data[i], frame->linesize[i], i ? chromaWidth : frame->width, i ? chromaHeight : frame->height};
+                }
+            } else if (format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_NV21) {
+                u.resize(chromaWidth * chromaHeight);
+                v.resize(chromaWidth * chromaHeight);
+                uint8_t *first = format == AV_PIX_FMT_NV12 ? u.data() : v.data();
+                uint8_t *second = format == AV_PIX_FMT_NV12 ? v.data() : u.data();
+
+                for (int y = 0; y < chromaHeight; y++) {
+                    const uint8_t *line = frame->data[1] + y * frame->linesize[1];
+
+                    for (int x = 0; x < chromaWidth; x++) {
+                        first[y * chromaWidth + x] = line[x * 2];
+                        second[y * chromaWidth + x] = line[x * 2 + 1];
+                    }
+                }
+
+                planes[0] = {frame->data[0], frame->linesize[0], frame->width, frame->height};
+                planes[1] = {u.data(), chromaWidth, chromaWidth, chromaHeight};
+                planes[2] = {v.data(), chromaWidth, chromaWidth, chromaHeight};
+            } else {
+                AF_LOGE("snapshot not support jpeg from pixel format %s\n", av_get_pix_fmt_name(format));
+                return -ENOSYS;
+            }
+
+            vector<uint8_t> scaled[3];
+            uint8_t *data[4] = {nullptr};
+            int lineSize[4] = {0};
+
+            for (int i = 0; i < 3; i++) {
+                int planeWidth = i ? (width + 1) / 2 : width;
+                int planeHeight = i ? (height + 1) / 2 : height;
+
+                if (planeWidth == planes[i].width && planeHeight == planes[i].height) {
+                    data[i] = const_cast<uint8_t *>(planes[i].data);
+                    lineSize[i] = planes[i].stride;
+                } else {
+                    data[i] = scalePlane(planes[i], planeWidth, planeHeight, 1, scaled[i]);
+                    lineSize[i] = planeWidth;
+                }
+            }
+
+            bool fullRange = frame->color_range == AVCOL_RANGE_JPEG || format == AV_PIX_FMT_YUVJ420P;
+            return encodeImage(AV_CODEC_ID_MJPEG, fullRange ? AV_PIX_FMT_YUVJ420P : AV_PIX_FMT_YUV420P, data, lineSize, width, height,
+                               result);
+        }
+
+        int toPNG(AVFrame *frame, int width, int height, VideoSnapshot::Result &result)
+        {
+            VideoSnapshot::Result rgba;
+            int ret = toRGBA(frame, width, height, rgba);
+
+            if (ret < 0) {
+                return ret;
+            }
+
+            uint8_t *data[4] = {rgba.data, nullptr, nullptr, nullptr};
+            int lineSize[4] = {width * 4, 0, 0, 0};
+            ret = encodeImage(AV_CODEC_ID_PNG, AV_PIX_FMT_RGBA, data, lineSize, width, height, result);
+            free(rgba.data);
+            return ret;
+        }
+    }// namespace
+
+    VideoSnapshot::VideoSnapshot() = default;
+
+    VideoSnapshot::~VideoSnapshot()
+    {
+        {
+            unique_lock<mutex> lock(mTaskMutex);
+            mRunning = false;
+        }
+        mCondition.notify_one();
+        delete mThread;
+
+        while (!mTasks.empty()) {
+            Result result;
+            result.format = mTasks.front()->format;
+            result.error = -ECANCELED;
+            mTasks.front()->callback(result);
+            mTasks.pop_front();
+        }
+    }
+
+    void VideoSnapshot::setFrame(IAFFrame *frame)
+    {
+        if (frame == nullptr) {
+            return;
+        }
+
+        // a reference of the frame buffer, not a copy
+        unique_ptr<IAFFrame> last = frame->clone();
+        {
+            unique_lock<mutex> lock(mFrameMutex);
+            mLastFrame.swap(last);
+            mHasFrame = true;
+        }
+
+        if (mWaitingCount == 0) {
+            return;
+        }
+
+        unique_lock<mutex> lock(mTaskMutex);
+
+        for (auto &task : mTasks) {
+            if (task->frame == nullptr && task->error == 0) {
+                task->frame = frame->clone();
+            }
+        }
+
+        mWaitingCount = 0;
+        mCondition.notify_one();
+    }
+
+    void VideoSnapshot::clearFrame()
+    {
+        unique_ptr<IAFFrame> last{};
+        {
+            unique_lock<mutex> lock(mFrameMutex);
+            mLastFrame.swap(last);
+            mHasFrame = false;
+        }
+
+        if (mWaitingCount == 0) {
+            return;
+        }
+
+        unique_lock<mutex> lock(mTaskMutex);
+
+        for (auto &task : mTasks) {
+            if (task->frame == nullptr) {
+                task->error = -ECANCELED;
+            }
+        }
+
+        mWaitingCount = 0;
+        mCondition.notify_one();
+    }
+
+    bool VideoSnapshot::hasFrame()
+    {
+        return mHasFrame;
+    }
+
+    int VideoSnapshot::request(int width, int height, Format format, Callback callback)
+    {
+        if (width < 0 || height < 0 || callback == nullptr) {
+            return -EINVAL;
+        }
+
+        unique_ptr<Task> task{new Task()};
+        task->width = width;
+        task->height = height;
+        task->format = format;
+        task->callback = move(callback);
+        task->requestTime = af_gettime_relative();
+        task->error = 0;
+        unique_lock<mutex> lock(mTaskMutex);
+        {
+            // counted in the frame lock, setFrame after it sees the request waiting
+            unique_lock<mutex> frameLock(mFrameMutex);
+
+            if (mLastFrame) {
+                task->frame = mLastFrame->clone();
+            } else {
+                // none rendered yet, wait for the first one
+                mWaitingCount++;
+            }
+        }
+        mTasks.push_back(move(task));
+
+        if (mThread == nullptr) {
+            mThread = NEW_AF_THREAD(snapshotLoop);
+            mThread->start();
+        }
+
+        mCondition.notify_one();
+        return 0;
+    }
+
+    int VideoSnapshot::snapshotLoop()
+    {
+        unique_ptr<Task> task;
+        {
+            unique_lock<mutex> lock(mTaskMutex);
+            // wait here as PlayerNotifier does, the thread is not paused between the requests
+            mCondition.wait(lock, [this]() { return !mRunning || !mTasks.empty(); });
+
+            if (!mRunning) {
+                return -1;
+            }
+
+            // the tasks are popped on this thread only, the front is still there after the wait
+            Task *front = mTasks.front().get();
+            int64_t timeout = front->requestTime + FRAME_WAIT_TIMEOUT - af_gettime_relative();
+            mCondition.wait_for(lock, std::chrono::microseconds(max(timeout, (int64_t) 0)),
+                                [this, front]() { return !mRunning || front->frame != nullptr || front->error != 0; });
+
+            if (!mRunning) {
+                return -1;
+            }
+
+            task = move(mTasks.front());
+            mTasks.pop_front();
+
+            if (task->frame == nullptr && task->error == 0) {
+                // no frame rendered in time
+                task->error = -EAGAIN;
+                mWaitingCount--;
+            }
+        }
+
+        Result result;
+        result.format = task->format;
+
+        if (task->frame == nullptr) {
+            result.error = task->error;
+            result.latency = af_gettime_relative() - task->requestTime;
+            AF_LOGW("snapshot format %d no frame, ret %d\n", result.format, result.error);
+            task->callback(result);
+            return 0;
+        }
+
+        result.pts = task->frame->getInfo().pts;
+        process(*task, result);
+        result.latency = af_gettime_relative() - task->requestTime;
+        AF_LOGI("snapshot %dx%d format %d size %d ret %d in %lld us\n", result.width, result.height, result.format, result.size,
+                result.error, (long long) result.latency);
+        task->callback(result);
+        return 0;
+    }
+
+    void VideoSnapshot::process(Task &task, Result &result)
+    {
+        AVFrame *frame = getAVFrame(task.frame.get());
+        unique_ptr<IAFFrame> converted{};
+#ifdef __APPLE__
+        auto *pbafFrame = dynamic_cast<PBAFFrame *>(task.frame.get());
+
+        if (frame == nullptr && pbafFrame != nullptr) {
+            converted.reset(static_cast<AVAFFrame *>(*pbafFrame));
+            frame = getAVFrame(converted.get());
+        }
+#endif
+
+        if (frame == nullptr) {
+            result.error = -ENOSYS;
+            return;
+        }
+
+        AVFrame *swFrame = nullptr;
+
+        if (frame->hw_frames_ctx) {
+            swFrame = av_frame_alloc();
+            result.error = av_hwframe_transfer_data(swFrame, frame, 0);
+
+            if (result.error < 0) {
+                av_frame_free(&swFrame);
+                return;
+            }
+
+            av_frame_copy_props(swFrame, frame);
+            frame = swFrame;
+        }
+
+        int width = task.width;
+        int height = task.height;
+
+        if (width == 0 && height == 0) {
+            width = frame->width;
+            height = frame->height;
+        } else if (width == 0) {
+            width = static_cast<int>(static_cast<int64_t>(frame->width) * height / max(frame->height, 1));
+        } else if (height == 0) {
+            height = static_cast<int>(static_cast<int64_t>(frame->height) * width / max(frame->width, 1));
+        }
+
+        result.width = max(width, 1);
+        result.height = max(height, 1);
+
+        switch (task.format) {
+            case FormatJPEG:
+                result.error = toJPEG(frame, result.width, result.height, result);
+                break;
+
+            case FormatPNG:
+                result.error = toPNG(frame, result.width, result.height, result);
+                break;
+
+            default:
+                result.error = toRGBA(frame, result.width, result.height, result);
+                break;
+        }
+
+        if (result.error < 0) {
+            free(result.data);
+            result.data = nullptr;
+            result.size = 0;
+        }
+
+        av_frame_free(&swFrame);
+    }
+}// namespace Cicada
@@ -0,0 +1,92 @@
+#ifndef CICADA_PLAYER_VIDEOSNAPSHOT_H
+#define CICADA_PLAYER_VIDEOSNAPSHOT_H
+
+#include <atomic>
+#include <base/media/IAFPacket.h>
+#include <condition_variable>
+#include <deque>
+#include <utils/afThread.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace Cicada {
+    /*
+     * Snapshots of the rendered video frames, off the render thread.
+     *
+     * A reference of the last rendered frame is kept, a request takes it at once, also when paused, and
+     * waits for the next rendered frame only if none is rendered yet. The conversion to rgba, the scaling
+     * and the encoding are done on the snapshot thread, it doesn't need a video render or a gl context.
+     */
+    class VideoSnapshot {
+    public:
+        enum Format { FormatRGBA, FormatJPEG, FormatPNG };
+
+        struct Result {
+            Format format{FormatRGBA};
+            int width{0};
+            int height{0};
+            // malloc-ed, owned by the callback after it is called
+            uint8_t *data{nullptr};
+            int size{0};
+            int64_t pts{INT64_MIN};
+            // from the request to the result, in us
+            int64_t latency{0};
+            int error{0};
+        };
+
+        typedef std::function<void(Result &result)> Callback;
+
+        VideoSnapshot();
+
+        ~VideoSnapshot();
+
+        // called on every rendered frame, a reference of it is kept, not a copy
+        void setFrame(IAFFrame *frame);
+
+        // no frame rendered from now on, the last frame is released and the waiting requests are canceled
+        void clearFrame();
+
+        // a frame has been rendered since the last clearFrame
+        bool hasFrame();
+
+        /*
+         * snapshot the last rendered frame, if no frame rendered yet, the next one, the request fails with
+         * -EAGAIN if no frame is rendered in 1s.
+         * width or height 0 to keep the aspect of the frame, both 0 for the frame size
+         */
+        int request(int width, int height, Format format, Callback callback);
+
+    private:
+        struct Task {
+            std::unique_ptr<IAFFrame> frame;
+            int width;
+            int height;
+            Format format;
+            Callback callback;
+            int64_t requestTime;
+            int error;
+        };
+
+        int snapshotLoop();
+
+        void process(Task &task, Result &result);
+
+    private:
+        std::atomic_bool mHasFrame{false};
+        // the requests waiting for a frame, checked on every rendered frame without lock
+        std::atomic<int> mWaitingCount{0};
+
+        std::mutex mFrameMutex;
+        std::unique_ptr<IAFFrame> mLastFrame{};
+
+        std::mutex mTaskMutex;
+        std::condition_variable mCondition;
+        std::deque<std::unique_ptr<Task>> mTasks;
+        bool mRunning{true};
+        afThread *mThread{nullptr};
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_VIDEOSNAPSHOT_H
@@ -621,6 +621,12 @@ void GLRender::AppDidBecomeActive()
 
 #endif
 
+int GLRender::getMaxHeldFrames()
+{
+    // the queue is cut to MAX_IN_SIZE on vsync, and a frame more is queued before that
+    return MAX_IN_SIZE + 1;
+}
+
 float GLRender::getRenderFPS()
 {
     return mFps;
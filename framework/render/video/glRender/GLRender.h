@@ -47,6 +47,8 @@ public:
 
     int renderFrame(std::unique_ptr<IAFFrame> &frame) override;
 
+    int getMaxHeldFrames() override;
+
     int setRotate(Rotate rotate) override;
 
     int setFlip(Flip flip) override;
@@ -0,0 +1,140 @@
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#ifdef AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS
+#include <libavutil/video_enc_params.h>
+#endif
+};
+
+#include "gtest/gtest.h"
+#include <WebAssemblyPlayer/bitStreamAnalyzer.h>
+
+using namespace Cicada;
+
+// us
+#define VIDEO_DURATION 40000
+#define AUDIO_DURATION 20000
+
+static bitStreamAnalyzer::FrameStats makeStats(bool video, int64_t pts)
+{
+    bitStreamAnalyzer::FrameStats stats{};
+    stats.video = video;
+    stats.pts = pts;
+    return stats;
+}
+
+TEST(frameStats, ptsJitter)
+{
+    bitStreamAnalyzer::FileStats fileStats{};
+    bitStreamAnalyzer::StatsCounter counter(fileStats);
+    // the third frame is 10ms late, the fourth one is on time again
+    const int64_t pts[] = {0, 40000, 90000, 120000, 160000};
+    const int64_t jitter[] = {0, 0, 10000, -10000, 0};
+
+    for (int i = 0; i < 5; i++) {
+        bitStreamAnalyzer::FrameStats stats = makeStats(true, pts[i]);
+        counter.add(stats, VIDEO_DURATION);
+        ASSERT_EQ(jitter[i], stats.ptsJitter) << i;
+        // no audio
+        ASSERT_EQ(INT64_MIN, stats.avDrift);
+    }
+
+    ASSERT_EQ(10000, fileStats.maxPtsJitter);
+    ASSERT_EQ(0, fileStats.maxAVDrift);
+}
+
+TEST(frameStats, ptsJitterNoDuration)
+{
+    bitStreamAnalyzer::FileStats fileStats{};
+    bitStreamAnalyzer::StatsCounter counter(fileStats);
+    // no frame duration, the distance to the previous frame is expected
+    const int64_t pts[] = {0, 40000, 80000, 100000, 140000};
+    const int64_t jitter[] = {0, 0, 0, -20000, 20000};
+
+    for (int i = 0; i < 5; i++) {
+        bitStreamAnalyzer::FrameStats stats = makeStats(true, pts[i]);
+        counter.add(stats, 0);
+        ASSERT_EQ(jitter[i], stats.ptsJitter) << i;
+    }
+
+    // the frames without pts are skipped
+    bitStreamAnalyzer::FrameStats stats = makeStats(true, INT64_MIN);
+    counter.add(stats, 0);
+    ASSERT_EQ(0, stats.ptsJitter);
+    stats = makeStats(true, 180000);
+    counter.add(stats, 0);
+    ASSERT_EQ(0, stats.ptsJitter);
+    ASSERT_EQ(20000, fileStats.maxPtsJitter);
+}
+
+TEST(frameStats, avDrift)
+{
+    bitStreamAnalyzer::FileStats fileStats{};
+    bitStreamAnalyzer::StatsCounter counter(fileStats);
+    bitStreamAnalyzer::FrameStats stats = makeStats(true, 0);
+    counter.add(stats, VIDEO_DURATION);
+    // no audio decoded yet
+    ASSERT_EQ(INT64_MIN, stats.avDrift);
+
+    int64_t audioPts = 0;
+
+    for (int i = 1; i < 5; i++) {
+        // the audio is decoded to the video pts
+        while (audioPts + AUDIO_DURATION <= i * VIDEO_DURATION) {
+            stats = makeStats(false, audioPts);
+            counter.add(stats, AUDIO_DURATION);
+            ASSERT_EQ(INT64_MIN, stats.avDrift);
+            audioPts += AUDIO_DURATION;
+        }
+
+        stats = makeStats(true, i * VIDEO_DURATION);
+        counter.add(stats, VIDEO_DURATION);
+        ASSERT_EQ(0, stats.avDrift) << i;
+    }
+
+    // the audio decoded 40ms ahead of the video
+    for (int i = 0; i < 4; i++) {
+        stats = makeStats(false, audioPts);
+        counter.add(stats, AUDIO_DURATION);
+        audioPts += AUDIO_DURATION;
+    }
+
+    stats = makeStats(true, 5 * VIDEO_DURATION);
+    counter.add(stats, VIDEO_DURATION);
+    ASSERT_EQ(-40000, stats.avDrift);
+    ASSERT_EQ(40000, fileStats.maxAVDrift);
+    ASSERT_EQ(0, fileStats.maxPtsJitter);
+}
+
+TEST(frameStats, qp)
+{
+    AVFrame *frame = av_frame_alloc();
+    frame->width = 64;
+    frame->height = 32;
+    // not exported
+    ASSERT_EQ(-1, bitStreamAnalyzer::getFrameQp(frame));
+#ifdef AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS
+    // a 32x32 block of qp 30 and two 16x32 blocks of qp 20 and 40
+    AVVideoEncParams *params = av_video_enc_params_create_side_data(frame, AV_VIDEO_ENC_PARAMS_H264, 3);
+    ASSERT_NE(nullptr, params);
+    params->qp = 30;
+    const int x[] = {0, 32, 48};
+    const int w[] = {32, 16, 16};
+    const int delta[] = {0, -10, 10};
+
+    for (int i = 0; i < 3; i++) {
+        AVVideoBlockParams *block = av_video_enc_params_block(params, i);
+        block->src_x = x[i];
+        block->src_y = 0;
+        block->w = w[i];
+        block->h = 32;
+        block->delta_qp = delta[i];
+    }
+
+    ASSERT_EQ(30, bitStreamAnalyzer::getFrameQp(frame));
+    av_video_enc_params_block(params, 2)->delta_qp = 14;
+    // (30 * 2 + 20 + 44) / 4
+    ASSERT_EQ(31, bitStreamAnalyzer::getFrameQp(frame));
+#endif
+    av_frame_free(&frame);
+}
@@ -0,0 +1,172 @@
+#include "gtest/gtest.h"
+#include <base/media/AVAFPacket.h>
+#include <cacheModule/timeShift/TimeShiftRecorder.h>
+#include <cstring>
+#include <utils/file/FileUtils.h>
+#include <utils/timer.h>
+
+using namespace Cicada;
+using namespace std;
+
+#define TIME_SHIFT_DIR "timeShiftUnitTest"
+// us
+#define FRAME_DURATION 20000
+#define CHUNK_DURATION 100000
+#define WINDOW_DURATION 500000
+
+static unique_ptr<streamMeta> audioMeta(int index)
+{
+    Stream_meta meta{};
+    meta.type = STREAM_TYPE_AUDIO;
+    meta.codec = AF_CODEC_ID_MP3;
+    meta.index = index;
+    meta.channels = 2;
+    meta.samplerate = 44100;
+    return unique_ptr<streamMeta>(new streamMeta(&meta));
+}
+
+static void addFrames(TimeShiftRecorder &recorder, int index, int64_t startPts, int count)
+{
+    for (int i = 0; i < count; i++) {
+        AVPacket *pkt = av_packet_alloc();
+        av_new_packet(pkt, 256);
+        memset(pkt->data, 0, pkt->size);
+        pkt->pts = pkt->dts = startPts + i * FRAME_DURATION;
+        pkt->duration = FRAME_DURATION;
+        pkt->stream_index = index;
+        pkt->flags = AV_PKT_FLAG_KEY;
+        AVAFPacket packet(&pkt);
+        packet.getInfo().timePosition = packet.getInfo().pts;
+        recorder.addFrame(&packet, ST_TYPE_AUDIO);
+    }
+}
+
+// the finished chunks end at or after pts
+static bool waitRange(TimeShiftRecorder &recorder, int64_t pts)
+{
+    int64_t start = af_getsteady_ms();
+    int64_t startPts;
+    int64_t endPts;
+
+    while (af_getsteady_ms() - start < 5000) {
+        if (recorder.getRange(startPts, endPts) && endPts >= pts) {
+            return true;
+        }
+
+        af_msleep(10);
+    }
+
+    return false;
+}
+
+class timeShiftRecorder : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        recorder = unique_ptr<TimeShiftRecorder>(new TimeShiftRecorder(TIME_SHIFT_DIR, ""));
+        recorder->setChunkDuration(CHUNK_DURATION);
+        recorder->setWindow(WINDOW_DURATION, 0);
+        vector<unique_ptr<streamMeta>> metas;
+        metas.push_back(audioMeta(1));
+        recorder->setStreamMetas(move(metas));
+        ASSERT_EQ(0, recorder->start());
+    }
+
+    void TearDown() override
+    {
+        recorder = nullptr;
+        FileUtils::rmrf(TIME_SHIFT_DIR);
+    }
+
+    unique_ptr<TimeShiftRecorder> recorder{};
+};
+
+TEST_F(timeShiftRecorder, trimChunks)
+{
+    addFrames(*recorder, 1, 0, 60);
+    ASSERT_TRUE(waitRange(*recorder, 1000000));
+
+    int64_t startPts;
+    int64_t endPts;
+    ASSERT_TRUE(recorder->getRange(startPts, endPts));
+    // the oldest chunks out of the window are removed with their files
+    ASSERT_GT(startPts, 0);
+    ASSERT_LE(endPts - startPts, WINDOW_DURATION);
+    ASSERT_NE(FILE_TRUE, FileUtils::isFileExist(TIME_SHIFT_DIR "/timeshift_0.ts"));
+    ASSERT_EQ(0, recorder->getPtsOffset());
+
+    TimeShiftRecorder::Chunk chunk{};
+    int64_t keyPts;
+    ASSERT_EQ(0, recorder->findChunk(startPts, chunk, keyPts));
+    ASSERT_EQ(FILE_TRUE, FileUtils::isFileExist(chunk.path.c_str()));
+
+    recorder->stop();
+    ASSERT_FALSE(recorder->getRange(startPts, endPts));
+    ASSERT_NE(FILE_TRUE, FileUtils::isFileExist(chunk.path.c_str()));
+}
+
+TEST_F(timeShiftRecorder, findChunk)
+{
+    addFrames(*recorder, 1, 0, 20);
+    ASSERT_TRUE(waitRange(*recorder, 300000));
+
+    TimeShiftRecorder::Chunk chunk{};
+    int64_t keyPts;
+    ASSERT_EQ(-ENOENT, recorder->findChunk(-1, chunk, keyPts));
+
+    ASSERT_EQ(0, recorder->findChunk(150000, chunk, keyPts));
+    ASSERT_TRUE(chunk.finished);
+    ASSERT_LE(chunk.startPts, 150000);
+    ASSERT_GT(chunk.endPts, 150000);
+    ASSERT_GT(chunk.bytes, 0);
+    // no key frames in the audio only chunks, from the chunk start
+    ASSERT_EQ(chunk.startPts, keyPts);
+
+    // in the chunk in recording
+    ASSERT_EQ(-EAGAIN, recorder->findChunk(390000, chunk, keyPts));
+}
+
+TEST_F(timeShiftRecorder, nextChunk)
+{
+    addFrames(*recorder, 1, 0, 20);
+    ASSERT_TRUE(waitRange(*recorder, 300000));
+
+    TimeShiftRecorder::Chunk chunk{};
+    int64_t keyPts;
+    ASSERT_EQ(0, recorder->findChunk(0, chunk, keyPts));
+    ASSERT_EQ(0, chunk.startPts);
+
+    int count = 1;
+    TimeShiftRecorder::Chunk next{};
+
+    while (recorder->nextChunk(chunk.id, next) == 0) {
+        // the chunks follow each other
+        ASSERT_GT(next.id, chunk.id);
+        ASSERT_EQ(chunk.endPts, next.startPts);
+        chunk = next;
+        count++;
+    }
+
+    ASSERT_EQ(3, count);
+    ASSERT_EQ(-EAGAIN, recorder->nextChunk(chunk.id, next));
+}
+
+TEST_F(timeShiftRecorder, switchStream)
+{
+    addFrames(*recorder, 1, 0, 10);
+    recorder->switchStream(audioMeta(3));
+    ASSERT_FALSE(recorder->hasStreamIndex(1));
+    ASSERT_TRUE(recorder->hasStreamIndex(3));
+    ASSERT_EQ(3, recorder->getStreamIndex(0));
+    // the frames of the old stream are not recorded after the switch
+    addFrames(*recorder, 1, 200000, 10);
+    addFrames(*recorder, 3, 400000, 10);
+    ASSERT_TRUE(waitRange(*recorder, 500000));
+
+    TimeShiftRecorder::Chunk chunk{};
+    int64_t keyPts;
+    ASSERT_EQ(0, recorder->findChunk(0, chunk, keyPts));
+    ASSERT_EQ(0, recorder->nextChunk(chunk.id, chunk));
+    ASSERT_EQ(0, recorder->nextChunk(chunk.id, chunk));
+    ASSERT_EQ(400000, chunk.startPts);
+}
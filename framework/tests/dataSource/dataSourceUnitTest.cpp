@@ -3,15 +3,30 @@
 //
 
 #include "gtest/gtest.h"
+#include <data_source/curl/CURLMultiEngine.h>
 #include <data_source/curl/curl_data_source.h>
 #include <data_source/dataSourcePrototype.h>
+#ifndef WIN32
+#include <data_source/LocalFileDataSource.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include <atomic>
 #include <memory>
+#include <preload/PreloadDataSource.h>
+#include <thread>
 #include <utils/AFUtils.h>
 #include <utils/CicadaJSON.h>
 #include <utils/errors/framework_error.h>
 #include <utils/frame_work_log.h>
+#include <utils/MetaCache.h>
 #include <utils/globalSettings.h>
 #include <utils/timer.h>
+#include <vector>
 
 using namespace std;
 using namespace Cicada;
@@ -67,6 +82,116 @@ TEST(protocol, file)
     free(obuffer);
 }
 
+#ifndef WIN32
+static void testLocalFile(bool mapped)
+{
+    const char *path = "localFileTest";
+    const int size = 1024 * 1024 + 7;
+    vector<uint8_t> content(size);
+
+    for (int i = 0; i < size; i++) {
+        content[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    FILE *file = fopen(path, "w");
+    fwrite(content.data(), 1, size, file);
+    fclose(file);
+    globalSettings::getSetting()->setProperty("localFileSource.mmap", mapped ? "1" : "0");
+    unique_ptr<IDataSource> source = unique_ptr<IDataSource>(dataSourcePrototype::create(string("file://") + path));
+    ASSERT_NE(dynamic_cast<LocalFileDataSource *>(source.get()), nullptr);
+    ASSERT_GE(source->Open(0), 0);
+    CicadaJSONItem readAhead(source->GetOption("readAhead"));
+    ASSERT_EQ(mapped, readAhead.getBool("mapped", !mapped));
+    ASSERT_EQ(size, source->Seek(0, SEEK_SIZE));
+    vector<uint8_t> buffer(size);
+    int read = 0;
+    int ret;
+
+    while ((ret = source->Read(buffer.data() + read, 32768)) > 0) {
+        read += ret;
+    }
+
+    ASSERT_EQ(size, read);
+    ASSERT_EQ(0, memcmp(content.data(), buffer.data(), size));
+    ASSERT_EQ(1000, source->Seek(1000, SEEK_SET));
+    ASSERT_EQ(100, source->Read(buffer.data(), 100));
+    ASSERT_EQ(0, memcmp(content.data() + 1000, buffer.data(), 100));
+    ASSERT_EQ(size - 10, source->Seek(-10, SEEK_END));
+    ASSERT_EQ(10, source->Read(buffer.data(), 100));
+
+    // a file growing while reading
+    file = fopen(path, "a");
+    fwrite(content.data(), 1, 100, file);
+    fclose(file);
+    ASSERT_EQ(100, source->Read(buffer.data(), 100));
+    ASSERT_EQ(0, memcmp(content.data(), buffer.data(), 100));
+    source->Close();
+    globalSettings::getSetting()->setProperty("localFileSource.mmap", "0");
+    unlink(path);
+}
+
+TEST(protocol, localFile)
+{
+    testLocalFile(false);
+}
+
+TEST(protocol, localFileMapped)
+{
+    testLocalFile(true);
+}
+
+static int64_t readFile(IDataSource *source, bool coldCache, const char *path)
+{
+    if (coldCache) {
+        // drop the clean pages of the file from the page cache
+        int fd = open(path, O_RDONLY);
+#if defined(__linux__)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+        close(fd);
+    }
+
+    vector<uint8_t> buffer(32768);
+    int64_t start = af_gettime_relative();
+    source->Open(0);
+
+    while (source->Read(buffer.data(), buffer.size()) > 0) {
+    }
+
+    source->Close();
+    return af_gettime_relative() - start;
+}
+
+TEST(protocol, localFileBenchmark)
+{
+    const char *path = "localFileBenchmark";
+    const int size = 64 * 1024 * 1024;
+    vector<uint8_t> content(1024 * 1024, 1);
+    FILE *file = fopen(path, "w");
+
+    for (int i = 0; i < size / (int) content.size(); i++) {
+        fwrite(content.data(), 1, content.size(), file);
+    }
+
+    fclose(file);
+    globalSettings::getSetting()->setProperty("localFileSource.disable", "1");
+    unique_ptr<IDataSource> avioSource = unique_ptr<IDataSource>(dataSourcePrototype::create(path));
+    globalSettings::getSetting()->setProperty("localFileSource.disable", "0");
+    unique_ptr<IDataSource> localSource = unique_ptr<IDataSource>(dataSourcePrototype::create(path));
+    ASSERT_EQ(dynamic_cast<LocalFileDataSource *>(avioSource.get()), nullptr);
+    ASSERT_NE(dynamic_cast<LocalFileDataSource *>(localSource.get()), nullptr);
+
+    for (int cold = 1; cold >= 0; cold--) {
+        int64_t avioTime = readFile(avioSource.get(), cold, path);
+        int64_t localTime = readFile(localSource.get(), cold, path);
+        printf("%s page cache, 64M in 32K reads: avio %lld us, local file %lld us\n", cold ? "cold" : "warm", (long long) avioTime,
+               (long long) localTime);
+    }
+
+    unlink(path);
+}
+#endif
+
 TEST(dns, https)
 {
     // https://ip.tool.chinaz.com/
@@ -104,6 +229,155 @@ TEST(dns, http)
     globalSettings::getSetting()->removeResolve("player.alicdn.com:80", ip);
 }
 
+TEST(metaCache, persistence)
+{
+    const char *path = "metaCacheTest";
+    remove(path);
+    MetaCache *cache = MetaCache::Instance();
+    cache->setPath(path);
+    string value;
+    ASSERT_FALSE(cache->get("playlist", "http://a/b.m3u8", value));
+    cache->put("playlist", "http://a/b.m3u8", "#EXTM3U", 60);
+    cache->put("dns", "a:80", "1.2.3.4", 60);
+    cache->flush();
+    // reloaded from the file
+    cache->setPath("");
+    cache->setPath(path);
+    ASSERT_TRUE(cache->get("playlist", "http://a/b.m3u8", value));
+    ASSERT_EQ(value, "#EXTM3U");
+    // the same value put again is not written
+    remove(path);
+    cache->put("dns", "a:80", "1.2.3.4", 60);
+    af_msleep(200);
+    ASSERT_NE(0, access(path, F_OK));
+    cache->put("dns", "a:80", "1.2.3.5", 60);
+
+    for (int i = 0; i < 100 && access(path, F_OK) != 0; i++) {
+        af_msleep(10);
+    }
+
+    ASSERT_EQ(0, access(path, F_OK));
+    cache->remove("dns", "a:80");
+    cache->flush();
+    cache->setPath("");
+    cache->setPath(path);
+    ASSERT_FALSE(cache->get("dns", "a:80", value));
+    CicadaJSONItem stats(cache->dumpStats());
+    ASSERT_EQ(stats.getInt("entries", 0), 1);
+    // a corrupted file is dropped
+    FILE *file = fopen(path, "r+");
+    fseek(file, -1, SEEK_END);
+    fputc('x', file);
+    fclose(file);
+    cache->setPath("");
+    cache->setPath(path);
+    ASSERT_FALSE(cache->get("playlist", "http://a/b.m3u8", value));
+    cache->setPath("");
+    remove(path);
+}
+
+static string writePreloadFile(const char *path, vector<uint8_t> &data, int size)
+{
+    data.resize(size);
+
+    for (int i = 0; i < size; i++) {
+        data[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+    }
+
+    FILE *file = fopen(path, "wb");
+    fwrite(data.data(), data.size(), 1, file);
+    fclose(file);
+    return path;
+}
+
+static void readAll(IDataSource *source, vector<uint8_t> &data, int size)
+{
+    data.resize(size);
+    int read = 0;
+
+    while (read < size) {
+        int ret = source->Read(data.data() + read, size - read);
+        ASSERT_GT(ret, 0);
+        read += ret;
+    }
+}
+
+TEST(preload, servedFromCache)
+{
+    const int fileSize = 256 * 1024;
+    const int itemBytes = 64 * 1024;
+    vector<uint8_t> data;
+    string path = writePreloadFile("preloadTest.bin", data, fileSize);
+    PreloadManager *manager = PreloadManager::Instance();
+    manager->clear();
+    CicadaJSONItem start(manager->getStatistics());
+    manager->setBudget(1024 * 1024, 1);
+    manager->setItemBytes(itemBytes);
+    manager->setUrls({path});
+
+    for (int i = 0; i < 500; i++) {
+        CicadaJSONItem stats(manager->getStatistics());
+
+        if (stats.getDouble("preloadedBytes", 0) - start.getDouble("preloadedBytes", 0) >= itemBytes) {
+            break;
+        }
+
+        af_msleep(10);
+    }
+
+    // the head is from the preload, the rest from the file
+    unique_ptr<IDataSource> source(dataSourcePrototype::create(path));
+    ASSERT_TRUE(dynamic_cast<PreloadDataSource *>(source.get()) != nullptr);
+    ASSERT_GE(source->Open(0), 0);
+    vector<uint8_t> read;
+    readAll(source.get(), read, fileSize);
+    ASSERT_TRUE(read == data);
+    source->Close();
+    // served once
+    ASSERT_FALSE(manager->hasItem(path));
+    CicadaJSONItem stats(manager->getStatistics());
+    ASSERT_EQ(1, stats.getInt("hits", 0) - start.getInt("hits", 0));
+    ASSERT_EQ(0, stats.getInt("misses", 0) - start.getInt("misses", 0));
+    manager->clear();
+    remove(path.c_str());
+}
+
+TEST(preload, missOnOpen)
+{
+    const int fileSize = 64 * 1024;
+    vector<uint8_t> data;
+    string path = writePreloadFile("preloadMissTest.bin", data, fileSize);
+    PreloadManager *manager = PreloadManager::Instance();
+    manager->clear();
+    CicadaJSONItem start(manager->getStatistics());
+    // no budget, the item is never loaded
+    manager->setBudget(0, 1);
+    manager->setUrls({path});
+
+    // the probes of the prototypes are not opens
+    for (int i = 0; i < 10; i++) {
+        unique_ptr<IDataSource> source(dataSourcePrototype::create(path));
+        ASSERT_TRUE(dynamic_cast<PreloadDataSource *>(source.get()) != nullptr);
+    }
+
+    CicadaJSONItem probed(manager->getStatistics());
+    ASSERT_EQ(0, probed.getInt("misses", 0) - start.getInt("misses", 0));
+
+    // opened before loaded, all from the file
+    unique_ptr<IDataSource> source(dataSourcePrototype::create(path));
+    ASSERT_GE(source->Open(0), 0);
+    vector<uint8_t> read;
+    readAll(source.get(), read, fileSize);
+    ASSERT_TRUE(read == data);
+    source->Close();
+    CicadaJSONItem stats(manager->getStatistics());
+    ASSERT_EQ(1, stats.getInt("misses", 0) - start.getInt("misses", 0));
+    ASSERT_EQ(0, stats.getInt("hits", 0) - start.getInt("hits", 0));
+    manager->setBudget(8 * 1024 * 1024, 2);
+    manager->clear();
+    remove(path.c_str());
+}
+
 TEST(http, 404)
 {
     string url = "https://img.alicdn.com/tfs/TB1DaGEcnvI8KJjSspjXXcgjXXa-220-781.png";
@@ -190,6 +464,172 @@ TEST(http, keep_alive)
     free(buf);
 }
 
+#ifndef WIN32
+// a local HTTP/1.1 keep-alive server, answers every request with the same body, counts the connections accepted
+class keepAliveServer {
+public:
+    explicit keepAliveServer(int bodySize) : mBody(bodySize, 'c')
+    {
+        mFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        bind(mFd, (sockaddr *) &addr, len);
+        listen(mFd, 8);
+        getsockname(mFd, (sockaddr *) &addr, &len);
+        mPort = ntohs(addr.sin_port);
+        mThreads.emplace_back(&keepAliveServer::acceptLoop, this);
+    }
+
+    ~keepAliveServer()
+    {
+        mRunning = false;
+
+        for (auto &thread : mThreads) {
+            thread.join();
+        }
+
+        close(mFd);
+    }
+
+    string url() const
+    {
+        return "http://127.0.0.1:" + to_string(mPort) + "/segment.ts";
+    }
+
+    int connections() const
+    {
+        return mConnections;
+    }
+
+private:
+    // 0 for timeout, < 0 for error
+    int waitReadable(int fd)
+    {
+        pollfd pfd{fd, POLLIN, 0};
+        return poll(&pfd, 1, 100);
+    }
+
+    void acceptLoop()
+    {
+        vector<thread> clients;
+
+        while (mRunning) {
+            if (waitReadable(mFd) <= 0) {
+                continue;
+            }
+
+            int fd = accept(mFd, nullptr, nullptr);
+
+            if (fd >= 0) {
+                mConnections++;
+                clients.emplace_back(&keepAliveServer::serve, this, fd);
+            }
+        }
+
+        for (auto &client : clients) {
+            client.join();
+        }
+    }
+
+    void serve(int fd)
+    {
+        string request;
+        char buf[1024];
+
+        while (mRunning) {
+            int ret = waitReadable(fd);
+
+            if (ret == 0) {
+                continue;
+            }
+
+            ssize_t size = ret > 0 ? recv(fd, buf, sizeof(buf), 0) : -1;
+
+            if (size <= 0) {
+                break;
+            }
+
+            request.append(buf, size);
+            size_t end = request.find("\r\n\r\n");
+
+            if (end == string::npos) {
+                continue;
+            }
+
+            request.erase(0, end + 4);
+            string response = "HTTP/1.1 200 OK\r\nContent-Length: " + to_string(mBody.size()) +
+                              "\r\nConnection: keep-alive\r\n\r\n" + mBody;
+            size_t sent = 0;
+
+            while (sent < response.size()) {
+                ssize_t written = send(fd, response.data() + sent, response.size() - sent, 0);
+
+                if (written <= 0) {
+                    break;
+                }
+
+                sent += written;
+            }
+        }
+
+        close(fd);
+    }
+
+    string mBody;
+    int mFd = -1;
+    int mPort = 0;
+    atomic_bool mRunning{true};
+    atomic_int mConnections{0};
+    vector<thread> mThreads;
+};
+
+TEST(http, sharedEngine)
+{
+    const int bodySize = 256 * 1024;
+    keepAliveServer server(bodySize);
+    const int count = 8;
+    uint64_t requests;
+    uint64_t connections;
+    CURLMultiEngine::Instance()->getStatistics(requests, connections);
+    void *buf = malloc(1024 * 64);
+
+    // segments of one host, one after another as HLS does, the connection is reused
+    for (int i = 0; i < count; i++) {
+        unique_ptr<IDataSource> source = unique_ptr<IDataSource>(dataSourcePrototype::create(server.url()));
+        ASSERT_GE(source->Open(0), 0);
+        int total = 0;
+        int ret;
+
+        while ((ret = source->Read(buf, 1024 * 64)) > 0) {
+            total += ret;
+        }
+
+        ASSERT_EQ(bodySize, total);
+        // the read ends at the content length, maybe before the transfer is done in the engine
+        int64_t start = af_getsteady_ms();
+
+        while (CicadaJSONItem(source->GetOption("transferTiming")).getInt64("bytes", 0) < bodySize &&
+               af_getsteady_ms() - start < 1000) {
+            af_msleep(10);
+        }
+
+        CicadaJSONItem timing(source->GetOption("transferTiming"));
+        ASSERT_EQ(bodySize, timing.getInt64("bytes", 0));
+        ASSERT_EQ(i > 0, timing.getBool("reused", false));
+    }
+
+    free(buf);
+    uint64_t newRequests;
+    uint64_t newConnections;
+    CURLMultiEngine::Instance()->getStatistics(newRequests, newConnections);
+    ASSERT_EQ(count, newRequests - requests);
+    ASSERT_EQ(1, newConnections - connections);
+    ASSERT_EQ(1, server.connections());
+}
+#endif
+
 TEST(http, post)
 {
     string url = "https://ptsv2.com/t/50oow-1602229322";
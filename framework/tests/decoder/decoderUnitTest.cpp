@@ -8,7 +8,15 @@
 #include <utils/timer.h>
 #include "gtest/gtest.h"
 #include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <deque>
 #include <utils/AFUtils.h>
+#include <codec/DecoderThreadBudget.h>
+#include <codec/FrameBufferPool.h>
+#include <codec/avcodecDecoder.h>
+#include <base/media/AVAFPacket.h>
 
 using namespace Cicada;
 using namespace std;
@@ -72,6 +80,99 @@ static void test_codec(const string &url, AFCodecID codec, int flags)
     delete demuxer;
 }
 
+struct benchmarkResult {
+    std::atomic<int> frames{0};
+    std::atomic<int> deadlineMisses{0};
+    std::atomic<int> errors{0};
+};
+
+/*
+ * decode the first frameCount video frames as fast as the source could be read,
+ * a frame come later than its frame duration since the previous one is a deadline miss
+ */
+static void benchmark_codec(const string &url, int frameCount, benchmarkResult *result)
+{
+    auto source = dataSourcePrototype::create(url);
+    source->Open(0);
+    auto *demuxer = new demuxer_service(source);
+    int ret = demuxer->initOpen();
+    unique_ptr<streamMeta> meta{nullptr};
+    unique_ptr<IDecoder> decoder{nullptr};
+    int64_t frameDuration = 40000;
+
+    for (int i = 0; ret >= 0 && i < demuxer->GetNbStreams(); ++i) {
+        demuxer->GetStreamMeta(meta, i, false);
+        auto *smeta = (Stream_meta *) (*meta);
+
+        if (smeta->type == STREAM_TYPE_VIDEO) {
+            decoder = decoderFactory::create(*smeta, DECFLAG_SW, 0, nullptr);
+
+            if (decoder == nullptr || decoder->open(smeta, nullptr, 0, nullptr) < 0) {
+                decoder = nullptr;
+                break;
+            }
+
+            demuxer->OpenStream(i);
+
+            if (smeta->avg_fps > 1) {
+                frameDuration = static_cast<int64_t>(1000000 / smeta->avg_fps);
+            }
+
+            break;
+        }
+    }
+
+    // no gtest assertion out of the test thread
+    if (decoder == nullptr) {
+        result->errors++;
+        delete demuxer;
+        delete source;
+        return;
+    }
+
+    std::unique_ptr<IAFPacket> packet{nullptr};
+    int64_t lastFrameTime = INT64_MIN;
+    int frames = 0;
+
+    while (frames < frameCount) {
+        if (packet == nullptr) {
+            ret = demuxer->readPacket(packet, 0);
+
+            if (ret == -EAGAIN) {
+                af_msleep(1);
+                continue;
+            }
+
+            if (ret < 0) {
+                break;
+            }
+        }
+
+        if (packet && decoder->send_packet(packet, 0) == -EAGAIN) {
+            af_msleep(1);
+        }
+
+        unique_ptr<IAFFrame> frame{nullptr};
+        decoder->getFrame(frame, 0);
+
+        if (frame) {
+            int64_t now = af_gettime_relative();
+
+            if (lastFrameTime != INT64_MIN && now - lastFrameTime > frameDuration) {
+                result->deadlineMisses++;
+            }
+
+            lastFrameTime = now;
+            frames++;
+            result->frames++;
+        }
+    }
+
+    decoder->close();
+    delete demuxer;
+    delete source;
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -96,3 +197,234 @@ TEST(softCodec, aac)
     std::string url = "http://player.alicdn.com/video/aliyunmedia.mp4";
     test_codec(url, AF_CODEC_ID_AAC, DECFLAG_SW);
 }
+
+static void multiStreamBenchmark(bool budget)
+{
+    std::string url = "http://player.alicdn.com/video/aliyunmedia.mp4";
+    const int streamCount = 4;
+    const int frameCount = 200;
+    benchmarkResult result;
+    std::vector<std::thread> threads;
+    DecoderThreadBudget::Instance()->setEnable(budget);
+    int64_t start = af_gettime_relative();
+
+    for (int i = 0; i < streamCount; i++) {
+        threads.emplace_back(benchmark_codec, url, frameCount, &result);
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    int64_t used = af_gettime_relative() - start;
+    DecoderThreadBudget::Instance()->setEnable(true);
+    ASSERT_EQ(result.errors, 0);
+    ASSERT_GT(result.frames, 0);
+    printf("%s budget, %d streams: %d frames in %lld ms, aggregate %.1f fps, %d deadline misses\n", budget ? "with" : "without",
+           streamCount, result.frames.load(), (long long) (used / 1000), result.frames * 1000000.0 / used,
+           result.deadlineMisses.load());
+}
+
+TEST(softCodec, multiStreamBenchmark)
+{
+    multiStreamBenchmark(false);
+    multiStreamBenchmark(true);
+}
+
+TEST(softCodec, threadBudget)
+{
+    DecoderThreadBudget *budget = DecoderThreadBudget::Instance();
+    int a, b;
+    budget->setMaxThreads(8);
+    ASSERT_EQ(9, budget->acquire(&a, 1920, 1080, 30));
+    budget->acquire(&b, 960, 540, 30);
+    ASSERT_GT(budget->getThreadCount(&a), budget->getThreadCount(&b));
+    ASSERT_LE(budget->getThreadCount(&a) + budget->getThreadCount(&b), 9);
+
+    // in background a decoder keeps one thread, the other takes all the cores back
+    budget->setBackground(&a, true);
+    ASSERT_EQ(1, budget->getThreadCount(&a));
+    ASSERT_EQ(9, budget->getThreadCount(&b));
+    budget->setBackground(&a, false);
+    ASSERT_GT(budget->getThreadCount(&a), budget->getThreadCount(&b));
+
+    budget->setEnable(false);
+    ASSERT_EQ(std::max(AFGetCpuCount(), 1) + 1, budget->getThreadCount(&b));
+    budget->setEnable(true);
+    budget->release(&a);
+    budget->release(&b);
+    budget->setMaxThreads(0);
+    ASSERT_EQ(0, budget->getDecoderCount());
+}
+
+TEST(softCodec, framePool)
+{
+    std::string url = "http://player.alicdn.com/video/aliyunmedia.mp4";
+    int64_t startBytes = FrameBufferPool::getTotalBytes();
+    auto source = dataSourcePrototype::create(url);
+    source->Open(0);
+    auto *demuxer = new demuxer_service(source);
+    ASSERT_GE(demuxer->initOpen(), 0);
+    unique_ptr<streamMeta> meta{nullptr};
+    unique_ptr<IDecoder> decoder{nullptr};
+
+    for (int i = 0; i < demuxer->GetNbStreams(); ++i) {
+        demuxer->GetStreamMeta(meta, i, false);
+        auto *smeta = (Stream_meta *) (*meta);
+
+        if (smeta->type == STREAM_TYPE_VIDEO) {
+            decoder = decoderFactory::create(*smeta, DECFLAG_SW, 0, nullptr);
+            ASSERT_TRUE(decoder);
+            demuxer->OpenStream(i);
+            ASSERT_GE(decoder->open(smeta, nullptr, 0, nullptr), 0);
+            // the render queue below and the frame taken
+            decoder->setHeldFrames(4);
+            break;
+        }
+    }
+
+    ASSERT_TRUE(decoder);
+    // as a render queue, the frames go back to the pool after released
+    std::deque<unique_ptr<IAFFrame>> renderQueue;
+    std::unique_ptr<IAFPacket> packet{nullptr};
+    int frames = 0;
+
+    while (frames < 100) {
+        if (packet == nullptr) {
+            int ret = demuxer->readPacket(packet, 0);
+
+            if (ret == -EAGAIN) {
+                af_msleep(1);
+                continue;
+            }
+
+            if (ret < 0) {
+                break;
+            }
+        }
+
+        if (packet && decoder->send_packet(packet, 0) == -EAGAIN) {
+            af_msleep(1);
+        }
+
+        unique_ptr<IAFFrame> frame{nullptr};
+        decoder->getFrame(frame, 0);
+
+        if (frame) {
+            AVFrame *avFrame = getAVFrame(frame.get());
+            ASSERT_TRUE(avFrame);
+            ASSERT_EQ(0, avFrame->linesize[0] % 64);
+            renderQueue.push_back(move(frame));
+
+            if (renderQueue.size() > 3) {
+                renderQueue.pop_front();
+            }
+
+            frames++;
+        }
+    }
+
+    ASSERT_GT(frames, 0);
+    ASSERT_GT(FrameBufferPool::getTotalBytes(), startBytes);
+    printf("frame pool %lld bytes, peak %lld bytes\n", (long long) FrameBufferPool::getTotalBytes(),
+           (long long) FrameBufferPool::getTotalPeakBytes());
+    decoder->close();
+    // the frames in render keep their buffers after the decoder closed
+    ASSERT_GT(FrameBufferPool::getTotalBytes(), startBytes);
+    renderQueue.clear();
+    ASSERT_EQ(startBytes, FrameBufferPool::getTotalBytes());
+    delete demuxer;
+    delete source;
+}
+
+TEST(softCodec, framePoolBound)
+{
+    AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+    ASSERT_TRUE(codec);
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    int64_t startBytes = FrameBufferPool::getTotalBytes();
+    FrameBufferPool pool;
+    // a reference, the frame being decoded and 2 output frames
+    pool.setOutputFrames(2);
+    pool.attach(ctx);
+    ASSERT_TRUE(ctx->get_buffer2 != avcodec_default_get_buffer2);
+    ASSERT_GE(avcodec_open2(ctx, codec, nullptr), 0);
+    ctx->width = 640;
+    ctx->height = 360;
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    ctx->refs = 1;
+    auto getFrame = [ctx]() -> AVFrame * {
+        AVFrame *frame = av_frame_alloc();
+        frame->format = ctx->pix_fmt;
+        frame->width = ctx->width;
+        frame->height = ctx->height;
+
+        if (ctx->get_buffer2(ctx, frame, 0) < 0) {
+            av_frame_free(&frame);
+        }
+
+        return frame;
+    };
+    std::vector<AVFrame *> frames;
+
+    for (int i = 0; i < 4; i++) {
+        frames.push_back(getFrame());
+        ASSERT_TRUE(frames.back());
+    }
+
+    int64_t fullBytes = FrameBufferPool::getTotalBytes();
+    ASSERT_GT(fullBytes, startBytes);
+    // all in use, a frame held out of the queues is allocated out of the pool at once
+    int64_t start = af_gettime_relative();
+    AVFrame *overflow = getFrame();
+    ASSERT_TRUE(overflow);
+    ASSERT_LT(af_gettime_relative() - start, 50000);
+    ASSERT_EQ(fullBytes, FrameBufferPool::getTotalBytes());
+    FrameBufferPool::Stats stats = pool.getStats();
+    ASSERT_EQ(4, stats.frames);
+    ASSERT_EQ(1, stats.overflowFrames);
+    av_frame_free(&overflow);
+    // a released frame is taken again
+    av_frame_free(&frames.back());
+    frames.pop_back();
+    frames.push_back(getFrame());
+    ASSERT_TRUE(frames.back());
+    ASSERT_EQ(fullBytes, FrameBufferPool::getTotalBytes());
+    ASSERT_EQ(1, pool.getStats().overflowFrames);
+    // the free buffers are trimmed, the ones in use are kept
+    av_frame_free(&frames.back());
+    frames.pop_back();
+    pool.trim();
+    ASSERT_EQ(3, pool.getStats().frames);
+    ASSERT_LT(FrameBufferPool::getTotalBytes(), fullBytes);
+
+    for (auto &item : frames) {
+        av_frame_free(&item);
+    }
+
+    pool.trim();
+    ASSERT_EQ(0, pool.getStats().frames);
+    avcodec_free_context(&ctx);
+    ASSERT_EQ(startBytes, FrameBufferPool::getTotalBytes());
+}
+
+TEST(softCodec, idrPacket)
+{
+    // aud, sps, then an idr slice
+    const uint8_t h264Idr[] = {0, 0, 0, 1, 0x09, 0xf0, 0, 0, 0, 1, 0x67, 0x42, 0, 0, 1, 0x65, 0x88};
+    // sei, then a non idr slice of an open gop i frame
+    const uint8_t h264NonIdr[] = {0, 0, 1, 0x06, 0x05, 0, 0, 1, 0x41, 0x9a};
+    ASSERT_TRUE(avcodecDecoder::isIdrPacket(AV_CODEC_ID_H264, h264Idr, sizeof(h264Idr), 0));
+    ASSERT_FALSE(avcodecDecoder::isIdrPacket(AV_CODEC_ID_H264, h264NonIdr, sizeof(h264NonIdr), 0));
+
+    // length prefixed, vps then IDR_W_RADL
+    const uint8_t hevcIdr[] = {0, 0, 0, 2, 0x40, 0x01, 0, 0, 0, 2, 0x26, 0x01};
+    // CRA
+    const uint8_t hevcCra[] = {0, 0, 0, 2, 0x2a, 0x01};
+    ASSERT_TRUE(avcodecDecoder::isIdrPacket(AV_CODEC_ID_HEVC, hevcIdr, sizeof(hevcIdr), 4));
+    ASSERT_FALSE(avcodecDecoder::isIdrPacket(AV_CODEC_ID_HEVC, hevcCra, sizeof(hevcCra), 4));
+
+    // a broken length is not an idr
+    const uint8_t broken[] = {0, 0, 0, 9, 0x65};
+    ASSERT_FALSE(avcodecDecoder::isIdrPacket(AV_CODEC_ID_H264, broken, sizeof(broken), 4));
+}
@@ -6,9 +6,17 @@
 #include "gtest/gtest.h"
 #include <data_source/dataSourcePrototype.h>
 #include <demuxer/demuxerPrototype.h>
+#include <base/media/subTitlePacket.h>
+#include <map>
+#include <demuxer/AnnexbBSF.h>
+#include <demuxer/SubtitleCueIndex.h>
 #include <demuxer/demuxer_service.h>
+#include <demuxer/play_list/DashParser.h>
+#include <demuxer/play_list/playList.h>
 #include <utils/AFUtils.h>
+#include <utils/CicadaJSON.h>
 #include <utils/frame_work_log.h>
+#include <utils/timer.h>
 
 using namespace Cicada;
 
@@ -182,6 +190,142 @@ TEST(mergeHeader, hls_multi)
     test_mergeHeader(url, header_type_extract);
 }
 
+TEST(hls, renditionMerge)
+{
+    // a master playlist with the audio in the separate renditions of EXT-X-MEDIA
+    std::string url = "https://devstreaming-cdn.apple.com/videos/streaming/examples/img_bipbop_adv_example_ts/master.m3u8";
+    auto source = dataSourcePrototype::create(url);
+    source->Open(0);
+    unique_ptr<demuxer_service> service = unique_ptr<demuxer_service>(new demuxer_service(source));
+    ASSERT_GE(service->initOpen(), 0);
+    int videoIndex = -1;
+    int audioIndex = -1;
+
+    for (int i = 0; i < service->GetNbStreams(); i++) {
+        unique_ptr<streamMeta> meta{};
+        service->GetStreamMeta(meta, i, false);
+        auto type = ((Stream_meta *) (*(meta.get())))->type;
+
+        if (type == STREAM_TYPE_VIDEO && videoIndex < 0) {
+            videoIndex = i;
+            service->OpenStream(i);
+        } else if (type == STREAM_TYPE_AUDIO && audioIndex < 0) {
+            audioIndex = i;
+            service->OpenStream(i);
+        }
+    }
+
+    ASSERT_GE(videoIndex, 0);
+    ASSERT_GE(audioIndex, 0);
+    service->start();
+    std::map<int, int64_t> lastDts{};
+    int count = 0;
+    int ret;
+
+    do {
+        std::unique_ptr<IAFPacket> packet{};
+        ret = service->readPacket(packet);
+
+        if (ret == -EAGAIN) {
+            af_usleep(10000);
+            continue;
+        }
+
+        if (ret < 0) {
+            break;
+        }
+
+        if (packet == nullptr || packet->getInfo().dts == INT64_MIN) {
+            continue;
+        }
+
+        int index = GEN_STREAM_INDEX(packet->getInfo().streamIndex);
+        lastDts[index] = packet->getInfo().dts;
+
+        // the renditions are merged by dts, the skew is bounded
+        if (lastDts.size() == 2) {
+            ASSERT_LE(std::abs(lastDts[videoIndex] - lastDts[audioIndex]), 1000000);
+        }
+
+        count++;
+    } while (ret != 0 && count < 2000);
+
+    ASSERT_FALSE(ret < 0 && ret != -EAGAIN);
+    ASSERT_EQ(2u, lastDts.size());
+    CicadaJSONItem starvation(service->GetProperty(audioIndex, "starvation"));
+    ASSERT_TRUE(starvation.hasItem("count"));
+    service->close();
+    delete source;
+}
+
+// the start of the playList event and the end of the segment event of the rendition, in the steady ms
+static bool getOpenWindow(const std::string &timeline, int64_t &start, int64_t &end)
+{
+    CicadaJSONArray array(timeline);
+    start = end = INT64_MIN;
+
+    for (int i = 0; i < array.getSize(); i++) {
+        CicadaJSONItem &item = array.getItem(i);
+
+        if (item.getString("name") == "playList") {
+            start = item.getInt64("start", INT64_MIN);
+        } else if (item.getString("name") == "segment") {
+            end = item.getInt64("end", INT64_MIN);
+        }
+    }
+
+    return start != INT64_MIN && end != INT64_MIN;
+}
+
+TEST(hls, renditionParallelOpen)
+{
+    std::string url = "https://devstreaming-cdn.apple.com/videos/streaming/examples/img_bipbop_adv_example_ts/master.m3u8";
+    auto source = dataSourcePrototype::create(url);
+    source->Open(0);
+    unique_ptr<demuxer_service> service = unique_ptr<demuxer_service>(new demuxer_service(source));
+    ASSERT_GE(service->initOpen(), 0);
+    int videoIndex = -1;
+    int audioIndex = -1;
+
+    for (int i = 0; i < service->GetNbStreams(); i++) {
+        unique_ptr<streamMeta> meta{};
+        service->GetStreamMeta(meta, i, false);
+        auto type = ((Stream_meta *) (*(meta.get())))->type;
+
+        if (type == STREAM_TYPE_VIDEO && videoIndex < 0) {
+            videoIndex = i;
+            service->OpenStream(i);
+        } else if (type == STREAM_TYPE_AUDIO && audioIndex < 0) {
+            audioIndex = i;
+            service->OpenStream(i);
+        }
+    }
+
+    ASSERT_GE(videoIndex, 0);
+    ASSERT_GE(audioIndex, 0);
+    service->start();
+    int64_t videoStart;
+    int64_t videoEnd;
+    int64_t audioStart;
+    int64_t audioEnd;
+    bool opened = false;
+    int64_t startTime = af_getsteady_ms();
+
+    while (!opened && af_getsteady_ms() - startTime < 10000) {
+        af_msleep(10);
+        opened = getOpenWindow(service->GetProperty(videoIndex, "startupTimeline"), videoStart, videoEnd) &&
+                 getOpenWindow(service->GetProperty(audioIndex, "startupTimeline"), audioStart, audioEnd);
+    }
+
+    ASSERT_TRUE(opened);
+    // the media playlist and the first segment of a rendition are fetched by its own read thread,
+    // the renditions don't wait for each other
+    ASSERT_LE(videoStart, audioEnd);
+    ASSERT_LE(audioStart, videoEnd);
+    service->close();
+    delete source;
+}
+
 //TEST(mergeAudioHeader, mp4)
 //{
 //    std::string url = "http://player.alicdn.com/video/aliyunmedia.mp4";
@@ -275,4 +419,417 @@ TEST(scd_h265 , mp4)
             "https://alivc-demo-vod.aliyuncs.com/a2b7103c0bd049ecb7689472027cad2d/20144bf04b0e4f3c82ea2a7425a0a345-c4f5aabdcc7ba2861e8f0092d94db3bc-sd.mp4";
     test_csd(url , header_type_merge);
     test_csd(url , header_type_extract);
-}
\ No newline at end of file
+}
+
+// a 24 hours dvr window of 2s segments, every S written out as a packager without "r" does
+static std::string makeTimelineMpd(int segmentCount, int videoCount)
+{
+    std::string mpd = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"dynamic\" availabilityStartTime=\"1970-01-01T00:00:00Z\""
+                      " timeShiftBufferDepth=\"PT24H\" minimumUpdatePeriod=\"PT2S\">\n"
+                      "<Period id=\"0\" start=\"PT0S\">\n"
+                      "<AdaptationSet mimeType=\"video/mp4\">\n"
+                      "<SegmentTemplate timescale=\"90000\" media=\"$RepresentationID$/$Time$.m4s\" initialization=\"$RepresentationID$/init.mp4\">\n"
+                      "<SegmentTimeline>\n";
+    uint64_t time = 90000ULL * 3600;
+
+    for (int i = 0; i < segmentCount; i++) {
+        // 1.96s and 2.04s, can't be merged into a "r" run
+        uint64_t duration = i % 2 ? 183600 : 176400;
+        mpd += "<S t=\"" + std::to_string(time) + "\" d=\"" + std::to_string(duration) + "\"/>\n";
+        time += duration;
+    }
+
+    mpd += "</SegmentTimeline>\n</SegmentTemplate>\n";
+
+    for (int i = 0; i < videoCount; i++) {
+        mpd += "<Representation id=\"v" + std::to_string(i) + "\" bandwidth=\"" + std::to_string((i + 1) * 1000000) +
+               "\" width=\"1280\" height=\"720\"/>\n";
+    }
+
+    mpd += "</AdaptationSet>\n</Period>\n</MPD>\n";
+    return mpd;
+}
+
+static SegmentList *getSegmentList(playList *pList, int index)
+{
+    auto adaptSets = pList->GetPeriods().front()->GetAdaptSets();
+    auto reps = adaptSets.front()->getRepresentations();
+    auto it = reps.begin();
+    std::advance(it, index);
+    return (*it)->GetSegmentList();
+}
+
+TEST(dash, parseBenchmark)
+{
+    const int segmentCount = 43200;
+    std::string mpd = makeTimelineMpd(segmentCount, 4);
+    DashParser parser("http://example.com/live/manifest.mpd");
+    int64_t start = af_gettime_relative();
+    playList *pList = parser.parse(mpd.c_str(), mpd.size(), "http://example.com/live/manifest.mpd");
+    int64_t used = af_gettime_relative() - start;
+    ASSERT_NE(pList, nullptr);
+    ASSERT_EQ(pList->GetPeriods().front()->GetAdaptSets().front()->getRepresentations().size(), 4);
+    ASSERT_EQ(getSegmentList(pList, 3)->getSegmentCount(), segmentCount);
+    printf("parse %d KB mpd, %d segments x 4 representations in %lld ms\n", (int) (mpd.size() / 1024), segmentCount,
+           (long long) (used / 1000));
+    delete pList;
+}
+
+TEST(dash, lookupBenchmark)
+{
+    const int segmentCount = 43200;
+    const int lookupCount = 100000;
+    std::string mpd = makeTimelineMpd(segmentCount, 1);
+    DashParser parser("http://example.com/live/manifest.mpd");
+    playList *pList = parser.parse(mpd.c_str(), mpd.size(), "http://example.com/live/manifest.mpd");
+    ASSERT_NE(pList, nullptr);
+    SegmentList *list = getSegmentList(pList, 0);
+    uint64_t first = list->getFirstSeqNum();
+    uint64_t totalUs = segmentCount / 2 * 4000000ULL;
+    int64_t start = af_gettime_relative();
+
+    for (int i = 0; i < lookupCount; i++) {
+        uint64_t time = totalUs / lookupCount * i;
+        uint64_t num = 0;
+        ASSERT_TRUE(list->getSegmentNumberByTime(time, num));
+        std::shared_ptr<segment> seg = list->getSegmentByNumber(num);
+        ASSERT_NE(seg, nullptr);
+        ASSERT_EQ(seg->sequence, num);
+        // every two segments are 4s
+        ASSERT_EQ((num - first) / 2, time / 4000000);
+    }
+
+    int64_t used = af_gettime_relative() - start;
+    std::shared_ptr<segment> seg = list->getSegmentByNumber(first + 2);
+    ASSERT_EQ(seg->mUri, "v0/" + std::to_string(90000ULL * 3600 + 360000) + ".m4s");
+    ASSERT_EQ(seg->init_section->mUri, "v0/init.mp4");
+    printf("%d time and number lookups in %lld us\n", lookupCount, (long long) used);
+    delete pList;
+}
+
+TEST(dash, liveNumberTemplate)
+{
+    std::string mpd = "<MPD type=\"dynamic\" availabilityStartTime=\"1970-01-01T00:00:00Z\" timeShiftBufferDepth=\"PT24H\">"
+                      "<Period start=\"PT0S\"><AdaptationSet contentType=\"audio\" lang=\"en\">"
+                      "<SegmentTemplate timescale=\"1000\" duration=\"2000\" startNumber=\"0\" media=\"a_$Number%08d$.m4s\"/>"
+                      "<Representation id=\"a\" bandwidth=\"128000\"/></AdaptationSet></Period></MPD>";
+    DashParser parser("http://example.com/live/manifest.mpd");
+    playList *pList = parser.parse(mpd.c_str(), mpd.size(), "http://example.com/live/manifest.mpd");
+    ASSERT_NE(pList, nullptr);
+    SegmentList *list = getSegmentList(pList, 0);
+    int64_t now = af_gettime();
+    uint64_t last = list->getLastSeqNum();
+    // the segments ended before now, in the 24 hours window
+    ASSERT_NEAR((double) last, (double) (now / 2000000 - 1), 1);
+    ASSERT_EQ(list->getSegmentCount(), 43200);
+    ASSERT_EQ(list->getFirstSeqNum(), last - 43199);
+    char name[32];
+    snprintf(name, sizeof(name), "a_%08llu.m4s", (unsigned long long) last);
+    ASSERT_EQ(list->getSegmentByNumber(last)->mUri, name);
+    ASSERT_EQ(list->getSegmentByNumber(last + 1), nullptr);
+    delete pList;
+}
+
+static std::string makeShortTimelineMpd(const std::string &depth)
+{
+    // 20 segments of 2s, then 2 after a 10s gap, 54s
+    return "<MPD type=\"dynamic\" availabilityStartTime=\"1970-01-01T00:00:00Z\" timeShiftBufferDepth=\"" + depth + "\">"
+           "<Period start=\"PT0S\"><AdaptationSet mimeType=\"video/mp4\">"
+           "<SegmentTemplate timescale=\"1000\" startNumber=\"1\" media=\"v_$Number$.m4s\"><SegmentTimeline>"
+           "<S t=\"0\" d=\"2000\" r=\"19\"/><S t=\"50000\" d=\"2000\" r=\"1\"/>"
+           "</SegmentTimeline></SegmentTemplate>"
+           "<Representation id=\"v\" bandwidth=\"1000000\"/></AdaptationSet></Period></MPD>";
+}
+
+TEST(dash, timelineTimeShiftBuffer)
+{
+    struct {
+        const char *depth;
+        uint64_t first;
+    } cases[] = {
+            // from 44s, only the two segments after the gap
+            {"PT10S", 21},
+            // from 35s, the segment started at 34s is partly out
+            {"PT19S", 19},
+            // the whole timeline
+            {"PT60S", 1},
+            // no segment ends in the window, the last one is kept
+            {"PT1S", 22},
+    };
+
+    for (auto &item : cases) {
+        std::string mpd = makeShortTimelineMpd(item.depth);
+        DashParser parser("http://example.com/live/manifest.mpd");
+        playList *pList = parser.parse(mpd.c_str(), mpd.size(), "http://example.com/live/manifest.mpd");
+        ASSERT_NE(pList, nullptr);
+        SegmentList *list = getSegmentList(pList, 0);
+        ASSERT_EQ(list->getLastSeqNum(), 22);
+        ASSERT_EQ(list->getFirstSeqNum(), item.first) << item.depth;
+        ASSERT_EQ(list->getSegmentCount(), 22 - item.first + 1);
+        // the segments out of the buffer are not given
+        ASSERT_EQ(list->getSegmentByNumber(1)->sequence, item.first);
+        delete pList;
+    }
+}
+
+static std::unique_ptr<IAFPacket> makeCue(int64_t pts, int64_t duration)
+{
+    uint8_t text[] = "cue";
+    return std::unique_ptr<IAFPacket>(new subTitlePacket(text, sizeof(text), pts, duration));
+}
+
+TEST(subtitle, cueOverlap)
+{
+    SubtitleCueIndex cues;
+    cues.add(makeCue(0, 10000000));
+    cues.add(makeCue(1000000, 1000000));
+    // the same start time
+    cues.add(makeCue(1000000, 3000000));
+    cues.add(makeCue(5000000, 1000000));
+    // out of order
+    cues.add(makeCue(3000000, 500000));
+    ASSERT_EQ(cues.size(), 5);
+    ASSERT_EQ(cues.at(3)->getInfo().pts, 3000000);
+    // the first cue is showing until 10s
+    ASSERT_EQ(cues.seek(9000000), 0);
+    ASSERT_EQ(cues.seek(10000001), 5);
+
+    SubtitleCueIndex shortCues;
+    shortCues.add(makeCue(0, 1000000));
+    shortCues.add(makeCue(1000000, 1000000));
+    shortCues.add(makeCue(1000000, 3000000));
+    shortCues.add(makeCue(5000000, 1000000));
+    ASSERT_EQ(shortCues.seek(2500000), 2);
+    ASSERT_EQ(shortCues.seek(4500000), 3);
+    ASSERT_EQ(shortCues.at(shortCues.seek(2500000))->getInfo().duration, 3000000);
+}
+
+TEST(subtitle, cueSeekBenchmark)
+{
+    // 4 hours of 2s cues
+    const int cueCount = 7200;
+    const int seekCount = 100000;
+    SubtitleCueIndex cues;
+
+    for (int i = 0; i < cueCount; i++) {
+        cues.add(makeCue(i * 2000000LL, 1500000));
+    }
+
+    int64_t start = af_gettime_relative();
+
+    for (int i = 0; i < seekCount; i++) {
+        int64_t pts = (int64_t) (cueCount - 1) * 2000000 / seekCount * i;
+        size_t index = cues.seek(pts);
+        ASSERT_LT(index, cues.size());
+        ASSERT_GE(cues.at(index)->getInfo().pts + cues.at(index)->getInfo().duration, pts);
+        ASSERT_TRUE(index == 0 || cues.at(index - 1)->getInfo().pts + cues.at(index - 1)->getInfo().duration < pts);
+    }
+
+    printf("%d seeks in %d cues in %lld us\n", seekCount, cueCount, (long long) (af_gettime_relative() - start));
+}
+
+TEST(subtitle, readPacketSize)
+{
+    const char *path = "readPacketSize.srt";
+    FILE *file = fopen(path, "w");
+    fputs("1\n00:00:01,000 --> 00:00:02,000\nfirst\n\n"
+          "2\n00:00:03,000 --> 00:00:04,000\nsecond\n\n"
+          "3\n00:00:05,000 --> 00:00:06,000\nthird\n\n", file);
+    fclose(file);
+    unique_ptr<IDataSource> source = unique_ptr<IDataSource>(dataSourcePrototype::create(string("file://") + path));
+    ASSERT_GE(source->Open(0), 0);
+    unique_ptr<demuxer_service> service = unique_ptr<demuxer_service>(new demuxer_service(source.get()));
+    ASSERT_GE(service->initOpen(), 0);
+    ASSERT_GT(service->GetNbStreams(), 0);
+    service->OpenStream(0);
+    int count = 0;
+    int ret;
+
+    do {
+        std::unique_ptr<IAFPacket> packet{};
+        ret = service->readPacket(packet, 0);
+
+        if (packet) {
+            // a packet read is never taken as the end of stream
+            ASSERT_GT(ret, 0);
+            ASSERT_EQ(ret, std::max(static_cast<int>(packet->getSize()), 1));
+            count++;
+        }
+    } while (ret > 0 || ret == -EAGAIN);
+
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(count, 3);
+    service->close();
+    remove(path);
+}
+
+static const uint8_t testSps[] = {0x67, 0x64, 0x00, 0x33, 0xac, 0xd9, 0x40, 0x0f, 0x00, 0x08, 0x7f};
+static const uint8_t testPps[] = {0x68, 0xeb, 0xe3, 0xcb, 0x22, 0xc0};
+
+static AVCodecParameters *makeAvcCParameters()
+{
+    AVCodecParameters *codecpar = avcodec_parameters_alloc();
+    std::vector<uint8_t> avcC{1, 0x64, 0x00, 0x33, 0xff, 0xe1, 0, sizeof(testSps)};
+    avcC.insert(avcC.end(), testSps, testSps + sizeof(testSps));
+    avcC.insert(avcC.end(), {1, 0, sizeof(testPps)});
+    avcC.insert(avcC.end(), testPps, testPps + sizeof(testPps));
+    codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    codecpar->codec_id = AV_CODEC_ID_H264;
+    codecpar->extradata = static_cast<uint8_t *>(av_mallocz(avcC.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+    memcpy(codecpar->extradata, avcC.data(), avcC.size());
+    codecpar->extradata_size = static_cast<int>(avcC.size());
+    return codecpar;
+}
+
+// a sei and the slices of sliceSize bytes, with 4 bytes nal length
+static AVPacket *makeAvcCPacket(bool key, int slices, int sliceSize)
+{
+    std::vector<uint8_t> data{};
+    const uint8_t sei[] = {0x06, 0x05, 0x01, 0x00, 0x80};
+    data.insert(data.end(), {0, 0, 0, sizeof(sei)});
+    data.insert(data.end(), sei, sei + sizeof(sei));
+
+    for (int i = 0; i < slices; i++) {
+        data.insert(data.end(), {(uint8_t) (sliceSize >> 24), (uint8_t) (sliceSize >> 16), (uint8_t) (sliceSize >> 8), (uint8_t) sliceSize});
+        data.push_back(key ? 0x65 : 0x41);
+        data.insert(data.end(), sliceSize - 1, (uint8_t) (i + 1));
+    }
+
+    AVPacket *pkt = av_packet_alloc();
+    av_new_packet(pkt, static_cast<int>(data.size()));
+    memcpy(pkt->data, data.data(), data.size());
+
+    if (key) {
+        pkt->flags |= AV_PKT_FLAG_KEY;
+    }
+
+    return pkt;
+}
+
+TEST(bsf, vcc2Annexb)
+{
+    AVCodecParameters *codecpar = makeAvcCParameters();
+    AnnexbBSF bsf;
+    ASSERT_GE(bsf.init("h26xVcc2Annexb", codecpar), 0);
+    std::vector<uint8_t> parameterSets{0, 0, 0, 1};
+    parameterSets.insert(parameterSets.end(), testSps, testSps + sizeof(testSps));
+    parameterSets.insert(parameterSets.end(), {0, 0, 0, 1});
+    parameterSets.insert(parameterSets.end(), testPps, testPps + sizeof(testPps));
+    ASSERT_EQ(std::vector<uint8_t>(codecpar->extradata, codecpar->extradata + codecpar->extradata_size), parameterSets);
+
+    for (bool key : {true, false}) {
+        AVPacket *pkt = makeAvcCPacket(key, 2, 100);
+        std::vector<uint8_t> expected = key ? parameterSets : std::vector<uint8_t>();
+        std::vector<uint8_t> in(pkt->data, pkt->data + pkt->size);
+
+        for (size_t pos = 0; pos < in.size();) {
+            uint32_t length = (uint32_t) in[pos] << 24 | in[pos + 1] << 16 | in[pos + 2] << 8 | in[pos + 3];
+            expected.insert(expected.end(), {0, 0, 0, 1});
+            expected.insert(expected.end(), in.begin() + pos + 4, in.begin() + pos + 4 + length);
+            pos += 4 + length;
+        }
+
+        const uint8_t *data = pkt->data;
+        ASSERT_EQ(bsf.push(pkt), 0);
+        ASSERT_EQ(bsf.pull(pkt), (int) expected.size());
+        ASSERT_EQ(std::vector<uint8_t>(pkt->data, pkt->data + pkt->size), expected);
+        // the parameter sets are inserted to the key frames only, the others are converted in place
+        ASSERT_EQ(pkt->data == data, !key);
+        av_packet_free(&pkt);
+    }
+
+    // a nal longer than the packet
+    AVPacket *pkt = makeAvcCPacket(false, 1, 100);
+    pkt->data[3] = 200;
+    ASSERT_EQ(bsf.push(pkt), 0);
+    ASSERT_LT(bsf.pull(pkt), 0);
+    av_packet_free(&pkt);
+    avcodec_parameters_free(&codecpar);
+}
+
+// the key frames with the sps and the pps in band are converted in place, with only one of them the both are inserted
+TEST(bsf, vcc2AnnexbInBandParameterSets)
+{
+    AVCodecParameters *codecpar = makeAvcCParameters();
+    AnnexbBSF bsf;
+    ASSERT_GE(bsf.init("h26xVcc2Annexb", codecpar), 0);
+    std::vector<uint8_t> parameterSets(codecpar->extradata, codecpar->extradata + codecpar->extradata_size);
+
+    for (bool withPps : {true, false}) {
+        std::vector<uint8_t> data{0, 0, 0, sizeof(testSps)};
+        data.insert(data.end(), testSps, testSps + sizeof(testSps));
+
+        if (withPps) {
+            data.insert(data.end(), {0, 0, 0, sizeof(testPps)});
+            data.insert(data.end(), testPps, testPps + sizeof(testPps));
+        }
+
+        AVPacket *slice = makeAvcCPacket(true, 1, 100);
+        data.insert(data.end(), slice->data, slice->data + slice->size);
+        av_packet_free(&slice);
+
+        AVPacket *pkt = av_packet_alloc();
+        av_new_packet(pkt, static_cast<int>(data.size()));
+        memcpy(pkt->data, data.data(), data.size());
+        pkt->flags |= AV_PKT_FLAG_KEY;
+
+        std::vector<uint8_t> expected = withPps ? std::vector<uint8_t>() : parameterSets;
+
+        for (size_t pos = 0; pos < data.size();) {
+            uint32_t length = (uint32_t) data[pos] << 24 | data[pos + 1] << 16 | data[pos + 2] << 8 | data[pos + 3];
+            expected.insert(expected.end(), {0, 0, 0, 1});
+            expected.insert(expected.end(), data.begin() + pos + 4, data.begin() + pos + 4 + length);
+            pos += 4 + length;
+        }
+
+        const uint8_t *in = pkt->data;
+        ASSERT_EQ(bsf.push(pkt), 0);
+        ASSERT_EQ(bsf.pull(pkt), (int) expected.size());
+        ASSERT_EQ(std::vector<uint8_t>(pkt->data, pkt->data + pkt->size), expected);
+        ASSERT_EQ(pkt->data == in, withPps);
+        av_packet_free(&pkt);
+    }
+
+    avcodec_parameters_free(&codecpar);
+}
+
+TEST(bsf, vcc2AnnexbBenchmark)
+{
+    // 10s of 4k 30fps at 25Mbps, a key frame every 2s, 4 slices a frame
+    const int frames = 300;
+    const int gop = 60;
+    const int keySize = 400 * 1024;
+    const int frameSize = 90 * 1024;
+    const int slices = 4;
+
+    for (const char *name : {"h264_mp4toannexb", "h26xVcc2Annexb"}) {
+        AVCodecParameters *codecpar = makeAvcCParameters();
+        std::unique_ptr<IAVBSF> bsf(IAVBSFFactory::create(name));
+        ASSERT_GE(bsf->init(name, codecpar), 0);
+        int64_t inBytes = 0;
+        int64_t outBytes = 0;
+        int64_t used = 0;
+
+        for (int i = 0; i < frames; i++) {
+            bool key = i % gop == 0;
+            AVPacket *pkt = makeAvcCPacket(key, slices, (key ? keySize : frameSize) / slices);
+            inBytes += pkt->size;
+            int64_t start = af_gettime_relative();
+            ASSERT_GE(bsf->push(pkt), 0);
+            int ret = bsf->pull(pkt);
+            used += af_gettime_relative() - start;
+            ASSERT_GT(ret, 0);
+            outBytes += pkt->size;
+            av_packet_free(&pkt);
+        }
+
+        // the ffmpeg bsf copies every packet to a new one
+        auto *annexbBSF = dynamic_cast<AnnexbBSF *>(bsf.get());
+        int64_t copied = annexbBSF ? annexbBSF->getCopiedBytes() : outBytes;
+        // per hour of the content
+        printf("%s: %lld MB in, %lld MB copied, %lld ms cpu per hour\n", name, (long long) (inBytes * 360 / 1024 / 1024),
+               (long long) (copied * 360 / 1024 / 1024), (long long) (used * 360 / 1000));
+        avcodec_parameters_free(&codecpar);
+    }
+}
@@ -15,6 +15,11 @@
 #endif
 #include <base/media/AVAFPacket.h>
 #include <utils/AFUtils.h>
+#include <utils/ColorConvert.h>
+#include <utils/pcm_utils.h>
+#include <render/video/VideoSnapshot.h>
+#include <condition_variable>
+#include <vector>
 #ifdef __APPLE__
 #include <base/media/PBAFFrame.h>
 #endif
@@ -203,8 +208,288 @@ TEST(audio, render)
     test_render(url, STREAM_TYPE_AUDIO, DECFLAG_SW, 100);
 }
 
+TEST(audio, pcmUtils)
+{
+    const int samples = 37;
+    const int maxChannels = 6;
+    uint8_t planes[maxChannels][samples * 4], interleaved[maxChannels * samples * 4], out[maxChannels][samples * 4];
+    const uint8_t *src[maxChannels];
+    uint8_t *dst[maxChannels];
+
+    for (int ch = 0; ch < maxChannels; ch++) {
+        for (int i = 0; i < samples * 4; i++) {
+            planes[ch][i] = static_cast<uint8_t>(ch * 31 + i * 7);
+        }
+
+        src[ch] = planes[ch];
+        dst[ch] = out[ch];
+    }
+
+    // 37 samples go through the simd code and the c code of the tail
+    for (int channels : {1, 2, 3, 6}) {
+        for (int sampleSize : {2, 4}) {
+            interleavePCM(interleaved, src, channels, samples, sampleSize);
+
+            for (int i = 0; i < samples; i++) {
+                for (int ch = 0; ch < channels; ch++) {
+                    ASSERT_EQ(0, memcmp(interleaved + (i * channels + ch) * sampleSize, planes[ch] + i * sampleSize, sampleSize));
+                }
+            }
+
+            deinterleavePCM(dst, interleaved, channels, samples, sampleSize);
+
+            for (int ch = 0; ch < channels; ch++) {
+                ASSERT_EQ(0, memcmp(out[ch], planes[ch], samples * sampleSize));
+            }
+        }
+    }
+
+    // a single sample through the c code only
+    int16_t s16[samples * 2], s16One[samples * 2];
+    float flt[samples * 2], fltOne[samples * 2];
+
+    for (int i = 0; i < samples * 2; i++) {
+        s16[i] = static_cast<int16_t>(i * 800 - 30000);
+        flt[i] = static_cast<float>(i) / samples - 1.0f;
+    }
+
+    memcpy(s16One, s16, sizeof(s16));
+    memcpy(fltOne, flt, sizeof(flt));
+    ASSERT_EQ(0, applyPCMGain(reinterpret_cast<uint8_t *>(s16), AF_SAMPLE_FMT_S16, samples * 2, 1.7f));
+    ASSERT_EQ(0, applyPCMGain(reinterpret_cast<uint8_t *>(flt), AF_SAMPLE_FMT_FLTP, samples * 2, 1.7f));
+
+    for (int i = 0; i < samples * 2; i++) {
+        applyPCMGain(reinterpret_cast<uint8_t *>(s16One + i), AF_SAMPLE_FMT_S16, 1, 1.7f);
+        applyPCMGain(reinterpret_cast<uint8_t *>(fltOne + i), AF_SAMPLE_FMT_FLT, 1, 1.7f);
+        ASSERT_EQ(s16One[i], s16[i]);
+        ASSERT_EQ(fltOne[i], flt[i]);
+    }
+
+    ASSERT_EQ(INT16_MIN, s16[0]);
+    ASSERT_EQ(INT16_MAX, s16[samples * 2 - 1]);
+    ASSERT_EQ(-1.0f, flt[0]);
+    ASSERT_EQ(-EINVAL, applyPCMGain(reinterpret_cast<uint8_t *>(flt), AF_SAMPLE_FMT_DBL, 1, 1.0f));
+
+    int16_t mono[samples], monoOne;
+    float fltMono[samples], fltMonoOne;
+    downmixPCMToMono(reinterpret_cast<uint8_t *>(mono), reinterpret_cast<const uint8_t *>(s16), AF_SAMPLE_FMT_S16, 2, samples);
+    downmixPCMToMono(reinterpret_cast<uint8_t *>(fltMono), reinterpret_cast<const uint8_t *>(flt), AF_SAMPLE_FMT_FLT, 2, samples);
+
+    for (int i = 0; i < samples; i++) {
+        downmixPCMToMono(reinterpret_cast<uint8_t *>(&monoOne), reinterpret_cast<const uint8_t *>(s16 + i * 2), AF_SAMPLE_FMT_S16, 2, 1);
+        downmixPCMToMono(reinterpret_cast<uint8_t *>(&fltMonoOne), reinterpret_cast<const uint8_t *>(flt + i * 2), AF_SAMPLE_FMT_FLT, 2, 1);
+        ASSERT_EQ(monoOne, mono[i]);
+        ASSERT_EQ(fltMonoOne, fltMono[i]);
+        ASSERT_EQ((s16[i * 2] + s16[i * 2 + 1]) / 2, mono[i]);
+    }
+
+    float peak, rms;
+
+    for (int i = 0; i < samples * 2; i++) {
+        s16[i] = static_cast<int16_t>(i % 2 ? -16384 : 16384);
+        flt[i] = i % 2 ? -0.5f : 0.5f;
+    }
+
+    ASSERT_EQ(0, meterPCM(reinterpret_cast<const uint8_t *>(s16), AF_SAMPLE_FMT_S16P, samples * 2, &peak, &rms));
+    ASSERT_FLOAT_EQ(0.5f, peak);
+    ASSERT_FLOAT_EQ(0.5f, rms);
+    ASSERT_EQ(0, meterPCM(reinterpret_cast<const uint8_t *>(flt), AF_SAMPLE_FMT_FLT, samples * 2, &peak, &rms));
+    ASSERT_FLOAT_EQ(0.5f, peak);
+    ASSERT_FLOAT_EQ(0.5f, rms);
+
+    uint8_t silence[4] = {1, 1, 1, 1};
+    fillPCMSilence(silence, AF_SAMPLE_FMT_U8P, 2);
+    fillPCMSilence(silence + 2, AF_SAMPLE_FMT_S16, 2);
+    ASSERT_EQ(0x80, silence[0]);
+    ASSERT_EQ(0, silence[3]);
+}
+
+template<typename F>
+static void pcmBenchmark(const char *name, int samples, F kernel)
+{
+    const int loops = 2000;
+    int64_t start = af_gettime_relative();
+
+    for (int i = 0; i < loops; i++) {
+        kernel();
+    }
+
+    int64_t used = af_gettime_relative() - start;
+    AF_LOGI("%s: %.3f ns per sample", name, (double) used * 1000 / loops / samples);
+}
+
+TEST(audio, pcmUtilsBenchmark)
+{
+    // 1024 samples of stereo, a frame of aac
+    const int samples = 1024;
+    const int channels = 2;
+    vector<int16_t> left(samples), right(samples), s16(samples * channels), mono(samples);
+    vector<float> fltLeft(samples), fltRight(samples), flt(samples * channels), fltMono(samples);
+    float peak, rms;
+
+    for (int i = 0; i < samples; i++) {
+        left[i] = static_cast<int16_t>(i * 37);
+        right[i] = static_cast<int16_t>(-i * 41);
+        fltLeft[i] = static_cast<float>(i) / samples;
+        fltRight[i] = -fltLeft[i];
+    }
+
+    const uint8_t *planes[] = {reinterpret_cast<const uint8_t *>(left.data()), reinterpret_cast<const uint8_t *>(right.data())};
+    const uint8_t *fltPlanes[] = {reinterpret_cast<const uint8_t *>(fltLeft.data()), reinterpret_cast<const uint8_t *>(fltRight.data())};
+    uint8_t *outPlanes[] = {reinterpret_cast<uint8_t *>(left.data()), reinterpret_cast<uint8_t *>(right.data())};
+    auto *s16Data = reinterpret_cast<uint8_t *>(s16.data());
+    auto *fltData = reinterpret_cast<uint8_t *>(flt.data());
+
+    // the loop of copyPCMData before the kernels
+    pcmBenchmark("interleave s16p, sample by sample", samples * channels, [&]() {
+        for (int i = 0, offset = 0; i < samples; i++) {
+            for (int ch = 0; ch < channels; ch++, offset += 2) {
+                memcpy(s16Data + offset, planes[ch] + i * 2, 2);
+            }
+        }
+    });
+    pcmBenchmark("interleave s16p", samples * channels, [&]() { interleavePCM(s16Data, planes, channels, samples, 2); });
+    pcmBenchmark("interleave fltp", samples * channels, [&]() { interleavePCM(fltData, fltPlanes, channels, samples, 4); });
+    pcmBenchmark("deinterleave s16", samples * channels, [&]() { deinterleavePCM(outPlanes, s16Data, channels, samples, 2); });
+    pcmBenchmark("gain s16", samples * channels, [&]() { applyPCMGain(s16Data, AF_SAMPLE_FMT_S16, samples * channels, 1.0f); });
+    pcmBenchmark("gain flt", samples * channels, [&]() { applyPCMGain(fltData, AF_SAMPLE_FMT_FLT, samples * channels, 1.0f); });
+    pcmBenchmark("silence s16", samples * channels, [&]() { fillPCMSilence(s16Data, AF_SAMPLE_FMT_S16, s16.size() * 2); });
+    interleavePCM(s16Data, planes, channels, samples, 2);
+    pcmBenchmark("downmix s16", samples * channels, [&]() {
+        downmixPCMToMono(reinterpret_cast<uint8_t *>(mono.data()), s16Data, AF_SAMPLE_FMT_S16, channels, samples);
+    });
+    pcmBenchmark("downmix flt", samples * channels, [&]() {
+        downmixPCMToMono(reinterpret_cast<uint8_t *>(fltMono.data()), fltData, AF_SAMPLE_FMT_FLT, channels, samples);
+    });
+    pcmBenchmark("meter s16", samples * channels, [&]() { meterPCM(s16Data, AF_SAMPLE_FMT_S16, samples * channels, &peak, &rms); });
+    pcmBenchmark("meter flt", samples * channels, [&]() { meterPCM(fltData, AF_SAMPLE_FMT_FLT, samples * channels, &peak, &rms); });
+}
+
 TEST(video, render)
 {
     std::string url = "http://player.alicdn.com/video/aliyunmedia.mp4";
     test_render(url, STREAM_TYPE_VIDEO, DECFLAG_SW, 100);
 }
+
+TEST(video, colorConvert)
+{
+    const int width = 37;
+    const int height = 4;
+    uint8_t y[width * height], u[width * height / 2], v[width * height / 2];
+    uint8_t rgba[width * height * 4], pixel[4];
+
+    for (int i = 0; i < width * height; i++) {
+        y[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    for (int i = 0; i < width * height / 2; i++) {
+        u[i] = static_cast<uint8_t>(i * 13);
+        v[i] = static_cast<uint8_t>(255 - i * 5);
+    }
+
+    // a line of 37 goes through the simd code, a single pixel through the c code only
+    for (int matrix = ColorConvert::MatrixBT601; matrix <= ColorConvert::MatrixBT709; matrix++) {
+        for (int fullRange = 0; fullRange < 2; fullRange++) {
+            ColorConvert::I420ToRGBA(y, width, u, width / 2, v, width / 2, rgba, width * 4, width, height,
+                                     static_cast<ColorConvert::Matrix>(matrix), fullRange);
+
+            for (int j = 0; j < height; j++) {
+                for (int i = 0; i < width; i++) {
+                    ColorConvert::I420ToRGBA(y + j * width + i, 1, u + (j / 2) * (width / 2) + i / 2, 1, v + (j / 2) * (width / 2) + i / 2,
+                                             1, pixel, 4, 1, 1, static_cast<ColorConvert::Matrix>(matrix), fullRange);
+                    ASSERT_EQ(0, memcmp(pixel, rgba + (j * width + i) * 4, 4));
+                }
+            }
+        }
+    }
+
+    uint8_t white = 235, gray = 128;
+    ColorConvert::I420ToRGBA(&white, 1, &gray, 1, &gray, 1, pixel, 4, 1, 1, ColorConvert::MatrixBT601, false);
+    ASSERT_EQ(255, pixel[0]);
+    ASSERT_EQ(255, pixel[1]);
+    ASSERT_EQ(255, pixel[2]);
+}
+
+TEST(video, snapshot)
+{
+    AVFrame *avFrame = av_frame_alloc();
+    avFrame->format = AV_PIX_FMT_YUV420P;
+    avFrame->width = 64;
+    avFrame->height = 48;
+    av_frame_get_buffer(avFrame, 32);
+
+    for (int i = 0; i < 3; i++) {
+        memset(avFrame->data[i], 128, avFrame->linesize[i] * (i ? 24 : 48));
+    }
+
+    unique_ptr<IAFFrame> frame{new AVAFFrame(&avFrame, IAFFrame::FrameTypeVideo)};
+    VideoSnapshot snapshot;
+    std::mutex mutex;
+    std::condition_variable condition;
+    int count = 0;
+    auto callback = [&](VideoSnapshot::Result &result) {
+        if (result.format == VideoSnapshot::FormatRGBA) {
+            EXPECT_EQ(0, result.error);
+            EXPECT_EQ(32, result.width);
+            EXPECT_EQ(24, result.height);
+            EXPECT_EQ(32 * 24 * 4, result.size);
+        } else if (result.error != -ENOSYS) {
+            // the encoders may be not in the ffmpeg build
+            EXPECT_EQ(0, result.error);
+            EXPECT_GT(result.size, 0);
+        }
+
+        free(result.data);
+        std::unique_lock<std::mutex> lock(mutex);
+        count++;
+        condition.notify_one();
+    };
+    // no frame rendered yet, the request waits for the first one
+    ASSERT_FALSE(snapshot.hasFrame());
+    ASSERT_EQ(0, snapshot.request(32, 0, VideoSnapshot::FormatRGBA, callback));
+    snapshot.setFrame(frame.get());
+    ASSERT_TRUE(snapshot.hasFrame());
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(condition.wait_for(lock, std::chrono::seconds(5), [&]() { return count == 1; }));
+    }
+
+    // no frame rendered any more (paused), the requests take the last one at once
+    frame = nullptr;
+    int64_t requestTime = af_getsteady_ms();
+    ASSERT_EQ(0, snapshot.request(32, 0, VideoSnapshot::FormatRGBA, callback));
+    ASSERT_EQ(0, snapshot.request(0, 0, VideoSnapshot::FormatJPEG, callback));
+    ASSERT_EQ(0, snapshot.request(0, 0, VideoSnapshot::FormatPNG, callback));
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(condition.wait_for(lock, std::chrono::seconds(5), [&]() { return count == 4; }));
+    }
+    // not waited for the 1s timeout of a next frame
+    ASSERT_LT(af_getsteady_ms() - requestTime, 500);
+
+    int error = 0;
+    auto failed = [&](VideoSnapshot::Result &result) {
+        std::unique_lock<std::mutex> lock(mutex);
+        error = result.error;
+        condition.notify_one();
+    };
+
+    // canceled by clearFrame, the last frame is released
+    snapshot.clearFrame();
+    ASSERT_FALSE(snapshot.hasFrame());
+    error = 0;
+    ASSERT_EQ(0, snapshot.request(0, 0, VideoSnapshot::FormatRGBA, failed));
+    snapshot.clearFrame();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(condition.wait_for(lock, std::chrono::seconds(5), [&]() { return error != 0; }));
+        ASSERT_EQ(-ECANCELED, error);
+    }
+
+    // no frame rendered after the clear, the request fails in time
+    error = 0;
+    ASSERT_EQ(0, snapshot.request(0, 0, VideoSnapshot::FormatRGBA, failed));
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(condition.wait_for(lock, std::chrono::seconds(5), [&]() { return error != 0; }));
+    ASSERT_EQ(-EAGAIN, error);
+}
@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+#include <utils/MemoryGovernor.h>
+
+using namespace Cicada;
+
+#define MB (1024 * 1024LL)
+
+class memoryGovernor : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        governor = MemoryGovernor::Instance();
+        governor->setBudget(100 * MB);
+        governor->addClient(&a);
+        governor->addClient(&b);
+
+        for (int i = 0; i < MemoryGovernor::ComponentNum; i++) {
+            governor->setUsage(nullptr, static_cast<MemoryGovernor::Component>(i), 0);
+        }
+    }
+
+    void TearDown() override
+    {
+        governor->removeClient(&a);
+        governor->removeClient(&b);
+        governor->setBudget(0);
+    }
+
+    MemoryGovernor *governor{};
+    int a{};
+    int b{};
+};
+
+TEST_F(memoryGovernor, noBudget)
+{
+    governor->setUsage(&a, MemoryGovernor::ComponentPacket, 200 * MB);
+    governor->setBudget(0);
+    ASSERT_EQ(INT64_MAX, governor->getAllowance(&a));
+    governor->setBudget(100 * MB);
+    int c;
+    ASSERT_EQ(INT64_MAX, governor->getAllowance(&c));
+    ASSERT_EQ(INT64_MAX, governor->getAllowance(nullptr));
+}
+
+TEST_F(memoryGovernor, underBudget)
+{
+    governor->setUsage(&a, MemoryGovernor::ComponentPacket, 30 * MB);
+    governor->addUsage(&a, MemoryGovernor::ComponentFrame, 10 * MB);
+    governor->setUsage(&b, MemoryGovernor::ComponentPacket, 40 * MB);
+    ASSERT_EQ(40 * MB, governor->getUsage(&a));
+    ASSERT_EQ(80 * MB, governor->getTotalUsage());
+    // the room left is given to each of them
+    ASSERT_EQ(60 * MB, governor->getAllowance(&a));
+    ASSERT_EQ(60 * MB, governor->getAllowance(&b));
+}
+
+TEST_F(memoryGovernor, cutByPriority)
+{
+    governor->setUsage(&a, MemoryGovernor::ComponentPacket, 40 * MB);
+    governor->setUsage(&b, MemoryGovernor::ComponentPacket, 80 * MB);
+    governor->setPriority(&b, MemoryGovernor::PriorityBackground);
+    // 20M over, all cut from the background one
+    ASSERT_EQ(40 * MB, governor->getAllowance(&a));
+    ASSERT_EQ(60 * MB, governor->getAllowance(&b));
+
+    // the shared components count in the total
+    governor->setUsage(nullptr, MemoryGovernor::ComponentCache, 80 * MB);
+    ASSERT_EQ(4 * MB, governor->getAllowance(&b));
+    // the background one can't give more, the rest is cut from the foreground one
+    ASSERT_EQ(40 * MB - 24 * MB, governor->getAllowance(&a));
+}
+
+TEST_F(memoryGovernor, cutInProportion)
+{
+    governor->setUsage(&a, MemoryGovernor::ComponentPacket, 60 * MB);
+    governor->setUsage(&b, MemoryGovernor::ComponentPacket, 60 * MB);
+    // the same priority, the 20M over is cut in proportion to the bytes over the minimum
+    ASSERT_EQ(50 * MB, governor->getAllowance(&a));
+    ASSERT_EQ(50 * MB, governor->getAllowance(&b));
+    // never under the minimum
+    governor->setUsage(&b, MemoryGovernor::ComponentPacket, 2 * MB);
+    governor->setUsage(&a, MemoryGovernor::ComponentPacket, 200 * MB);
+    ASSERT_EQ(2 * MB, governor->getAllowance(&b));
+    ASSERT_EQ(98 * MB, governor->getAllowance(&a));
+}
+
+TEST_F(memoryGovernor, lowMemory)
+{
+    // polled on the first call, no system info is not low memory
+    bool low = governor->isLowMemory(UINT64_MAX);
+#if TARGET_OS_IPHONE || defined ANDROID
+    ASSERT_TRUE(low);
+#else
+    ASSERT_FALSE(low);
+#endif
+    ASSERT_FALSE(governor->isLowMemory(0));
+}
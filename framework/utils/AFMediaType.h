@@ -400,6 +400,10 @@ enum dec_flag {
     dec_flag_passthrough_info,
     // adjust setting to output frames as soon as possiable.
     dec_flag_output_frame_asap,
+    // key frames only and low resolution is acceptable, for thumbnails.
+    dec_flag_thumbnail,
+    // export the qp of the video frames as side data, for the quality check.
+    dec_flag_export_qp,
 };
 #define DECFLAG_DUMMY  1u << dec_flag_dummy
 #define DECFLAG_HW     (1u << dec_flag_hw)
@@ -409,6 +413,8 @@ enum dec_flag {
 #define DECFLAG_ADAPTIVE (1u << dec_flag_adaptive)
 #define DECFLAG_PASSTHROUGH_INFO (1 << dec_flag_passthrough_info)
 #define DECFLAG_OUTPUT_FRAME_ASAP (1u << dec_flag_output_frame_asap)
+#define DECFLAG_THUMBNAIL (1u << dec_flag_thumbnail)
+#define DECFLAG_EXPORT_QP (1u << dec_flag_export_qp)
 
 typedef struct mediaFrame_t mediaFrame;
 
@@ -0,0 +1,296 @@
+#include "ColorConvert.h"
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLOR_CONVERT_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define COLOR_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+namespace Cicada {
+    namespace {
+        // x 64
+        struct Coefficients {
+            int16_t yOffset;
+            int16_t yScale;
+            // adds a half to yScale
+            int16_t yHalf;
+            int16_t rv;
+            int16_t gu;
+            int16_t gv;
+            int16_t bu;
+        };
+
+        // [matrix][fullRange]
+        const Coefficients sCoefficients[2][2] = {
+                {{16, 74, 1, 102, 25, 52, 129}, {0, 64, 0, 90, 22, 46, 113}},
+                {{16, 74, 1, 115, 14, 34, 135}, {0, 64, 0, 101, 12, 30, 119}},
+        };
+
+        inline int sat16(int value)
+        {
+            return value < INT16_MIN ? INT16_MIN : (value > INT16_MAX ? INT16_MAX : value);
+        }
+
+        inline uint8_t clamp8(int value)
+        {
+            return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+        }
+
+        inline void yuvToRgba(const Coefficients &c, int y, int u, int v, uint8_t *rgba)
+        {
+            y -= c.yOffset;
+            int yy = sat16(y * c.yScale + ((y * c.yHalf) >> 1));
+            u -= 128;
+            v -= 128;
+            rgba[0] = clamp8(sat16(sat16(yy + c.rv * v) + 32) >> 6);
+            rgba[1] = clamp8(sat16(sat16(sat16(yy - c.gu * u) - c.gv * v) + 32) >> 6);
+            rgba[2] = clamp8(sat16(sat16(yy + c.bu * u) + 32) >> 6);
+            rgba[3] = 255;
+        }
+
+#if defined(COLOR_CONVERT_SSE2)
+
+        // 16 pixels, u and v are 8 chroma samples - 128 in 16 bits
+        inline void yuvToRgba16(const Coefficients &c, const uint8_t *y, __m128i u, __m128i v, uint8_t *rgba)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i round = _mm_set1_epi16(32);
+            const __m128i yOffset = _mm_set1_epi16(c.yOffset);
+            const __m128i yScale = _mm_set1_epi16(c.yScale);
+            const __m128i yHalf = _mm_set1_epi16(c.yHalf);
+            const __m128i rv = _mm_set1_epi16(c.rv);
+            const __m128i gu = _mm_set1_epi16(c.gu);
+            const __m128i gv = _mm_set1_epi16(c.gv);
+            const __m128i bu = _mm_set1_epi16(c.bu);
+            __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y));
+            __m128i ys[2] = {_mm_unpacklo_epi8(y8, zero), _mm_unpackhi_epi8(y8, zero)};
+            // a chroma sample for two pixels
+            __m128i us[2] = {_mm_unpacklo_epi16(u, u), _mm_unpackhi_epi16(u, u)};
+            __m128i vs[2] = {_mm_unpacklo_epi16(v, v), _mm_unpackhi_epi16(v, v)};
+            __m128i r[2], g[2], b[2];
+
+            for (int i = 0; i < 2; i++) {
+                __m128i y16 = _mm_sub_epi16(ys[i], yOffset);
+                __m128i yy = _mm_add_epi16(_mm_mullo_epi16(y16, yScale), _mm_srai_epi16(_mm_mullo_epi16(y16, yHalf), 1));
+                r[i] = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(vs[i], rv)), round), 6);
+                g[i] = _mm_subs_epi16(_mm_subs_epi16(yy, _mm_mullo_epi16(us[i], gu)), _mm_mullo_epi16(vs[i], gv));
+                g[i] = _mm_srai_epi16(_mm_adds_epi16(g[i], round), 6);
+                b[i] = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(us[i], bu)), round), 6);
+            }
+
+            __m128i r8 = _mm_packus_epi16(r[0], r[1]);
+            __m128i g8 = _mm_packus_epi16(g[0], g[1]);
+            __m128i b8 = _mm_packus_epi16(b[0], b[1]);
+            __m128i a8 = _mm_set1_epi8(-1);
+            __m128i rgLo = _mm_unpacklo_epi8(r8, g8);
+            __m128i rgHi = _mm_unpackhi_epi8(r8, g8);
+            __m128i baLo = _mm_unpacklo_epi8(b8, a8);
+            __m128i baHi = _mm_unpackhi_epi8(b8, a8);
+            auto *out = reinterpret_cast<__m128i *>(rgba);
+            _mm_storeu_si128(out, _mm_unpacklo_epi16(rgLo, baLo));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rgLo, baLo));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rgHi, baHi));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rgHi, baHi));
+        }
+
+        int i420Line16(const Coefficients &c, const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *rgba, int width)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i bias = _mm_set1_epi16(128);
+            int x = 0;
+
+            for (; x + 16 <= width; x += 16) {
+                __m128i u16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2)), zero), bias);
+                __m128i v16 = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2)), zero), bias);
+                yuvToRgba16(c, y + x, u16, v16, rgba + x * 4);
+            }
+
+            return x;
+        }
+
+        int nv12Line16(const Coefficients &c, const uint8_t *y, const uint8_t *uv, bool swapUV, uint8_t *rgba, int width)
+        {
+            const __m128i mask = _mm_set1_epi16(0xFF);
+            const __m128i bias = _mm_set1_epi16(128);
+            int x = 0;
+
+            for (; x + 16 <= width; x += 16) {
+                __m128i uv8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(uv + x));
+                __m128i first = _mm_sub_epi16(_mm_and_si128(uv8, mask), bias);
+                __m128i second = _mm_sub_epi16(_mm_srli_epi16(uv8, 8), bias);
+                yuvToRgba16(c, y + x, swapUV ? second : first, swapUV ? first : second, rgba + x * 4);
+            }
+
+            return x;
+        }
+
+#elif defined(COLOR_CONVERT_NEON)
+
+        // 16 pixels, u and v are 8 chroma samples - 128 in 16 bits
+        inline void yuvToRgba16(const Coefficients &c, const uint8_t *y, int16x8_t u, int16x8_t v, uint8_t *rgba)
+        {
+            const int16x8_t round = vdupq_n_s16(32);
+            const int16x8_t yOffset = vdupq_n_s16(c.yOffset);
+            const int16x8_t yScale = vdupq_n_s16(c.yScale);
+            const int16x8_t yHalf = vdupq_n_s16(c.yHalf);
+            const int16x8_t rv = vdupq_n_s16(c.rv);
+            const int16x8_t gu = vdupq_n_s16(c.gu);
+            const int16x8_t gv = vdupq_n_s16(c.gv);
+            const int16x8_t bu = vdupq_n_s16(c.bu);
+            uint8x16_t y8 = vld1q_u8(y);
+            int16x8_t ys[2] = {vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y8))), vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(y8)))};
+            // a chroma sample for two pixels
+            int16x8x2_t us = vzipq_s16(u, u);
+            int16x8x2_t vs = vzipq_s16(v, v);
+            uint8x8_t r[2], g[2], b[2];
+
+            for (int i = 0; i < 2; i++) {
+                int16x8_t y16 = vsubq_s16(ys[i], yOffset);
+                int16x8_t yy = vaddq_s16(vmulq_s16(y16, yScale), vshrq_n_s16(vmulq_s16(y16, yHalf), 1));
+                int16x8_t rr = vqaddq_s16(vqaddq_s16(yy, vmulq_s16(vs.val[i], rv)), round);
+                int16x8_t gg = vqsubq_s16(vqsubq_s16(yy, vmulq_s16(us.val[i], gu)), vmulq_s16(vs.val[i], gv));
+                int16x8_t bb = vqaddq_s16(vqaddq_s16(yy, vmulq_s16(us.val[i], bu)), round);
+                r[i] = vqmovun_s16(vshrq_n_s16(rr, 6));
+                g[i] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(gg, round), 6));
+                b[i] = vqmovun_s16(vshrq_n_s16(bb, 6));
+            }
+
+            uint8x16x4_t pixels;
+            pixels.val[0] = vcombine_u8(r[0], r[1]);
+            pixels.val[1] = vcombine_u8(g[0], g[1]);
+            pixels.val[2] = vcombine_u8(b[0], b[1]);
+            pixels.val[3] = vdupq_n_u8(255);
+            vst4q_u8(rgba, pixels);
+        }
+
+        int i420Line16(const Coefficients &c, const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *rgba, int width)
+        {
+            const int16x8_t bias = vdupq_n_s16(128);
+            int x = 0;
+
+            for (; x + 16 <= width; x += 16) {
+                int16x8_t u16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + x / 2))), bias);
+                int16x8_t v16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + x / 2))), bias);
+                yuvToRgba16(c, y + x, u16, v16, rgba + x * 4);
+            }
+
+            return x;
+        }
+
+        int nv12Line16(const Coefficients &c, const uint8_t *y, const uint8_t *uv, bool swapUV, uint8_t *rgba, int width)
+        {
+            const int16x8_t bias = vdupq_n_s16(128);
+            int x = 0;
+
+            for (; x + 16 <= width; x += 16) {
+                uint8x8x2_t uv8 = vld2_u8(uv + x);
+                int16x8_t first = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uv8.val[0])), bias);
+                int16x8_t second = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uv8.val[1])), bias);
+                yuvToRgba16(c, y + x, swapUV ? second : first, swapUV ? first : second, rgba + x * 4);
+            }
+
+            return x;
+        }
+
+#else
+
+        int i420Line16(const Coefficients &c, const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *rgba, int width)
+        {
+            return 0;
+        }
+
+        int nv12Line16(const Coefficients &c, const uint8_t *y, const uint8_t *uv, bool swapUV, uint8_t *rgba, int width)
+        {
+            return 0;
+        }
+
+#endif
+    }// namespace
+
+    void ColorConvert::I420ToRGBA(const uint8_t *y, int yStride, const uint8_t *u, int uStride, const uint8_t *v, int vStride,
+                                  uint8_t *rgba, int rgbaStride, int width, int height, Matrix matrix, bool fullRange)
+    {
+        const Coefficients &c = sCoefficients[matrix == MatrixBT709][fullRange];
+
+        for (int line = 0; line < height; line++) {
+            const uint8_t *yLine = y + line * yStride;
+            const uint8_t *uLine = u + (line / 2) * uStride;
+            const uint8_t *vLine = v + (line / 2) * vStride;
+            uint8_t *out = rgba + line * rgbaStride;
+
+            for (int x = i420Line16(c, yLine, uLine, vLine, out, width); x < width; x++) {
+                yuvToRgba(c, yLine[x], uLine[x / 2], vLine[x / 2], out + x * 4);
+            }
+        }
+    }
+
+    void ColorConvert::NV12ToRGBA(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride, bool swapUV, uint8_t *rgba,
+                                  int rgbaStride, int width, int height, Matrix matrix, bool fullRange)
+    {
+        const Coefficients &c = sCoefficients[matrix == MatrixBT709][fullRange];
+        int uIndex = swapUV ? 1 : 0;
+
+        for (int line = 0; line < height; line++) {
+            const uint8_t *yLine = y + line * yStride;
+            const uint8_t *uvLine = uv + (line / 2) * uvStride;
+            uint8_t *out = rgba + line * rgbaStride;
+
+            for (int x = nv12Line16(c, yLine, uvLine, swapUV, out, width); x < width; x++) {
+                const uint8_t *sample = uvLine + (x / 2) * 2;
+                yuvToRgba(c, yLine[x], sample[uIndex], sample[1 - uIndex], out + x * 4);
+            }
+        }
+    }
+
+    void ColorConvert::Scale(const uint8_t *src, int srcStride, int srcWidth, int srcHeight, uint8_t *dst, int dstStride, int dstWidth,
+                             int dstHeight, int channels)
+    {
+        if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+            return;
+        }
+
+        // the centers of the pixels are aligned, in 16.16 fixed point
+        int64_t xStep = ((int64_t) srcWidth << 16) / dstWidth;
+        int64_t yStep = ((int64_t) srcHeight << 16) / dstHeight;
+        vector<int> x0(dstWidth), x1(dstWidth), xWeight(dstWidth);
+        int64_t fx = xStep / 2 - (1 << 15);
+
+        for (int x = 0; x < dstWidth; x++, fx += xStep) {
+            int64_t position = max(fx, (int64_t) 0);
+            x0[x] = min((int) (position >> 16), srcWidth - 1);
+            x1[x] = min(x0[x] + 1, srcWidth - 1);
+            xWeight[x] = (int) ((position >> 8) & 0xFF);
+        }
+
+        int64_t fy = yStep / 2 - (1 << 15);
+
+        for (int y = 0; y < dstHeight; y++, fy += yStep) {
+            int64_t position = max(fy, (int64_t) 0);
+            int y0 = min((int) (position >> 16), srcHeight - 1);
+            int y1 = min(y0 + 1, srcHeight - 1);
+            int yWeight = (int) ((position >> 8) & 0xFF);
+            const uint8_t *line0 = src + y0 * srcStride;
+            const uint8_t *line1 = src + y1 * srcStride;
+            uint8_t *out = dst + y * dstStride;
+
+            for (int x = 0; x < dstWidth; x++) {
+                const uint8_t *p00 = line0 + x0[x] * channels;
+                const uint8_t *p01 = line0 + x1[x] * channels;
+                const uint8_t *p10 = line1 + x0[x] * channels;
+                const uint8_t *p11 = line1 + x1[x] * channels;
+
+                for (int i = 0; i < channels; i++) {
+                    int top = p00[i] * (256 - xWeight[x]) + p01[i] * xWeight[x];
+                    int bottom = p10[i] * (256 - xWeight[x]) + p11[i] * xWeight[x];
+                    out[x * channels + i] = static_cast<uint8_t>((top * (256 - yWeight) + bottom * yWeight + (1 << 15)) >> 16);
+                }
+            }
+        }
+    }
+}// namespace Cicada
@@ -0,0 +1,31 @@
+#ifndef CICADA_PLAYER_COLORCONVERT_H
+#define CICADA_PLAYER_COLORCONVERT_H
+
+#include <cstdint>
+
+namespace Cicada {
+    /*
+     * yuv 4:2:0 to rgba in 6 bits fixed point, BT.601 or BT.709, limited or full range.
+     *
+     * 16 pixels a time with SSE2 or NEON when the target has them, the rest of a line in C,
+     * the C code does the same saturating steps, so the results are the same on all the targets.
+     */
+    class ColorConvert {
+    public:
+        enum Matrix { MatrixBT601, MatrixBT709 };
+
+        static void I420ToRGBA(const uint8_t *y, int yStride, const uint8_t *u, int uStride, const uint8_t *v, int vStride,
+                               uint8_t *rgba, int rgbaStride, int width, int height, Matrix matrix, bool fullRange);
+
+        // the chroma is interleaved as u,v (NV12), or as v,u (NV21) when swapUV
+        static void NV12ToRGBA(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride, bool swapUV, uint8_t *rgba,
+                               int rgbaStride, int width, int height, Matrix matrix, bool fullRange);
+
+        // bilinear scale of a plane of 1 to 4 bytes per pixel
+        static void Scale(const uint8_t *src, int srcStride, int srcWidth, int srcHeight, uint8_t *dst, int dstStride, int dstWidth,
+                          int dstHeight, int channels);
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_COLORCONVERT_H
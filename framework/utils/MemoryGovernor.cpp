@@ -0,0 +1,232 @@
+#define LOG_TAG "MemoryGovernor"
+
+#include "MemoryGovernor.h"
+#include "CicadaJSON.h"
+#include "frame_work_log.h"
+#include "oscl/oscl_utils.h"
+#include "property.h"
+#include "timer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#define MEM_INFO_INTERVAL_MS 500
+// a player is never cut under it, to keep playing
+#define MIN_ALLOWANCE (4 * 1024 * 1024)
+
+using namespace std;
+
+namespace Cicada {
+    MemoryGovernor MemoryGovernor::sInstance{};
+
+    static const char *componentNames[] = {"packet", "frame", "cache", "network"};
+
+    MemoryGovernor::MemoryGovernor() = default;
+
+    MemoryGovernor *MemoryGovernor::Instance()
+    {
+        return &sInstance;
+    }
+
+    void MemoryGovernor::setBudget(int64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBudget = bytes;
+        mBudgetSet = true;
+    }
+
+    int64_t MemoryGovernor::getBudget()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return getBudgetLocked();
+    }
+
+    int64_t MemoryGovernor::getBudgetLocked()
+    {
+        // the property can be set after the load of the library
+        if (!mBudgetSet) {
+            mBudget = atoll(getProperty("memory.budgetM")) * 1024 * 1024;
+        }
+
+        return mBudget;
+    }
+
+    void MemoryGovernor::addClient(const void *client)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClients[client];
+    }
+
+    void MemoryGovernor::removeClient(const void *client)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClients.erase(client);
+    }
+
+    void MemoryGovernor::setPriority(const void *client, Priority priority)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto item = mClients.find(client);
+
+        if (item != mClients.end()) {
+            item->second.priority = priority;
+        }
+    }
+
+    void MemoryGovernor::setUsage(const void *client, Component component, int64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // the shared components have no addClient
+        auto item = client ? mClients.find(client) : mClients.insert({client, Client()}).first;
+
+        if (item != mClients.end()) {
+            item->second.bytes[component] = bytes;
+        }
+    }
+
+    void MemoryGovernor::addUsage(const void *client, Component component, int64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto item = client ? mClients.find(client) : mClients.insert({client, Client()}).first;
+
+        if (item != mClients.end()) {
+            item->second.bytes[component] += bytes;
+        }
+    }
+
+    int64_t MemoryGovernor::getBytes(const Client &client)
+    {
+        int64_t bytes = 0;
+
+        for (int64_t componentBytes : client.bytes) {
+            bytes += componentBytes;
+        }
+
+        return bytes;
+    }
+
+    int64_t MemoryGovernor::getAllowance(const void *client)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return getAllowanceLocked(client);
+    }
+
+    int64_t MemoryGovernor::getAllowanceLocked(const void *client)
+    {
+        auto self = mClients.find(client);
+
+        if (getBudgetLocked() <= 0 || client == nullptr || self == mClients.end()) {
+            return INT64_MAX;
+        }
+
+        int64_t total = 0;
+
+        for (auto &item : mClients) {
+            total += getBytes(item.second);
+        }
+
+        int64_t used = getBytes(self->second);
+        int64_t over = total - getBudgetLocked();
+
+        if (over <= 0) {
+            return used - over;
+        }
+
+        // cut the players of the lowest priority first, in proportion to what they hold
+        for (int priority = PriorityBackground; priority >= PriorityForeground && over > 0; priority--) {
+            int64_t trimmable = 0;
+
+            for (auto &item : mClients) {
+                if (item.first != nullptr && item.second.priority == priority) {
+                    trimmable += std::max((int64_t) 0, getBytes(item.second) - MIN_ALLOWANCE);
+                }
+            }
+
+            if (trimmable <= 0) {
+                continue;
+            }
+
+            int64_t cut = std::min(over, trimmable);
+
+            if (self->second.priority == priority) {
+                int64_t mine = std::max((int64_t) 0, used - MIN_ALLOWANCE);
+                return used - (int64_t) ((double) cut * mine / trimmable);
+            }
+
+            over -= cut;
+        }
+
+        return used;
+    }
+
+    int64_t MemoryGovernor::getUsage(const void *client)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto item = mClients.find(client);
+        return item != mClients.end() ? getBytes(item->second) : 0;
+    }
+
+    int64_t MemoryGovernor::getTotalUsage()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        int64_t total = 0;
+
+        for (auto &item : mClients) {
+            total += getBytes(item.second);
+        }
+
+        return total;
+    }
+
+    bool MemoryGovernor::isLowMemory(uint64_t lowMemSize)
+    {
+        int64_t now = af_getsteady_ms();
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // never polled yet, now - INT64_MIN overflows
+        if (mMemInfoTime == INT64_MIN || now - mMemInfoTime >= MEM_INFO_INTERVAL_MS) {
+            mem_info info{};
+
+            if (AFGetSystemMemInfo(&info) >= 0) {
+                mAvailableRam = info.system_availableram;
+            }
+
+            mMemInfoTime = now;
+        }
+
+        return mAvailableRam > 0 && mAvailableRam < lowMemSize;
+    }
+
+    string MemoryGovernor::dumpUsage()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        CicadaJSONItem json;
+        CicadaJSONArray clients;
+        int64_t total = 0;
+
+        for (auto &item : mClients) {
+            CicadaJSONItem client;
+            char id[32];
+            snprintf(id, sizeof(id), "%p", item.first);
+            client.addValue("client", item.first ? id : "shared");
+            client.addValue("priority", (int) item.second.priority);
+
+            for (int i = 0; i < ComponentNum; i++) {
+                client.addValue(componentNames[i], (double) item.second.bytes[i]);
+            }
+
+            if (item.first) {
+                int64_t allowance = getAllowanceLocked(item.first);
+                client.addValue("allowance", allowance == INT64_MAX ? -1.0 : (double) allowance);
+            }
+
+            clients.addJSON(client);
+            total += getBytes(item.second);
+        }
+
+        json.addValue("budget", (double) getBudgetLocked());
+        json.addValue("total", (double) total);
+        json.addArray("clients", clients);
+        return json.printJSON();
+    }
+}// namespace Cicada
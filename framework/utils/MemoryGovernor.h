@@ -0,0 +1,86 @@
+#ifndef CICADA_PLAYER_MEMORYGOVERNOR_H
+#define CICADA_PLAYER_MEMORYGOVERNOR_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace Cicada {
+    /*
+     * Process wide memory accounting and budget of the players.
+     *
+     * A player reports the bytes it holds per component, the shared components (slice cache, network
+     * buffers) report as the client nullptr. When the total is over the budget, the allowance of the
+     * players is cut down from the background players, then the paused ones, then the playing ones,
+     * a player over its allowance stops buffering until it is under it again.
+     *
+     * The system memory is polled here for all the players, at most once per MEM_INFO_INTERVAL_MS.
+     */
+    class MemoryGovernor {
+    public:
+        enum Component { ComponentPacket, ComponentFrame, ComponentCache, ComponentNetwork, ComponentNum };
+
+        // the order of trimming is from the last one
+        enum Priority { PriorityForeground, PriorityPaused, PriorityBackground };
+
+        static MemoryGovernor *Instance();
+
+        // the budget of all the clients, <= 0 for no budget, the property "memory.budgetM" by default
+        void setBudget(int64_t bytes);
+
+        int64_t getBudget();
+
+        void addClient(const void *client);
+
+        void removeClient(const void *client);
+
+        void setPriority(const void *client, Priority priority);
+
+        void setUsage(const void *client, Component component, int64_t bytes);
+
+        void addUsage(const void *client, Component component, int64_t bytes);
+
+        // the bytes the client can hold, INT64_MAX if no limit
+        int64_t getAllowance(const void *client);
+
+        int64_t getUsage(const void *client);
+
+        int64_t getTotalUsage();
+
+        // available system memory < lowMemSize
+        bool isLowMemory(uint64_t lowMemSize);
+
+        // the usage of all the clients in json
+        std::string dumpUsage();
+
+    private:
+        struct Client {
+            int64_t bytes[ComponentNum]{};
+            Priority priority{PriorityForeground};
+        };
+
+    private:
+        MemoryGovernor();
+
+        ~MemoryGovernor() = default;
+
+        static int64_t getBytes(const Client &client);
+
+        int64_t getBudgetLocked();
+
+        int64_t getAllowanceLocked(const void *client);
+
+    private:
+        static MemoryGovernor sInstance;
+        std::mutex mMutex;
+        std::map<const void *, Client> mClients;
+        int64_t mBudget{0};
+        bool mBudgetSet{false};
+        uint64_t mAvailableRam{0};
+        int64_t mMemInfoTime{INT64_MIN};
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_MEMORYGOVERNOR_H
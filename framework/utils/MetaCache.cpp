@@ -0,0 +1,472 @@
+#define LOG_TAG "MetaCache"
+
+#include "MetaCache.h"
+#include "AsyncJob.h"
+#include "CicadaJSON.h"
+#include "frame_work_log.h"
+#include "property.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <vector>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// "CMC1"
+#define META_CACHE_MAGIC 0x31434d43
+#define META_CACHE_VERSION 1
+#define META_CACHE_HEADER_SIZE 32
+#define META_CACHE_ENTRY_HEADER_SIZE 24
+#define MAX_CACHE_BYTES (4 * 1024 * 1024)
+#define MAX_ENTRY_BYTES (1024 * 1024)
+
+using namespace std;
+
+namespace Cicada {
+    MetaCache MetaCache::sInstance{};
+
+    // fnv-1a, to detect a file corrupted, not for the security
+    static uint64_t checksum(const uint8_t *data, size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+
+        for (size_t i = 0; i < size; i++) {
+            hash ^= data[i];
+            hash *= 0x100000001b3ULL;
+        }
+
+        return hash;
+    }
+
+    template<typename T>
+    static void appendValue(string &out, T value)
+    {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    static T readValue(const uint8_t *data)
+    {
+        T value;
+        memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    MetaCache *MetaCache::Instance()
+    {
+        return &sInstance;
+    }
+
+    string MetaCache::genKey(const string &type, const string &key)
+    {
+        return type + '\n' + key;
+    }
+
+    void MetaCache::setPath(const string &path)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (mPathSet && path == mPath) {
+            return;
+        }
+
+        mPath = path;
+        mPathSet = true;
+        mLoaded = false;
+        mEntries.clear();
+        mBytes = 0;
+    }
+
+    bool MetaCache::isEnabledLocked()
+    {
+        // the property can be set after the load of the library
+        if (!mPathSet) {
+            mPath = getProperty("metaCache.path");
+        }
+
+        if (mPath.empty()) {
+            return false;
+        }
+
+        if (!mLoaded) {
+            mLoaded = true;
+            load();
+        }
+
+        return true;
+    }
+
+    void MetaCache::load()
+    {
+#ifdef _WIN32
+        // no mmap, the file is small
+        FILE *file = fopen(mPath.c_str(), "rb");
+
+        if (file == nullptr) {
+            return;
+        }
+
+        vector<uint8_t> data;
+        uint8_t buffer[64 * 1024];
+        size_t size;
+
+        while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.insert(data.end(), buffer, buffer + size);
+        }
+
+        fclose(file);
+
+        if (data.size() < META_CACHE_HEADER_SIZE) {
+            return;
+        }
+
+        if (!parse(data.data(), data.size())) {
+            AF_LOGW("drop the cache file %s\n", mPath.c_str());
+            mEntries.clear();
+            mBytes = 0;
+        }
+#else
+        int fd = open(mPath.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat st {};
+
+        if (fstat(fd, &st) < 0 || st.st_size < META_CACHE_HEADER_SIZE) {
+            close(fd);
+            return;
+        }
+
+        auto size = static_cast<size_t>(st.st_size);
+        void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (addr == MAP_FAILED) {
+            AF_LOGW("mmap %s error %d\n", mPath.c_str(), errno);
+            return;
+        }
+
+        if (!parse(static_cast<const uint8_t *>(addr), size)) {
+            AF_LOGW("drop the cache file %s\n", mPath.c_str());
+            mEntries.clear();
+            mBytes = 0;
+        }
+
+        munmap(addr, size);
+#endif
+        AF_LOGI("loaded %d entries\n", (int) mEntries.size());
+    }
+
+    bool MetaCache::parse(const uint8_t *data, size_t size)
+    {
+        if (readValue<uint32_t>(data) != META_CACHE_MAGIC || readValue<uint32_t>(data + 4) != META_CACHE_VERSION) {
+            return false;
+        }
+
+        uint32_t count = readValue<uint32_t>(data + 8);
+        uint64_t payloadSize = readValue<uint64_t>(data + 16);
+
+        if (payloadSize != size - META_CACHE_HEADER_SIZE ||
+            readValue<uint64_t>(data + 24) != checksum(data + META_CACHE_HEADER_SIZE, payloadSize)) {
+            return false;
+        }
+
+        const uint8_t *p = data + META_CACHE_HEADER_SIZE;
+        const uint8_t *end = data + size;
+        auto now = static_cast<int64_t>(time(nullptr));
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (end - p < META_CACHE_ENTRY_HEADER_SIZE) {
+                return false;
+            }
+
+            uint32_t typeSize = readValue<uint32_t>(p);
+            uint32_t keySize = readValue<uint32_t>(p + 4);
+            uint32_t valueSize = readValue<uint32_t>(p + 8);
+            int64_t expireTime = readValue<int64_t>(p + 16);
+            p += META_CACHE_ENTRY_HEADER_SIZE;
+
+            if ((uint64_t) (end - p) < (uint64_t) typeSize + keySize + valueSize) {
+                return false;
+            }
+
+            Entry entry;
+            entry.type.assign(reinterpret_cast<const char *>(p), typeSize);
+            p += typeSize;
+            entry.key.assign(reinterpret_cast<const char *>(p), keySize);
+            p += keySize;
+            entry.value.assign(reinterpret_cast<const char *>(p), valueSize);
+            p += valueSize;
+            entry.expireTime = expireTime;
+
+            if (expireTime > now) {
+                mBytes += entry.value.size();
+                mEntries[genKey(entry.type, entry.key)] = std::move(entry);
+            }
+        }
+
+        return true;
+    }
+
+    bool MetaCache::get(const string &type, const string &key, string &value)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (!isEnabledLocked()) {
+            return false;
+        }
+
+        Stats &stats = mStats[type];
+        auto item = mEntries.find(genKey(type, key));
+
+        if (item == mEntries.end()) {
+            stats.miss++;
+            return false;
+        }
+
+        if (item->second.expireTime <= static_cast<int64_t>(time(nullptr))) {
+            mBytes -= item->second.value.size();
+            mEntries.erase(item);
+            stats.miss++;
+            return false;
+        }
+
+        item->second.lastUse = ++mUseCount;
+        value = item->second.value;
+        stats.hit++;
+        return true;
+    }
+
+    void MetaCache::put(const string &type, const string &key, const string &value, int64_t ttl)
+    {
+        if (ttl <= 0 || value.size() > MAX_ENTRY_BYTES) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (!isEnabledLocked()) {
+            return;
+        }
+
+        Entry &entry = mEntries[genKey(type, key)];
+        auto now = static_cast<int64_t>(time(nullptr));
+        entry.lastUse = ++mUseCount;
+
+        // put again on every connect, the file is written only if the value changed or is close to expire
+        if (entry.value == value && !entry.type.empty() && entry.expireTime - now > ttl / 2) {
+            return;
+        }
+
+        mBytes += (int64_t) value.size() - (int64_t) entry.value.size();
+        entry.type = type;
+        entry.key = key;
+        entry.value = value;
+        entry.expireTime = now + ttl;
+        evictLocked();
+        scheduleFlushLocked();
+    }
+
+    void MetaCache::remove(const string &type, const string &key)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (!isEnabledLocked()) {
+            return;
+        }
+
+        auto item = mEntries.find(genKey(type, key));
+
+        if (item != mEntries.end()) {
+            mBytes -= item->second.value.size();
+            mEntries.erase(item);
+            scheduleFlushLocked();
+        }
+    }
+
+    void MetaCache::evictLocked()
+    {
+        auto now = static_cast<int64_t>(time(nullptr));
+
+        // the expired ones, and then the least recently used ones
+        for (auto item = mEntries.begin(); item != mEntries.end();) {
+            if (item->second.expireTime <= now) {
+                mBytes -= item->second.value.size();
+                item = mEntries.erase(item);
+            } else {
+                ++item;
+            }
+        }
+
+        while (mBytes > MAX_CACHE_BYTES && !mEntries.empty()) {
+            auto oldest = mEntries.begin();
+
+            for (auto item = mEntries.begin(); item != mEntries.end(); ++item) {
+                if (item->second.lastUse < oldest->second.lastUse) {
+                    oldest = item;
+                }
+            }
+
+            mBytes -= oldest->second.value.size();
+            mEntries.erase(oldest);
+        }
+    }
+
+    void MetaCache::scheduleFlushLocked()
+    {
+        if (mFlushPending) {
+            return;
+        }
+
+        AsyncJob *job = AsyncJob::Instance();
+
+        // exiting
+        if (job == nullptr) {
+            return;
+        }
+
+        mFlushPending = true;
+        job->addJob([this]() {
+            // not flushed by the user already
+            if (mFlushPending) {
+                flush();
+            }
+        });
+    }
+
+    string MetaCache::serializeLocked()
+    {
+        string payload;
+
+        for (auto &item : mEntries) {
+            const Entry &entry = item.second;
+            appendValue<uint32_t>(payload, (uint32_t) entry.type.size());
+            appendValue<uint32_t>(payload, (uint32_t) entry.key.size());
+            appendValue<uint32_t>(payload, (uint32_t) entry.value.size());
+            appendValue<uint32_t>(payload, 0);
+            appendValue<int64_t>(payload, entry.expireTime);
+            payload.append(entry.type).append(entry.key).append(entry.value);
+        }
+
+        string out;
+        out.reserve(META_CACHE_HEADER_SIZE + payload.size());
+        appendValue<uint32_t>(out, META_CACHE_MAGIC);
+        appendValue<uint32_t>(out, META_CACHE_VERSION);
+        appendValue<uint32_t>(out, (uint32_t) mEntries.size());
+        appendValue<uint32_t>(out, 0);
+        appendValue<uint64_t>(out, payload.size());
+        appendValue<uint64_t>(out, checksum(reinterpret_cast<const uint8_t *>(payload.data()), payload.size()));
+        out.append(payload);
+        return out;
+    }
+
+    void MetaCache::flush()
+    {
+        string data;
+        string path;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFlushPending = false;
+
+            if (!isEnabledLocked()) {
+                return;
+            }
+
+            data = serializeLocked();
+            path = mPath;
+        }
+        // the file is replaced at once by rename, the readers never see a partial file
+        std::lock_guard<std::mutex> lock(mFileMutex);
+        string tmpPath = path + ".tmp";
+
+        if (!writeFile(tmpPath, data) || !replaceFile(tmpPath, path)) {
+            AF_LOGW("write %s error %d\n", path.c_str(), errno);
+            ::remove(tmpPath.c_str());
+        }
+    }
+
+    bool MetaCache::writeFile(const string &path, const string &data)
+    {
+#ifdef _WIN32
+        FILE *file = fopen(path.c_str(), "wb");
+
+        if (file == nullptr) {
+            return false;
+        }
+
+        bool ok = fwrite(data.data(), 1, data.size(), file) == data.size() && fflush(file) == 0 && _commit(_fileno(file)) == 0;
+        fclose(file);
+        return ok;
+#else
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if (fd < 0) {
+            return false;
+        }
+
+        size_t written = 0;
+
+        while (written < data.size()) {
+            ssize_t ret = write(fd, data.data() + written, data.size() - written);
+
+            if (ret < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (ret <= 0) {
+                break;
+            }
+
+            written += ret;
+        }
+
+        bool ok = written == data.size() && fsync(fd) == 0;
+        close(fd);
+        return ok;
+#endif
+    }
+
+    bool MetaCache::replaceFile(const string &from, const string &to)
+    {
+#ifdef _WIN32
+        // rename doesn't replace an existing file on windows
+        return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        return rename(from.c_str(), to.c_str()) == 0;
+#endif
+    }
+
+    string MetaCache::dumpStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        CicadaJSONItem json;
+        CicadaJSONArray types;
+
+        for (auto &item : mStats) {
+            CicadaJSONItem type;
+            uint64_t total = item.second.hit + item.second.miss;
+            type.addValue("type", item.first);
+            type.addValue("hit", (double) item.second.hit);
+            type.addValue("miss", (double) item.second.miss);
+            type.addValue("hitRate", total > 0 ? (double) item.second.hit / total : 0.0);
+            types.addJSON(type);
+        }
+
+        json.addValue("enabled", !mPath.empty());
+        json.addValue("entries", (int) mEntries.size());
+        json.addValue("bytes", (double) mBytes);
+        json.addArray("types", types);
+        return json.printJSON();
+    }
+}// namespace Cicada
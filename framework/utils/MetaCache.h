@@ -0,0 +1,94 @@
+#ifndef CICADA_PLAYER_METACACHE_H
+#define CICADA_PLAYER_METACACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace Cicada {
+    /*
+     * A small process wide cache of the metadata fetched at the start of a playback (the vod playlists,
+     * the init sections, the last ip connected of the hosts), kept in a file across the restarts of the
+     * app, to start the first playback with fewer round trips.
+     *
+     * The file is loaded once, by mmap where there is one, and written to a temp file then renamed over
+     * it, a crash while writing leaves the old file. A file of another version or not matching its checksum is dropped.
+     * The entries are grouped by a type, the hits and misses of the types are counted.
+     */
+    class MetaCache {
+    public:
+        static MetaCache *Instance();
+
+        // the file of the cache, the property "metaCache.path" by default, empty to disable the cache
+        void setPath(const std::string &path);
+
+        bool get(const std::string &type, const std::string &key, std::string &value);
+
+        // ttl in seconds, the same value put again is not written before half of its ttl has passed
+        void put(const std::string &type, const std::string &key, const std::string &value, int64_t ttl);
+
+        void remove(const std::string &type, const std::string &key);
+
+        // write the file now, it's written async after the changes by default
+        void flush();
+
+        // the hits and misses of the types in json
+        std::string dumpStats();
+
+    private:
+        struct Entry {
+            std::string type;
+            std::string key;
+            std::string value;
+            // seconds since epoch
+            int64_t expireTime{0};
+            uint64_t lastUse{0};
+        };
+
+        struct Stats {
+            uint64_t hit{0};
+            uint64_t miss{0};
+        };
+
+    private:
+        MetaCache() = default;
+
+        ~MetaCache() = default;
+
+        bool isEnabledLocked();
+
+        void load();
+
+        void scheduleFlushLocked();
+
+        void evictLocked();
+
+        std::string serializeLocked();
+
+        bool parse(const uint8_t *data, size_t size);
+
+        static bool writeFile(const std::string &path, const std::string &data);
+
+        // replace the file at once, the readers never see a partial file
+        static bool replaceFile(const std::string &from, const std::string &to);
+
+        static std::string genKey(const std::string &type, const std::string &key);
+
+    private:
+        static MetaCache sInstance;
+        std::mutex mMutex;
+        std::mutex mFileMutex;
+        std::string mPath{};
+        bool mPathSet{false};
+        bool mLoaded{false};
+        std::map<std::string, Entry> mEntries{};
+        std::map<std::string, Stats> mStats{};
+        int64_t mBytes{0};
+        uint64_t mUseCount{0};
+        std::atomic_bool mFlushPending{false};
+    };
+}// namespace Cicada
+
+#endif//CICADA_PLAYER_METACACHE_H
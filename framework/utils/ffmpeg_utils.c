@@ -22,6 +22,7 @@
 #include <libavutil/timestamp.h>
 #include <pthread.h>
 #include <utils/frame_work_log.h>
+#include <utils/pcm_utils.h>
 
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -680,16 +681,10 @@ bool isAudioPlanar(const AVFrame *frame)
 
 void copyPCMData(const AVFrame *frame, uint8_t *buffer)
 {
-    int offset = 0;
     int sampleSize = av_get_bytes_per_sample((enum AVSampleFormat) (frame->format));
 
     if (av_sample_fmt_is_planar((enum AVSampleFormat) frame->format)) {
-        for (int i = 0; i < frame->nb_samples; i++) {
-            for (int ch = 0; ch < frame->channels; ch++) {
-                memcpy(buffer + offset, frame->data[ch] + sampleSize * i, sampleSize);
-                offset += sampleSize;
-            }
-        }
+        interleavePCM(buffer, (const uint8_t *const *) frame->extended_data, frame->channels, frame->nb_samples, sampleSize);
     } else {
         memcpy(buffer, frame->extended_data[0], ((size_t) sampleSize * frame->nb_samples * frame->channels));
     }
@@ -704,6 +699,25 @@ size_t copyPCMDataWithOffset(const AVFrame *frame, int frameOffset, uint8_t *out
         int samplesOffset = frameOffset / (frame->channels * sampleSize);
         int channelsOffset = (frameOffset % (frame->channels * sampleSize)) / frame->channels;
         int writeOffset = (frameOffset % sampleSize);
+        int frameSize = frame->channels * sampleSize;
+
+        // the whole sample frames at once, the rest sample by sample
+        if (frameOffset % frameSize == 0 && frame->channels <= AV_NUM_DATA_POINTERS) {
+            const uint8_t *planes[AV_NUM_DATA_POINTERS];
+            int count = frame->nb_samples - samplesOffset;
+
+            if ((size_t) count * frameSize > outSize) {
+                count = (int) (outSize / frameSize);
+            }
+
+            for (int ch = 0; ch < frame->channels; ch++) {
+                planes[ch] = frame->extended_data[ch] + (size_t) samplesOffset * sampleSize;
+            }
+
+            interleavePCM(outBuffer, planes, frame->channels, count, sampleSize);
+            totalWriteSize = count * frameSize;
+            samplesOffset += count;
+        }
 
         for (int i = samplesOffset; i < frame->nb_samples; i++) {
             for (; channelsOffset < frame->channels; channelsOffset++) {
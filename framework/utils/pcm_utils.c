@@ -0,0 +1,704 @@
+#include "pcm_utils.h"
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PCM_UTILS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCM_UTILS_NEON
+#include <arm_neon.h>
+#endif
+
+static enum AFSampleFormat packedFormat(enum AFSampleFormat format)
+{
+    if (format >= AF_SAMPLE_FMT_U8P && format <= AF_SAMPLE_FMT_DBLP) {
+        return (enum AFSampleFormat) (format - AF_SAMPLE_FMT_U8P);
+    }
+
+    return format;
+}
+
+// the samples are copied by memcpy of a constant size, the buffers of the renders may be not aligned
+static inline void interleaveC(uint8_t *dst, const uint8_t *const *src, int channels, int start, int nb_samples, size_t size)
+{
+    for (int n = start; n < nb_samples; n++) {
+        for (int ch = 0; ch < channels; ch++) {
+            memcpy(dst + ((size_t) n * channels + ch) * size, src[ch] + (size_t) n * size, size);
+        }
+    }
+}
+
+static inline void deinterleaveC(uint8_t *const *dst, const uint8_t *src, int channels, int start, int nb_samples, size_t size)
+{
+    for (int n = start; n < nb_samples; n++) {
+        for (int ch = 0; ch < channels; ch++) {
+            memcpy(dst[ch] + (size_t) n * size, src + ((size_t) n * channels + ch) * size, size);
+        }
+    }
+}
+
+static inline int16_t gainS16(int16_t sample, float gain)
+{
+    float value = sample * gain;
+    value = value < -32768.0f ? -32768.0f : (value > 32767.0f ? 32767.0f : value);
+    // half away from zero, as the simd code
+    return (int16_t) (value < 0 ? value - 0.5f : value + 0.5f);
+}
+
+static inline int32_t gainS32(int32_t sample, float gain)
+{
+    double value = (double) sample * gain;
+    value = value < INT32_MIN ? INT32_MIN : (value > INT32_MAX ? INT32_MAX : value);
+    return (int32_t) (value < 0 ? value - 0.5 : value + 0.5);
+}
+
+static inline float gainFlt(float sample, float gain)
+{
+    float value = sample * gain;
+    return value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+}
+
+#if defined(PCM_UTILS_SSE2)
+
+static int interleaveStereo(uint8_t *dst, const uint8_t *left, const uint8_t *right, int nb_samples, int sampleSize)
+{
+    // 16 bytes of a channel a time
+    int step = 16 / sampleSize;
+    int n = 0;
+
+    for (; n + step <= nb_samples; n += step) {
+        __m128i l = _mm_loadu_si128((const __m128i *) (left + n * sampleSize));
+        __m128i r = _mm_loadu_si128((const __m128i *) (right + n * sampleSize));
+        __m128i *out = (__m128i *) (dst + n * 2 * sampleSize);
+
+        switch (sampleSize) {
+            case 1:
+                _mm_storeu_si128(out, _mm_unpacklo_epi8(l, r));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(l, r));
+                break;
+
+            case 2:
+                _mm_storeu_si128(out, _mm_unpacklo_epi16(l, r));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(l, r));
+                break;
+
+            case 4:
+                _mm_storeu_si128(out, _mm_unpacklo_epi32(l, r));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(l, r));
+                break;
+
+            default:
+                _mm_storeu_si128(out, _mm_unpacklo_epi64(l, r));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi64(l, r));
+                break;
+        }
+    }
+
+    return n;
+}
+
+static int deinterleaveStereo(uint8_t *left, uint8_t *right, const uint8_t *src, int nb_samples, int sampleSize)
+{
+    int n = 0;
+
+    if (sampleSize == 2) {
+        for (; n + 8 <= nb_samples; n += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i *) (src + n * 4));
+            __m128i b = _mm_loadu_si128((const __m128i *) (src + n * 4 + 16));
+            // sign extended, the saturating pack keeps the values
+            __m128i l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+            __m128i r = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+            _mm_storeu_si128((__m128i *) (left + n * 2), l);
+            _mm_storeu_si128((__m128i *) (right + n * 2), r);
+        }
+    } else if (sampleSize == 4) {
+        for (; n + 4 <= nb_samples; n += 4) {
+            __m128 a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) (src + n * 8)));
+            __m128 b = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) (src + n * 8 + 16)));
+            _mm_storeu_si128((__m128i *) (left + n * 4), _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))));
+            _mm_storeu_si128((__m128i *) (right + n * 4), _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+        }
+    }
+
+    return n;
+}
+
+static int gainS16Simd(int16_t *data, int count, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (data + i));
+        __m128i xs[2] = {_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16), _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)};
+
+        for (int j = 0; j < 2; j++) {
+            __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(xs[j]), g);
+            v = _mm_max_ps(_mm_min_ps(v, high), low);
+            v = _mm_add_ps(v, _mm_or_ps(_mm_and_ps(v, sign), half));
+            xs[j] = _mm_cvttps_epi32(v);
+        }
+
+        _mm_storeu_si128((__m128i *) (data + i), _mm_packs_epi32(xs[0], xs[1]));
+    }
+
+    return i;
+}
+
+static int gainFltSimd(float *data, int count, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 low = _mm_set1_ps(-1.0f);
+    const __m128 high = _mm_set1_ps(1.0f);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(data + i), g);
+        _mm_storeu_ps(data + i, _mm_max_ps(_mm_min_ps(v, high), low));
+    }
+
+    return i;
+}
+
+static int downmixStereoS16(int16_t *dst, const int16_t *src, int nb_samples)
+{
+    int n = 0;
+
+    for (; n + 8 <= nb_samples; n += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *) (src + n * 2));
+        __m128i b = _mm_loadu_si128((const __m128i *) (src + n * 2 + 8));
+        __m128i sa = _mm_add_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(a, 16));
+        __m128i sb = _mm_add_epi32(_mm_srai_epi32(_mm_slli_epi32(b, 16), 16), _mm_srai_epi32(b, 16));
+        // divided toward zero, as in C
+        sa = _mm_srai_epi32(_mm_add_epi32(sa, _mm_srli_epi32(sa, 31)), 1);
+        sb = _mm_srai_epi32(_mm_add_epi32(sb, _mm_srli_epi32(sb, 31)), 1);
+        _mm_storeu_si128((__m128i *) (dst + n), _mm_packs_epi32(sa, sb));
+    }
+
+    return n;
+}
+
+static int downmixStereoFlt(float *dst, const float *src, int nb_samples)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    int n = 0;
+
+    for (; n + 4 <= nb_samples; n += 4) {
+        __m128 a = _mm_loadu_ps(src + n * 2);
+        __m128 b = _mm_loadu_ps(src + n * 2 + 4);
+        __m128 sum = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_ps(dst + n, _mm_mul_ps(sum, half));
+    }
+
+    return n;
+}
+
+static int meterS16Simd(const int16_t *data, int count, int *peak, int64_t *sum)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i max = zero;
+    __m128i acc = zero;
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (data + i));
+        // -32768 is taken as 32767, the squares of a pair fit in 32 bits
+        __m128i a = _mm_max_epi16(x, _mm_subs_epi16(zero, x));
+        __m128i sq = _mm_madd_epi16(a, a);
+        max = _mm_max_epi16(max, a);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+    }
+
+    int16_t maxs[8];
+    int64_t accs[2];
+    _mm_storeu_si128((__m128i *) maxs, max);
+    _mm_storeu_si128((__m128i *) accs, acc);
+
+    for (int j = 0; j < 8; j++) {
+        *peak = maxs[j] > *peak ? maxs[j] : *peak;
+    }
+
+    *sum += accs[0] + accs[1];
+    return i;
+}
+
+static int meterFltSimd(const float *data, int count, float *peak, double *sum)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 max = _mm_setzero_ps();
+    __m128d acc = _mm_setzero_pd();
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(data + i);
+        __m128d lo = _mm_cvtps_pd(x);
+        __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+        max = _mm_max_ps(max, _mm_andnot_ps(sign, x));
+        acc = _mm_add_pd(acc, _mm_add_pd(_mm_mul_pd(lo, lo), _mm_mul_pd(hi, hi)));
+    }
+
+    float maxs[4];
+    double accs[2];
+    _mm_storeu_ps(maxs, max);
+    _mm_storeu_pd(accs, acc);
+
+    for (int j = 0; j < 4; j++) {
+        *peak = maxs[j] > *peak ? maxs[j] : *peak;
+    }
+
+    *sum += accs[0] + accs[1];
+    return i;
+}
+
+#elif defined(PCM_UTILS_NEON)
+
+static int interleaveStereo(uint8_t *dst, const uint8_t *left, const uint8_t *right, int nb_samples, int sampleSize)
+{
+    int n = 0;
+
+    if (sampleSize == 2) {
+        for (; n + 8 <= nb_samples; n += 8) {
+            int16x8x2_t v = {{vld1q_s16((const int16_t *) (left + n * 2)), vld1q_s16((const int16_t *) (right + n * 2))}};
+            vst2q_s16((int16_t *) (dst + n * 4), v);
+        }
+    } else if (sampleSize == 4) {
+        for (; n + 4 <= nb_samples; n += 4) {
+            int32x4x2_t v = {{vld1q_s32((const int32_t *) (left + n * 4)), vld1q_s32((const int32_t *) (right + n * 4))}};
+            vst2q_s32((int32_t *) (dst + n * 8), v);
+        }
+    }
+
+    return n;
+}
+
+static int deinterleaveStereo(uint8_t *left, uint8_t *right, const uint8_t *src, int nb_samples, int sampleSize)
+{
+    int n = 0;
+
+    if (sampleSize == 2) {
+        for (; n + 8 <= nb_samples; n += 8) {
+            int16x8x2_t v = vld2q_s16((const int16_t *) (src + n * 4));
+            vst1q_s16((int16_t *) (left + n * 2), v.val[0]);
+            vst1q_s16((int16_t *) (right + n * 2), v.val[1]);
+        }
+    } else if (sampleSize == 4) {
+        for (; n + 4 <= nb_samples; n += 4) {
+            int32x4x2_t v = vld2q_s32((const int32_t *) (src + n * 8));
+            vst1q_s32((int32_t *) (left + n * 4), v.val[0]);
+            vst1q_s32((int32_t *) (right + n * 4), v.val[1]);
+        }
+    }
+
+    return n;
+}
+
+static inline float32x4_t roundAway(float32x4_t v)
+{
+    const uint32x4_t sign = vdupq_n_u32(0x80000000);
+    uint32x4_t half = vorrq_u32(vandq_u32(vreinterpretq_u32_f32(v), sign), vreinterpretq_u32_f32(vdupq_n_f32(0.5f)));
+    return vaddq_f32(v, vreinterpretq_f32_u32(half));
+}
+
+static int gainS16Simd(int16_t *data, int count, float gain)
+{
+    const float32x4_t low = vdupq_n_f32(-32768.0f);
+    const float32x4_t high = vdupq_n_f32(32767.0f);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(data + i);
+        float32x4_t lo = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), gain);
+        float32x4_t hi = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), gain);
+        lo = roundAway(vmaxq_f32(vminq_f32(lo, high), low));
+        hi = roundAway(vmaxq_f32(vminq_f32(hi, high), low));
+        vst1q_s16(data + i, vcombine_s16(vqmovn_s32(vcvtq_s32_f32(lo)), vqmovn_s32(vcvtq_s32_f32(hi))));
+    }
+
+    return i;
+}
+
+static int gainFltSimd(float *data, int count, float gain)
+{
+    const float32x4_t low = vdupq_n_f32(-1.0f);
+    const float32x4_t high = vdupq_n_f32(1.0f);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t v = vmulq_n_f32(vld1q_f32(data + i), gain);
+        vst1q_f32(data + i, vmaxq_f32(vminq_f32(v, high), low));
+    }
+
+    return i;
+}
+
+static int downmixStereoS16(int16_t *dst, const int16_t *src, int nb_samples)
+{
+    int n = 0;
+
+    for (; n + 8 <= nb_samples; n += 8) {
+        int16x8x2_t v = vld2q_s16(src + n * 2);
+        int32x4_t lo = vaddl_s16(vget_low_s16(v.val[0]), vget_low_s16(v.val[1]));
+        int32x4_t hi = vaddl_s16(vget_high_s16(v.val[0]), vget_high_s16(v.val[1]));
+        // divided toward zero, as in C
+        lo = vshrq_n_s32(vaddq_s32(lo, vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(lo), 31))), 1);
+        hi = vshrq_n_s32(vaddq_s32(hi, vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(hi), 31))), 1);
+        vst1q_s16(dst + n, vcombine_s16(vmovn_s32(lo), vmovn_s32(hi)));
+    }
+
+    return n;
+}
+
+static int downmixStereoFlt(float *dst, const float *src, int nb_samples)
+{
+    int n = 0;
+
+    for (; n + 4 <= nb_samples; n += 4) {
+        float32x4x2_t v = vld2q_f32(src + n * 2);
+        vst1q_f32(dst + n, vmulq_n_f32(vaddq_f32(v.val[0], v.val[1]), 0.5f));
+    }
+
+    return n;
+}
+
+static int meterS16Simd(const int16_t *data, int count, int *peak, int64_t *sum)
+{
+    int16x8_t max = vdupq_n_s16(0);
+    int64x2_t acc = vdupq_n_s64(0);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        // -32768 is taken as 32767
+        int16x8_t a = vqabsq_s16(vld1q_s16(data + i));
+        int32x4_t sq = vmull_s16(vget_low_s16(a), vget_low_s16(a));
+        sq = vmlal_s16(sq, vget_high_s16(a), vget_high_s16(a));
+        max = vmaxq_s16(max, a);
+        acc = vreinterpretq_s64_u64(vpadalq_u32(vreinterpretq_u64_s64(acc), vreinterpretq_u32_s32(sq)));
+    }
+
+    int16_t maxs[8];
+    int64_t accs[2];
+    vst1q_s16(maxs, max);
+    vst1q_s64(accs, acc);
+
+    for (int j = 0; j < 8; j++) {
+        *peak = maxs[j] > *peak ? maxs[j] : *peak;
+    }
+
+    *sum += accs[0] + accs[1];
+    return i;
+}
+
+static int meterFltSimd(const float *data, int count, float *peak, double *sum)
+{
+    float32x4_t max = vdupq_n_f32(0);
+    float32x4_t acc = vdupq_n_f32(0);
+    int i = 0;
+
+    // summed in float a block, the blocks in double
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t x = vld1q_f32(data + i);
+        max = vmaxq_f32(max, vabsq_f32(x));
+        acc = vmlaq_f32(acc, x, x);
+
+        if ((i & 1023) == 1020) {
+            float accs[4];
+            vst1q_f32(accs, acc);
+            *sum += (double) accs[0] + accs[1] + accs[2] + accs[3];
+            acc = vdupq_n_f32(0);
+        }
+    }
+
+    float maxs[4];
+    float accs[4];
+    vst1q_f32(maxs, max);
+    vst1q_f32(accs, acc);
+
+    for (int j = 0; j < 4; j++) {
+        *peak = maxs[j] > *peak ? maxs[j] : *peak;
+    }
+
+    *sum += (double) accs[0] + accs[1] + accs[2] + accs[3];
+    return i;
+}
+
+#else
+
+static int interleaveStereo(uint8_t *dst, const uint8_t *left, const uint8_t *right, int nb_samples, int sampleSize)
+{
+    return 0;
+}
+
+static int deinterleaveStereo(uint8_t *left, uint8_t *right, const uint8_t *src, int nb_samples, int sampleSize)
+{
+    return 0;
+}
+
+static int gainS16Simd(int16_t *data, int count, float gain)
+{
+    return 0;
+}
+
+static int gainFltSimd(float *data, int count, float gain)
+{
+    return 0;
+}
+
+static int downmixStereoS16(int16_t *dst, const int16_t *src, int nb_samples)
+{
+    return 0;
+}
+
+static int downmixStereoFlt(float *dst, const float *src, int nb_samples)
+{
+    return 0;
+}
+
+static int meterS16Simd(const int16_t *data, int count, int *peak, int64_t *sum)
+{
+    return 0;
+}
+
+static int meterFltSimd(const float *data, int count, float *peak, double *sum)
+{
+    return 0;
+}
+
+#endif
+
+void interleavePCM(uint8_t *dst, const uint8_t *const *src, int channels, int nb_samples, int sampleSize)
+{
+    if (channels == 1) {
+        memcpy(dst, src[0], (size_t) nb_samples * sampleSize);
+        return;
+    }
+
+    int n = channels == 2 ? interleaveStereo(dst, src[0], src[1], nb_samples, sampleSize) : 0;
+
+    switch (sampleSize) {
+        case 1:
+            interleaveC(dst, src, channels, n, nb_samples, 1);
+            break;
+
+        case 2:
+            interleaveC(dst, src, channels, n, nb_samples, 2);
+            break;
+
+        case 4:
+            interleaveC(dst, src, channels, n, nb_samples, 4);
+            break;
+
+        default:
+            interleaveC(dst, src, channels, n, nb_samples, 8);
+            break;
+    }
+}
+
+void deinterleavePCM(uint8_t *const *dst, const uint8_t *src, int channels, int nb_samples, int sampleSize)
+{
+    if (channels == 1) {
+        memcpy(dst[0], src, (size_t) nb_samples * sampleSize);
+        return;
+    }
+
+    int n = channels == 2 ? deinterleaveStereo(dst[0], dst[1], src, nb_samples, sampleSize) : 0;
+
+    switch (sampleSize) {
+        case 1:
+            deinterleaveC(dst, src, channels, n, nb_samples, 1);
+            break;
+
+        case 2:
+            deinterleaveC(dst, src, channels, n, nb_samples, 2);
+            break;
+
+        case 4:
+            deinterleaveC(dst, src, channels, n, nb_samples, 4);
+            break;
+
+        default:
+            deinterleaveC(dst, src, channels, n, nb_samples, 8);
+            break;
+    }
+}
+
+int applyPCMGain(uint8_t *data, enum AFSampleFormat format, int count, float gain)
+{
+    switch (packedFormat(format)) {
+        case AF_SAMPLE_FMT_S16: {
+            int16_t *samples = (int16_t *) data;
+
+            for (int i = gainS16Simd(samples, count, gain); i < count; i++) {
+                samples[i] = gainS16(samples[i], gain);
+            }
+
+            return 0;
+        }
+
+        case AF_SAMPLE_FMT_S32: {
+            int32_t *samples = (int32_t *) data;
+
+            for (int i = 0; i < count; i++) {
+                samples[i] = gainS32(samples[i], gain);
+            }
+
+            return 0;
+        }
+
+        case AF_SAMPLE_FMT_FLT: {
+            float *samples = (float *) data;
+
+            for (int i = gainFltSimd(samples, count, gain); i < count; i++) {
+                samples[i] = gainFlt(samples[i], gain);
+            }
+
+            return 0;
+        }
+
+        default:
+            return -EINVAL;
+    }
+}
+
+void fillPCMSilence(uint8_t *data, enum AFSampleFormat format, size_t size)
+{
+    memset(data, packedFormat(format) == AF_SAMPLE_FMT_U8 ? 0x80 : 0, size);
+}
+
+int downmixPCMToMono(uint8_t *dst, const uint8_t *src, enum AFSampleFormat format, int channels, int nb_samples)
+{
+    if (channels <= 0) {
+        return -EINVAL;
+    }
+
+    switch (format) {
+        case AF_SAMPLE_FMT_S16: {
+            int16_t *out = (int16_t *) dst;
+            const int16_t *in = (const int16_t *) src;
+
+            for (int n = channels == 2 ? downmixStereoS16(out, in, nb_samples) : 0; n < nb_samples; n++) {
+                int32_t sum = 0;
+
+                for (int ch = 0; ch < channels; ch++) {
+                    sum += in[n * channels + ch];
+                }
+
+                out[n] = (int16_t) (sum / channels);
+            }
+
+            return 0;
+        }
+
+        case AF_SAMPLE_FMT_S32: {
+            int32_t *out = (int32_t *) dst;
+            const int32_t *in = (const int32_t *) src;
+
+            for (int n = 0; n < nb_samples; n++) {
+                int64_t sum = 0;
+
+                for (int ch = 0; ch < channels; ch++) {
+                    sum += in[n * channels + ch];
+                }
+
+                out[n] = (int32_t) (sum / channels);
+            }
+
+            return 0;
+        }
+
+        case AF_SAMPLE_FMT_FLT: {
+            float *out = (float *) dst;
+            const float *in = (const float *) src;
+
+            for (int n = channels == 2 ? downmixStereoFlt(out, in, nb_samples) : 0; n < nb_samples; n++) {
+                float sum = in[n * channels];
+
+                for (int ch = 1; ch < channels; ch++) {
+                    sum += in[n * channels + ch];
+                }
+
+                out[n] = sum * (1.0f / channels);
+            }
+
+            return 0;
+        }
+
+        default:
+            return -EINVAL;
+    }
+}
+
+int meterPCM(const uint8_t *data, enum AFSampleFormat format, int count, float *peak, float *rms)
+{
+    *peak = 0;
+    *rms = 0;
+
+    switch (packedFormat(format)) {
+        case AF_SAMPLE_FMT_S16: {
+            const int16_t *samples = (const int16_t *) data;
+            int max = 0;
+            int64_t sum = 0;
+
+            for (int i = meterS16Simd(samples, count, &max, &sum); i < count; i++) {
+                int value = samples[i] < 0 ? -samples[i] : samples[i];
+                value = value > INT16_MAX ? INT16_MAX : value;
+                max = value > max ? value : max;
+                sum += value * value;
+            }
+
+            if (count > 0) {
+                *peak = max / 32768.0f;
+                *rms = (float) (sqrt((double) sum / count) / 32768.0);
+            }
+
+            return 0;
+        }
+
+        case AF_SAMPLE_FMT_S32: {
+            const int32_t *samples = (const int32_t *) data;
+            double max = 0;
+            double sum = 0;
+
+            for (int i = 0; i < count; i++) {
+                double value = fabs((double) samples[i]);
+                max = value > max ? value : max;
+                sum += value * value;
+            }
+
+            if (count > 0) {
+                *peak = (float) (max / 2147483648.0);
+                *rms = (float) (sqrt(sum / count) / 2147483648.0);
+            }
+
+            return 0;
+        }
+
+        case AF_SAMPLE_FMT_FLT: {
+            const float *samples = (const float *) data;
+            float max = 0;
+            double sum = 0;
+
+            for (int i = meterFltSimd(samples, count, &max, &sum); i < count; i++) {
+                float value = fabsf(samples[i]);
+                max = value > max ? value : max;
+                sum += (double) value * value;
+            }
+
+            if (count > 0) {
+                *peak = max;
+                *rms = (float) sqrt(sum / count);
+            }
+
+            return 0;
+        }
+
+        default:
+            return -EINVAL;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef FRAMEWORK_PCM_UTILS_H
+#define FRAMEWORK_PCM_UTILS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utils/AFMediaType.h>
+
+/*
+ * pcm kernels of the audio renders, for s16, s32, flt and their planar formats.
+ *
+ * A block of samples a time with SSE2 or NEON when the target has them, the rest in C. The C code rounds
+ * and clips the same way, so the results are the same on all the targets, but the rms of flt, which is
+ * summed in another order.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// planes of nb_samples samples to interleaved, sampleSize of 1, 2, 4 or 8 bytes
+void interleavePCM(uint8_t *dst, const uint8_t *const *src, int channels, int nb_samples, int sampleSize);
+
+void deinterleavePCM(uint8_t *const *dst, const uint8_t *src, int channels, int nb_samples, int sampleSize);
+
+// count samples in place, clipped to the full scale, a planar format is taken as one plane
+int applyPCMGain(uint8_t *data, enum AFSampleFormat format, int count, float gain);
+
+// 0x80 for u8, 0 for the others
+void fillPCMSilence(uint8_t *data, enum AFSampleFormat format, size_t size);
+
+// the mean of the interleaved channels
+int downmixPCMToMono(uint8_t *dst, const uint8_t *src, enum AFSampleFormat format, int channels, int nb_samples);
+
+// peak and rms of count samples, 1.0 is the full scale
+int meterPCM(const uint8_t *data, enum AFSampleFormat format, int count, float *peak, float *rms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif//FRAMEWORK_PCM_UTILS_H
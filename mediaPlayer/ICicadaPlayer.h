@@ -6,6 +6,7 @@
 #define CICADA_PLAYER_ICICADAPLAYER_H
 
 #include "native_cicada_player_def.h"
+#include <cerrno>
 #include <cacheModule/cache/CacheConfig.h>
 #include <drm/DrmHandler.h>
 #include <render/video/IVideoRender.h>
@@ -79,6 +80,31 @@ namespace Cicada {
          */
         virtual void SeekTo(int64_t seekPos, bool bAccurate = false) = 0;
 
+        /*
+         * 拖动进度条(scrub)模式, 拖动中不flush播放管线, 只显示目标位置前的关键帧,
+         * 新的位置取消未完成的旧位置, 退出时seek到最后的位置
+         */
+        virtual int EnterScrub()
+        {
+            return -ENOSYS;
+        }
+
+        /*
+         * pos 拖动到的位置(ms)
+         */
+        virtual int UpdateScrub(int64_t pos)
+        {
+            return -ENOSYS;
+        }
+
+        /*
+         * bAccurate 退出时是否精准seek
+         */
+        virtual int ExitScrub(bool bAccurate)
+        {
+            return -ENOSYS;
+        }
+
         /*
          * 停止播放
          */
@@ -182,6 +208,14 @@ namespace Cicada {
          */
         virtual void CaptureScreen() = 0;
 
+        /*
+         * 异步截取当前视频帧, 不依赖渲染, 结果通过listener.Snapshot回调
+         */
+        virtual int Snapshot(int width, int height, SnapshotFormat format)
+        {
+            return -ENOSYS;
+        }
+
         /*
          * 获取视频分辨率
          */
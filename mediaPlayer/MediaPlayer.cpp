@@ -12,6 +12,7 @@
 #include "MediaPlayer.h"
 #include "media_player_api.h"
 #include "abr/AbrManager.h"
+#include "preload/PreloadManager.h"
 #include "abr/AbrBufferAlgoStrategy.h"
 #include "abr/AbrBufferRefererData.h"
 
@@ -59,6 +60,7 @@ namespace Cicada {
         listener.StreamSwitchSuc = streamChangedSucCallback;
         listener.StatusChanged = PlayerStatusChanged;
         listener.CaptureScreen = captureScreenResult;
+        listener.Snapshot = snapshotResult;
         listener.AutoPlayStart = autoPlayStart;
         CicadaSetListener(handle, listener);
         CicadaSetMediaFrameCb(handle, onMediaFrameCallback, this);
@@ -335,6 +337,27 @@ namespace Cicada {
         mAbrManager->Pause();
     }
 
+    int MediaPlayer::EnterScrub()
+    {
+        GET_PLAYER_HANDLE
+        return CicadaEnterScrub(handle);
+    }
+
+    int MediaPlayer::UpdateScrub(int64_t pos)
+    {
+        GET_PLAYER_HANDLE
+        return CicadaUpdateScrub(handle, pos);
+    }
+
+    int MediaPlayer::ExitScrub(SeekMode mode)
+    {
+        GET_PLAYER_HANDLE
+        int ret = CicadaExitScrub(handle, (mode & SEEK_MODE_ACCURATE) != 0);
+        //when seek, close abrmanager
+        mAbrManager->Pause();
+        return ret;
+    }
+
     void MediaPlayer::CaptureScreen()
     {
         GET_PLAYER_HANDLE
@@ -345,6 +368,18 @@ namespace Cicada {
         }
     }
 
+    int MediaPlayer::Snapshot(int width, int height, SnapshotFormat format)
+    {
+        GET_PLAYER_HANDLE
+        int ret = CicadaSnapshot(handle, width, height, format);
+
+        if (ret >= 0 && mCollector) {
+            mCollector->ReportSnapshot();
+        }
+
+        return ret;
+    }
+
     void MediaPlayer::Stop()
     {
         if (mCollector) {
@@ -467,6 +502,18 @@ namespace Cicada {
             playerConfig.maxBufferDuration = playerConfig.highBufferDuration;
         }
 
+        if (playerConfig.highBufferMemory < 0) {
+            playerConfig.highBufferMemory = 0;
+        }
+
+        if (playerConfig.maxBufferMemory < 0) {
+            playerConfig.maxBufferMemory = 0;
+        }
+
+        if (playerConfig.maxBufferMemory > 0 && playerConfig.highBufferMemory > playerConfig.maxBufferMemory) {
+            playerConfig.highBufferMemory = playerConfig.maxBufferMemory;
+        }
+
         CicadaSetDropBufferThreshold(handle, playerConfig.maxDelayTime);
         CicadaSetRefer(handle, playerConfig.referer.c_str());
         CicadaSetTimeout(handle, playerConfig.networkTimeout);
@@ -479,6 +526,8 @@ namespace Cicada {
         CicadaSetOption(handle, "highLevelBufferDuration", chHighBufDur.c_str());
         string chMaxBufDur = to_string(playerConfig.maxBufferDuration);
         CicadaSetOption(handle, "maxBufferDuration", chMaxBufDur.c_str());
+        CicadaSetOption(handle, "highLevelBufferBytes", to_string((int64_t) playerConfig.highBufferMemory * 1024).c_str());
+        CicadaSetOption(handle, "maxBufferBytes", to_string((int64_t) playerConfig.maxBufferMemory * 1024).c_str());
         CicadaSetOption(handle, "liveStartIndex", to_string(playerConfig.liveStartIndex).c_str());
         CicadaSetOption(handle, "http_proxy", playerConfig.httpProxy.c_str());
         CicadaSetOption(handle, "ClearShowWhenStop", playerConfig.bClearShowWhenStop ? "1" : "0");
@@ -638,6 +687,12 @@ namespace Cicada {
         return CicadaGetPropertyString(handle, key);
     }
 
+    int64_t MediaPlayer::GetPropertyLong(PropertyKey key)
+    {
+        GET_PLAYER_HANDLE
+        return CicadaGetPropertyLong(handle, key);
+    }
+
     void MediaPlayer::SetOption(const char *key, const char *value)
     {
         GET_PLAYER_HANDLE
@@ -964,6 +1019,15 @@ namespace Cicada {
         }
     }
 
+    void MediaPlayer::snapshotResult(int64_t error, int64_t size, const void *result, void *userData)
+    {
+        GET_MEDIA_PLAYER
+
+        if (player->mListener.Snapshot) {
+            player->mListener.Snapshot(error, size, result, player->mListener.userData);
+        }
+    }
+
     void MediaPlayer::autoPlayStart(void *userData)
     {
         GET_MEDIA_PLAYER
@@ -1175,4 +1239,29 @@ namespace Cicada {
         GET_PLAYER_HANDLE;
         return CicadaGetPlayerName(handle);
     }
+
+    void MediaPlayer::SetPreloadUrls(const std::vector<std::string> &urls)
+    {
+        PreloadManager::Instance()->setUrls(urls);
+    }
+
+    void MediaPlayer::SetPreloadBudget(int64_t maxBytes, int maxConcurrency)
+    {
+        PreloadManager::Instance()->setBudget(maxBytes, maxConcurrency);
+    }
+
+    void MediaPlayer::SetPreloadItemBytes(int64_t bytes)
+    {
+        PreloadManager::Instance()->setItemBytes(bytes);
+    }
+
+    void MediaPlayer::ClearPreload()
+    {
+        PreloadManager::Instance()->clear();
+    }
+
+    std::string MediaPlayer::GetPreloadStatistics()
+    {
+        return PreloadManager::Instance()->getStatistics();
+    }
 }
@@ -61,6 +61,23 @@ namespace Cicada {
             return "paas 0.9";//TODO version
         }
 
+        /*
+         * warm the upcoming items of a feed, the most likely first, a later Prepare of a loaded url
+         * reads the first data from memory, see PreloadManager
+         */
+        static void SetPreloadUrls(const std::vector<std::string> &urls);
+
+        // total bytes of all the items, and the count of the items loading at the same time
+        static void SetPreloadBudget(int64_t maxBytes, int maxConcurrency);
+
+        // the head bytes loaded for each file item
+        static void SetPreloadItemBytes(int64_t bytes);
+
+        static void ClearPreload();
+
+        // a json object of hits, misses, hitRate, preloadedBytes and wastedBytes
+        static std::string GetPreloadStatistics();
+
         std::string getName();
 
     public:
@@ -146,11 +163,26 @@ namespace Cicada {
          */
         void SeekTo(int64_t seekPos, SeekMode mode);
 
+        /*
+         * scrub mode for dragging the seek bar, shows the key frames before the positions,
+         * exit seeks to the last position by mode
+         */
+        int EnterScrub();
+
+        int UpdateScrub(int64_t pos);
+
+        int ExitScrub(SeekMode mode);
+
         /*
          * capture screen, buffer will get by callback
          */
         void CaptureScreen();
 
+        /*
+         * snapshot the current video frame without the render, the result will get by callback
+         */
+        int Snapshot(int width, int height, SnapshotFormat format);
+
         /*
          * stop playing
          */
@@ -323,6 +355,8 @@ namespace Cicada {
 
         std::string GetPropertyString(PropertyKey key);
 
+        int64_t GetPropertyLong(PropertyKey key);
+
         void SetOption(const char *key, const char *value);
 
         void GetOption(const char *key, char *value);
@@ -400,6 +434,8 @@ namespace Cicada {
 
         static void captureScreenResult(int64_t width, int64_t height, const void *buffer, void *userData);
 
+        static void snapshotResult(int64_t error, int64_t size, const void *result, void *userData);
+
         static void autoPlayStart(void *userData);
 
         void abrChanged(int stream);
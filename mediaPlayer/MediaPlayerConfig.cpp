@@ -16,6 +16,8 @@ namespace Cicada {
         maxBufferDuration = 50000;
         highBufferDuration = 3000;
         startBufferDuration = 500;
+        highBufferMemory = 0;
+        maxBufferMemory = 0;
         bClearShowWhenStop = false;
         bEnableTunnelRender = false;
         pixelBufferOutputFormat = 0;
@@ -37,6 +39,8 @@ namespace Cicada {
         item.addValue("maxBufferDuration", maxBufferDuration);
         item.addValue("highBufferDuration", highBufferDuration);
         item.addValue("startBufferDuration", startBufferDuration);
+        item.addValue("highBufferMemory", highBufferMemory);
+        item.addValue("maxBufferMemory", maxBufferMemory);
         item.addValue("bClearShowWhenStop", bClearShowWhenStop);
         item.addValue("bEnableTunnelRender", bEnableTunnelRender);
         item.addValue("mDisableAudio", mDisableAudio);
@@ -30,6 +30,9 @@ namespace Cicada {
         int maxBufferDuration;
         int highBufferDuration;
         int startBufferDuration;
+        /* the buffer limits in KB, with the duration ones, the one reached first works, 0 for no limit */
+        int highBufferMemory;
+        int maxBufferMemory;
         /* true is to clear image show when stop */
         bool bClearShowWhenStop;
         /* enable tunnel render*/
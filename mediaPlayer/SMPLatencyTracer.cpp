@@ -0,0 +1,278 @@
+#define LOG_TAG "SMPLatencyTracer"
+
+#include "SMPLatencyTracer.h"
+#include <algorithm>
+#include <utils/CicadaJSON.h>
+#include <utils/timer.h>
+
+using namespace Cicada;
+
+static const char *trackNames[SMPLatencyTracer::TRACK_NUM] = {"video", "audio"};
+
+SMPLatencyTracer::Histogram::Histogram()
+{
+    reset();
+}
+
+void SMPLatencyTracer::Histogram::add(int64_t us)
+{
+    if (us < 0) {
+        us = 0;
+    }
+
+    int index = 0;
+    uint64_t value = static_cast<uint64_t>(us) >> 1;
+
+    while (value && index < BUCKET_NUM - 1) {
+        value >>= 1;
+        index++;
+    }
+
+    buckets[index].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(static_cast<uint64_t>(us), std::memory_order_relaxed);
+
+    int64_t oldMax = max.load(std::memory_order_relaxed);
+
+    while (us > oldMax && !max.compare_exchange_weak(oldMax, us, std::memory_order_relaxed)) {
+    }
+}
+
+void SMPLatencyTracer::Histogram::reset()
+{
+    for (auto &bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+
+    count = 0;
+    sum = 0;
+    max = 0;
+}
+
+int64_t SMPLatencyTracer::Histogram::percentile(double p) const
+{
+    uint64_t total = count.load(std::memory_order_relaxed);
+
+    if (total == 0) {
+        return 0;
+    }
+
+    auto target = static_cast<uint64_t>(total * p);
+    uint64_t accumulated = 0;
+
+    for (int i = 0; i < BUCKET_NUM; i++) {
+        accumulated += buckets[i].load(std::memory_order_relaxed);
+
+        if (accumulated > target) {
+            // upper bound of the bucket
+            return std::min((int64_t) 1 << (i + 1), max.load(std::memory_order_relaxed));
+        }
+    }
+
+    return max;
+}
+
+SMPLatencyTracer::SMPLatencyTracer()
+{
+    flush();
+}
+
+const char *SMPLatencyTracer::stageName(Stage stage)
+{
+    switch (stage) {
+        case STAGE_DEMUX_OUT:
+            return "demuxOut";
+        case STAGE_BUFFER_IN:
+            return "bufferIn";
+        case STAGE_DECODER_IN:
+            return "decoderIn";
+        case STAGE_DECODER_OUT:
+            return "decoderOut";
+        case STAGE_RENDER_QUEUE:
+            return "renderQueue";
+        case STAGE_PRESENTED:
+            return "presented";
+        default:
+            return "unknown";
+    }
+}
+
+int SMPLatencyTracer::slotIndex(int64_t pts)
+{
+    // pts are usually multiples of the frame duration, mix them before take the slot
+    uint64_t hash = static_cast<uint64_t>(pts) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<int>(hash >> 56) % SLOT_NUM;
+}
+
+void SMPLatencyTracer::stamp(Track track, int64_t pts, Stage stage, int64_t time)
+{
+    if (!mEnabled || pts == INT64_MIN || track >= TRACK_NUM || stage >= STAGE_NUM) {
+        return;
+    }
+
+    if (time == INT64_MIN) {
+        time = af_gettime_relative();
+    }
+
+    Slot &slot = mSlots[track][slotIndex(pts)];
+
+    if (stage == STAGE_DEMUX_OUT) {
+        // a new packet, the older one in this slot was lost (dropped or collided)
+        slot.pts = pts;
+
+        for (auto &t : slot.time) {
+            t = INT64_MIN;
+        }
+    } else if (slot.pts != pts) {
+        return;
+    }
+
+    if (slot.time[stage] != INT64_MIN) {
+        return;
+    }
+
+    slot.time[stage] = time;
+
+    for (int i = stage - 1; i >= 0; i--) {
+        if (slot.time[i] != INT64_MIN) {
+            mHistograms[track][stage].add(time - slot.time[i]);
+            break;
+        }
+    }
+
+    // audio render don't report the presented time of each frame, finish it on render queue
+    if (stage == STAGE_PRESENTED || (track == TRACK_AUDIO && stage == STAGE_RENDER_QUEUE)) {
+        finish(track, slot);
+    }
+}
+
+void SMPLatencyTracer::finish(Track track, Slot &slot)
+{
+    {
+        std::lock_guard<std::mutex> lock(mTraceMutex);
+        TraceEvent event{};
+        event.track = track;
+        event.pts = slot.pts;
+
+        for (int i = 0; i < STAGE_NUM; i++) {
+            event.time[i] = slot.time[i];
+        }
+
+        if (mTraceEvents.size() < TRACE_EVENT_MAX) {
+            mTraceEvents.push_back(event);
+        } else {
+            mTraceEvents[mTraceEventIndex] = event;
+        }
+
+        mTraceEventIndex = (mTraceEventIndex + 1) % TRACE_EVENT_MAX;
+    }
+    slot.pts = INT64_MIN;
+}
+
+void SMPLatencyTracer::flush()
+{
+    for (int i = 0; i < TRACK_NUM; i++) {
+        flush(static_cast<Track>(i));
+    }
+}
+
+void SMPLatencyTracer::flush(Track track)
+{
+    for (auto &slot : mSlots[track]) {
+        slot.pts = INT64_MIN;
+
+        for (auto &t : slot.time) {
+            t = INT64_MIN;
+        }
+    }
+}
+
+void SMPLatencyTracer::reset()
+{
+    flush();
+
+    for (auto &track : mHistograms) {
+        for (auto &histogram : track) {
+            histogram.reset();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mTraceMutex);
+    mTraceEvents.clear();
+    mTraceEventIndex = 0;
+}
+
+std::string SMPLatencyTracer::dumpHistograms() const
+{
+    CicadaJSONArray tracks;
+
+    for (int t = 0; t < TRACK_NUM; t++) {
+        CicadaJSONItem trackItem;
+        CicadaJSONArray stages;
+        trackItem.addValue("type", trackNames[t]);
+
+        // the first stage have no predecessor
+        for (int s = STAGE_DEMUX_OUT + 1; s < STAGE_NUM; s++) {
+            const Histogram &histogram = mHistograms[t][s];
+            uint64_t count = histogram.count.load(std::memory_order_relaxed);
+
+            if (count == 0) {
+                continue;
+            }
+
+            CicadaJSONItem stageItem;
+            stageItem.addValue("stage", stageName(static_cast<Stage>(s)));
+            stageItem.addValue("count", (double) count);
+            stageItem.addValue("avgUs", (double) histogram.sum.load(std::memory_order_relaxed) / count);
+            stageItem.addValue("p50Us", (double) histogram.percentile(0.5));
+            stageItem.addValue("p90Us", (double) histogram.percentile(0.9));
+            stageItem.addValue("p99Us", (double) histogram.percentile(0.99));
+            stageItem.addValue("maxUs", (double) histogram.max.load(std::memory_order_relaxed));
+            stages.addJSON(stageItem);
+        }
+
+        trackItem.addArray("stages", stages);
+        tracks.addJSON(trackItem);
+    }
+
+    return tracks.printJSON();
+}
+
+std::string SMPLatencyTracer::dumpChromeTrace() const
+{
+    CicadaJSONArray traceEvents;
+    std::lock_guard<std::mutex> lock(mTraceMutex);
+    size_t size = mTraceEvents.size();
+    // oldest first
+    size_t start = size < TRACE_EVENT_MAX ? 0 : mTraceEventIndex;
+
+    for (size_t n = 0; n < size; n++) {
+        const TraceEvent &event = mTraceEvents[(start + n) % size];
+        int last = STAGE_DEMUX_OUT;
+
+        for (int s = STAGE_DEMUX_OUT + 1; s < STAGE_NUM; s++) {
+            if (event.time[s] == INT64_MIN) {
+                continue;
+            }
+
+            if (event.time[last] != INT64_MIN) {
+                CicadaJSONItem item;
+                item.addValue("name", stageName(static_cast<Stage>(s)));
+                item.addValue("cat", trackNames[event.track]);
+                item.addValue("ph", "X");
+                item.addValue("ts", (double) event.time[last]);
+                item.addValue("dur", (double) (event.time[s] - event.time[last]));
+                item.addValue("pid", 1);
+                item.addValue("tid", (int) event.track + 1);
+                traceEvents.addJSON(item);
+            }
+
+            last = s;
+        }
+    }
+
+    CicadaJSONItem trace;
+    trace.addArray("traceEvents", traceEvents);
+    trace.addValue("displayTimeUnit", "ms");
+    return trace.printJSON();
+}
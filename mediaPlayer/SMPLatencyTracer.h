@@ -0,0 +1,126 @@
+#ifndef SOURCE_SMPLATENCYTRACER_H
+#define SOURCE_SMPLATENCYTRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Cicada {
+    /*
+     * Steady state latency tracing of the playback pipeline.
+     *
+     * Every packet is identified by its pts, and stamped when it passes one of the stages below.
+     * The time spent between two consecutive stages is accumulated into lock-free log2 histograms,
+     * which can be queried from any thread, and the latest finished packets are kept as
+     * Chrome trace events (chrome://tracing, ui.perfetto.dev).
+     *
+     * stamp() must be called from the player main loop thread only.
+     */
+    class SMPLatencyTracer {
+    public:
+        enum Stage {
+            STAGE_DEMUX_OUT = 0,
+            STAGE_BUFFER_IN,
+            STAGE_DECODER_IN,
+            STAGE_DECODER_OUT,
+            STAGE_RENDER_QUEUE,
+            STAGE_PRESENTED,
+            STAGE_NUM,
+        };
+
+        enum Track {
+            TRACK_VIDEO = 0,
+            TRACK_AUDIO,
+            TRACK_NUM,
+        };
+
+    public:
+        SMPLatencyTracer();
+
+        ~SMPLatencyTracer() = default;
+
+        void enable(bool enable)
+        {
+            mEnabled = enable;
+        }
+
+        bool isEnabled() const
+        {
+            return mEnabled;
+        }
+
+        /*
+         * time is a af_gettime_relative() value, INT64_MIN means now.
+         * a stage is only stamped once per packet, the first stamp wins (e.g. decoder retry in).
+         */
+        void stamp(Track track, int64_t pts, Stage stage, int64_t time = INT64_MIN);
+
+        // drop the in flight packets, on stop
+        void flush();
+
+        // drop the in flight packets of a track, on the flush of its path (seek, drop, switch)
+        void flush(Track track);
+
+        // drop all the statistics
+        void reset();
+
+        // histograms of each stage, in JSON
+        std::string dumpHistograms() const;
+
+        // the latest finished packets, in Chrome trace JSON format
+        std::string dumpChromeTrace() const;
+
+        static const char *stageName(Stage stage);
+
+    private:
+        static const int SLOT_NUM = 256;
+        static const int BUCKET_NUM = 24;// 1us ... 8s
+        static const int TRACE_EVENT_MAX = 2048;
+
+        class Histogram {
+        public:
+            Histogram();
+
+            void add(int64_t us);
+
+            void reset();
+
+            std::atomic<uint64_t> buckets[BUCKET_NUM];
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> sum{0};
+            std::atomic<int64_t> max{0};
+
+            int64_t percentile(double p) const;
+        };
+
+        struct Slot {
+            int64_t pts;
+            int64_t time[STAGE_NUM];
+        };
+
+        struct TraceEvent {
+            Track track;
+            int64_t pts;
+            int64_t time[STAGE_NUM];
+        };
+
+    private:
+        static int slotIndex(int64_t pts);
+
+        void finish(Track track, Slot &slot);
+
+    private:
+        std::atomic_bool mEnabled{false};
+        Slot mSlots[TRACK_NUM][SLOT_NUM]{};
+        Histogram mHistograms[TRACK_NUM][STAGE_NUM];
+
+        mutable std::mutex mTraceMutex;
+        std::vector<TraceEvent> mTraceEvents;
+        int mTraceEventIndex{0};
+    };
+}// namespace Cicada
+
+
+#endif//SOURCE_SMPLATENCYTRACER_H
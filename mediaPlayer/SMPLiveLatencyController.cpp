@@ -0,0 +1,121 @@
+#define LOG_TAG "SMPLiveLatencyController"
+
+#include "SMPLiveLatencyController.h"
+#include <algorithm>
+#include <cmath>
+#include <utils/frame_work_log.h>
+
+using namespace Cicada;
+
+#define HOLD_BACK_FACTOR 3
+// apply a correction no more than once per interval, the audio render need time to take effect
+#define CORRECT_INTERVAL (500 * 1000)
+// 1s latency error ==> 0.1 speed
+#define SPEED_GAIN (0.1 / (1000 * 1000))
+// far more than MAX_SPEED can catch up in one minute
+#define DROP_THRESHOLD (10 * 1000 * 1000)
+
+constexpr float SMPLiveLatencyController::MIN_SPEED;
+constexpr float SMPLiveLatencyController::MAX_SPEED;
+
+void SMPLiveLatencyController::setStreamDurations(int64_t targetDuration, int64_t partTargetDuration)
+{
+    mTargetDuration = std::max(targetDuration, (int64_t) 0);
+    mPartTargetDuration = std::max(partTargetDuration, (int64_t) 0);
+}
+
+int64_t SMPLiveLatencyController::getTargetLatency() const
+{
+    if (mUserTargetLatency > 0) {
+        return mUserTargetLatency;
+    }
+
+    if (mPartTargetDuration > 0) {
+        return HOLD_BACK_FACTOR * mPartTargetDuration;
+    }
+
+    if (mTargetDuration > 0) {
+        return HOLD_BACK_FACTOR * mTargetDuration;
+    }
+
+    return INT64_MIN;
+}
+
+int64_t SMPLiveLatencyController::getDeadBand() const
+{
+    // don't chase the latency error smaller than the publish granularity
+    int64_t granularity = mPartTargetDuration > 0 ? mPartTargetDuration.load() : mTargetDuration.load() / 4;
+    return std::max(granularity / 2, (int64_t) 100 * 1000);
+}
+
+float SMPLiveLatencyController::update(int64_t bufferDuration, int64_t now)
+{
+    int64_t target = getTargetLatency();
+
+    if (!mEnable || bufferDuration < 0 || target == INT64_MIN) {
+        return -1;
+    }
+
+    // the data not published is not in buffer, but it's a part of the live edge distance.
+    int64_t latency = bufferDuration + (mPartTargetDuration > 0 ? mPartTargetDuration.load() : mTargetDuration.load());
+    mCurrentLatency = latency;
+
+    // the buffer level jumps on each part/segment arrival, smooth it
+    if (mSmoothedLatency == INT64_MIN) {
+        mSmoothedLatency = latency;
+    } else {
+        mSmoothedLatency = (mSmoothedLatency * 7 + latency) / 8;
+    }
+
+    if (mLastCorrectTime != INT64_MIN && now - mLastCorrectTime < CORRECT_INTERVAL) {
+        return 0;
+    }
+
+    int64_t error = mSmoothedLatency - target;
+    float speed = 1.0f;
+
+    if (std::llabs(error) > getDeadBand()) {
+        speed = static_cast<float>(1.0 + error * SPEED_GAIN);
+        speed = std::min(std::max(speed, MIN_SPEED), MAX_SPEED);
+        // 0.01 step, avoid to reconfigure the audio filter for tiny changes
+        speed = std::round(speed * 100) / 100;
+    }
+
+    if (std::fabs(speed - mSpeed) < 0.005f) {
+        return 0;
+    }
+
+    AF_LOGI("live latency correction: latency %lld ms, smoothed %lld ms, target %lld ms, speed %.2f --> %.2f",
+            (long long) (latency / 1000), (long long) (mSmoothedLatency / 1000), (long long) (target / 1000),
+            mSpeed.load(), speed);
+    mSpeed = speed;
+    mLastCorrectTime = now;
+    return speed;
+}
+
+bool SMPLiveLatencyController::needDrop() const
+{
+    int64_t target = getTargetLatency();
+
+    if (!mEnable || target == INT64_MIN || mCurrentLatency == INT64_MIN) {
+        return false;
+    }
+
+    return mCurrentLatency > target + DROP_THRESHOLD;
+}
+
+void SMPLiveLatencyController::resetSpeed()
+{
+    mSpeed = 1.0f;
+    mLastCorrectTime = INT64_MIN;
+}
+
+void SMPLiveLatencyController::reset()
+{
+    mTargetDuration = 0;
+    mPartTargetDuration = 0;
+    mCurrentLatency = INT64_MIN;
+    mSpeed = 1.0f;
+    mSmoothedLatency = INT64_MIN;
+    mLastCorrectTime = INT64_MIN;
+}
@@ -0,0 +1,90 @@
+#ifndef SOURCE_SMPLIVELATENCYCONTROLLER_H
+#define SOURCE_SMPLIVELATENCYCONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace Cicada {
+    /*
+     * Hold a live stream at a target distance from the live edge by small playback rate changes,
+     * instead of dropping the buffered data.
+     *
+     * The live edge distance is estimated from the data buffered in the player and the demuxer, plus
+     * the part (LL-HLS) or segment target duration that is not published yet.
+     * When no target latency is set, it follows the HLS spec hold back: 3 part target durations
+     * for LL-HLS, otherwise 3 target durations.
+     */
+    class SMPLiveLatencyController {
+    public:
+        SMPLiveLatencyController() = default;
+
+        ~SMPLiveLatencyController() = default;
+
+        void setEnable(bool enable)
+        {
+            mEnable = enable;
+        }
+
+        bool isEnabled() const
+        {
+            return mEnable;
+        }
+
+        // us, <= 0 to follow the playlist hold back
+        void setTargetLatency(int64_t latency)
+        {
+            mUserTargetLatency = latency;
+        }
+
+        // us, INT64_MIN or <= 0 if unknown
+        void setStreamDurations(int64_t targetDuration, int64_t partTargetDuration);
+
+        /*
+         * feed the buffered duration (us) at time now (us)
+         * return the playback rate should be used, 0 for keep the current rate,
+         * < 0 if the latency can't be controlled (disabled, no target, no buffer), the rate should go back to normal
+         */
+        float update(int64_t bufferDuration, int64_t now);
+
+        int64_t getCurrentLatency() const
+        {
+            return mCurrentLatency;
+        }
+
+        int64_t getTargetLatency() const;
+
+        float getSpeed() const
+        {
+            return mSpeed;
+        }
+
+        // latency is too far from target to be recovered by rate in reasonable time
+        bool needDrop() const;
+
+        void reset();
+
+        // the rate is back to normal by the player, the next update corrects from 1.0 without delay
+        void resetSpeed();
+
+    public:
+        static constexpr float MIN_SPEED = 0.95f;
+        static constexpr float MAX_SPEED = 1.1f;
+
+    private:
+        int64_t getDeadBand() const;
+
+    private:
+        std::atomic_bool mEnable{false};
+        std::atomic<int64_t> mUserTargetLatency{0};
+        std::atomic<int64_t> mTargetDuration{0};
+        std::atomic<int64_t> mPartTargetDuration{0};
+        std::atomic<int64_t> mCurrentLatency{INT64_MIN};
+        std::atomic<float> mSpeed{1.0f};
+
+        int64_t mSmoothedLatency{INT64_MIN};
+        int64_t mLastCorrectTime{INT64_MIN};
+    };
+}// namespace Cicada
+
+
+#endif//SOURCE_SMPLIVELATENCYCONTROLLER_H
@@ -132,7 +132,16 @@ void SMPMessageControllerListener::ProcessPrepareMsg()
 #ifdef __APPLE__
         mPlayer.mDemuxerService->getDemuxerHandle()->setBitStreamFormat(header_type::header_type_extract, header_type::header_type_extract);
 #else
-        mPlayer.mDemuxerService->getDemuxerHandle()->setBitStreamFormat(header_type::header_type_merge, header_type::header_type_merge);
+        // avcodec takes avcC/hvcC as it is, skip the conversion unless a hardware decoder may be used
+        header_type videoHeader = header_type::header_type_merge;
+#ifdef ANDROID
+        if (!mPlayer.mSet->bEnableHwVideoDecode) {
+            videoHeader = header_type::header_type_no_touch;
+        }
+#else
+        videoHeader = header_type::header_type_no_touch;
+#endif
+        mPlayer.mDemuxerService->getDemuxerHandle()->setBitStreamFormat(videoHeader, header_type::header_type_merge);
 #endif
         if (noFile) {
             IDataSource::SourceConfig config;
@@ -333,6 +342,7 @@ void SMPMessageControllerListener::ProcessPauseMsg()
 
     mPlayer.ChangePlayerStatus(PLAYER_PAUSED);
     mPlayer.startRendering(false);
+    mPlayer.StopLiveLatencyControl();
 }
 
 // TODO: set layout when init videoRender?
@@ -398,8 +408,11 @@ void SMPMessageControllerListener::ProcessSeekToMsg(int64_t seekPos, bool bAccur
         return;
     }
 
+    // a live stream can seek in the time shift window
+    bool timeShift = mPlayer.mDuration == 0 && mPlayer.mTimeShiftRecorder != nullptr && mPlayer.mPlayStatus < PLAYER_STOPPED;
+
     //can seek when finished
-    if ((0 >= mPlayer.mDuration) || (mPlayer.mPlayStatus >= PLAYER_STOPPED && mPlayer.mPlayStatus != PLAYER_COMPLETION)) {
+    if ((0 >= mPlayer.mDuration && !timeShift) || (mPlayer.mPlayStatus >= PLAYER_STOPPED && mPlayer.mPlayStatus != PLAYER_COMPLETION)) {
         mPlayer.ResetSeekStatus();
         return;
     }
@@ -411,7 +424,7 @@ void SMPMessageControllerListener::ProcessSeekToMsg(int64_t seekPos, bool bAccur
     mPlayer.mSoughtVideoPos = INT64_MIN;
     mPlayer.mCurVideoPts = INT64_MIN;
     //flush packet queue
-    mPlayer.mSeekInCache = mPlayer.SeekInCache(seekPos);
+    mPlayer.mSeekInCache = !timeShift && mPlayer.SeekInCache(seekPos);
 
     mPlayer.mPNotifier->NotifySeeking(mPlayer.mSeekInCache);
 
@@ -423,10 +436,17 @@ void SMPMessageControllerListener::ProcessSeekToMsg(int64_t seekPos, bool bAccur
 */
     if (!mPlayer.mSeekInCache) {
         mPlayer.mBufferController->ClearPacket(BUFFER_TYPE_ALL);
-        int64_t ret = mPlayer.mDemuxerService->Seek(seekPos, 0, -1);
+        // the new stream is sought with the others, nothing to splice
+        mPlayer.mFastSwitchPos = INT64_MIN;
 
-        if (ret < 0) {
-            mPlayer.NotifyError(ret);
+        if (timeShift) {
+            mPlayer.TimeShiftSeek(seekPos);
+        } else {
+            int64_t ret = mPlayer.mDemuxerService->Seek(seekPos, 0, -1);
+
+            if (ret < 0) {
+                mPlayer.NotifyError(ret);
+            }
         }
         //in case of seekpos larger than duration.
         mPlayer.mPNotifier->NotifyBufferPosition((seekPos <= mPlayer.mDuration ? seekPos : mPlayer.mDuration) / 1000);
@@ -467,6 +487,83 @@ void SMPMessageControllerListener::ProcessSeekToMsg(int64_t seekPos, bool bAccur
     mPlayer.mMasterClock.setTime(seekPos);
 }
 
+void SMPMessageControllerListener::ProcessScrubEnterMsg()
+{
+    if (mPlayer.mScrubbing) {
+        return;
+    }
+
+    if (mPlayer.mPlayStatus < PLAYER_PREPARED || mPlayer.mPlayStatus == PLAYER_STOPPED || mPlayer.mPlayStatus == PLAYER_ERROR ||
+        !HAVE_VIDEO || mPlayer.mDuration <= 0) {
+        AF_LOGW("can't scrub in status %d\n", mPlayer.mPlayStatus.load());
+        return;
+    }
+
+    mPlayer.mScrubbing = true;
+    mPlayer.mScrubPos = INT64_MIN;
+    mPlayer.startRendering(false);
+
+    if (mPlayer.mScrubEngine == nullptr) {
+        mPlayer.mScrubEngine = unique_ptr<ThumbnailEngine>(new ThumbnailEngine(mPlayer.mSet->url));
+        mPlayer.mScrubEngine->setOptions(&mPlayer.mSet->mOptions);
+        SuperMediaPlayer *player = &mPlayer;
+        mPlayer.mScrubEngine->setCallback([player](int64_t time, const std::shared_ptr<IAFFrame> &frame, int ret) -> void {
+            player->onScrubFrame(time, frame, ret);
+        });
+    }
+
+    // the key packets in the buffer are decoded by the meta of the current stream
+    unique_ptr<streamMeta> meta{};
+
+    if (mPlayer.mDemuxerService->GetStreamMeta(meta, mPlayer.mCurrentVideoIndex, false) >= 0) {
+        mPlayer.mScrubEngine->setPacketMeta(move(meta));
+    }
+}
+
+void SMPMessageControllerListener::ProcessScrubUpdateMsg(int64_t pos)
+{
+    if (!mPlayer.mScrubbing) {
+        return;
+    }
+
+    pos = std::max(std::min(pos, mPlayer.mDuration), (int64_t) 0);
+    mPlayer.mScrubPos = pos;
+    unique_ptr<IAFPacket> keyPacket{};
+
+    // the buffered packets first, no seek and no download. the encrypted ones can only be decoded in the pipeline
+    if (!mPlayer.mSecretPlayBack && !mPlayer.mDrmKeyValid && pos <= mPlayer.mBufferController->GetPacketLastTimePos(BUFFER_TYPE_VIDEO)) {
+        keyPacket = mPlayer.mBufferController->GetKeyPacketBefore(BUFFER_TYPE_VIDEO, pos);
+    }
+
+    if (keyPacket) {
+        int64_t nextKeyPos = mPlayer.mBufferController->FindKeyTimePositionAfter(BUFFER_TYPE_VIDEO, keyPacket->getInfo().timePosition + 1);
+        mPlayer.mScrubEngine->requestThumbnail(pos, move(keyPacket), nextKeyPos);
+    } else {
+        mPlayer.mScrubEngine->requestThumbnail(pos);
+    }
+}
+
+void SMPMessageControllerListener::ProcessScrubExitMsg(bool bAccurate)
+{
+    if (!mPlayer.mScrubbing) {
+        return;
+    }
+
+    mPlayer.mScrubbing = false;
+    mPlayer.mScrubEngine->cancelAll();
+    {
+        std::lock_guard<std::mutex> lock(mPlayer.mScrubMutex);
+        mPlayer.mScrubFrame = nullptr;
+    }
+    mPlayer.mScrubShownFrame = nullptr;
+
+    // the rendering is started again by the main loop when playing
+    if (mPlayer.mScrubPos != INT64_MIN) {
+        ProcessSeekToMsg(mPlayer.mScrubPos, bAccurate);
+        mPlayer.mScrubPos = INT64_MIN;
+    }
+}
+
 void SMPMessageControllerListener::ProcessMuteMsg()
 {
     mPlayer.mAVDeviceManager->setMute(mPlayer.mSet->bMute);
@@ -541,6 +638,7 @@ void SMPMessageControllerListener::ProcessVideoRenderedMsg(int64_t pts, int64_t
     mPlayer.mUtil->render(pts);
     if (rendered) {
         mPlayer.checkFirstRender();
+        mPlayer.mLatencyTracer->stamp(SMPLatencyTracer::TRACK_VIDEO, pts, SMPLatencyTracer::STAGE_PRESENTED, timeMs * 1000);
     }
 
     if (!mPlayer.mSeekFlag) {
@@ -551,6 +649,13 @@ void SMPMessageControllerListener::ProcessVideoRenderedMsg(int64_t pts, int64_t
 
     if ((INT64_MIN != mPlayer.mVideoChangedFirstPts) && (pts >= mPlayer.mVideoChangedFirstPts)) {
         AF_LOGD("video stream changed");
+
+        if (mPlayer.mSwitchStartTime != INT64_MIN) {
+            mPlayer.mSwitchLatency = af_getsteady_ms() - mPlayer.mSwitchStartTime;
+            mPlayer.mSwitchStartTime = INT64_MIN;
+            AF_LOGI("video stream switch latency %lld ms", mPlayer.mSwitchLatency);
+        }
+
         StreamInfo *info = mPlayer.GetCurrentStreamInfo(ST_TYPE_VIDEO);
         mPlayer.mPNotifier->NotifyStreamChanged(info, ST_TYPE_VIDEO);
         mPlayer.mVideoChangedFirstPts = INT64_MIN;
@@ -588,6 +693,8 @@ void SMPMessageControllerListener::ProcessVideoHoldMsg(bool hold)
 {
     if (mPlayer.mAVDeviceManager->getDecoder(SMPAVDeviceManager::DEVICE_TYPE_VIDEO)) {
         mPlayer.mAVDeviceManager->getDecoder(SMPAVDeviceManager::DEVICE_TYPE_VIDEO)->holdOn(hold);
+        // give the cores to the other players' decoders
+        mPlayer.mAVDeviceManager->getDecoder(SMPAVDeviceManager::DEVICE_TYPE_VIDEO)->enterBackground(hold);
 
         if (!hold) {
             int size = mPlayer.mAVDeviceManager->getDecoder(SMPAVDeviceManager::DEVICE_TYPE_VIDEO)->getRecoverQueueSize();
@@ -601,6 +708,13 @@ void SMPMessageControllerListener::ProcessVideoHoldMsg(bool hold)
 }
 
 void SMPMessageControllerListener::ProcessSetSpeed(float speed)
+{
+    mPlayer.mUserRate = speed;
+    mPlayer.StopLiveLatencyControl();
+    ChangeSpeed(speed);
+}
+
+void SMPMessageControllerListener::ChangeSpeed(float speed)
 {
     if (!CicadaUtils::isEqual(mPlayer.mSet->rate, speed)) {
         mPlayer.mAVDeviceManager->setSpeed(speed);
@@ -677,10 +791,19 @@ void SMPMessageControllerListener::switchVideoStream(int index, Stream_type type
     mPlayer.mWillChangedVideoStreamIndex = index;
     mPlayer.mVideoChangedFirstPts = INT64_MAX;
 
+    if (mPlayer.mSwitchStartTime == INT64_MIN) {
+        mPlayer.mSwitchStartTime = af_getsteady_ms();
+    }
+
     if (willChangeInfo->videoBandwidth < currentInfo->videoBandwidth) {
         mPlayer.mDemuxerService->SwitchStreamAligned(currentId, index);
     } else {
         mPlayer.mMixMode = (type == STREAM_TYPE_MIXED);
+
+        if (mPlayer.mFastAbrSwitch && mPlayer.mDuration > 0 && mPlayer.FastSwitchVideo()) {
+            return;
+        }
+
         int videoCount = 0;
         int64_t startTime = mPlayer.mBufferController->FindSeamlessPointTimePosition(BUFFER_TYPE_VIDEO, videoCount);
 
@@ -17,10 +17,15 @@ namespace Cicada {
     public:
         void ProcessSetViewMsg(void *view) final;
         void ProcessSetSpeed(float speed) final;
+        // the rate used by the player itself, the rate set by the user is not changed
+        void ChangeSpeed(float speed);
         void ProcessVideoRenderedMsg(int64_t pts, int64_t timeMs, bool rendered, void *picUserData) final;
         void ProcessSeekToMsg(int64_t seekPos, bool bAccurate) final;
         void ProcessMuteMsg() final;
         void ProcessVideoHoldMsg(bool hold) final;
+        void ProcessScrubEnterMsg() final;
+        void ProcessScrubUpdateMsg(int64_t pos) final;
+        void ProcessScrubExitMsg(bool bAccurate) final;
 
     private:
         bool OnPlayerMsgIsPadding(PlayMsgType msg, MsgParam msgContent) final;
@@ -8,6 +8,7 @@
 #include <cassert>
 #include <cinttypes>
 #include <codec/avcodecDecoder.h>
+#include <codec/FrameBufferPool.h>
 #include <codec/decoderFactory.h>
 #include <data_source/dataSourcePrototype.h>
 #include <demuxer/IDemuxer.h>
@@ -16,6 +17,7 @@
 #include <utils/af_string.h>
 #include <utils/err.h>
 #include <utils/errors/framework_error.h>
+#include <utils/MetaCache.h>
 #include <utils/ffmpeg_utils.h>
 #include <utils/file/FileUtils.h>
 #include <utils/frame_work_log.h>
@@ -34,6 +36,11 @@
 
 #define PTS_DISCONTINUE_DELTA (20 * 1000 * 1000)
 #define VIDEO_PICTURE_MAX_CACHE_SIZE 2
+// the buffer kept before the splice point for downloading the new rendition in fast abr switch
+#define FAST_SWITCH_MIN_LEAD (2 * 1000 * 1000)
+// the media duration read in a batch, the buffer limits are checked once per batch
+#define READ_BATCH_DURATION (100 * 1000)
+#define MAX_READ_BATCH 32
 
 static int MAX_DECODE_ERROR_FRAME = 1000;
 
@@ -70,10 +77,14 @@ SuperMediaPlayer::SuperMediaPlayer()
         return  mDrmManager->require(info);
     });
     mRecorderSet = static_cast<unique_ptr<SMPRecorderSet>>(new SMPRecorderSet());
+    mLatencyTracer = static_cast<unique_ptr<SMPLatencyTracer>>(new SMPLatencyTracer());
+    mLiveLatencyController = static_cast<unique_ptr<SMPLiveLatencyController>>(new SMPLiveLatencyController());
+    mSnapshot = static_cast<unique_ptr<VideoSnapshot>>(new VideoSnapshot());
 
     mPNotifier = new PlayerNotifier();
     Reset();
     mTimerInterval = 500;
+    MemoryGovernor::Instance()->addClient(this);
 }
 
 SuperMediaPlayer::~SuperMediaPlayer()
@@ -88,6 +99,9 @@ SuperMediaPlayer::~SuperMediaPlayer()
     mApsaraThread->stop();
     mSubPlayer = nullptr;
     mSubListener = nullptr;
+    // the pending snapshots are notified when deleting
+    mSnapshot = nullptr;
+    MemoryGovernor::Instance()->removeClient(this);
     // delete mPNotifier after mPMainThread, to avoid be using
     delete mPNotifier;
     mPNotifier = nullptr;
@@ -154,6 +168,21 @@ void SuperMediaPlayer::CaptureScreen()
                 this->mPNotifier->NotifyCaptureScreen(data, width, height);
             }
         });
+    } else if (mSnapshot->hasFrame()) {
+        // no render, capture the last frame by the snapshot pipeline
+        int ret = mSnapshot->request(0, 0, VideoSnapshot::FormatRGBA, [this](VideoSnapshot::Result &result) {
+            if (result.error < 0) {
+                this->mPNotifier->NotifyCaptureScreen(nullptr, 0, 0);
+            } else {
+                this->mPNotifier->NotifyCaptureScreen(result.data, result.width, result.height);
+            }
+
+            free(result.data);
+        });
+
+        if (ret < 0) {
+            this->mPNotifier->NotifyCaptureScreen(nullptr, 0, 0);
+        }
     } else {
         if (this->mPNotifier) {
             this->mPNotifier->NotifyCaptureScreen(nullptr, 0, 0);
@@ -161,6 +190,22 @@ void SuperMediaPlayer::CaptureScreen()
     }
 }
 
+int SuperMediaPlayer::Snapshot(int width, int height, SnapshotFormat format)
+{
+    // SnapshotFormat is in the order of VideoSnapshot::Format
+    return mSnapshot->request(width, height, static_cast<VideoSnapshot::Format>(format), [this](VideoSnapshot::Result &result) {
+        auto *snapshot = new SnapshotResult();
+        snapshot->format = static_cast<SnapshotFormat>(result.format);
+        snapshot->width = result.width;
+        snapshot->height = result.height;
+        snapshot->data = result.data;
+        snapshot->size = result.size;
+        snapshot->pts = result.pts;
+        snapshot->latency = result.latency;
+        this->mPNotifier->NotifySnapshot(result.error, snapshot);
+    });
+}
+
 void SuperMediaPlayer::SetVolume(float volume)
 {
     //TODO:put message to
@@ -205,6 +250,34 @@ void SuperMediaPlayer::SeekTo(int64_t pos, bool bAccurate)
     mSeekPos = pos * 1000;
     mSeekNeedCatch = bAccurate;
 }
+int SuperMediaPlayer::EnterScrub()
+{
+    this->putMsg(MSG_SCRUB_ENTER, dummyMsg);
+    return 0;
+}
+
+int SuperMediaPlayer::UpdateScrub(int64_t pos)
+{
+    MsgParam param;
+    MsgSeekParam seekParam;
+    seekParam.seekPos = pos * 1000;
+    seekParam.bAccurate = false;
+    param.seekParam = seekParam;
+    this->putMsg(MSG_SCRUB_UPDATE, param);
+    return 0;
+}
+
+int SuperMediaPlayer::ExitScrub(bool bAccurate)
+{
+    MsgParam param;
+    MsgSeekParam seekParam;
+    seekParam.seekPos = INT64_MIN;
+    seekParam.bAccurate = bAccurate;
+    param.seekParam = seekParam;
+    this->putMsg(MSG_SCRUB_EXIT, param);
+    return 0;
+}
+
 void SuperMediaPlayer::Mute(bool bMute)
 {
     if (bMute == mSet->bMute) {
@@ -322,6 +395,19 @@ int SuperMediaPlayer::Stop()
     Interrupt(true);
     mPlayerCondition.notify_one();
     mApsaraThread->pause();
+
+    if (mScrubEngine) {
+        mScrubEngine->stop();
+        mScrubEngine = nullptr;
+    }
+
+    {
+        // the chunks are removed with the recorder
+        std::lock_guard<std::mutex> uMutex(mCreateMutex);
+        mTimeShiftReader = nullptr;
+        mTimeShiftRecorder = nullptr;
+    }
+
     mAVDeviceManager->invalidDevices(SMPAVDeviceManager::DEVICE_TYPE_AUDIO | SMPAVDeviceManager::DEVICE_TYPE_VIDEO);
     mPlayStatus = PLAYER_STOPPED;
     //        ChangePlayerStatus(PLAYER_STOPPED);
@@ -410,6 +496,10 @@ int SuperMediaPlayer::Stop()
     Reset();
 
     mRecorderSet->reset();
+    mLatencyTracer->reset();
+    StopLiveLatencyControl();
+    mLiveLatencyController->reset();
+    mLiveDurationsUpdateTime = INT64_MIN;
     mDrmManager->clearErrorItems();
 
     AF_LOGD("stop spend time is %lld", af_getsteady_ms() - t1);
@@ -502,6 +592,10 @@ int SuperMediaPlayer::SetOption(const char *key, const char *value)
         if (duration > 0) {
             mSet->maxBufferDuration = int64_t(duration) * 1000;
         }
+    } else if (theKey == "maxBufferBytes") {
+        mSet->maxBufferBytes = atoll(value);
+    } else if (theKey == "highLevelBufferBytes") {
+        mSet->highLevelBufferBytes = atoll(value);
     } else if (theKey == "DisableBufferManager") {
         mSet->bDisableBufferManager = (bool) atoi(value);
     } else if (theKey == "LowLatency") {
@@ -570,6 +664,18 @@ int SuperMediaPlayer::SetOption(const char *key, const char *value)
         }
     } else if (theKey == "networkRetryCount") {
         mSet->netWorkRetryCount = (int) atol(value);
+    } else if (theKey == "enableLatencyTrace") {
+        mLatencyTracer->enable(atoi(value) != 0);
+    } else if (theKey == "liveLatencyControl") {
+        mLiveLatencyController->setEnable(atoi(value) != 0);
+    } else if (theKey == "liveTargetLatency") {
+        mLiveLatencyController->setTargetLatency(int64_t(atoi(value)) * 1000);
+    } else if (theKey == "fastAbrSwitch") {
+        mFastAbrSwitch = atoi(value) != 0;
+    } else if (theKey == "timeShiftDir") {
+        mTimeShiftDir = value;
+    } else if (theKey == "timeShiftWindow") {
+        mTimeShiftWindow = int64_t(atoi(value)) * 1000;
     }
 
     return 0;
@@ -585,6 +691,8 @@ void SuperMediaPlayer::GetOption(const char *key, char *value)
 
     if (theKey == "maxBufferDuration") {
         snprintf(value, MAX_OPT_VALUE_LENGTH, "%" PRId64 "", mSet->maxBufferDuration);
+    } else if (theKey == "maxBufferBytes") {
+        snprintf(value, MAX_OPT_VALUE_LENGTH, "%" PRId64 "", mSet->maxBufferBytes);
     } else if (theKey == "mediaStreamSize") {
         int64_t size = -1;
         std::unique_lock<std::mutex> uMutex(mCreateMutex);
@@ -772,9 +880,24 @@ int64_t SuperMediaPlayer::GetPropertyInt(PropertyKey key)
         case PROPERTY_KEY_REMAIN_LIVE_SEG:
             return mRemainLiveSegment;
 
+        case PROPERTY_KEY_BUFFER_BYTES:
+            return mBufferController->GetPacketBytes(BUFFER_TYPE_ALL);
+
         case PROPERTY_KEY_NETWORK_IS_CONNECTED:
             return mSourceListener->isConnected();
 
+        case PROPERTY_KEY_LIVE_LATENCY:
+            return mLiveLatencyController->getCurrentLatency();
+
+        case PROPERTY_KEY_LIVE_TARGET_LATENCY:
+            return mLiveLatencyController->getTargetLatency();
+
+        case PROPERTY_KEY_ABR_SWITCH_LATENCY:
+            return mSwitchLatency;
+
+        case PROPERTY_KEY_MEMORY_USAGE:
+            return MemoryGovernor::Instance()->getUsage(this);
+
         default:
             break;
     }
@@ -856,6 +979,8 @@ std::string SuperMediaPlayer::GetPropertyString(PropertyKey key)
             item.addValue("startBufferDuration" , (int)mSet->startBufferDuration);
             item.addValue("highLevelBufferDuration" , (int)mSet->highLevelBufferDuration);
             item.addValue("maxBufferDuration" , (int)mSet->maxBufferDuration);
+            item.addValue("highLevelBufferBytes" , (double)mSet->highLevelBufferBytes);
+            item.addValue("maxBufferBytes" , (double)mSet->maxBufferBytes);
             return item.printJSON();
         }
         case PROPERTY_KEY_DECODE_INFO: {
@@ -898,6 +1023,71 @@ std::string SuperMediaPlayer::GetPropertyString(PropertyKey key)
             return "";
         }
 
+        case PROPERTY_KEY_LATENCY_TRACE:
+            return mLatencyTracer->dumpHistograms();
+
+        case PROPERTY_KEY_LATENCY_CHROME_TRACE:
+            return mLatencyTracer->dumpChromeTrace();
+
+        case PROPERTY_KEY_STARTUP_TIMELINE: {
+            CicadaJSONArray array;
+            int64_t prepareStartMS = mPrepareStartTime / 1000;
+
+            if (mFirstReadPacketSucMS > 0) {
+                CicadaJSONItem item;
+                item.addValue("name", "firstPacket");
+                item.addValue("start", (double) prepareStartMS);
+                item.addValue("end", (double) mFirstReadPacketSucMS);
+                array.addJSON(item);
+            }
+
+            if (mFirstRenderedMS > 0) {
+                CicadaJSONItem item;
+                item.addValue("name", "firstFrame");
+                item.addValue("start", (double) prepareStartMS);
+                item.addValue("end", (double) mFirstRenderedMS);
+                array.addJSON(item);
+            }
+
+            std::lock_guard<std::mutex> uMutex(mCreateMutex);
+
+            if (mDemuxerService && mDemuxerService->isPlayList()) {
+                MediaPlayerUtil::getPropertyJSONStr("startupTimeline", array, true, mStreamInfoQueue, mDemuxerService.get());
+            }
+
+            return array.printJSON();
+        }
+
+        case PROPERTY_KEY_MEMORY_USAGE: {
+            CicadaJSONItem usage(MemoryGovernor::Instance()->dumpUsage());
+            // the decoded frames of all the players, in the decoders and renders
+            usage.addValue("framePool", (double) FrameBufferPool::getTotalBytes());
+            usage.addValue("framePoolPeak", (double) FrameBufferPool::getTotalPeakBytes());
+            return usage.printJSON();
+        }
+
+        case PROPERTY_KEY_EVENT_STATS:
+            return mPNotifier->dumpStats();
+
+        case PROPERTY_KEY_TIME_SHIFT: {
+            CicadaJSONItem item;
+            std::lock_guard<std::mutex> uMutex(mCreateMutex);
+            int64_t startPts;
+            int64_t endPts;
+
+            if (mTimeShiftRecorder && mTimeShiftRecorder->getPtsOffset() != INT64_MIN && mTimeShiftRecorder->getRange(startPts, endPts)) {
+                int64_t offset = mTimeShiftRecorder->getPtsOffset();
+                item.addValue("start", (double) ((startPts - offset) / 1000));
+                item.addValue("end", (double) ((endPts - offset) / 1000));
+            }
+
+            item.addValue("shifted", mTimeShiftReader != nullptr);
+            return item.printJSON();
+        }
+
+        case PROPERTY_KEY_META_CACHE:
+            return MetaCache::Instance()->dumpStats();
+
         default:
             break;
     }
@@ -905,6 +1095,61 @@ std::string SuperMediaPlayer::GetPropertyString(PropertyKey key)
     return "";
 }
 
+static int64_t getFrameBytes(IAFFrame *frame)
+{
+    if (frame == nullptr || frame->getData() == nullptr || frame->getLineSize() == nullptr) {
+        return 0;
+    }
+
+    uint8_t **data = frame->getData();
+    int *lineSize = frame->getLineSize();
+    int64_t bytes = 0;
+
+    // the planes after the first one of a yuv frame are chroma planes, assume 4:2:0
+    for (int i = 0; i < 8 && data[i]; i++) {
+        if (frame->getType() == IAFFrame::FrameTypeVideo) {
+            int height = frame->getInfo().video.height;
+            bytes += (int64_t) lineSize[i] * (i == 0 ? height : (height + 1) / 2);
+        } else {
+            bytes += lineSize[i];
+        }
+    }
+
+    return bytes;
+}
+
+void SuperMediaPlayer::updateMemoryUsage()
+{
+    MemoryGovernor *governor = MemoryGovernor::Instance();
+    governor->setUsage(this, MemoryGovernor::ComponentPacket, mBufferController->GetPacketBytes(BUFFER_TYPE_ALL));
+
+    // the frames of a queue are the same size mostly
+    int64_t frameBytes = 0;
+
+    if (!mVideoFrameQue.empty()) {
+        frameBytes += getFrameBytes(mVideoFrameQue.front().get()) * (int64_t) mVideoFrameQue.size();
+    }
+
+    if (!mAudioFrameQue.empty()) {
+        frameBytes += getFrameBytes(mAudioFrameQue.front().get()) * (int64_t) mAudioFrameQue.size();
+    }
+
+    governor->setUsage(this, MemoryGovernor::ComponentFrame, frameBytes);
+
+    MemoryGovernor::Priority priority = MemoryGovernor::PriorityForeground;
+
+    if (mAppStatus == APP_BACKGROUND) {
+        priority = MemoryGovernor::PriorityBackground;
+    } else if (mPlayStatus == PLAYER_PAUSED) {
+        priority = MemoryGovernor::PriorityPaused;
+    }
+
+    if (priority != mMemoryPriority) {
+        mMemoryPriority = priority;
+        governor->setPriority(this, priority);
+    }
+}
+
 int SuperMediaPlayer::getCurrentStreamMeta(Stream_meta *meta, StreamType type)
 {
     int streamIndex = -1;
@@ -1131,6 +1376,20 @@ void SuperMediaPlayer::ProcessVideoLoop()
 
         return;
     }
+
+    if (mScrubbing) {
+        // keep buffering for the play after scrub, the decoders and renders are held as they are
+        doReadPacket();
+        RenderScrubFrame();
+
+        if (curTime - mTimerLatestTime > mTimerInterval) {
+            OnTimer(curTime);
+            mTimerLatestTime = curTime;
+        }
+
+        return;
+    }
+
     doReadPacket();
     doDeCode();
 
@@ -1175,9 +1434,22 @@ void SuperMediaPlayer::doReadPacket()
             timeout = 5000;
         }
 
-        mem_info info{};
+        MemoryGovernor *governor = MemoryGovernor::Instance();
         int checkStep = 0;
 
+        int64_t cur_buffer_bytes = mBufferController->GetPacketBytes(BUFFER_TYPE_ALL);
+
+        if (mTimeShiftRecorder) {
+            // the live edge goes on recording when the player is paused on a full buffer, play from the disk after resume
+            if (mTimeShiftReader == nullptr && mPlayStatus == PLAYER_PAUSED && mBufferIsFull) {
+                StartTimeShift(INT64_MIN);
+            }
+
+            if (mTimeShiftReader) {
+                ReadTimeShiftLive();
+            }
+        }
+
         while (true) {
             // once buffer is full, we will try to read again if buffer consume more then BufferGap
             if (mBufferIsFull) {
@@ -1187,25 +1459,46 @@ void SuperMediaPlayer::doReadPacket()
                     getPlayerBufferDuration(false, true) > 0) {
                     break;
                 }
+
+                // and if the bytes consumed more then 1/10 of maxBufferBytes
+                if (mBufferBytesFull && (mSet->maxBufferBytes > 0) && (cur_buffer_bytes > mSet->maxBufferBytes - mSet->maxBufferBytes / 10) &&
+                    getPlayerBufferDuration(false, true) > 0) {
+                    break;
+                }
             }
 
             if (cur_buffer_duration > mSet->maxBufferDuration &&
                 getPlayerBufferDuration(false, true) > 0// we need readout the buffer in demuxer when no buffer in player
             ) {
                 mBufferIsFull = true;
+                mBufferBytesFull = false;
+                break;
+            }
+
+            // a high bitrate stream reaches the bytes limit before the duration limit
+            if (mSet->maxBufferBytes > 0 && cur_buffer_bytes >= mSet->maxBufferBytes && getPlayerBufferDuration(false, true) > 0) {
+                mBufferIsFull = true;
+                mBufferBytesFull = true;
                 break;
             }
 
             mBufferIsFull = false;
+            mBufferBytesFull = false;
 
-            if ((0 >= checkStep--) && (cur_buffer_duration > 1000 * 1000) && (AFGetSystemMemInfo(&info) >= 0)) {
-                //AF_LOGD("system_availableram is %" PRIu64 "",info.system_availableram);
-                if (info.system_availableram > 2 * mSet->lowMemSize) {
-                    checkStep = (int) (info.system_availableram / (5 * 1024 * 1024));
+            if ((0 >= checkStep--) && (cur_buffer_duration > 1000 * 1000)) {
+                checkStep = 5;
+                updateMemoryUsage();
+
+                if (governor->getUsage(this) > governor->getAllowance(this)) {
+                    AF_LOGD("over memory allowance, stop buffering");
+                    mBufferIsFull = true;
+                    mBufferBytesFull = true;
+                    break;
+                }
 #ifdef ANDROID
-                } else if (0 && info.system_availableram < mSet->lowMemSize) {
+                if (0 && governor->isLowMemory(mSet->lowMemSize)) {
 #else
-                } else if (info.system_availableram < mSet->lowMemSize) {
+                if (governor->isLowMemory(mSet->lowMemSize)) {
 #endif
                    AF_LOGW("low memory...");
 
@@ -1225,12 +1518,12 @@ void SuperMediaPlayer::doReadPacket()
 
                     break;
                 } else {
-                    checkStep = 5;
                     mLowMem = false;
                 }
             }
 
-            int ret = ReadPacket();
+            int count = GetReadBatchSize(cur_buffer_duration, cur_buffer_bytes);
+            int ret = ReadPackets(count);
 
             if (ret == -EAGAIN) {
                 if (0 == mDuration) {
@@ -1282,6 +1575,7 @@ void SuperMediaPlayer::doReadPacket()
             }
 
             cur_buffer_duration = getPlayerBufferDuration(false, false);
+            cur_buffer_bytes = mBufferController->GetPacketBytes(BUFFER_TYPE_ALL);
             //                if(getPlayerBufferDuration(true) > mSet->maxBufferDuration * 2){
             //                    AF_LOGE("buffer stuffed\n");
             //                    mPNotifier->NotifyError(MEDIA_PLAYER_ERROR_BUFFER_STUFFED,"buffer stuffed");
@@ -1291,6 +1585,40 @@ void SuperMediaPlayer::doReadPacket()
     }
 }
 
+int SuperMediaPlayer::GetReadBatchSize(int64_t bufferDuration, int64_t bufferBytes)
+{
+    // packets per us of the buffered video and audio
+    double rate = 0;
+    int packets = 0;
+
+    for (BUFFER_TYPE type : {BUFFER_TYPE_VIDEO, BUFFER_TYPE_AUDIO}) {
+        int size = mBufferController->GetPacketSize(type);
+        int64_t duration = mBufferController->GetPacketDuration(type);
+
+        if (size > 0 && duration > 0) {
+            rate += (double) size / duration;
+        }
+
+        packets += size;
+    }
+
+    // read one by one until the rate is known
+    if (rate <= 0) {
+        return 1;
+    }
+
+    // not reading much over the buffer limits
+    int64_t duration = std::min((int64_t) READ_BATCH_DURATION, mSet->maxBufferDuration - bufferDuration);
+    auto batch = (int64_t) (rate * duration);
+
+    if (mSet->maxBufferBytes > 0 && bufferBytes > 0 && packets > 0) {
+        // a high bitrate stream reaches the bytes limit first
+        batch = std::min(batch, (mSet->maxBufferBytes - bufferBytes) * packets / bufferBytes);
+    }
+
+    return (int) std::max((int64_t) 1, std::min(batch, (int64_t) MAX_READ_BATCH));
+}
+
 void SuperMediaPlayer::OnDemuxerCallback(const std::string &key, const std::string &value)
 {}
 
@@ -1402,17 +1730,30 @@ bool SuperMediaPlayer::DoCheckBufferPass()
         mTimeoutStartTime = INT64_MIN;
         mMasterClock.pause();
         mAVDeviceManager->pauseAudioRender(true);
+        StopLiveLatencyControl();
         return false;
     }
 
     //AF_LOGD("current duration is %lld,video duration is %lld,audio duration is %lld", cur_buffer_duration
     //	,mBufferController->GetPacketDuration(BUFFER_TYPE_VIDEO), mBufferController->GetPacketDuration(BUFFER_TYPE_AUDIO));
     bool isRealTime = false;
-    if (mDemuxerService != nullptr) {
+    // the time shifted play is behind the live edge by intent
+    if (mDemuxerService != nullptr && mTimeShiftReader == nullptr) {
         isRealTime = mDemuxerService->isRealTimeStream(mCurrentVideoIndex);
     }
 
-    while (isRealTime && mSet->RTMaxDelayTime > 0) {
+    // live stream latency controlled by playback rate, instead of drop and catch up
+    bool latencyControlled = mLiveLatencyController->isEnabled() && mDuration == 0 && mDemuxerService != nullptr && mTimeShiftReader == nullptr &&
+                             mDemuxerService->isPlayList() && mPlayStatus == PLAYER_PLAYING && !mBufferingFlag;
+
+    if (latencyControlled) {
+        ControlLiveLatency();
+    } else {
+        // buffering, paused, disabled or time shifted
+        StopLiveLatencyControl();
+    }
+
+    while (!latencyControlled && isRealTime && mSet->RTMaxDelayTime > 0) {
         if (!HAVE_AUDIO) {
             int64_t maxBufferDuration = getPlayerBufferDuration(true, false);
 
@@ -1430,40 +1771,7 @@ bool SuperMediaPlayer::DoCheckBufferPass()
 
         if (maxBufferDuration > mSet->RTMaxDelayTime + 1000 * 1000 * 5) {
             //drop frame
-            int64_t lastVideoPos = mBufferController->GetPacketLastTimePos(BUFFER_TYPE_VIDEO);
-            int64_t lastAudioPos = mBufferController->GetPacketLastTimePos(BUFFER_TYPE_AUDIO);
-            int64_t lastAudioPts = mBufferController->GetPacketLastPTS(BUFFER_TYPE_AUDIO);
-            int64_t lastPos;
-
-            if (lastVideoPos == INT64_MIN) {
-                lastPos = lastAudioPos;
-            } else if (lastAudioPos == INT64_MIN) {
-                lastPos = lastVideoPos;
-            } else {
-                lastPos = lastAudioPos < lastVideoPos ? lastAudioPos : lastVideoPos;
-            }
-
-            lastPos -= min(mSet->RTMaxDelayTime, 500 * 1000);
-            int64_t lastVideoKeyTimePos = mBufferController->GetKeyTimePositionBefore(BUFFER_TYPE_VIDEO, lastPos);
-            if (lastVideoKeyTimePos != INT64_MIN) {
-                AF_LOGD("drop left lastPts %lld, lastVideoKeyPts %lld", lastPos, lastVideoKeyTimePos);
-                mMsgCtrlListener->ProcessSetSpeed(1.0);
-                int64_t dropVideoCount = mBufferController->ClearPacketBeforeTimePos(BUFFER_TYPE_VIDEO, lastVideoKeyTimePos);
-                int64_t dropAudioCount = mBufferController->ClearPacketBeforeTimePos(BUFFER_TYPE_AUDIO, lastVideoKeyTimePos);
-
-                if (dropVideoCount > 0) {
-                    FlushVideoPath();
-                    AF_LOGD("drop left video duration is %lld,left video size is %d",
-                            mBufferController->GetPacketDuration(BUFFER_TYPE_VIDEO), mBufferController->GetPacketSize(BUFFER_TYPE_VIDEO));
-                }
-
-                if (dropAudioCount > 0) {
-                    FlushAudioPath();
-                    AF_LOGD("drop left aduio duration is %lld,left aduio size is %d",
-                            mBufferController->GetPacketDuration(BUFFER_TYPE_AUDIO), mBufferController->GetPacketSize(BUFFER_TYPE_AUDIO));
-                    mMasterClock.setTime(lastAudioPts);
-                }
-            }
+            LiveDropBuffer(min(mSet->RTMaxDelayTime, 500 * 1000));
         }
 
         int64_t lastAudio = mBufferController->GetPacketLastPTS(BUFFER_TYPE_AUDIO);
@@ -1485,7 +1793,12 @@ bool SuperMediaPlayer::DoCheckBufferPass()
 
     //check buffering status
     if ((mBufferingFlag || mFirstBufferFlag) && !mSet->bDisableBufferManager) {
-        if (((cur_buffer_duration > HighBufferDur || (HighBufferDur >= mSet->maxBufferDuration && mBufferIsFull)) &&
+        // the buffer is enough when either the duration or the bytes reach the high level
+        bool highLevelBytesReached =
+                mSet->highLevelBufferBytes > 0 && mBufferController->GetPacketBytes(BUFFER_TYPE_ALL) >= mSet->highLevelBufferBytes;
+
+        if (((cur_buffer_duration > HighBufferDur || highLevelBytesReached ||
+              (mBufferIsFull && (HighBufferDur >= mSet->maxBufferDuration || mBufferBytesFull))) &&
              (!HAVE_VIDEO || videoDecoderFull || APP_BACKGROUND == mAppStatus)) ||
             mEof) {
             // if still in seek, wait for seek status be changed.
@@ -1548,10 +1861,116 @@ void SuperMediaPlayer::LiveCatchUp(int64_t delayTime)
     }
 
     if ((delayTime > mSet->RTMaxDelayTime) && (150 * 1000 < delayTime)) {
-        mMsgCtrlListener->ProcessSetSpeed(1.2);
+        mMsgCtrlListener->ChangeSpeed(1.2);
     } else if ((delayTime < mSet->RTMaxDelayTime - recoverGap) || (100 * 1000 > delayTime)) {
-        mMsgCtrlListener->ProcessSetSpeed(1.0);
+        mMsgCtrlListener->ChangeSpeed(1.0);
+    }
+}
+
+void SuperMediaPlayer::LiveDropBuffer(int64_t keepDuration)
+{
+    int64_t lastVideoPos = mBufferController->GetPacketLastTimePos(BUFFER_TYPE_VIDEO);
+    int64_t lastAudioPos = mBufferController->GetPacketLastTimePos(BUFFER_TYPE_AUDIO);
+    int64_t lastAudioPts = mBufferController->GetPacketLastPTS(BUFFER_TYPE_AUDIO);
+    int64_t lastPos;
+
+    if (lastVideoPos == INT64_MIN) {
+        lastPos = lastAudioPos;
+    } else if (lastAudioPos == INT64_MIN) {
+        lastPos = lastVideoPos;
+    } else {
+        lastPos = lastAudioPos < lastVideoPos ? lastAudioPos : lastVideoPos;
+    }
+
+    lastPos -= keepDuration;
+    int64_t lastVideoKeyTimePos = mBufferController->GetKeyTimePositionBefore(BUFFER_TYPE_VIDEO, lastPos);
+    if (lastVideoKeyTimePos != INT64_MIN) {
+        AF_LOGD("drop left lastPts %lld, lastVideoKeyPts %lld", lastPos, lastVideoKeyTimePos);
+        mMsgCtrlListener->ChangeSpeed(1.0);
+        int64_t dropVideoCount = mBufferController->ClearPacketBeforeTimePos(BUFFER_TYPE_VIDEO, lastVideoKeyTimePos);
+        int64_t dropAudioCount = mBufferController->ClearPacketBeforeTimePos(BUFFER_TYPE_AUDIO, lastVideoKeyTimePos);
+
+        if (dropVideoCount > 0) {
+            FlushVideoPath();
+            AF_LOGD("drop left video duration is %lld,left video size is %d",
+                    mBufferController->GetPacketDuration(BUFFER_TYPE_VIDEO), mBufferController->GetPacketSize(BUFFER_TYPE_VIDEO));
+        }
+
+        if (dropAudioCount > 0) {
+            FlushAudioPath();
+            AF_LOGD("drop left aduio duration is %lld,left aduio size is %d",
+                    mBufferController->GetPacketDuration(BUFFER_TYPE_AUDIO), mBufferController->GetPacketSize(BUFFER_TYPE_AUDIO));
+            mMasterClock.setTime(lastAudioPts);
+        }
+    }
+}
+
+void SuperMediaPlayer::ControlLiveLatency()
+{
+    // a rate set by the user is not overridden
+    if (!CicadaUtils::isEqual(mUserRate, 1.0f)) {
+        StopLiveLatencyControl();
+        return;
+    }
+
+    int64_t now = af_gettime_relative();
+
+    // the durations may be changed by playlist reloading
+    if (mLiveDurationsUpdateTime == INT64_MIN || now - mLiveDurationsUpdateTime > 1000 * 1000) {
+        int index = HAVE_VIDEO ? mCurrentVideoIndex : mCurrentAudioIndex;
+
+        if (mMixMode) {
+            index = mMainStreamId;
+        }
+
+        int64_t targetDuration = atoll(mDemuxerService->GetProperty(index, "targetDuration").c_str());
+        int64_t partTargetDuration = atoll(mDemuxerService->GetProperty(index, "partTargetDuration").c_str());
+        mLiveLatencyController->setStreamDurations(targetDuration, partTargetDuration);
+        mLiveDurationsUpdateTime = now;
+    }
+
+    int64_t delayTime = INT64_MIN;
+    int64_t lastAudio = mBufferController->GetPacketLastPTS(BUFFER_TYPE_AUDIO);
+
+    // the data in decoder and render is counted in also
+    if (HAVE_AUDIO && lastAudio != INT64_MIN && mPlayedAudioPts != INT64_MIN) {
+        delayTime = lastAudio - mPlayedAudioPts;
+    } else {
+        delayTime = getPlayerBufferDuration(true, false);
+    }
+
+    float speed = mLiveLatencyController->update(delayTime, now);
+
+    if (speed < 0) {
+        StopLiveLatencyControl();
+        return;
+    }
+
+    if (speed > 0) {
+        mLatencyRateActive = true;
+        mMsgCtrlListener->ChangeSpeed(speed);
+    }
+
+    if (mLiveLatencyController->needDrop()) {
+        int64_t targetLatency = mLiveLatencyController->getTargetLatency();
+        AF_LOGW("live latency %lld is too large to catch up by speed, drop to %lld", mLiveLatencyController->getCurrentLatency(),
+                targetLatency);
+        LiveDropBuffer(targetLatency);
+        StopLiveLatencyControl();
+        mLiveLatencyController->reset();
+        mLiveDurationsUpdateTime = INT64_MIN;
+    }
+}
+
+void SuperMediaPlayer::StopLiveLatencyControl()
+{
+    if (!mLatencyRateActive) {
+        return;
     }
+
+    mLatencyRateActive = false;
+    mLiveLatencyController->resetSpeed();
+    mMsgCtrlListener->ChangeSpeed(mUserRate);
 }
 
 void SuperMediaPlayer::notifyPreparedCallback()
@@ -1876,6 +2295,7 @@ int SuperMediaPlayer::DecodeVideoPacket(unique_ptr<IAFPacket> &pVideoPacket)
             info.sendFirstPacketTimeMs = af_getsteady_ms();
         }
 
+        mLatencyTracer->stamp(SMPLatencyTracer::TRACK_VIDEO, pVideoPacket->getInfo().pts, SMPLatencyTracer::STAGE_DECODER_IN);
         ret = mAVDeviceManager->sendPacket(pVideoPacket, SMPAVDeviceManager::DEVICE_TYPE_VIDEO, 0);
         // don't need pop if need retry later
         if (!(ret & STATUS_RETRY_IN)) {
@@ -1932,6 +2352,7 @@ int SuperMediaPlayer::FillVideoFrame()
             info.waitFirstFrame = false;
         }
 
+        mLatencyTracer->stamp(SMPLatencyTracer::TRACK_VIDEO, pFrame->getInfo().pts, SMPLatencyTracer::STAGE_DECODER_OUT);
         mAVDeviceManager->getDecoder(SMPAVDeviceManager::DEVICE_TYPE_VIDEO)->clean_error();
 
         if (mSecretPlayBack) {
@@ -2050,6 +2471,10 @@ RENDER_RESULT SuperMediaPlayer::RenderAudio()
 
     render_ret = mAVDeviceManager->renderAudioFrame(mAudioFrameQue.front(), 0);
 
+    if (render_ret >= 0) {
+        mLatencyTracer->stamp(SMPLatencyTracer::TRACK_AUDIO, pts, SMPLatencyTracer::STAGE_RENDER_QUEUE);
+    }
+
     if (render_ret == IAudioRender::FORMAT_NOT_SUPPORT) {
         if (mAVDeviceManager->getAudioRenderQueDuration() == 0) {
             std::lock_guard<std::mutex> uMutex(mCreateMutex);
@@ -2362,9 +2787,9 @@ void SuperMediaPlayer::OnTimer(int64_t curTime)
     if (mPlayedAudioPts != INT64_MIN || mPlayedVideoPts != INT64_MIN) {
         /*
              * if have seek not completed,DO NOT update the position,it will lead process bar
-             * jumping
+             * jumping, so is the scrubbing
              */
-        if ((mPlayStatus == PLAYER_PLAYING) && !isSeeking()) {
+        if ((mPlayStatus == PLAYER_PLAYING) && !isSeeking() && !mScrubbing) {
             //AF_LOGD("TIMEPOS OnTimer :%lld", getCurrentPosition());
             NotifyPosition(getCurrentPosition());
         }
@@ -2375,6 +2800,12 @@ void SuperMediaPlayer::OnTimer(int64_t curTime)
 
 void SuperMediaPlayer::SendVideoFrameToRender(unique_ptr<IAFFrame> frame, bool valid)
 {
+    mLatencyTracer->stamp(SMPLatencyTracer::TRACK_VIDEO, frame->getInfo().pts, SMPLatencyTracer::STAGE_RENDER_QUEUE);
+
+    if (!mSecretPlayBack) {
+        mSnapshot->setFrame(frame.get());
+    }
+
     if (mFrameCb && (!mSecretPlayBack || mDrmKeyValid)) {
         bool rendered = mFrameCb(mFrameCbUserData, frame.get());
         if (rendered) {
@@ -2422,6 +2853,8 @@ int SuperMediaPlayer::DecodeAudio(unique_ptr<IAFPacket> &pPacket)
                 mBufferController->SetOnePacketDuration(BUFFER_TYPE_AUDIO, packetDuration);
             }
 
+            mLatencyTracer->stamp(SMPLatencyTracer::TRACK_AUDIO, frame->getInfo().pts, SMPLatencyTracer::STAGE_DECODER_OUT);
+
             if(mRecorderSet->decodeFirstAudioFrameInfo.waitFirstFrame) {
                 DecodeFirstFrameInfo &info = mRecorderSet->decodeFirstAudioFrameInfo;
                 info.getFirstFrameTimeMs = af_getsteady_ms();
@@ -2454,6 +2887,10 @@ int SuperMediaPlayer::DecodeAudio(unique_ptr<IAFPacket> &pPacket)
         info.sendFirstPacketTimeMs = af_getsteady_ms();
     }
 
+    if (pPacket) {
+        mLatencyTracer->stamp(SMPLatencyTracer::TRACK_AUDIO, pPacket->getInfo().pts, SMPLatencyTracer::STAGE_DECODER_IN);
+    }
+
     ret = mAVDeviceManager->sendPacket(pPacket, SMPAVDeviceManager::DEVICE_TYPE_AUDIO, 0);
 
     if (ret > 0) {
@@ -2590,11 +3027,8 @@ bool SuperMediaPlayer::NeedDrop(int64_t pts, int64_t refer)
     return (pts < refer) && (pts < mDuration - 200 * 1000);
 }
 
-int SuperMediaPlayer::ReadPacket()
+int SuperMediaPlayer::ReadPackets(int &count)
 {
-    IAFPacket *pFrame = nullptr;
-    std::unique_ptr<IAFPacket> pMedia_Frame{};
-
     if (mDemuxerService == nullptr) {
         assert(0);
     }
@@ -2609,9 +3043,27 @@ int SuperMediaPlayer::ReadPacket()
         }
     }
 
-    int ret = mDemuxerService->readPacket(pMedia_Frame, index);
+    int ret;
 
-    if (pMedia_Frame == nullptr) {
+    // the subtitle is read one by one, the read index is decided by the buffer of the subtitle
+    if (mTimeShiftReader || index != -1) {
+        count = 1;
+    }
+
+    if ((int) mReadBatch.size() < count) {
+        mReadBatch.resize(count);
+    }
+
+    if (mTimeShiftReader) {
+        ret = mTimeShiftReader->readPacket(mReadBatch[0]);
+        count = mReadBatch[0] ? 1 : 0;
+    } else {
+        ret = mDemuxerService->readPackets(mReadBatch.data(), count, index);
+    }
+
+    int64_t demuxOutTime = mLatencyTracer->isEnabled() ? af_gettime_relative() : INT64_MIN;
+
+    if (count == 0) {
         //  AF_LOGD("Can't read packet %d\n", ret);
         if (ret == 0) {
             mSubtitleEOS = true;
@@ -2624,6 +3076,38 @@ int SuperMediaPlayer::ReadPacket()
         return ret;
     }
 
+    mBatchReading = true;
+
+    for (int i = 0; i < count; i++) {
+        HandlePacket(move(mReadBatch[i]), demuxOutTime);
+    }
+
+    mBatchReading = false;
+    FlushBatchPackets();
+    return ret;
+}
+
+void SuperMediaPlayer::AddBufferPacket(unique_ptr<IAFPacket> packet, BUFFER_TYPE type)
+{
+    if (!mBatchReading) {
+        mBufferController->AddPacket(move(packet), type);
+    } else if (type == BUFFER_TYPE_VIDEO) {
+        mBatchVideoPackets.push_back(move(packet));
+    } else {
+        mBatchAudioPackets.push_back(move(packet));
+    }
+}
+
+void SuperMediaPlayer::FlushBatchPackets()
+{
+    mBufferController->AddPackets(mBatchVideoPackets, BUFFER_TYPE_VIDEO);
+    mBufferController->AddPackets(mBatchAudioPackets, BUFFER_TYPE_AUDIO);
+}
+
+void SuperMediaPlayer::HandlePacket(unique_ptr<IAFPacket> pMedia_Frame, int64_t demuxOutTime)
+{
+    IAFPacket *pFrame = nullptr;
+
     if (mPtsDiscontinueDelta == INT64_MIN) {
         int64_t maxGopTimeUs = mDemuxerService->getDemuxerHandle()->getMaxGopTimeUs();
         if (maxGopTimeUs > 0) {
@@ -2691,11 +3175,23 @@ int SuperMediaPlayer::ReadPacket()
         mMainStreamId = id;
     }
 
+    if (mFastSwitchPos != INT64_MIN) {
+        FlushBatchPackets();
+    }
+
+    if (mFastSwitchPos != INT64_MIN && !FastSwitchSplice(pFrame)) {
+        return;
+    }
+
     if (!mInited) {
         ProcessOpenStreamInit(pFrame->getInfo().streamIndex);
         mInited = true;
     }
 
+    if (mTimeShiftReader == nullptr) {
+        RecordTimeShift(pFrame);
+    }
+
     //        AF_LOGD("read packet pts is %lld,streamIndex is %d duration is %d\n", pFrame->getInfo().pts, pFrame->getInfo().streamIndex,
     //                pFrame->getInfo().duration);
 
@@ -2705,7 +3201,9 @@ int SuperMediaPlayer::ReadPacket()
             mMediaFrameCb(mMediaFrameCbArg, pMedia_Frame.get(), ST_TYPE_VIDEO);
         }
 
-        mBufferController->AddPacket(move(pMedia_Frame), BUFFER_TYPE_VIDEO);
+        mLatencyTracer->stamp(SMPLatencyTracer::TRACK_VIDEO, pFrame->getInfo().pts, SMPLatencyTracer::STAGE_DEMUX_OUT, demuxOutTime);
+        mLatencyTracer->stamp(SMPLatencyTracer::TRACK_VIDEO, pFrame->getInfo().pts, SMPLatencyTracer::STAGE_BUFFER_IN);
+        AddBufferPacket(move(pMedia_Frame), BUFFER_TYPE_VIDEO);
         mDemuxerService->SetOption("FRAME_RECEIVE", pFrame->getInfo().pts);
 
         if (mVideoInterlaced == InterlacedType_UNKNOWN) {
@@ -2779,7 +3277,7 @@ int SuperMediaPlayer::ReadPacket()
         }
 
         if (mSeekFlag && mSeekNeedCatch && NeedDrop(pFrame->getInfo().timePosition, mSeekPos)) {
-            return ret;
+            return;
         }
 
         if (pFrame->getInfo().streamIndex == mWillChangedAudioStreamIndex) {
@@ -2792,7 +3290,7 @@ int SuperMediaPlayer::ReadPacket()
             int64_t playedTime = mMasterClock.GetTime();
 
             if (pFrame->getInfo().pts < playedTime) {
-                return ret;
+                return;
             } else {
                 //recodr 64MAX for audio stream changed for first frame
                 mAudioChangedFirstPts = pFrame->getInfo().pts;
@@ -2803,7 +3301,9 @@ int SuperMediaPlayer::ReadPacket()
             mMediaFrameCb(mMediaFrameCbArg, pMedia_Frame.get(), ST_TYPE_AUDIO);
         }
 
-        mBufferController->AddPacket(move(pMedia_Frame), BUFFER_TYPE_AUDIO);
+        mLatencyTracer->stamp(SMPLatencyTracer::TRACK_AUDIO, pFrame->getInfo().pts, SMPLatencyTracer::STAGE_DEMUX_OUT, demuxOutTime);
+        mLatencyTracer->stamp(SMPLatencyTracer::TRACK_AUDIO, pFrame->getInfo().pts, SMPLatencyTracer::STAGE_BUFFER_IN);
+        AddBufferPacket(move(pMedia_Frame), BUFFER_TYPE_AUDIO);
     } else if (pFrame->getInfo().streamIndex == mCurrentSubtitleIndex || pFrame->getInfo().streamIndex == mWillChangedSubtitleStreamIndex) {
         if (mMediaFrameCb && (!pMedia_Frame->isProtected() || mDrmKeyValid)) {
             mMediaFrameCb(mMediaFrameCbArg, pMedia_Frame.get(), ST_TYPE_SUB);
@@ -2848,18 +3348,19 @@ int SuperMediaPlayer::ReadPacket()
     }
 
     if (mWillSwitchVideo) {
+        FlushBatchPackets();
         int videoCount = 0;
         int64_t startTime = mBufferController->FindSeamlessPointTimePosition(BUFFER_TYPE_VIDEO, videoCount);
 
         if (startTime == 0 || videoCount < 40) {
-            return ret;
+            return;
         }
 
         if (mMixMode) {
             int64_t startTimeA = mBufferController->FindSeamlessPointTimePosition(BUFFER_TYPE_AUDIO, videoCount);
 
             if (startTimeA == 0 || videoCount < 40) {
-                return ret;
+                return;
             }
 
             startTime = std::max(startTime, startTimeA);
@@ -2868,8 +3369,6 @@ int SuperMediaPlayer::ReadPacket()
         SwitchVideo(startTime);
         mWillSwitchVideo = false;
     }
-
-    return ret;
 }
 
 void SuperMediaPlayer::printTimePosition(int64_t time) const
@@ -2900,6 +3399,7 @@ void SuperMediaPlayer::FlushAudioPath()
     mAudioTime.deltaTime = 0;
     mAudioTime.deltaTimeTmp = 0;
     mAudioPacket = nullptr;
+    mLatencyTracer->flush(SMPLatencyTracer::TRACK_AUDIO);
 }
 
 void SuperMediaPlayer::FlushVideoPath()
@@ -2922,6 +3422,7 @@ void SuperMediaPlayer::FlushVideoPath()
     mVideoPacket = nullptr;
     dropLateVideoFrames = false;
     mVideoCatchingUp = false;
+    mLatencyTracer->flush(SMPLatencyTracer::TRACK_VIDEO);
 }
 
 void SuperMediaPlayer::FlushSubtitleInfo()
@@ -3012,7 +3513,7 @@ int64_t SuperMediaPlayer::getPlayerBufferDuration(bool gotMax, bool internal)
 
     /*
          *  Do not let player loading when switching subtitle, we'll read subtitle first
-         *  in ReadPacket()
+         *  in ReadPackets()
          */
     if (HAVE_SUBTITLE && !mSubtitleEOS && mSubtitleChangedFirstPts == INT64_MIN) {
         int64_t &duration_c = durations[i++];
@@ -3079,6 +3580,161 @@ bool SuperMediaPlayer::SeekInCache(int64_t pos)
     return true;
 }
 
+void SuperMediaPlayer::onScrubFrame(int64_t time, const std::shared_ptr<IAFFrame> &frame, int ret)
+{
+    if (ret < 0 || frame == nullptr) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mScrubMutex);
+        mScrubFrame = frame;
+    }
+    mPlayerCondition.notify_one();
+}
+
+void SuperMediaPlayer::RenderScrubFrame()
+{
+    std::shared_ptr<IAFFrame> frame;
+    {
+        std::lock_guard<std::mutex> lock(mScrubMutex);
+        frame = move(mScrubFrame);
+    }
+
+    // the positions in the same gop resolve to the same key frame
+    if (frame == nullptr || frame == mScrubShownFrame) {
+        return;
+    }
+
+    mScrubShownFrame = frame;
+    // the frame is kept in the engine cache, render a copy
+    unique_ptr<IAFFrame> videoFrame = frame->clone();
+
+    if (videoFrame == nullptr) {
+        return;
+    }
+
+    videoFrame->getInfo().video.rotate = mVideoRotation;
+    SendVideoFrameToRender(move(videoFrame));
+}
+
+void SuperMediaPlayer::RecordTimeShift(IAFPacket *packet)
+{
+    if (mTimeShiftDir.empty() || mTimeShiftWindow <= 0 || mDuration != 0 || mSecretPlayBack || mTimeShiftFailed) {
+        return;
+    }
+
+    if (mTimeShiftRecorder == nullptr) {
+        vector<unique_ptr<streamMeta>> metas;
+
+        for (int index : {mCurrentVideoIndex, mCurrentAudioIndex}) {
+            if (index < 0) {
+                continue;
+            }
+
+            unique_ptr<streamMeta> meta{};
+            mDemuxerService->GetStreamMeta(meta, index, false);
+
+            if (meta) {
+                ((Stream_meta *) (meta.get()))->index = index;
+                metas.push_back(move(meta));
+            }
+        }
+
+        unique_ptr<TimeShiftRecorder> recorder(new TimeShiftRecorder(mTimeShiftDir, mSet->mOptions.get("description")));
+        recorder->setWindow(mTimeShiftWindow, 0);
+        recorder->setStreamMetas(move(metas));
+
+        if (recorder->start() < 0) {
+            AF_LOGE("time shift recorder start failed\n");
+            mTimeShiftFailed = true;
+            return;
+        }
+
+        std::lock_guard<std::mutex> uMutex(mCreateMutex);
+        mTimeShiftRecorder = move(recorder);
+    }
+
+    int index = packet->getInfo().streamIndex;
+
+    if (index != mCurrentVideoIndex && index != mCurrentAudioIndex) {
+        return;
+    }
+
+    if (!mTimeShiftRecorder->hasStreamIndex(index)) {
+        // the track or the bitrate switched, record the new stream in place of the old one
+        unique_ptr<streamMeta> meta{};
+        mDemuxerService->GetStreamMeta(meta, index, false);
+
+        if (meta) {
+            ((Stream_meta *) (meta.get()))->index = index;
+            mTimeShiftRecorder->switchStream(move(meta));
+        }
+    }
+
+    mTimeShiftRecorder->addFrame(packet, index == mCurrentVideoIndex ? ST_TYPE_VIDEO : ST_TYPE_AUDIO);
+}
+
+void SuperMediaPlayer::ReadTimeShiftLive()
+{
+    int64_t startTime = af_gettime_relative();
+
+    // not to hold the loop, the rest is read in the next loop
+    while (af_gettime_relative() - startTime < 5000) {
+        unique_ptr<IAFPacket> packet{};
+        int ret = mDemuxerService->readPacket(packet, -1);
+
+        if (packet == nullptr) {
+            if (ret < 0 && ret != -EAGAIN && ret != FRAMEWORK_ERR_EXIT) {
+                AF_LOGW("read live for time shift error %d\n", ret);
+            }
+
+            break;
+        }
+
+        RecordTimeShift(packet.get());
+    }
+}
+
+void SuperMediaPlayer::StartTimeShift(int64_t pos)
+{
+    int64_t offset = mTimeShiftRecorder->getPtsOffset();
+
+    if (offset == INT64_MIN) {
+        return;
+    }
+
+    if (mTimeShiftReader == nullptr) {
+        std::lock_guard<std::mutex> uMutex(mCreateMutex);
+        mTimeShiftReader = unique_ptr<TimeShiftReader>(new TimeShiftReader(*mTimeShiftRecorder));
+    }
+
+    if (pos != INT64_MIN) {
+        mTimeShiftReader->open(pos + offset);
+    } else {
+        mTimeShiftReader->open(mBufferController->GetPacketLastDTS(BUFFER_TYPE_VIDEO), mBufferController->GetPacketLastDTS(BUFFER_TYPE_AUDIO));
+    }
+
+    AF_LOGI("time shift start at %lld\n", (long long) pos);
+}
+
+void SuperMediaPlayer::TimeShiftSeek(int64_t pos)
+{
+    int64_t offset = mTimeShiftRecorder->getPtsOffset();
+    int64_t startPts;
+    int64_t endPts;
+
+    if (offset == INT64_MIN || !mTimeShiftRecorder->getRange(startPts, endPts) || pos + offset >= endPts) {
+        // the live demuxer is read all the time, go on with it
+        AF_LOGI("time shift back to live\n");
+        std::lock_guard<std::mutex> uMutex(mCreateMutex);
+        mTimeShiftReader = nullptr;
+        return;
+    }
+
+    StartTimeShift(std::max(pos, startPts - offset));
+}
+
 void SuperMediaPlayer::SwitchVideo(int64_t startTime)
 {
     AF_LOGD("video change find start time is %lld", startTime);
@@ -3108,6 +3764,93 @@ void SuperMediaPlayer::SwitchVideo(int64_t startTime)
     mEof = false;
 }
 
+bool SuperMediaPlayer::FastSwitchVideo()
+{
+    int64_t headPos = mBufferController->GetPacketFirstTimePos(BUFFER_TYPE_VIDEO);
+
+    if (headPos == INT64_MIN) {
+        return false;
+    }
+
+    // leave the time to download the new rendition to the splice point
+    int64_t splicePos = mBufferController->FindKeyTimePositionAfter(BUFFER_TYPE_VIDEO, headPos + FAST_SWITCH_MIN_LEAD);
+
+    if (splicePos == INT64_MIN) {
+        return false;
+    }
+
+    int ret = mDemuxerService->OpenStream(mWillChangedVideoStreamIndex);
+
+    if (ret < 0) {
+        AF_LOGE("fast switch video open stream failed, stream index %d\n", mWillChangedVideoStreamIndex);
+        return false;
+    }
+
+    if (mMixMode) {
+        mDemuxerService->CloseStream(GEN_STREAM_INDEX(mCurrentVideoIndex));
+    } else {
+        mDemuxerService->CloseStream(mCurrentVideoIndex);
+    }
+
+    AF_LOGI("fast switch video to %d, buffer head %lld, splice after %lld", mWillChangedVideoStreamIndex, headPos, splicePos);
+    // the packets buffered are kept until the new rendition reaches the splice point
+    mDemuxerService->Seek(splicePos / 1000 * 1000, 0, mWillChangedVideoStreamIndex);
+    mFastSwitchPos = splicePos;
+    mFastSwitchVideoSpliced = false;
+    mFastSwitchAudioSpliced = !mMixMode;
+    mWillSwitchVideo = false;
+    mVideoChangedFirstPts = INT64_MAX;
+    mEof = false;
+    return true;
+}
+
+bool SuperMediaPlayer::FastSwitchSplice(IAFPacket *packet)
+{
+    int streamIndex = packet->getInfo().streamIndex;
+    int64_t pos = packet->getInfo().timePosition;
+    bool isVideo = streamIndex == mWillChangedVideoStreamIndex;
+    bool isAudio = mMixMode && streamIndex == mWillChangedAudioStreamIndex;
+
+    if (!mFastSwitchVideoSpliced) {
+        if (isAudio) {
+            return false;
+        }
+
+        if (!isVideo || !(packet->getInfo().flags & AF_PKT_FLAG_KEY) || pos < mFastSwitchPos) {
+            return !isVideo;
+        }
+
+        int64_t headPos = mBufferController->GetPacketFirstTimePos(BUFFER_TYPE_VIDEO);
+
+        // played to here already when downloading, try the next key frame
+        if (headPos != INT64_MIN && pos <= headPos) {
+            AF_LOGW("fast switch missed key frame %lld, buffer head %lld", pos, headPos);
+            return false;
+        }
+
+        // the key frames of the renditions are not always aligned, cut the old one by time
+        int64_t dropCount = mBufferController->ClearPacketFromTimePosition(BUFFER_TYPE_VIDEO, pos);
+        AF_LOGI("fast switch splice video at %lld, drop %lld old packets", pos, dropCount);
+        mFastSwitchPos = pos;
+        mFastSwitchVideoSpliced = true;
+    } else if (isAudio) {
+        if (pos < mFastSwitchPos) {
+            return false;
+        }
+
+        // the old audio plays until the first new one, no gap
+        int64_t dropCount = mBufferController->ClearPacketFromTimePosition(BUFFER_TYPE_AUDIO, pos);
+        AF_LOGI("fast switch splice audio at %lld, drop %lld old packets", pos, dropCount);
+        mFastSwitchAudioSpliced = true;
+    }
+
+    if (mFastSwitchVideoSpliced && mFastSwitchAudioSpliced) {
+        mFastSwitchPos = INT64_MIN;
+    }
+
+    return true;
+}
+
 int64_t SuperMediaPlayer::getAudioPlayTimeStampCB(void *arg)
 {
     SuperMediaPlayer *pHandle = static_cast<SuperMediaPlayer *>(arg);
@@ -3528,6 +4271,15 @@ int SuperMediaPlayer::CreateVideoDecoder(bool bHW, Stream_meta &meta)
     if (ret < 0) {
         return ret;
     }
+
+    // the frame queue of the player, the frame being sent, the last frame kept for snapshot and the render
+    int heldFrames = VIDEO_PICTURE_MAX_CACHE_SIZE + 2;
+
+    if (mAVDeviceManager->getVideoRender()) {
+        heldFrames += mAVDeviceManager->getVideoRender()->getMaxHeldFrames();
+    }
+
+    mAVDeviceManager->getDecoder(SMPAVDeviceManager::DEVICE_TYPE_VIDEO)->setHeldFrames(heldFrames);
     {
         std::lock_guard<std::mutex> lock(mAppStatusMutex);
         mMsgCtrlListener->ProcessVideoHoldMsg(mAppStatus == APP_BACKGROUND);
@@ -3538,6 +4290,15 @@ int SuperMediaPlayer::CreateVideoDecoder(bool bHW, Stream_meta &meta)
 
 void SuperMediaPlayer::Reset()
 {
+    mSnapshot->clearFrame();
+    mScrubbing = false;
+    mScrubPos = INT64_MIN;
+    {
+        std::lock_guard<std::mutex> lock(mScrubMutex);
+        mScrubFrame = nullptr;
+    }
+    mScrubShownFrame = nullptr;
+    mTimeShiftFailed = false;
     mCurrentVideoIndex = -1;
     mCurrentAudioIndex = -1;
     mCurrentSubtitleIndex = -1;
@@ -3566,7 +4327,11 @@ void SuperMediaPlayer::Reset()
     mWillChangedAudioStreamIndex = -1;
     mWillChangedSubtitleStreamIndex = -1;
     mBufferIsFull = false;
+    mBufferBytesFull = false;
     mWillSwitchVideo = false;
+    mFastSwitchPos = INT64_MIN;
+    mSwitchStartTime = INT64_MIN;
+    mSwitchLatency = -1;
     mMixMode = false;
     mFirstRendered = false;
     mInited = false;
@@ -3579,6 +4344,7 @@ void SuperMediaPlayer::Reset()
     mSubtitleChangedFirstPts = INT64_MIN;
     mSoughtVideoPos = INT64_MIN;
     mFirstReadPacketSucMS = 0;
+    mFirstRenderedMS = 0;
     mCanceled = false;
     mPNotifier->Enable(true);
     FlushSubtitleInfo();
@@ -3594,6 +4360,8 @@ void SuperMediaPlayer::Reset()
     mVideoParserTimes = 0;
     mVideoPtsRevert = mAudioPtsRevert = false;
     mLowMem = false;
+    MemoryGovernor::Instance()->setUsage(this, MemoryGovernor::ComponentPacket, 0);
+    MemoryGovernor::Instance()->setUsage(this, MemoryGovernor::ComponentFrame, 0);
     mCurrentVideoMeta = nullptr;
     mAdaptiveVideo = false;
     dropLateVideoFrames = false;
@@ -3692,6 +4460,7 @@ void SuperMediaPlayer::checkFirstRender()
 {
     if (!mFirstRendered) {
         mFirstRendered = true;
+        mFirstRenderedMS = af_getsteady_ms();
         AF_LOGI("Player NotifyFirstFrame");
         mPNotifier->NotifyFirstFrame();
     }
@@ -24,9 +24,13 @@ using namespace std;
 #include "player_notifier.h"
 #include "player_types.h"
 #include "render/video/IVideoRender.h"
+#include "render/video/VideoSnapshot.h"
+#include "thumbnail/ThumbnailEngine.h"
+#include <cacheModule/timeShift/TimeShiftReader.h>
 #include <filter/IAudioFilter.h>
 #include <queue>
 #include <render/audio/IAudioRender.h>
+#include <utils/MemoryGovernor.h>
 #include <utils/bitStreamParser.h>
 
 #include "CicadaPlayerPrototype.h"
@@ -43,6 +47,8 @@ using namespace std;
 
 #include "mediaPlayerSubTitleListener.h"
 #include "SMPRecorderSet.h"
+#include "SMPLatencyTracer.h"
+#include "SMPLiveLatencyController.h"
 
 namespace Cicada {
     typedef struct streamTime_t {
@@ -139,6 +145,8 @@ namespace Cicada {
 
         void CaptureScreen() override;
 
+        int Snapshot(int width, int height, SnapshotFormat format) override;
+
         void SetDecoderType(DecoderType type) override;
 
         DecoderType GetDecoderType() override;
@@ -169,6 +177,12 @@ namespace Cicada {
 
         void SeekTo(int64_t pos, bool bAccurate) override;
 
+        int EnterScrub() override;
+
+        int UpdateScrub(int64_t pos) override;
+
+        int ExitScrub(bool bAccurate) override;
+
         void Mute(bool bMute) override;
 
         void EnterBackGround(bool back) override;
@@ -236,6 +250,13 @@ namespace Cicada {
 
         void LiveCatchUp(int64_t delayTime);
 
+        void LiveDropBuffer(int64_t keepDuration);
+
+        void ControlLiveLatency();
+
+        // give the rate back to the user when the latency control leaves catching up
+        void StopLiveLatencyControl();
+
         int FillVideoFrame();
 
     private:
@@ -254,7 +275,17 @@ namespace Cicada {
 
         int DecodeAudio(unique_ptr<IAFPacket> &pPacket);
 
-        int ReadPacket();
+        // count in the max count to read, out the count of the packets read, return the result of the last read
+        int ReadPackets(int &count);
+
+        void HandlePacket(unique_ptr<IAFPacket> pMedia_Frame, int64_t demuxOutTime);
+
+        void AddBufferPacket(unique_ptr<IAFPacket> packet, BUFFER_TYPE type);
+
+        // the packets of a batch are added to the buffer at once, and before looking into the buffer
+        void FlushBatchPackets();
+
+        int GetReadBatchSize(int64_t bufferDuration, int64_t bufferBytes);
 
         void PostBufferPositionMsg();
 
@@ -274,10 +305,34 @@ namespace Cicada {
 
         bool SeekInCache(int64_t pos);
 
+        // called by mScrubEngine, on its thread or in place
+        void onScrubFrame(int64_t time, const std::shared_ptr<IAFFrame> &frame, int ret);
+
+        void RenderScrubFrame();
+
+        // record the live packet for time shift
+        void RecordTimeShift(IAFPacket *packet);
+
+        // the live edge is read to the recorder only while the play is shifted
+        void ReadTimeShiftLive();
+
+        // play from the disk, at pos, or after the packets buffered if pos is INT64_MIN
+        void StartTimeShift(int64_t pos);
+
+        // seek in the time shift window, back to live if pos is after the window
+        void TimeShiftSeek(int64_t pos);
+
         void SwitchVideo(int64_t startTime);
 
+        bool FastSwitchVideo();
+
+        bool FastSwitchSplice(IAFPacket *packet);
+
         int64_t getPlayerBufferDuration(bool gotMax, bool internal);
 
+        // report the bytes held by the player and its priority to the MemoryGovernor
+        void updateMemoryUsage();
+
         void ProcessOpenStreamInit(int streamIndex);
 
         static int64_t getAudioPlayTimeStampCB(void *arg);
@@ -454,12 +509,14 @@ namespace Cicada {
         int64_t mAudioChangedFirstPts{INT64_MIN};
         int64_t mSubtitleChangedFirstPts{INT64_MIN};
         int64_t mFirstReadPacketSucMS{0};
+        int64_t mFirstRenderedMS{0};
         int mMainStreamId{-1};
         int64_t mRemovedFirstAudioPts{INT64_MIN};;
         int64_t mFirstSeekStartTime{0};
         bool mEof{false};
         bool mSubtitleEOS{false};
         bool mLowMem{false};
+        MemoryGovernor::Priority mMemoryPriority{MemoryGovernor::PriorityForeground};
         bool mSeekFlag{false};
         bool mSeekInCache{false};
         bool mFirstBufferFlag{true}; // first play and after seek play
@@ -472,6 +529,8 @@ namespace Cicada {
         int64_t mTimeoutStartTime{INT64_MIN};
         int64_t mSubtitleShowIndex{0};
         bool mBufferIsFull{false};
+        // the buffer is full by maxBufferBytes or the memory allowance
+        bool mBufferBytesFull{false};
         bool mWillSwitchVideo{false};
         std::unique_ptr<player_type_set> mSet{};
         int64_t mSoughtVideoPos{INT64_MIN};
@@ -482,6 +541,20 @@ namespace Cicada {
         std::mutex mSleepMutex{};
         std::condition_variable mPlayerCondition;
         PlayerNotifier *mPNotifier = nullptr;
+        std::unique_ptr<VideoSnapshot> mSnapshot{};
+        // scrub mode, the pipeline is held and the key frames are decoded aside by mScrubEngine
+        bool mScrubbing{false};
+        int64_t mScrubPos{INT64_MIN};
+        std::unique_ptr<ThumbnailEngine> mScrubEngine{};
+        std::mutex mScrubMutex{};
+        std::shared_ptr<IAFFrame> mScrubFrame{};// guarded by mScrubMutex
+        std::shared_ptr<IAFFrame> mScrubShownFrame{};
+        // live time shift, mTimeShiftReader feeds the player instead of the demuxer when the play is shifted
+        std::string mTimeShiftDir{};
+        int64_t mTimeShiftWindow{0};
+        std::unique_ptr<TimeShiftRecorder> mTimeShiftRecorder{};
+        std::unique_ptr<TimeShiftReader> mTimeShiftReader{};
+        bool mTimeShiftFailed{false};
         std::unique_ptr<afThread> mApsaraThread{};
         int mLoadingProcess{0};
         int64_t mPrepareStartTime = 0;
@@ -492,6 +565,11 @@ namespace Cicada {
 
         int64_t mPtsDiscontinueDelta{INT64_MIN};
 
+        std::vector<std::unique_ptr<IAFPacket>> mReadBatch{};
+        bool mBatchReading{false};
+        std::vector<std::unique_ptr<IAFPacket>> mBatchVideoPackets{};
+        std::vector<std::unique_ptr<IAFPacket>> mBatchAudioPackets{};
+
         std::unique_ptr<MediaPlayerUtil> mUtil{};
 
         std::unique_ptr<SuperMediaPlayerDataSourceListener> mSourceListener{nullptr};
@@ -511,6 +589,19 @@ namespace Cicada {
         bool mDrmKeyValid{false};
 
         std::unique_ptr<SMPRecorderSet> mRecorderSet{nullptr};
+        std::unique_ptr<SMPLatencyTracer> mLatencyTracer{nullptr};
+        std::unique_ptr<SMPLiveLatencyController> mLiveLatencyController{nullptr};
+        int64_t mLiveDurationsUpdateTime{INT64_MIN};
+        // the rate set by setSpeed, the latency control only changes the rate while it's 1.0
+        float mUserRate{1.0f};
+        bool mLatencyRateActive{false};
+
+        bool mFastAbrSwitch{false};
+        int64_t mFastSwitchPos{INT64_MIN};// splice position of the switching rendition
+        bool mFastSwitchVideoSpliced{false};
+        bool mFastSwitchAudioSpliced{false};
+        int64_t mSwitchStartTime{INT64_MIN};
+        int64_t mSwitchLatency{-1};// ms, from the switch decision to the first frame of the new rendition rendered
 
     private:
 
@@ -61,6 +61,12 @@ void AbrBufferAlgoStrategy::ComputeBufferTrend(int64_t curTime)
     int64_t maxBufferDuration = mRefererData->GetMaxBufferDurationInConfig() / 1000;
     int64_t bufferDuration = mRefererData->GetCurrentPacketBufferLength() / 1000;
     bool bufferFull = (bufferDuration >= (maxBufferDuration - 1000));
+    int64_t maxBufferBytes = mRefererData->GetMaxBufferBytesInConfig();
+
+    // a high bitrate stream is full by the bytes before the duration
+    if (maxBufferBytes > 0 && mRefererData->GetCurrentPacketBufferBytes() >= (maxBufferBytes - maxBufferBytes / 10)) {
+        bufferFull = true;
+    }
 
     if (0 == mDurationMS) {
         bool connect = mRefererData->GetIsConnected();
@@ -164,6 +170,12 @@ void AbrBufferAlgoStrategy::SwitchBitrate(bool up, int64_t speed, int64_t maxSpe
         }
 
         bitrate = mBitrates[currentIndex + 1];
+        int64_t maxBufferBytes = mRefererData->GetMaxBufferBytesInConfig();
+
+        if (!FitBufferBytes(bitrate, maxBufferBytes)) {
+            AF_LOGI("BA maxBufferBytes:%lld is too small for bitrate:%d", maxBufferBytes, bitrate);
+            return;
+        }
 
         if (mIsUpHistory.size() > 0 && speed > 0) {
             // last BA down
@@ -174,7 +186,7 @@ void AbrBufferAlgoStrategy::SwitchBitrate(bool up, int64_t speed, int64_t maxSpe
         }
 
         for (int i = currentIndex + 2; i < count; ++i) {
-            if (speed >= mBitrates[i]) {
+            if (speed >= mBitrates[i] && FitBufferBytes(mBitrates[i], maxBufferBytes)) {
                 bitrate = mBitrates[i];
             }
         }
@@ -225,6 +237,12 @@ void AbrBufferAlgoStrategy::SwitchBitrate(bool up, int64_t speed, int64_t maxSpe
     }
 }
 
+bool AbrBufferAlgoStrategy::FitBufferBytes(int bitrate, int64_t maxBufferBytes)
+{
+    // the buffer under LOWER_SWITCH_VALUE_MS switches down, so a bitrate not holding it in the bytes would switch back
+    return maxBufferBytes <= 0 || (int64_t) bitrate * LOWER_SWITCH_VALUE_MS / 8000 <= maxBufferBytes;
+}
+
 void AbrBufferAlgoStrategy::ProcessAbrAlgo()
 {
     if (mRefererData == nullptr || mCurrentBitrate == -1) {
@@ -29,6 +29,7 @@ public:
 protected:
     void ComputeBufferTrend(int64_t curTime);
     void SwitchBitrate(bool up, int64_t speed, int64_t maxSpeed);
+    bool FitBufferBytes(int bitrate, int64_t maxBufferBytes);
     
 protected:
     bool mSwitching = false;
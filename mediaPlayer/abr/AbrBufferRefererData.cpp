@@ -33,6 +33,30 @@ int64_t AbrBufferRefererData::GetMaxBufferDurationInConfig()
     return 0;
 }
 
+int64_t AbrBufferRefererData::GetMaxBufferBytesInConfig()
+{
+    playerHandle *handle = (playerHandle *)mHandle;
+
+    if (handle) {
+        char maxBufferBytes[48] = {0};
+        CicadaGetOption(handle, "maxBufferBytes", maxBufferBytes);
+        return atoll(maxBufferBytes);
+    }
+
+    return 0;
+}
+
+int64_t AbrBufferRefererData::GetCurrentPacketBufferBytes()
+{
+    playerHandle *handle = (playerHandle *)mHandle;
+
+    if (handle) {
+        return CicadaGetPropertyLong(handle, PROPERTY_KEY_BUFFER_BYTES);
+    }
+
+    return 0;
+}
+
 int AbrBufferRefererData::GetRemainSegmentCount()
 {
     playerHandle *handle = (playerHandle *)mHandle;
@@ -26,6 +26,10 @@ public:
 
     virtual int GetRemainSegmentCount();
 
+    virtual int64_t GetMaxBufferBytesInConfig();
+
+    virtual int64_t GetCurrentPacketBufferBytes();
+
     virtual bool GetIsConnected();
 
 private:
@@ -28,6 +28,12 @@ public:
 
     virtual int GetRemainSegmentCount() = 0;
 
+    //get max buffer bytes, 0 for no limit
+    virtual int64_t GetMaxBufferBytesInConfig() {return 0;}
+
+    //measure current packet bytes
+    virtual int64_t GetCurrentPacketBufferBytes() {return 0;}
+
     virtual bool GetIsConnected() {return true;}
 
     //measure network strength
@@ -41,6 +41,28 @@ namespace Cicada {
         }
     }
 
+    void BufferController::AddPackets(vector<unique_ptr<IAFPacket>> &packets, BUFFER_TYPE type)
+    {
+        if (packets.empty()) {
+            return;
+        }
+
+        switch (type) {
+            case BUFFER_TYPE_AUDIO:
+                return mAudioPacketQueue.AddPackets(packets);
+
+            case BUFFER_TYPE_VIDEO:
+                return mVideoPacketQueue.AddPackets(packets);
+
+            case BUFFER_TYPE_SUBTITLE:
+                return mSubtitlePacketQueue.AddPackets(packets);
+
+            default:
+                AF_LOGE("error media type");
+                break;
+        }
+    }
+
     void BufferController::SetOnePacketDuration(BUFFER_TYPE type, int64_t duration) {
         switch (type) {
             case BUFFER_TYPE_AUDIO:
@@ -181,6 +203,82 @@ namespace Cicada {
         }
     }
 
+    int64_t BufferController::ClearPacketFromTimePosition(BUFFER_TYPE type, int64_t pos)
+    {
+        int64_t dropCount = 0;
+
+        if (type & BUFFER_TYPE_AUDIO) {
+            dropCount += mAudioPacketQueue.ClearPacketFromTimePosition(pos);
+        }
+
+        if (type & BUFFER_TYPE_VIDEO) {
+            dropCount += mVideoPacketQueue.ClearPacketFromTimePosition(pos);
+        }
+
+        if (type & BUFFER_TYPE_SUBTITLE) {
+            dropCount += mSubtitlePacketQueue.ClearPacketFromTimePosition(pos);
+        }
+
+        return dropCount;
+    }
+
+    int64_t BufferController::GetPacketFirstTimePos(BUFFER_TYPE type)
+    {
+        switch (type) {
+            case BUFFER_TYPE_AUDIO:
+                return mAudioPacketQueue.GetFirstTimePos();
+
+            case BUFFER_TYPE_VIDEO:
+                return mVideoPacketQueue.GetFirstTimePos();
+
+            case BUFFER_TYPE_SUBTITLE:
+                return mSubtitlePacketQueue.GetFirstTimePos();
+
+            default:
+                AF_LOGE("error media type");
+                break;
+        }
+
+        return INT64_MIN;
+    }
+
+    int64_t BufferController::FindKeyTimePositionAfter(BUFFER_TYPE type, int64_t pos)
+    {
+        switch (type) {
+            case BUFFER_TYPE_AUDIO:
+                return mAudioPacketQueue.FindKeyTimePositionAfter(pos);
+
+            case BUFFER_TYPE_VIDEO:
+                return mVideoPacketQueue.FindKeyTimePositionAfter(pos);
+
+            case BUFFER_TYPE_SUBTITLE:
+                return mSubtitlePacketQueue.FindKeyTimePositionAfter(pos);
+
+            default:
+                AF_LOGE("error media type");
+                break;
+        }
+
+        return INT64_MIN;
+    }
+
+    std::unique_ptr<IAFPacket> BufferController::GetKeyPacketBefore(BUFFER_TYPE type, int64_t pos)
+    {
+        switch (type) {
+            case BUFFER_TYPE_AUDIO:
+                return mAudioPacketQueue.GetKeyPacketBefore(pos);
+
+            case BUFFER_TYPE_VIDEO:
+                return mVideoPacketQueue.GetKeyPacketBefore(pos);
+
+            default:
+                AF_LOGE("error media type");
+                break;
+        }
+
+        return nullptr;
+    }
+
     int64_t BufferController::GetPacketLastKeyTimePos(BUFFER_TYPE type)
     {
         switch (type) {
@@ -221,6 +319,26 @@ namespace Cicada {
         return 0;
     }
 
+    int64_t BufferController::GetPacketLastDTS(BUFFER_TYPE type)
+    {
+        switch (type) {
+            case BUFFER_TYPE_AUDIO:
+                return mAudioPacketQueue.GetLastDTS();
+
+            case BUFFER_TYPE_VIDEO:
+                return mVideoPacketQueue.GetLastDTS();
+
+            case BUFFER_TYPE_SUBTITLE:
+                return mSubtitlePacketQueue.GetLastDTS();
+
+            default:
+                AF_LOGE("error media type");
+                break;
+        }
+
+        return 0;
+    }
+
     int64_t BufferController::GetPacketLastTimePos(BUFFER_TYPE type)
     {
         switch (type) {
@@ -340,6 +458,25 @@ namespace Cicada {
         return size;
     }
 
+    int64_t BufferController::GetPacketBytes(BUFFER_TYPE type)
+    {
+        int64_t bytes = 0;
+
+        if (type & BUFFER_TYPE_AUDIO) {
+            bytes += mAudioPacketQueue.GetBytes();
+        }
+
+        if (type & BUFFER_TYPE_VIDEO) {
+            bytes += mVideoPacketQueue.GetBytes();
+        }
+
+        if (type & BUFFER_TYPE_SUBTITLE) {
+            bytes += mSubtitlePacketQueue.GetBytes();
+        }
+
+        return bytes;
+    }
+
     void BufferController::ClearPacket(BUFFER_TYPE type)
     {
         if (type & BUFFER_TYPE_AUDIO) {
@@ -33,12 +33,18 @@ namespace Cicada {
 
         int GetPacketSize(BUFFER_TYPE type);
 
+        // the bytes of the packets of the types
+        int64_t GetPacketBytes(BUFFER_TYPE type);
+
         bool IsPacketEmtpy(BUFFER_TYPE type);
 
         std::unique_ptr<IAFPacket> getPacket(BUFFER_TYPE type);
 
         void AddPacket(std::unique_ptr<IAFPacket> packet, BUFFER_TYPE type);
 
+        // the packets of a read batch, the packets are moved out
+        void AddPackets(std::vector<std::unique_ptr<IAFPacket>> &packets, BUFFER_TYPE type);
+
         void ClearPacket(BUFFER_TYPE type);
 
         int64_t GetPacketPts(BUFFER_TYPE type);
@@ -57,10 +63,20 @@ namespace Cicada {
 
         int64_t GetPacketLastPTS(BUFFER_TYPE type);
 
+        int64_t GetPacketLastDTS(BUFFER_TYPE type);
+
         int64_t FindSeamlessPointTimePosition(BUFFER_TYPE type, int &count);
 
         void ClearPacketAfterTimePosition(BUFFER_TYPE type, int64_t pts);
 
+        int64_t ClearPacketFromTimePosition(BUFFER_TYPE type, int64_t pos);
+
+        int64_t GetPacketFirstTimePos(BUFFER_TYPE type);
+
+        int64_t FindKeyTimePositionAfter(BUFFER_TYPE type, int64_t pos);
+
+        std::unique_ptr<IAFPacket> GetKeyPacketBefore(BUFFER_TYPE type, int64_t pos);
+
 //       std::deque<std::shared_ptr<IAFPacket>> CopyVideoCacheQueue();
 
     private:
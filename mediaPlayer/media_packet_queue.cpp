@@ -18,13 +18,29 @@ namespace Cicada {
         ADD_LOCK;
         mQueue.clear();
         mDuration = 0;
+        mBytes = 0;
         mPacketDuration = 0;
     }
 
     void MediaPacketQueue::AddPacket(mediaPacket frame)
     {
         ADD_LOCK;
+        AddPacketLocked(move(frame));
+    }
+
+    void MediaPacketQueue::AddPackets(std::vector<mediaPacket> &frames)
+    {
+        ADD_LOCK;
+
+        for (auto &frame : frames) {
+            AddPacketLocked(move(frame));
+        }
+
+        frames.clear();
+    }
 
+    void MediaPacketQueue::AddPacketLocked(mediaPacket frame)
+    {
         if (frame->getInfo().duration > 0) {
             if (mPacketDuration == 0) {
                 mPacketDuration = frame->getInfo().duration;
@@ -40,6 +56,7 @@ namespace Cicada {
             frame->getInfo().dump();
         }
 
+        mBytes += frame->getSize();
         mQueue.push_back(move(frame));
     }
 
@@ -93,6 +110,17 @@ namespace Cicada {
         return mQueue.back()->getInfo().pts;
     }
 
+    int64_t MediaPacketQueue::GetLastDTS()
+    {
+        ADD_LOCK;
+
+        if (mQueue.empty()) {
+            return INT64_MIN;
+        }
+
+        return mQueue.back()->getInfo().dts;
+    }
+
     int64_t MediaPacketQueue::GetLastTimePos()
     {
         ADD_LOCK;
@@ -153,6 +181,10 @@ namespace Cicada {
             mDuration -= packet->getInfo().duration;
         }
 
+        if (packet) {
+            mBytes -= packet->getSize();
+        }
+
         return packet;
     };
 
@@ -168,6 +200,10 @@ namespace Cicada {
             mDuration -= mQueue.front()->getInfo().duration;
         }
 
+        if (mQueue.front()) {
+            mBytes -= mQueue.front()->getSize();
+        }
+
         mQueue.pop_front();
     }
 
@@ -208,6 +244,12 @@ namespace Cicada {
         return mDuration;
     }
 
+    int64_t MediaPacketQueue::GetBytes()
+    {
+        ADD_LOCK;
+        return mBytes;
+    }
+
     int64_t MediaPacketQueue::ClearPacketBeforePTS(int64_t pts)
     {
         ADD_LOCK;
@@ -267,6 +309,7 @@ namespace Cicada {
                 mDuration -= packet->getInfo().duration;
             }
 
+            mBytes -= packet->getSize();
             mQueue.pop_back();
         }
 
@@ -285,6 +328,82 @@ namespace Cicada {
         }
     }
 
+    int64_t MediaPacketQueue::ClearPacketFromTimePosition(int64_t pos)
+    {
+        ADD_LOCK;
+        // in decode order, the frames before the cut are decodable without the ones after it
+        auto it = mQueue.begin();
+
+        while (it != mQueue.end() && (*it == nullptr || (*it)->getInfo().timePosition < pos)) {
+            ++it;
+        }
+
+        int64_t dropCount = 0;
+
+        for (auto item = it; item != mQueue.end(); ++item) {
+            if (*item && (*item)->getInfo().duration > 0) {
+                mDuration -= (*item)->getInfo().duration;
+            }
+
+            if (*item) {
+                mBytes -= (*item)->getSize();
+            }
+
+            dropCount++;
+        }
+
+        mQueue.erase(it, mQueue.end());
+
+        if (!mQueue.empty()) {
+            if (mMediaType == BUFFER_TYPE_AUDIO) {
+                AF_LOGD("audio change last pts is %lld\n", mQueue.back()->getInfo().pts);
+            } else {
+                AF_LOGD("video change last pts is %lld\n", mQueue.back()->getInfo().pts);
+            }
+        }
+
+        return dropCount;
+    }
+
+    int64_t MediaPacketQueue::GetFirstTimePos()
+    {
+        ADD_LOCK;
+
+        if (mQueue.empty()) {
+            return INT64_MIN;
+        }
+
+        return mQueue.front()->getInfo().timePosition;
+    }
+
+    int64_t MediaPacketQueue::FindKeyTimePositionAfter(int64_t pos)
+    {
+        ADD_LOCK;
+
+        for (auto &packet : mQueue) {
+            if (packet && (packet->getInfo().flags & AF_PKT_FLAG_KEY) && packet->getInfo().timePosition >= pos) {
+                return packet->getInfo().timePosition;
+            }
+        }
+
+        return INT64_MIN;
+    }
+
+    std::unique_ptr<IAFPacket> MediaPacketQueue::GetKeyPacketBefore(int64_t pos)
+    {
+        ADD_LOCK;
+
+        for (auto r_iter = mQueue.rbegin(); r_iter != mQueue.rend(); ++r_iter) {
+            IAFPacket *packet = (*r_iter).get();
+
+            if (packet && (packet->getInfo().flags & AF_PKT_FLAG_KEY) && packet->getInfo().timePosition <= pos) {
+                return packet->clone();
+            }
+        }
+
+        return nullptr;
+    }
+
     int64_t MediaPacketQueue::GetPts()
     {
         ADD_LOCK;
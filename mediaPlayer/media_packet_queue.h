@@ -3,6 +3,7 @@
 
 #include <mutex>
 #include <deque>
+#include <vector>
 #include <utils/AFMediaType.h>
 #include <base/media/IAFPacket.h>
 
@@ -24,6 +25,9 @@ namespace Cicada {
 
         void AddPacket(mediaPacket frame);
 
+        // add the packets in order under one lock, the packets are moved out
+        void AddPackets(std::vector<mediaPacket> &frames);
+
         std::unique_ptr<IAFPacket> getPacket();
 
         void PopFrontPacket();
@@ -32,6 +36,9 @@ namespace Cicada {
 
         int64_t GetDuration();
 
+        // the bytes of the packets in the queue
+        int64_t GetBytes();
+
         int64_t GetPts();
 
         int64_t GetKeyTimePositionBefore(int64_t pts);
@@ -48,17 +55,34 @@ namespace Cicada {
 
         int64_t GetLastPTS();
 
+        int64_t GetLastDTS();
+
         int64_t FindSeamlessPointTimePosition(int &count);
 
         void ClearPacketAfterTimePosition(int64_t pts);
 
+        // clear in decode order from the first packet at or after pos to the end, return the count cleared
+        int64_t ClearPacketFromTimePosition(int64_t pos);
+
+        int64_t GetFirstTimePos();
+
+        // the first key packet at or after pos
+        int64_t FindKeyTimePositionAfter(int64_t pos);
+
+        // a copy of the last key packet at or before pos, the queue is not changed
+        std::unique_ptr<IAFPacket> GetKeyPacketBefore(int64_t pos);
+
         int mMediaType = 0;
 
+    private:
+        void AddPacketLocked(mediaPacket frame);
+
     private:
         std::deque<mediaPacket> mQueue;
         std::recursive_mutex mMutex;
         int mPacketDuration = 0;
         int64_t mDuration = 0;
+        int64_t mBytes = 0;
     };
 
 } // namespace Cicada
@@ -235,6 +235,39 @@ void CicadaSeekToTime(playerHandle *pHandle, int64_t seekPos, bool bAccurate)
     }
 }
 
+int CicadaEnterScrub(playerHandle *pHandle)
+{
+    GET_PLAYER;
+
+    if (player) {
+        return player->EnterScrub();
+    }
+
+    return -EINVAL;
+}
+
+int CicadaUpdateScrub(playerHandle *pHandle, int64_t pos)
+{
+    GET_PLAYER;
+
+    if (player) {
+        return player->UpdateScrub(pos);
+    }
+
+    return -EINVAL;
+}
+
+int CicadaExitScrub(playerHandle *pHandle, bool bAccurate)
+{
+    GET_PLAYER;
+
+    if (player) {
+        return player->ExitScrub(bAccurate);
+    }
+
+    return -EINVAL;
+}
+
 int CicadaStopPlayer(playerHandle *pHandle)
 {
     GET_PLAYER;
@@ -266,6 +299,17 @@ void CicadaCaptureScreen(playerHandle *pHandle)
     }
 }
 
+int CicadaSnapshot(playerHandle *pHandle, int width, int height, SnapshotFormat format)
+{
+    GET_PLAYER;
+
+    if (player) {
+        return player->Snapshot(width, height, format);
+    }
+
+    return -EINVAL;
+}
+
 void CicadaSetVolume(playerHandle *pHandle, float volume)
 {
     GET_PLAYER;
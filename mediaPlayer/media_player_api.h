@@ -83,6 +83,12 @@ void CicadaRemoveAllCustomHttpHeader(playerHandle *pHandle);
 
 void CicadaCaptureScreen(playerHandle *pHandle);
 
+/*
+ * snapshot the current video frame in width x height, 0 to keep the aspect,
+ * the result is sent by the listener Snapshot
+ */
+int CicadaSnapshot(playerHandle *pHandle, int width, int height, SnapshotFormat format);
+
 int64_t CicadaGetMasterClockPts(playerHandle *pHandle);
 
 void CicadaSetClockRefer(playerHandle *pHandle,clockRefer cb, void *arg);
@@ -127,6 +133,16 @@ float CicadaGetVolume(playerHandle *player);
  */
 void CicadaSeekToTime(playerHandle *player, int64_t seekPos, bool bAccurate);
 
+/*
+ * scrub mode, the key frames before the positions are shown while dragging without flushing the player,
+ * exit seeks to the last position updated
+ */
+int CicadaEnterScrub(playerHandle *pHandle);
+
+int CicadaUpdateScrub(playerHandle *pHandle, int64_t pos);
+
+int CicadaExitScrub(playerHandle *pHandle, bool bAccurate);
+
 /*
  * stop the playback
  */
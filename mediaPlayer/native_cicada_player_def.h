@@ -75,6 +75,23 @@ typedef struct _StreamInfo {
     char *subtitleLang;
 } StreamInfo;
 
+typedef enum SnapshotFormat_t {
+    SNAPSHOT_FORMAT_RGBA = 0,
+    SNAPSHOT_FORMAT_JPEG,
+    SNAPSHOT_FORMAT_PNG,
+} SnapshotFormat;
+
+typedef struct SnapshotResult_t {
+    SnapshotFormat format;
+    int width;
+    int height;
+    const uint8_t *data;
+    int size;
+    int64_t pts;
+    // from the request to the result, in us
+    int64_t latency;
+} SnapshotResult;
+
 //apsara player callback define
 typedef void (*playerVoidCallback)(void *userData);
 
@@ -115,6 +132,8 @@ typedef struct playerListener_t {
     playerType123Callback SubtitleHide;
     playerType123Callback SubtitleShow;
     playerType13Callback SubtitleExtAdd;
+    // (error, size, const SnapshotResult *)
+    playerType123Callback Snapshot;
     void *userData;
 } playerListener;
 
@@ -155,6 +174,17 @@ typedef enum PropertyKey {
     PROPERTY_KEY_PLAY_CONFIG = 8,
     PROPERTY_KEY_DECODE_INFO = 9,
     PROPERTY_KEY_HLS_KEY_URL = 10,
+    PROPERTY_KEY_LATENCY_TRACE = 11,
+    PROPERTY_KEY_LATENCY_CHROME_TRACE = 12,
+    PROPERTY_KEY_LIVE_LATENCY = 13,
+    PROPERTY_KEY_LIVE_TARGET_LATENCY = 14,
+    PROPERTY_KEY_STARTUP_TIMELINE = 15,
+    PROPERTY_KEY_ABR_SWITCH_LATENCY = 16,
+    PROPERTY_KEY_MEMORY_USAGE = 17,
+    PROPERTY_KEY_BUFFER_BYTES = 18,
+    PROPERTY_KEY_EVENT_STATS = 19,
+    PROPERTY_KEY_TIME_SHIFT = 20,
+    PROPERTY_KEY_META_CACHE = 21,
 } PropertyKey;
 
 class AMediaFrame;
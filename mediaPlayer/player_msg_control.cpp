@@ -25,6 +25,8 @@ namespace Cicada {
             case MSG_SET_ROTATE_MODE:
             case MSG_SET_MIRROR_MODE:
             case MSG_SET_VIDEO_BACKGROUND_COLOR:
+            // only the latest scrub position is worth to show
+            case MSG_SCRUB_UPDATE:
                 return REPLACE_ALL;
 
             case MSG_START:
@@ -40,6 +42,8 @@ namespace Cicada {
             case MSG_SELECT_EXT_SUBTITLE:
             case MSG_INTERNAL_VIDEO_CLEAN_FRAME:
             case MSG_INTERNAL_VIDEO_HOLD_ON:
+            case MSG_SCRUB_ENTER:
+            case MSG_SCRUB_EXIT:
                 return REPLACE_NONE;
 
             default:
@@ -287,6 +291,18 @@ namespace Cicada {
                 mProcessor.ProcessSetSpeed(msgContent.msgSpeedParam.speed);
                 break;
 
+            case MSG_SCRUB_ENTER:
+                mProcessor.ProcessScrubEnterMsg();
+                break;
+
+            case MSG_SCRUB_UPDATE:
+                mProcessor.ProcessScrubUpdateMsg(msgContent.seekParam.seekPos);
+                break;
+
+            case MSG_SCRUB_EXIT:
+                mProcessor.ProcessScrubExitMsg(msgContent.seekParam.bAccurate);
+                break;
+
             default:
                 AF_LOGE("Unknown msg\n");
                 break;
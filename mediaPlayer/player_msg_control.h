@@ -31,6 +31,10 @@ namespace Cicada {
         MSG_SELECT_EXT_SUBTITLE,
         MSG_SET_SPEED,
 
+        MSG_SCRUB_ENTER,
+        MSG_SCRUB_UPDATE,
+        MSG_SCRUB_EXIT,
+
         MSG_INTERNAL_VIDEO_FIRST = 0x100,
         MSG_INTERNAL_VIDEO_RENDERED = MSG_INTERNAL_VIDEO_FIRST,
         MSG_INTERNAL_VIDEO_CLEAN_FRAME,
@@ -152,6 +156,12 @@ namespace Cicada {
 
         virtual void ProcessSetSpeed(float speed) = 0;
 
+        virtual void ProcessScrubEnterMsg() = 0;
+
+        virtual void ProcessScrubUpdateMsg(int64_t pos) = 0;
+
+        virtual void ProcessScrubExitMsg(bool bAccurate) = 0;
+
 
     };
 
@@ -5,7 +5,9 @@
 #define LOG_TAG "PlayerNotifier"
 #include <utils/timer.h>
 #include "player_notifier.h"
+#include <new>
 #include <type_traits>
+#include <utils/CicadaJSON.h>
 
 #include <utils/frame_work_log.h>
 #ifdef __APPLE__
@@ -25,11 +27,26 @@ namespace Cicada {
 #define ARG_FLAGS_13  (ARG_TYPE_1 | ARG_TYPE_3)
 #define ARG_FLAGS_123 (ARG_FLAGS_12 | ARG_TYPE_3)
 
+// the events kept for reuse, and the queue nodes allocated at first
+#define EVENT_POOL_SIZE 64
+// the notifier thread checks the queue at least this often when waiting
+#define WAIT_TIMEOUT_MS 20
+// the events coalesced to the latest value
+#define COALESCED_EVENTS                                                                                                                   \
+    ((1u << EVENT_POSITION) | (1u << EVENT_BUFFER_POSITION) | (1u << EVENT_LOADING_PROGRESS) | (1u << EVENT_VIDEO_RENDERED))
+
     static void releaseIPacket(void *data)
     {
         delete (IAFPacket *) data;
     }
 
+    static void releaseSnapshotResult(void *data)
+    {
+        auto *result = static_cast<SnapshotResult *>(data);
+        free(const_cast<uint8_t *>(result->data));
+        delete result;
+    }
+
     static void releaseAppleImage(void *data)
     {
 #ifdef __APPLE__
@@ -138,6 +155,12 @@ namespace Cicada {
             }
         }
 
+        void setArgs(int64_t _arg1, int64_t _arg2)
+        {
+            arg1 = _arg1;
+            arg2 = _arg2;
+        }
+
         ~player_event()
         {
             if (!mKeepData && data) {
@@ -152,6 +175,9 @@ namespace Cicada {
     public:
         function mFunc{nullptr};
         releaseFunc mRelease = nullptr;
+        int mType{0};
+        int mGeneration{0};
+        int64_t mQueueTime{0};
 
     private:
         int64_t arg1{};
@@ -161,7 +187,8 @@ namespace Cicada {
         bool mKeepData = false;
     };
 
-    PlayerNotifier::PlayerNotifier()
+
+    PlayerNotifier::PlayerNotifier() : mEventQueue(EVENT_POOL_SIZE), mFreeEvents(EVENT_POOL_SIZE)
     {
         mpThread = NEW_AF_THREAD(post_loop);
     }
@@ -175,107 +202,183 @@ namespace Cicada {
         mCondition.notify_one();
         delete mpThread;
         Clean();
+        player_event *event = nullptr;
+
+        while (mFreeEvents.pop(event)) {
+            ::operator delete(event);
+        }
+    }
+
+    template<typename... Args>
+    player_event *PlayerNotifier::obtainEvent(Args &&...args)
+    {
+        void *memory = nullptr;
+        player_event *event = nullptr;
+
+        if (mFreeEvents.pop(event)) {
+            memory = event;
+        } else {
+            memory = ::operator new(sizeof(player_event));
+            mAllocatedCount++;
+        }
+
+        return new (memory) player_event(std::forward<Args>(args)...);
+    }
+
+    void PlayerNotifier::recycleEvent(player_event *event)
+    {
+        event->~player_event();
+
+        if (!mFreeEvents.bounded_push(event)) {
+            ::operator delete(event);
+        }
     }
 
     void PlayerNotifier::setListener(const playerListener &listener)
     {
         mpThread->pause();
         mListener = listener;
+        uint32_t subscribed = 0;
+#define SUBSCRIBE(callback, type)                                                                                                          \
+    if (listener.callback != nullptr) subscribed |= 1u << (type)
+        SUBSCRIBE(LoopingStart, EVENT_LOOPING_START);
+        SUBSCRIBE(Prepared, EVENT_PREPARED);
+        SUBSCRIBE(Completion, EVENT_COMPLETION);
+        SUBSCRIBE(FirstFrameShow, EVENT_FIRST_FRAME);
+        SUBSCRIBE(LoadingStart, EVENT_LOADING_START);
+        SUBSCRIBE(LoadingEnd, EVENT_LOADING_END);
+        SUBSCRIBE(AutoPlayStart, EVENT_AUTO_PLAY_START);
+        SUBSCRIBE(Seeking, EVENT_SEEKING);
+        SUBSCRIBE(SeekEnd, EVENT_SEEK_END);
+        SUBSCRIBE(PositionUpdate, EVENT_POSITION);
+        SUBSCRIBE(BufferPositionUpdate, EVENT_BUFFER_POSITION);
+        SUBSCRIBE(LoadingProgress, EVENT_LOADING_PROGRESS);
+        SUBSCRIBE(VideoSizeChanged, EVENT_VIDEO_SIZE_CHANGED);
+        SUBSCRIBE(StatusChanged, EVENT_STATUS_CHANGED);
+        SUBSCRIBE(VideoRendered, EVENT_VIDEO_RENDERED);
+        SUBSCRIBE(ErrorCallback, EVENT_ERROR);
+        SUBSCRIBE(EventCallback, EVENT_EVENT);
+        SUBSCRIBE(StreamInfoGet, EVENT_STREAM_INFO);
+        SUBSCRIBE(StreamSwitchSuc, EVENT_STREAM_SWITCH);
+        SUBSCRIBE(CaptureScreen, EVENT_CAPTURE_SCREEN);
+        SUBSCRIBE(SubtitleHide, EVENT_SUBTITLE_HIDE);
+        SUBSCRIBE(SubtitleShow, EVENT_SUBTITLE_SHOW);
+        SUBSCRIBE(SubtitleExtAdd, EVENT_SUBTITLE_EXT_ADD);
+        SUBSCRIBE(Snapshot, EVENT_SNAPSHOT);
+#undef SUBSCRIBE
+        mSubscribed = subscribed;
         mpThread->start();
     }
 
     // TODO: change releaseAppleImage to a parameter of NotifyCaptureScreen
     void PlayerNotifier::NotifyCaptureScreen(uint8_t *buffer, int width, int height)
     {
-        if (!mEnable || mListener.CaptureScreen == nullptr) {
+        if (!subscribed(EVENT_CAPTURE_SCREEN)) {
             return;
         }
 
         if (width == -1 && height == -1) {
-            auto *event = new player_event(width, height, buffer, mListener.CaptureScreen, false, releaseAppleImage);
-            pushEvent(event);
+            auto *event = obtainEvent(width, height, buffer, mListener.CaptureScreen, false, releaseAppleImage);
+            pushEvent(EVENT_CAPTURE_SCREEN, event);
             return;
         }
         auto *dupBuffer = static_cast<uint8_t *>(malloc(width * height * 4));
         memcpy(dupBuffer, buffer, width * height * 4);
-        auto *event = new player_event(width, height, dupBuffer, mListener.CaptureScreen, false);
-        pushEvent(event);
+        auto *event = obtainEvent(width, height, dupBuffer, mListener.CaptureScreen, false);
+        pushEvent(EVENT_CAPTURE_SCREEN, event);
+    }
+
+    void PlayerNotifier::NotifySnapshot(int error, SnapshotResult *result)
+    {
+        if (!subscribed(EVENT_SNAPSHOT)) {
+            releaseSnapshotResult(result);
+            return;
+        }
+
+        auto *event = obtainEvent(error, result->size, result, mListener.Snapshot, false, releaseSnapshotResult);
+        pushEvent(EVENT_SNAPSHOT, event);
+    }
+
+    bool PlayerNotifier::coalesce(EventType type, int64_t arg1, int64_t arg2)
+    {
+        CoalescedSlot &slot = mSlots[type];
+
+        while (slot.lock.test_and_set(std::memory_order_acquire)) {
+        }
+
+        slot.arg1 = arg1;
+        slot.arg2 = arg2;
+        slot.lock.clear(std::memory_order_release);
+
+        if (slot.pending.exchange(true)) {
+            mCoalescedCount++;
+            return true;
+        }
+
+        return false;
     }
 
     void PlayerNotifier::NotifyPosition(int64_t pos)
     {
         AF_LOGD("NotifyPosition() :%lld", pos);
 
-        if (!mEnable || mListener.PositionUpdate == nullptr) {
+        if (!subscribed(EVENT_POSITION) || coalesce(EVENT_POSITION, pos, 0)) {
             return;
         }
 
-        auto *event = new player_event(pos, mListener.PositionUpdate);
-        pushEvent(event);
+        auto *event = obtainEvent(pos, mListener.PositionUpdate);
+        pushEvent(EVENT_POSITION, event);
     }
 
     void PlayerNotifier::NotifyBufferPosition(int64_t pos)
     {
-        if (!mEnable || mListener.BufferPositionUpdate == nullptr) {
+        if (!subscribed(EVENT_BUFFER_POSITION) || coalesce(EVENT_BUFFER_POSITION, pos, 0)) {
             return;
         }
 
-        auto *event = new player_event(pos, mListener.BufferPositionUpdate);
-        pushEvent(event);
+        auto *event = obtainEvent(pos, mListener.BufferPositionUpdate);
+        pushEvent(EVENT_BUFFER_POSITION, event);
     }
 
     void PlayerNotifier::NotifyVideoSizeChanged(int64_t width, int64_t height)
     {
-        if (!mEnable || mListener.VideoSizeChanged == nullptr) {
+        if (!subscribed(EVENT_VIDEO_SIZE_CHANGED)) {
             return;
         }
 
-        auto *event = new player_event(width, height, mListener.VideoSizeChanged);
-        pushEvent(event);
+        auto *event = obtainEvent(width, height, mListener.VideoSizeChanged);
+        pushEvent(EVENT_VIDEO_SIZE_CHANGED, event);
     }
 
     void PlayerNotifier::NotifyVideoRendered(int64_t timeMs, int64_t pts)
     {
-        if (!mEnable || mListener.VideoRendered == nullptr) {
+        if (!subscribed(EVENT_VIDEO_RENDERED) || coalesce(EVENT_VIDEO_RENDERED, timeMs, pts)) {
             return;
         }
 
-        auto *event = new player_event(timeMs, pts, mListener.VideoRendered);
-        pushEvent(event);
+        auto *event = obtainEvent(timeMs, pts, mListener.VideoRendered);
+        pushEvent(EVENT_VIDEO_RENDERED, event);
     }
 
     void PlayerNotifier::NotifyFirstFrame()
     {
-        if (!mEnable || mListener.FirstFrameShow == nullptr) {
-            return;
-        }
-
-        NotifyVoidEvent(mListener.FirstFrameShow);
+        NotifyVoidEvent(EVENT_FIRST_FRAME, mListener.FirstFrameShow);
     }
 
     void PlayerNotifier::NotifyStreamInfo(StreamInfo *info[], int size)
     {
-        if (!mEnable || mListener.StreamInfoGet == nullptr) {
+        if (!subscribed(EVENT_STREAM_INFO)) {
             return;
         }
 
-        auto *event = new player_event(size, info, mListener.StreamInfoGet, true);
-        pushEvent(event);
+        auto *event = obtainEvent(size, info, mListener.StreamInfoGet, true);
+        pushEvent(EVENT_STREAM_INFO, event);
     }
 
     void PlayerNotifier::CancelNotifyStreamInfo()
     {
-        if (mListener.StreamInfoGet == nullptr) {
-            return;
-        }
-
-        std::unique_lock<std::mutex> uMutex(mMutex);
-
-        for (auto &event : mEventQueue) {
-            if (event->mFunc.p13 == mListener.StreamInfoGet) {
-                mEventQueue.remove(event);
-            }
-        }
+        // the events can't be taken out of the lock free queue, the ones queued before are dropped in dispatch
+        mStreamInfoGeneration++;
     }
 
     void PlayerNotifier::NotifySubtitleEvent(subTitle_event id, IAFPacket *packet, int64_t index, const char *url)
@@ -284,168 +387,195 @@ namespace Cicada {
             return;
         }
 
-        player_event *event = nullptr;
-
         if (id == subTitle_event_show) {
-            if (mListener.SubtitleShow)
-                event = new player_event(packet->getInfo().pts, (int64_t) (sizeof(IAFPacket)), (void *) (packet), mListener.SubtitleShow,
-                                         true);
+            if (subscribed(EVENT_SUBTITLE_SHOW)) {
+                auto *event = obtainEvent(packet->getInfo().pts, (int64_t) (sizeof(IAFPacket)), (void *) (packet),
+                                          mListener.SubtitleShow, true);
+                pushEvent(EVENT_SUBTITLE_SHOW, event);
+            }
         } else if (id == subTitle_event_hide) {
-            if (mListener.SubtitleHide)
-                event = new player_event(packet->getInfo().pts, (int64_t) (sizeof(IAFPacket)), (void *) (packet), mListener.SubtitleHide,
-                                         false, releaseIPacket);
+            if (subscribed(EVENT_SUBTITLE_HIDE)) {
+                auto *event = obtainEvent(packet->getInfo().pts, (int64_t) (sizeof(IAFPacket)), (void *) (packet),
+                                          mListener.SubtitleHide, false, releaseIPacket);
+                pushEvent(EVENT_SUBTITLE_HIDE, event);
+            }
         } else if (id == subTitle_event_ext_added) {
-            if (mListener.SubtitleExtAdd) {
-                event = new player_event(index, strdup(url), mListener.SubtitleExtAdd);
+            if (subscribed(EVENT_SUBTITLE_EXT_ADD)) {
+                auto *event = obtainEvent(index, strdup(url), mListener.SubtitleExtAdd);
+                pushEvent(EVENT_SUBTITLE_EXT_ADD, event);
             }
         }
-
-        if (event == nullptr) {
-            return;
-        }
-
-        pushEvent(event);
     }
 
     void PlayerNotifier::NotifyEvent(int code, const char *desc)
     {
-        if (!mEnable || mListener.EventCallback == nullptr) {
+        if (!subscribed(EVENT_EVENT)) {
             return;
         }
 
-        auto *event = new player_event(code, strdup(desc), mListener.EventCallback);
-        pushEvent(event);
+        auto *event = obtainEvent(code, strdup(desc), mListener.EventCallback);
+        pushEvent(EVENT_EVENT, event);
     }
 
     void PlayerNotifier::NotifyError(int code, const char *desc)
     {
-        if (!mEnable || mListener.ErrorCallback == nullptr) {
+        if (!subscribed(EVENT_ERROR)) {
             return;
         }
 
-        auto *event = new player_event(code, strdup(desc), mListener.ErrorCallback);
-        pushEvent(event);
+        auto *event = obtainEvent(code, strdup(desc), mListener.ErrorCallback);
+        pushEvent(EVENT_ERROR, event);
     }
 
     void PlayerNotifier::NotifyCompletion()
     {
-        if (!mEnable || mListener.Completion == nullptr) {
-            return;
-        }
-
-        NotifyVoidEvent(mListener.Completion);
+        NotifyVoidEvent(EVENT_COMPLETION, mListener.Completion);
     }
 
     void PlayerNotifier::NotifyLoopStart()
     {
-        if (!mEnable || mListener.LoopingStart == nullptr) {
-            return;
-        }
-
-        NotifyVoidEvent(mListener.LoopingStart);
+        NotifyVoidEvent(EVENT_LOOPING_START, mListener.LoopingStart);
     }
 
-    void PlayerNotifier::NotifyVoidEvent(playerVoidCallback listener)
+    void PlayerNotifier::NotifyVoidEvent(EventType type, playerVoidCallback listener)
     {
-        if (!mEnable) {
+        if (!subscribed(type)) {
             return;
         }
 
-        auto *event = new player_event(listener);
-        pushEvent(event);
+        auto *event = obtainEvent(listener);
+        pushEvent(type, event);
     }
 
     void PlayerNotifier::NotifySeeking(bool seekInCache) {
-        if (!mEnable) {
+        if (!subscribed(EVENT_SEEKING)) {
             return;
         }
 
-        auto *event = new player_event(seekInCache ? 1 : 0 , mListener.Seeking);
-        pushEvent(event);
+        auto *event = obtainEvent(seekInCache ? 1 : 0, mListener.Seeking);
+        pushEvent(EVENT_SEEKING, event);
     }
 
     void PlayerNotifier::NotifySeekEnd(bool seekInCache)
     {
-        if (!mEnable || mListener.SeekEnd == nullptr) {
+        if (!subscribed(EVENT_SEEK_END)) {
             return;
         }
 
-        auto *event = new player_event(seekInCache ? 1 : 0, mListener.SeekEnd);
-        pushEvent(event);
+        auto *event = obtainEvent(seekInCache ? 1 : 0, mListener.SeekEnd);
+        pushEvent(EVENT_SEEK_END, event);
     }
 
     void PlayerNotifier::NotifyStreamChanged(StreamInfo *info, StreamType type)
     {
-        if (!mEnable || mListener.StreamSwitchSuc == nullptr) {
+        if (!subscribed(EVENT_STREAM_SWITCH)) {
             return;
         }
 
-        auto *event = new player_event(type, info, mListener.StreamSwitchSuc, true);
-        pushEvent(event);
+        auto *event = obtainEvent(type, info, mListener.StreamSwitchSuc, true);
+        pushEvent(EVENT_STREAM_SWITCH, event);
     }
 
     void PlayerNotifier::NotifyPrepared()
     {
-        if (!mEnable || mListener.Prepared == nullptr) {
-            return;
-        }
-
-        NotifyVoidEvent(mListener.Prepared);
+        NotifyVoidEvent(EVENT_PREPARED, mListener.Prepared);
     }
 
     void PlayerNotifier::NotifyAutoPlayStart()
     {
-        if (!mEnable  || mListener.AutoPlayStart == nullptr) {
-            return;
-        }
-
-        NotifyVoidEvent(mListener.AutoPlayStart);
+        NotifyVoidEvent(EVENT_AUTO_PLAY_START, mListener.AutoPlayStart);
     }
 
     void PlayerNotifier::NotifyLoading(loading_event loadingEvent, int progress)
     {
-        if (!mEnable) {
-            return;
-        }
-
-        player_event *event = nullptr;
-
         if (loadingEvent == loading_event_start) {
-            if (mListener.LoadingStart) {
-                event = new player_event(mListener.LoadingStart);
-            }
+            NotifyVoidEvent(EVENT_LOADING_START, mListener.LoadingStart);
         } else if (loadingEvent == loading_event_end) {
-            if (mListener.LoadingEnd) {
-                event = new player_event(mListener.LoadingEnd);
-            }
+            NotifyVoidEvent(EVENT_LOADING_END, mListener.LoadingEnd);
         } else {
-            if (mListener.LoadingProgress) {
-                event = new player_event(progress, mListener.LoadingProgress);
+            if (!subscribed(EVENT_LOADING_PROGRESS) || coalesce(EVENT_LOADING_PROGRESS, progress, 0)) {
+                return;
             }
+
+            auto *event = obtainEvent(progress, mListener.LoadingProgress);
+            pushEvent(EVENT_LOADING_PROGRESS, event);
         }
+    }
 
-        if (event == nullptr) {
+    void PlayerNotifier::pushEvent(EventType type, player_event *event)
+    {
+        event->mType = type;
+        event->mGeneration = mStreamInfoGeneration;
+        event->mQueueTime = af_gettime_relative();
+
+        if (!mEventQueue.push(event)) {
+            AF_LOGE("event queue out of memory\n");
+            mSlots[type].pending = false;
+            recycleEvent(event);
             return;
         }
 
-        pushEvent(event);
+        mPushedCount++;
+        /*
+         * the notifier thread sets mWaiting before checking the queue the last time, the fences order the push
+         * before the load of mWaiting here, and the store of mWaiting before the pop there
+         */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (mWaiting) {
+            std::unique_lock<std::mutex> uMutex(mMutex);
+            mCondition.notify_one();
+        }
     }
 
-    void PlayerNotifier::pushEvent(player_event *event)
+    void PlayerNotifier::NotifyPlayerStatusChanged(PlayerStatus from, PlayerStatus to)
     {
-        std::unique_lock<std::mutex> uMutex(mMutex);
-        mEventQueue.push_back(unique_ptr<player_event>(event));
-        mCondition.notify_one();
+        if (!subscribed(EVENT_STATUS_CHANGED)) {
+            return;
+        }
+
+        auto *event = obtainEvent(from, to, mListener.StatusChanged);
+        pushEvent(EVENT_STATUS_CHANGED, event);
     }
 
-    void PlayerNotifier::NotifyPlayerStatusChanged(PlayerStatus from, PlayerStatus to)
+    void PlayerNotifier::dispatchEvent(player_event *event)
     {
-        if (!mEnable || mListener.StatusChanged == nullptr) {
+        if (event->mType == EVENT_STREAM_INFO && event->mGeneration != mStreamInfoGeneration) {
+            mDroppedCount++;
             return;
         }
 
-        auto *event = new player_event(from, to, mListener.StatusChanged);
-        pushEvent(event);
+        if ((1u << event->mType) & COALESCED_EVENTS) {
+            CoalescedSlot &slot = mSlots[event->mType];
+            // the values notified from now on need a new event
+            slot.pending = false;
+
+            while (slot.lock.test_and_set(std::memory_order_acquire)) {
+            }
+
+            event->setArgs(slot.arg1, slot.arg2);
+            slot.lock.clear(std::memory_order_release);
+        }
+
+        int64_t now = af_gettime_relative();
+        int64_t latency = now - event->mQueueTime;
+        mLatencySum += latency;
+
+        if (latency > mMaxLatency) {
+            mMaxLatency = latency;
+        }
+
+        if (mRateStartTime == INT64_MIN) {
+            mRateStartTime = now;
+        } else if (now - mRateStartTime >= 1000000) {
+            mEventRate = mRateCount * 1000000 / (now - mRateStartTime);
+            mRateStartTime = now;
+            mRateCount = 0;
+        }
+
+        mRateCount++;
+        mDispatchedCount++;
+        event->onEvent(mListener.userData);
     }
 
     int PlayerNotifier::post_loop()
@@ -454,28 +584,28 @@ namespace Cicada {
             return -1;
         }
 
-        std::unique_ptr<player_event> playerEvent = nullptr;
-        {
-            std::unique_lock<std::mutex> uMutex(mMutex);
+        player_event *event = nullptr;
 
-            if (mEventQueue.empty()) {
-                mCondition.wait(uMutex, [this]() {
-                    return !mRunning || !mEventQueue.empty();
-                });
+        if (!mEventQueue.pop(event)) {
+            std::unique_lock<std::mutex> uMutex(mMutex);
+            mWaiting = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
 
-                if (mEventQueue.empty()) {
-                    return 0;
-                }
+            // the events pushed before mWaiting set are popped here, the ones after wake up the wait
+            while (mRunning && !mEventQueue.pop(event)) {
+                // not only on the wakeup, a lost one delays an event no more than the timeout
+                mCondition.wait_for(uMutex, std::chrono::milliseconds(WAIT_TIMEOUT_MS));
             }
 
-            playerEvent = move(mEventQueue.front());
-            mEventQueue.pop_front();
-        }
+            mWaiting = false;
 
-        if (playerEvent != nullptr) {
-            playerEvent->onEvent(mListener.userData);
+            if (event == nullptr) {
+                return 0;
+            }
         }
 
+        dispatchEvent(event);
+        recycleEvent(event);
         return 0;
     }
 
@@ -486,10 +616,26 @@ namespace Cicada {
 
     void PlayerNotifier::Clean()
     {
-        std::unique_lock<std::mutex> uMutex(mMutex);
+        player_event *event = nullptr;
 
-        while (!mEventQueue.empty()) {
-            mEventQueue.pop_front();
+        while (mEventQueue.pop(event)) {
+            mSlots[event->mType].pending = false;
+            recycleEvent(event);
         }
     }
+
+    std::string PlayerNotifier::dumpStats()
+    {
+        int64_t dispatched = mDispatchedCount;
+        CicadaJSONItem json;
+        json.addValue("pushed", (double) mPushedCount);
+        json.addValue("coalesced", (double) mCoalescedCount);
+        json.addValue("dropped", (double) mDroppedCount);
+        json.addValue("dispatched", (double) dispatched);
+        json.addValue("allocated", (double) mAllocatedCount);
+        json.addValue("rate", (double) mEventRate);
+        json.addValue("avgLatencyUs", dispatched > 0 ? (double) (mLatencySum / dispatched) : 0.0);
+        json.addValue("maxLatencyUs", (double) mMaxLatency);
+        return json.printJSON();
+    }
 }
@@ -5,9 +5,12 @@
 #ifndef CICADA_PLAYER_PLAYER_NOTIFIER_H
 #define CICADA_PLAYER_PLAYER_NOTIFIER_H
 
-#include <list>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <string>
+#include <boost/lockfree/queue.hpp>
+#include <boost/lockfree/stack.hpp>
 //#include "apsara_player_event_def.h"
 #include "native_cicada_player_def.h"
 #include "utils/afThread.h"
@@ -27,6 +30,16 @@ namespace Cicada {
 
     class player_event;
 
+    /*
+     * The events are posted by the player threads and called back on the notifier thread.
+     *
+     * The events are taken from a pool and go through a lock free queue, the notifier thread is
+     * woken only when it's waiting, so a notify costs no allocation and no lock in playing.
+     * The events nobody listens to are not queued. The position, buffer position, loading progress
+     * and video rendered are coalesced, a new value replaces the one still in the queue, the
+     * listener gets the latest value once instead of all the old ones when the notifier thread is
+     * late.
+     */
     class PlayerNotifier {
     public:
         PlayerNotifier();
@@ -65,6 +78,9 @@ namespace Cicada {
 
         void NotifyCaptureScreen(uint8_t *buffer, int width, int height);
 
+        // takes the result and its data
+        void NotifySnapshot(int error, SnapshotResult *result);
+
         // Still support change status when Enable as false
         void NotifyPlayerStatusChanged(PlayerStatus from, PlayerStatus to);
 
@@ -80,22 +96,93 @@ namespace Cicada {
 
         void NotifySeeking(bool seekInCache);
 
-    private:
-
-        void NotifyVoidEvent(playerVoidCallback listener);
+        // events counts, the events allocated out of the pool, rate and the delay from notify to callback, in json
+        std::string dumpStats();
 
-        void pushEvent(player_event *event);
+    private:
+        enum EventType {
+            EVENT_LOOPING_START,
+            EVENT_PREPARED,
+            EVENT_COMPLETION,
+            EVENT_FIRST_FRAME,
+            EVENT_LOADING_START,
+            EVENT_LOADING_END,
+            EVENT_AUTO_PLAY_START,
+            EVENT_SEEKING,
+            EVENT_SEEK_END,
+            EVENT_POSITION,
+            EVENT_BUFFER_POSITION,
+            EVENT_LOADING_PROGRESS,
+            EVENT_VIDEO_SIZE_CHANGED,
+            EVENT_STATUS_CHANGED,
+            EVENT_VIDEO_RENDERED,
+            EVENT_ERROR,
+            EVENT_EVENT,
+            EVENT_STREAM_INFO,
+            EVENT_STREAM_SWITCH,
+            EVENT_CAPTURE_SCREEN,
+            EVENT_SUBTITLE_HIDE,
+            EVENT_SUBTITLE_SHOW,
+            EVENT_SUBTITLE_EXT_ADD,
+            EVENT_SNAPSHOT,
+            EVENT_TYPE_MAX,
+        };
+
+        // the latest value of a coalesced event type
+        struct CoalescedSlot {
+            std::atomic_flag lock = ATOMIC_FLAG_INIT;
+            int64_t arg1{0};
+            int64_t arg2{0};
+            // an event of the type is in queue, it will take the latest value
+            std::atomic_bool pending{false};
+        };
+
+        bool subscribed(EventType type) const
+        {
+            return mEnable && (mSubscribed.load(std::memory_order_relaxed) & (1u << type));
+        }
+
+        template<typename... Args>
+        player_event *obtainEvent(Args &&...args);
+
+        void recycleEvent(player_event *event);
+
+        // true if an event of the type is already in queue, it will take the values
+        bool coalesce(EventType type, int64_t arg1, int64_t arg2);
+
+        void NotifyVoidEvent(EventType type, playerVoidCallback listener);
+
+        void pushEvent(EventType type, player_event *event);
+
+        void dispatchEvent(player_event *event);
 
         int post_loop();
 
     private:
         playerListener mListener{nullptr};
-        std::list<std::unique_ptr<player_event>> mEventQueue;
+        std::atomic<uint32_t> mSubscribed{0};
+        boost::lockfree::queue<player_event *> mEventQueue;
+        boost::lockfree::stack<player_event *> mFreeEvents;
+        CoalescedSlot mSlots[EVENT_TYPE_MAX];
+        std::atomic_int mStreamInfoGeneration{0};
         std::mutex mMutex;
         afThread *mpThread;
         std::condition_variable mCondition;
+        std::atomic_bool mWaiting{false};
         bool mEnable = true;
         std::atomic_bool mRunning{true};
+
+        std::atomic<int64_t> mPushedCount{0};
+        std::atomic<int64_t> mCoalescedCount{0};
+        std::atomic<int64_t> mDroppedCount{0};
+        std::atomic<int64_t> mDispatchedCount{0};
+        // the events not taken from the pool
+        std::atomic<int64_t> mAllocatedCount{0};
+        std::atomic<int64_t> mLatencySum{0};
+        std::atomic<int64_t> mMaxLatency{0};
+        std::atomic<int64_t> mEventRate{0};
+        int64_t mRateStartTime{INT64_MIN};
+        int64_t mRateCount{0};
     };
 }
 
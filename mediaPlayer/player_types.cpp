@@ -29,6 +29,8 @@ namespace Cicada {
         startBufferDuration = START_BUFFER_DURATION_DEFAULT;
         highLevelBufferDuration = HIGH_BUFFERING_LEVEL_DEFAULT;
         maxBufferDuration = MAX_BUFFER_DURATION_DEFAULT;
+        highLevelBufferBytes = 0;
+        maxBufferBytes = 0;
         url = "";
         refer = "";
         timeout_ms = 15000;
@@ -27,6 +27,9 @@ namespace Cicada {
         int64_t startBufferDuration = 0;
         int64_t highLevelBufferDuration = 0;
         int64_t maxBufferDuration = 0;
+        // the limits of the packet bytes, work with the duration ones, <= 0 for no limit
+        int64_t highLevelBufferBytes = 0;
+        int64_t maxBufferBytes = 0;
         uint64_t lowMemSize = 0;
         std::string url{""};
         std::string refer{""};
@@ -0,0 +1,226 @@
+#define LOG_TAG "PreloadDataSource"
+
+#include "PreloadDataSource.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utils/errors/framework_error.h>
+#include <utils/frame_work_log.h>
+
+using namespace std;
+
+namespace Cicada {
+    PreloadDataSource PreloadDataSource::se(0);
+
+    void PreloadDataSource::init()
+    {
+        (void) &se;
+    }
+
+    PreloadDataSource::PreloadDataSource(const string &url) : IDataSource(url)
+    {
+    }
+
+    PreloadDataSource::~PreloadDataSource()
+    {
+        Close();
+    }
+
+    int PreloadDataSource::Open(int flags)
+    {
+        shared_ptr<PreloadManager::Item> item = PreloadManager::Instance()->takeItem(mUri);
+
+        if (item) {
+            mItem = item;
+        } else if (mItem && mItem->url != mUri) {
+            mItem = nullptr;
+        }
+
+        mPos = rangeStart != INT64_MIN ? rangeStart : 0;
+
+        if (mItem) {
+            AF_LOGI("open %s from preload, %lld bytes", mUri.c_str(), (long long) mItem->bytes);
+            mUpstreamOpened = false;
+            return 0;
+        }
+
+        return openUpstream();
+    }
+
+    int PreloadDataSource::Open(const string &url)
+    {
+        mUri = url;
+        return Open(0);
+    }
+
+    int PreloadDataSource::openUpstream()
+    {
+        int ret;
+
+        if (mUpstream == nullptr) {
+            if (mOpts) {
+                mUpstreamOpts = *mOpts;
+            }
+
+            PreloadManager::setBypass(mUpstreamOpts);
+            IDataSource *source = dataSourcePrototype::create(mUri, &mUpstreamOpts);
+            source->Set_config(mConfig);
+            source->Interrupt(mInterrupt);
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mUpstream = unique_ptr<IDataSource>(source);
+            }
+            mUpstream->setRange(mPos, rangeEnd);
+            ret = mUpstream->Open(0);
+        } else {
+            mUpstream->setRange(mPos, rangeEnd);
+            ret = mUpstream->Open(mUri);
+        }
+
+        mUpstreamOpened = ret >= 0;
+        mUpstreamPos = ret >= 0 ? mPos : -1;
+        return ret;
+    }
+
+    void PreloadDataSource::Close()
+    {
+        if (mUpstream) {
+            mUpstream->Close();
+        }
+
+        mUpstreamOpened = false;
+    }
+
+    int64_t PreloadDataSource::getEnd()
+    {
+        int64_t end = mItem ? mItem->fileSize : -1;
+
+        if (rangeEnd != INT64_MIN) {
+            end = end > 0 ? std::min(end, rangeEnd) : rangeEnd;
+        }
+
+        return end;
+    }
+
+    int64_t PreloadDataSource::Seek(int64_t offset, int whence)
+    {
+        if (mItem == nullptr) {
+            if (mUpstream == nullptr) {
+                return -(ESPIPE);
+            }
+
+            int64_t ret = mUpstream->Seek(offset, whence);
+
+            if (ret >= 0 && whence != SEEK_SIZE) {
+                mPos = mUpstreamPos = ret;
+            }
+
+            return ret;
+        }
+
+        if (whence == SEEK_SIZE) {
+            if (mItem->fileSize > 0 || !mUpstreamOpened) {
+                return mItem->fileSize;
+            }
+
+            return mUpstream->Seek(0, SEEK_SIZE);
+        }
+
+        if (whence == SEEK_CUR) {
+            offset += mPos;
+        } else if (whence == SEEK_END) {
+            if (mItem->fileSize <= 0) {
+                return -(ENOSYS);
+            }
+
+            offset += mItem->fileSize;
+        } else if (whence != SEEK_SET) {
+            return -(EINVAL);
+        }
+
+        if (offset < 0) {
+            return -(ESPIPE);
+        }
+
+        // the upstream follows on the next read out of the preloaded data
+        mPos = offset;
+        return offset;
+    }
+
+    int PreloadDataSource::Read(void *buf, size_t nbyte)
+    {
+        if (mItem) {
+            int64_t end = getEnd();
+
+            if (end > 0) {
+                if (mPos >= end) {
+                    return 0;
+                }
+
+                nbyte = (size_t) std::min((int64_t) nbyte, end - mPos);
+            }
+
+            auto size = (int64_t) nbyte;
+            const uint8_t *data = mItem->find(mPos, size);
+
+            if (data) {
+                memcpy(buf, data, (size_t) size);
+                mPos += size;
+                return (int) size;
+            }
+        }
+
+        if (mInterrupt) {
+            return FRAMEWORK_ERR_EXIT;
+        }
+
+        int64_t ret;
+
+        if (!mUpstreamOpened) {
+            AF_LOGD("read %s at %lld from network", mUri.c_str(), (long long) mPos);
+            ret = openUpstream();
+
+            if (ret < 0) {
+                return (int) ret;
+            }
+        } else if (mUpstreamPos != mPos) {
+            ret = mUpstream->Seek(mPos, SEEK_SET);
+
+            if (ret < 0) {
+                return (int) ret;
+            }
+
+            mUpstreamPos = mPos;
+        }
+
+        int size = mUpstream->Read(buf, nbyte);
+
+        if (size > 0) {
+            mPos += size;
+            mUpstreamPos += size;
+        }
+
+        return size;
+    }
+
+    void PreloadDataSource::Interrupt(bool interrupt)
+    {
+        IDataSource::Interrupt(interrupt);
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (mUpstream) {
+            mUpstream->Interrupt(interrupt);
+        }
+    }
+
+    string PreloadDataSource::GetOption(const string &key)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (mUpstream) {
+            return mUpstream->GetOption(key);
+        }
+
+        return IDataSource::GetOption(key);
+    }
+}// namespace Cicada
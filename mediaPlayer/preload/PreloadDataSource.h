@@ -0,0 +1,83 @@
+#ifndef CICADA_PLAYER_PRELOADDATASOURCE_H
+#define CICADA_PLAYER_PRELOADDATASOURCE_H
+
+#include "PreloadManager.h"
+#include <data_source/dataSourcePrototype.h>
+#include <memory>
+#include <mutex>
+
+namespace Cicada {
+    /*
+     * Serve an url from the data loaded by PreloadManager, the reads out of the preloaded ranges go to
+     * a network source created on demand. Reopen with another url (hls segments) takes the preloaded
+     * item of the new url if there is one.
+     */
+    class PreloadDataSource : public IDataSource, private dataSourcePrototype {
+    public:
+        explicit PreloadDataSource(const std::string &url);
+
+        ~PreloadDataSource() override;
+
+        int Open(int flags) override;
+
+        int Open(const std::string &url) override;
+
+        void Close() override;
+
+        int64_t Seek(int64_t offset, int whence) override;
+
+        int Read(void *buf, size_t nbyte) override;
+
+        void Interrupt(bool interrupt) override;
+
+        std::string GetOption(const std::string &key) override;
+
+        // the player library is not linked whole-archive, a call keeps the prototype linked
+        static void init();
+
+    private:
+        explicit PreloadDataSource(int dummy) : IDataSource("")
+        {
+            addPrototype(this);
+        }
+
+        IDataSource *clone(const std::string &uri) override
+        {
+            return new PreloadDataSource(uri);
+        }
+
+        bool is_supported(const std::string &uri) override
+        {
+            // also the items still loading, a miss is counted when opened
+            return PreloadManager::Instance()->hasItem(uri);
+        }
+
+        int probeScore(const std::string &uri, const options *opts) override
+        {
+            if (!PreloadManager::isBypass(opts) && is_supported(uri)) {
+                return SUPPORT_MAX;
+            }
+
+            return SUPPORT_NOT;
+        }
+
+        static PreloadDataSource se;
+
+    private:
+        int openUpstream();
+
+        int64_t getEnd();
+
+    private:
+        std::shared_ptr<PreloadManager::Item> mItem{nullptr};
+        std::unique_ptr<IDataSource> mUpstream{nullptr};
+        options mUpstreamOpts;
+        std::mutex mMutex;
+        int64_t mPos{0};
+        int64_t mUpstreamPos{-1};
+        bool mUpstreamOpened{false};
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_PRELOADDATASOURCE_H
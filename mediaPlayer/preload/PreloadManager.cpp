@@ -0,0 +1,515 @@
+#define LOG_TAG "PreloadManager"
+
+#include "PreloadManager.h"
+#include "PreloadDataSource.h"
+#include <algorithm>
+#include <cstring>
+#include <data_source/dataSourcePrototype.h>
+#include <sstream>
+#include <utils/CicadaJSON.h>
+#include <utils/af_string.h>
+#include <utils/frame_work_log.h>
+#include <utils/timer.h>
+
+#define BYPASS_KEY "preloadBypass"
+#define READ_BLOCK_SIZE (32 * 1024)
+#define MAX_BOX_SCAN 16
+#define HLS_HEADER "#EXTM3U"
+
+using namespace std;
+
+namespace Cicada {
+    PreloadManager PreloadManager::sInstance{};
+
+    const uint8_t *PreloadManager::Item::find(int64_t pos, int64_t &size) const
+    {
+        auto it = ranges.upper_bound(pos);
+
+        if (it == ranges.begin()) {
+            return nullptr;
+        }
+
+        --it;
+        int64_t end = it->first + (int64_t) it->second.size();
+
+        if (pos >= end) {
+            return nullptr;
+        }
+
+        size = std::min(size, end - pos);
+        return it->second.data() + (pos - it->first);
+    }
+
+    PreloadManager *PreloadManager::Instance()
+    {
+        return &sInstance;
+    }
+
+    PreloadManager::~PreloadManager()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopped = true;
+        }
+        stopWorkers();
+    }
+
+    bool PreloadManager::isBypass(const options *opts)
+    {
+        return opts != nullptr && !opts->get(BYPASS_KEY).empty();
+    }
+
+    void PreloadManager::setBypass(options &opts)
+    {
+        opts.set(BYPASS_KEY, "1");
+    }
+
+    void PreloadManager::setBudget(int64_t maxBytes, int maxConcurrency)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mMaxBytes = std::max(maxBytes, (int64_t) 0);
+        mMaxConcurrency = std::max(maxConcurrency, 1);
+    }
+
+    void PreloadManager::setItemBytes(int64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mItemBytes = std::max(bytes, (int64_t) READ_BLOCK_SIZE);
+    }
+
+    void PreloadManager::setUrls(const vector<string> &urls)
+    {
+        PreloadDataSource::init();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            map<string, int> ranks;
+
+            for (int i = 0; i < (int) urls.size(); i++) {
+                if (ranks.find(urls[i]) == ranks.end()) {
+                    ranks[urls[i]] = i;
+                }
+            }
+
+            for (auto it = mItems.begin(); it != mItems.end();) {
+                auto rank = ranks.find(it->second->root);
+
+                if (rank == ranks.end()) {
+                    auto drop = it++;
+                    dropItem(drop);
+                    continue;
+                }
+
+                it->second->rank = rank->second;
+                ++it;
+            }
+
+            for (auto &rank : ranks) {
+                if (mItems.find(rank.first) == mItems.end()) {
+                    shared_ptr<Item> item = make_shared<Item>();
+                    item->url = rank.first;
+                    item->root = rank.first;
+                    item->rank = rank.second;
+                    mItems[rank.first] = item;
+                }
+            }
+
+            mStopped = false;
+
+            while ((int) mWorkers.size() < mMaxConcurrency) {
+                afThread *worker = NEW_AF_THREAD(workLoop);
+                mWorkers.push_back(worker);
+                worker->start();
+            }
+        }
+        mCondition.notify_all();
+    }
+
+    void PreloadManager::clear()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopped = true;
+
+            for (auto it = mItems.begin(); it != mItems.end();) {
+                auto drop = it++;
+                dropItem(drop);
+            }
+        }
+        stopWorkers();
+    }
+
+    void PreloadManager::stopWorkers()
+    {
+        mCondition.notify_all();
+        vector<afThread *> workers;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            workers.swap(mWorkers);
+        }
+
+        for (auto worker : workers) {
+            worker->stop();
+            delete worker;
+        }
+    }
+
+    void PreloadManager::dropItem(map<string, shared_ptr<Item>>::iterator it)
+    {
+        shared_ptr<Item> item = it->second;
+        auto loading = mLoading.find(item);
+
+        if (loading != mLoading.end()) {
+            loading->second->Interrupt(true);
+        }
+
+        mWastedBytes += item->bytes;
+        mUsedBytes -= item->finished ? item->bytes : item->budget;
+        mItems.erase(it);
+    }
+
+    string PreloadManager::getStatistics()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        CicadaJSONItem item;
+        uint64_t total = mHits + mMisses;
+        item.addValue("hits", (double) mHits);
+        item.addValue("misses", (double) mMisses);
+        item.addValue("hitRate", total > 0 ? (double) mHits / total : 0.0);
+        item.addValue("preloadedBytes", (double) mPreloadedBytes);
+        item.addValue("wastedBytes", (double) mWastedBytes);
+        return item.printJSON();
+    }
+
+    bool PreloadManager::hasItem(const string &url) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mItems.find(url) != mItems.end();
+    }
+
+    shared_ptr<PreloadManager::Item> PreloadManager::takeItem(const string &url)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mItems.find(url);
+
+        if (it == mItems.end()) {
+            return nullptr;
+        }
+
+        shared_ptr<Item> item = it->second;
+
+        if (!item->finished || item->failed) {
+            if (!item->isChild) {
+                AF_LOGI("preload miss %s", url.c_str());
+                mMisses++;
+            }
+
+            return nullptr;
+        }
+
+        if (!item->isChild) {
+            mHits++;
+        }
+
+        // the memory is owned by the player now
+        mUsedBytes -= item->bytes;
+        mItems.erase(it);
+        mCondition.notify_all();
+        return item;
+    }
+
+    shared_ptr<PreloadManager::Item> PreloadManager::pickItem()
+    {
+        shared_ptr<Item> picked;
+
+        for (auto &it : mItems) {
+            const shared_ptr<Item> &item = it.second;
+
+            if (item->finished || mLoading.find(item) != mLoading.end()) {
+                continue;
+            }
+
+            // a child is needed before the next item of the same rank
+            if (picked == nullptr || item->rank < picked->rank || (item->rank == picked->rank && item->isChild && !picked->isChild)) {
+                picked = item;
+            }
+        }
+
+        if (picked == nullptr || mUsedBytes >= mMaxBytes) {
+            return nullptr;
+        }
+
+        picked->budget = std::min(mItemBytes, mMaxBytes - mUsedBytes);
+        mUsedBytes += picked->budget;
+        return picked;
+    }
+
+    int PreloadManager::workLoop()
+    {
+        shared_ptr<Item> item;
+        options opts;
+        setBypass(opts);
+        unique_ptr<IDataSource> source;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait_for(lock, std::chrono::milliseconds(100), [this, &item]() {
+                if (mStopped) {
+                    return true;
+                }
+
+                item = pickItem();
+                return item != nullptr;
+            });
+
+            if (mStopped || item == nullptr) {
+                return 0;
+            }
+
+            source = unique_ptr<IDataSource>(dataSourcePrototype::create(item->url, &opts));
+            mLoading[item] = source.get();
+        }
+        IDataSource::SourceConfig config{};
+        config.connect_time_out_ms = 5000;
+        config.low_speed_time_ms = 5000;
+        config.priority = IDataSource::SourceConfig::PriorityPrefetch;
+        source->Set_config(config);
+        int64_t start = af_getsteady_ms();
+        int ret = source->Open(0);
+
+        if (ret >= 0) {
+            item->fileSize = source->Seek(0, SEEK_SIZE);
+            ret = readRange(source.get(), item, 0, item->budget);
+        }
+
+        if (ret >= 0) {
+            int64_t moovOffset = findMoovOffset(item);
+
+            if (moovOffset > 0) {
+                // the moov is after mdat, it's needed before the first frame
+                AF_LOGD("load moov at %lld", (long long) moovOffset);
+                readRange(source.get(), item, moovOffset, item->budget - item->bytes);
+            }
+        }
+
+        source->Close();
+        bool isHls = ret >= 0 && item->ranges.size() == 1 && item->ranges.begin()->second.size() > strlen(HLS_HEADER)
+                     && memcmp(item->ranges.begin()->second.data(), HLS_HEADER, strlen(HLS_HEADER)) == 0;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mLoading.erase(item);
+            bool dropped = mItems.find(item->url) == mItems.end() || mItems[item->url] != item;
+
+            if (!dropped) {
+                mUsedBytes -= item->budget - item->bytes;
+                mPreloadedBytes += item->bytes;
+
+                if (ret < 0) {
+                    item->failed = true;
+                }
+            }
+
+            item->finished = true;
+            AF_LOGI("preload %s %s, %lld bytes in %lld ms", item->url.c_str(), dropped ? "dropped" : (ret < 0 ? "failed" : "done"),
+                    (long long) item->bytes, (long long) (af_getsteady_ms() - start));
+
+            if (isHls && !dropped) {
+                addHlsChildren(item);
+            }
+        }
+        mCondition.notify_all();
+        return 0;
+    }
+
+    int PreloadManager::readRange(IDataSource *source, const shared_ptr<Item> &item, int64_t offset, int64_t size)
+    {
+        if (size <= 0) {
+            return 0;
+        }
+
+        if (offset > 0 && source->Seek(offset, SEEK_SET) != offset) {
+            return -1;
+        }
+
+        vector<uint8_t> data;
+        int ret = 0;
+
+        while ((int64_t) data.size() < size) {
+            size_t old = data.size();
+            auto block = (size_t) std::min((int64_t) READ_BLOCK_SIZE, size - (int64_t) old);
+            data.resize(old + block);
+            ret = source->Read(data.data() + old, block);
+
+            if (ret <= 0) {
+                data.resize(old);
+                break;
+            }
+
+            data.resize(old + ret);
+        }
+
+        if (data.empty()) {
+            return ret < 0 ? ret : -1;
+        }
+
+        // chunked response, the size is known at eof
+        if (ret == 0 && item->fileSize <= 0) {
+            item->fileSize = offset + (int64_t) data.size();
+        }
+
+        item->bytes += data.size();
+        // merge with the range before if it's adjacent
+        auto it = item->ranges.upper_bound(offset);
+
+        if (it != item->ranges.begin()) {
+            --it;
+
+            if (it->first + (int64_t) it->second.size() == offset) {
+                it->second.insert(it->second.end(), data.begin(), data.end());
+                return 0;
+            }
+        }
+
+        item->ranges[offset] = std::move(data);
+        return 0;
+    }
+
+    static uint64_t readBE(const uint8_t *p, int size)
+    {
+        uint64_t value = 0;
+
+        for (int i = 0; i < size; i++) {
+            value = (value << 8) | p[i];
+        }
+
+        return value;
+    }
+
+    int64_t PreloadManager::findMoovOffset(const shared_ptr<Item> &item)
+    {
+        int64_t size = 16;
+        const uint8_t *p = item->find(0, size);
+
+        // not a mp4, or unknown size
+        if (p == nullptr || size < 8 || memcmp(p + 4, "ftyp", 4) != 0 || item->fileSize <= 0) {
+            return -1;
+        }
+
+        int64_t pos = 0;
+
+        for (int i = 0; i < MAX_BOX_SCAN && pos + 8 <= item->fileSize; i++) {
+            size = 16;
+            p = item->find(pos, size);
+
+            // the box header is out of the preloaded data, load from here
+            if (p == nullptr || size < 16) {
+                return pos;
+            }
+
+            uint64_t boxSize = readBE(p, 4);
+
+            if (boxSize == 1) {
+                boxSize = readBE(p + 8, 8);
+            } else if (boxSize == 0) {
+                boxSize = item->fileSize - pos;
+            }
+
+            if (memcmp(p + 4, "moov", 4) == 0) {
+                int64_t loaded = boxSize;
+                p = item->find(pos, loaded);
+                // load the rest of moov
+                return loaded < (int64_t) boxSize ? pos + loaded : -1;
+            }
+
+            if (boxSize < 8) {
+                return -1;
+            }
+
+            pos += boxSize;
+        }
+
+        return -1;
+    }
+
+    void PreloadManager::addChild(const shared_ptr<Item> &parent, const string &url)
+    {
+        string absolute = AfString::make_absolute_url(parent->url, url);
+
+        if (mItems.find(absolute) != mItems.end()) {
+            return;
+        }
+
+        shared_ptr<Item> child = make_shared<Item>();
+        child->url = absolute;
+        child->root = parent->root;
+        child->rank = parent->rank;
+        child->isChild = true;
+        mItems[absolute] = child;
+    }
+
+    void PreloadManager::addHlsChildren(const shared_ptr<Item> &item)
+    {
+        const vector<uint8_t> &data = item->ranges.begin()->second;
+        istringstream stream(string(data.begin(), data.end()));
+        string line;
+        bool isMaster = false;
+        bool streamInf = false;
+        bool endList = false;
+        string firstSegment;
+        string initSection;
+
+        while (getline(stream, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+
+            if (line.empty()) {
+                continue;
+            }
+
+            if (line[0] == '#') {
+                if (line.compare(0, 18, "#EXT-X-STREAM-INF:") == 0) {
+                    isMaster = true;
+                    streamInf = true;
+                } else if (line.compare(0, 14, "#EXT-X-ENDLIST") == 0) {
+                    endList = true;
+                } else if (line.compare(0, 11, "#EXT-X-MAP:") == 0 && initSection.empty()) {
+                    size_t start = line.find("URI=\"");
+                    size_t end = start == string::npos ? string::npos : line.find('"', start + 5);
+
+                    if (end != string::npos) {
+                        initSection = line.substr(start + 5, end - start - 5);
+                    }
+                }
+
+                continue;
+            }
+
+            // the player starts from the first variant
+            if (streamInf) {
+                addChild(item, line);
+                return;
+            }
+
+            if (!isMaster && firstSegment.empty()) {
+                firstSegment = line;
+            }
+        }
+
+        if (isMaster) {
+            return;
+        }
+
+        // a live playlist is outdated soon, only the connection is warmed
+        if (!endList) {
+            item->failed = true;
+            return;
+        }
+
+        if (!initSection.empty()) {
+            addChild(item, initSection);
+        }
+
+        if (!firstSegment.empty()) {
+            addChild(item, firstSegment);
+        }
+    }
+}// namespace Cicada
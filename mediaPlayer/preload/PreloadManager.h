@@ -0,0 +1,130 @@
+#ifndef CICADA_PLAYER_PRELOADMANAGER_H
+#define CICADA_PLAYER_PRELOADMANAGER_H
+
+#include <atomic>
+#include <base/options.h>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utils/afThread.h>
+#include <vector>
+
+namespace Cicada {
+    class IDataSource;
+
+    /*
+     * Warm the upcoming items of a feed before the user swipes to them.
+     *
+     * Given a ranked list of urls, the items are loaded in background in rank order, by at most
+     * maxConcurrency loaders and at most maxBytes in total:
+     *  - mp4 and other files: the first itemBytes of the file, plus the moov box if it is at the tail.
+     *  - hls: the master and the first media playlist, the init section and the first segment.
+     * The dns cache and the tls session are shared by all the curl sources, loading the data warms them too.
+     *
+     * A loaded item is served once by PreloadDataSource, which is picked by dataSourcePrototype for any
+     * url in the store, so a later Prepare demuxes and probes the first data from memory, and goes to the
+     * network only for the data out of the preloaded ranges.
+     */
+    class PreloadManager {
+    public:
+        // the cached ranges of an url, shared with the PreloadDataSource serving it
+        class Item {
+        public:
+            std::string url;
+            std::string root;// the url in the ranked list, a hls item adds its playlist and segments
+            int rank{0};
+            bool isChild{false};
+            int64_t fileSize{-1};
+            std::map<int64_t, std::vector<uint8_t>> ranges;// offset --> data
+            int64_t bytes{0};
+            int64_t budget{0};// the bytes reserved from the total budget when loading
+            std::atomic_bool finished{false};
+            std::atomic_bool failed{false};
+
+            // the data in [pos, pos + size), nullptr if not cached
+            const uint8_t *find(int64_t pos, int64_t &size) const;
+        };
+
+        static PreloadManager *Instance();
+
+        // total bytes of all the items, and the count of the items loading at the same time
+        void setBudget(int64_t maxBytes, int maxConcurrency);
+
+        // the head bytes loaded for each file item
+        void setItemBytes(int64_t bytes);
+
+        /*
+         * the urls will be played, the most likely first
+         * the items not in the list anymore are canceled and dropped
+         */
+        void setUrls(const std::vector<std::string> &urls);
+
+        void clear();
+
+        /*
+         * a json object:
+         * hits: opened with a loaded item, misses: opened when the item not loaded yet,
+         * hitRate, preloadedBytes, wastedBytes: the bytes of the items dropped without played
+         */
+        std::string getStatistics();
+
+        // called by PreloadDataSource, the url is in the list, loaded or not, no statistics counted
+        bool hasItem(const std::string &url) const;
+
+        // the loaded item of the url opened, nullptr and counted as a miss if not loaded yet
+        std::shared_ptr<Item> takeItem(const std::string &url);
+
+        // options mark the sources created by the preload, dataSourcePrototype shouldn't return preload source for them
+        static bool isBypass(const options *opts);
+
+        static void setBypass(options &opts);
+
+    private:
+        PreloadManager() = default;
+
+        ~PreloadManager();
+
+        int workLoop();
+
+        std::shared_ptr<Item> pickItem();
+
+        int loadItem(const std::shared_ptr<Item> &item);
+
+        int readRange(IDataSource *source, const std::shared_ptr<Item> &item, int64_t offset, int64_t size);
+
+        int64_t findMoovOffset(const std::shared_ptr<Item> &item);
+
+        void addHlsChildren(const std::shared_ptr<Item> &item);
+
+        void addChild(const std::shared_ptr<Item> &parent, const std::string &url);
+
+        void dropItem(std::map<std::string, std::shared_ptr<Item>>::iterator it);
+
+        void stopWorkers();
+
+    private:
+        static PreloadManager sInstance;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mCondition;
+        std::map<std::string, std::shared_ptr<Item>> mItems;
+        std::map<std::shared_ptr<Item>, IDataSource *> mLoading;
+        std::vector<afThread *> mWorkers;
+        int64_t mMaxBytes{8 * 1024 * 1024};
+        int64_t mItemBytes{1024 * 1024};
+        int mMaxConcurrency{2};
+        int64_t mUsedBytes{0};
+        bool mStopped{false};
+
+        uint64_t mHits{0};
+        uint64_t mMisses{0};
+        int64_t mPreloadedBytes{0};
+        int64_t mWastedBytes{0};
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_PRELOADMANAGER_H
@@ -80,10 +80,41 @@ namespace Cicada {
             return -EINVAL;
         }
 
+        if (mSeekPts != INT64_MIN) {
+            // a cue starting before the seek time may not be ended
+            while (!mEos && mCues.lastStart() <= mSeekPts && loadCue() >= 0) {
+            }
+
+            mCurrent = mCues.seek(mSeekPts);
+            mSeekPts = INT64_MIN;
+        }
+
+        if (mCurrent >= mCues.size()) {
+            int ret = loadCue();
+
+            if (mCurrent >= mCues.size()) {
+                return ret;
+            }
+        }
+
+        packet = mCues.at(mCurrent++)->clone();
+        packet->getInfo().streamIndex = mId;
+        return static_cast<int>(packet->getSize());
+    }
+
+    int subTitleSource::loadCue()
+    {
+        if (mEos) {
+            return 0;
+        }
+
+        unique_ptr<IAFPacket> packet;
         int ret = mDemuxer->readPacket(packet, 0);
 
         if (packet) {
-            packet->getInfo().streamIndex = mId;
+            mCues.add(move(packet));
+        } else if (ret != -EAGAIN) {
+            mEos = true;
         }
 
         return ret;
@@ -95,7 +126,8 @@ namespace Cicada {
             return -EINVAL;
         }
 
-        return mDemuxer->Seek(pts, 0, -1);
+        mSeekPts = pts;
+        return 0;
     }
 
     void subTitleSource::setID(int id)
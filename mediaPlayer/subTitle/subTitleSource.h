@@ -6,11 +6,17 @@
 #define CICADAPLAYERSDK_SUBTITLESOURCE_H
 
 #include <data_source/IDataSource.h>
+#include <demuxer/SubtitleCueIndex.h>
 #include <demuxer/demuxer_service.h>
 #include <base/OptionOwner.h>
 
 namespace Cicada {
 
+    /*
+     * The cues are read from the demuxer into mCues when needed, a seek loads the cues starting
+     * before the seek time only, a cue is read from mCues in the start order from the first one
+     * not ended at the seek time.
+     */
     class subTitleSource : public OptionOwner {
     public:
         explicit subTitleSource(std::string uri);
@@ -48,11 +54,19 @@ namespace Cicada {
 //            }
 //        };
 
+    private:
+        // read a cue from the demuxer to mCues
+        int loadCue();
+
     private:
         std::unique_ptr<IDataSource> mDataSource{nullptr};
         std::unique_ptr<demuxer_service> mDemuxer{nullptr};
         int mId = -1;
         std::string mUrl;
+        SubtitleCueIndex mCues;
+        size_t mCurrent{0};
+        int64_t mSeekPts{INT64_MIN};
+        bool mEos{false};
 
     };
 }
@@ -5,10 +5,15 @@
 #include "tests/mediaPlayerTest.h"
 #include "tests/player_command.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <cstdio>
+#include <data_source/dataSourcePrototype.h>
 #include <memory>
+#include <utils/CicadaJSON.h>
 #include <utils/AFUtils.h>
 #include <utils/frame_work_log.h>
 #include <utils/mediaFrame.h>
+#include <utils/pcm_utils.h>
 #include <utils/timer.h>
 #include <vector>
 
@@ -241,6 +246,53 @@ TEST(config, set)
                 nullptr, nullptr);
 }
 
+static int setBufferMemoryOnCallback(Cicada::MediaPlayer *player, void *arg)
+{
+    Cicada::MediaPlayerConfig config;
+    config.highBufferDuration = 5000;
+    config.maxBufferDuration = 60 * 1000;
+    // reached long before the duration ones
+    config.highBufferMemory = 256;
+    config.maxBufferMemory = 512;
+    player->SetConfig(&config);
+    return 0;
+}
+
+struct bufferMemoryCase {
+    int64_t start{0};
+    int64_t maxBytes{0};
+};
+
+static int bufferMemoryLoop(Cicada::MediaPlayer *player, void *arg)
+{
+    auto *testCase = static_cast<bufferMemoryCase *>(arg);
+
+    if (testCase->start == 0) {
+        testCase->start = af_getsteady_ms();
+    }
+
+    int64_t bytes = player->GetPropertyLong(PROPERTY_KEY_BUFFER_BYTES);
+    testCase->maxBytes = std::max(testCase->maxBytes, bytes);
+    // the reading stops at the limit, a read batch of a few packets may pass it
+    EXPECT_LE(bytes, (512 + 128) * 1024);
+
+    if (af_getsteady_ms() - testCase->start > 10000) {
+        return -1;
+    }
+
+    af_msleep(20);
+    return 0;
+}
+
+TEST(config, bufferMemory)
+{
+    bufferMemoryCase testCase;
+    test_simple("http://player.alicdn.com/video/aliyunmedia.mp4", setBufferMemoryOnCallback, bufferMemoryLoop,
+                &testCase, nullptr);
+    // the buffer was filled to the high level, 5s of the video is far more than 256k
+    ASSERT_GE(testCase.maxBytes, 256 * 1024);
+}
+
 bool OnRenderFrame(void *userData, IAFFrame *frame)
 {
     if (frame->getType() == IAFFrame::FrameTypeVideo) {
@@ -261,6 +313,15 @@ bool OnRenderFrame(void *userData, IAFFrame *frame)
             default:
                 break;
         }
+    } else if (frame->getType() == IAFFrame::FrameTypeAudio) {
+        const IAFFrame::audioInfo &audio = frame->getInfo().audio;
+        // the first channel of a planar frame
+        int count = audio.nb_samples * (audio.format >= AF_SAMPLE_FMT_U8P ? 1 : audio.channels);
+        float peak, rms;
+
+        if (meterPCM(frame->getData()[0], (enum AFSampleFormat) audio.format, count, &peak, &rms) >= 0) {
+            AF_LOGD("audio peak %f rms %f", peak, rms);
+        }
     }
     return false;
 }
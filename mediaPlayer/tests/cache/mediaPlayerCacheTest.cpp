@@ -2,14 +2,21 @@
 // Created by moqi on 2020/1/14.
 //
 
+#include "buffer_controller.h"
 #include "tests/mediaPlayerTest.h"
 #include "tests/player_command.h"
 #include "gtest/gtest.h"
+#include <base/media/subTitlePacket.h>
 #include <data_source/SourceReader.h>
 #include <data_source/cachedSource.h>
+#include <data_source/dataSourcePrototype.h>
+#include <demuxer/demuxer_service.h>
+#include <cacheModule/cache/CacheFileRemuxer.h>
+#include <cstring>
 #include <memory>
 #include <utils/AFUtils.h>
 #include <utils/frame_work_log.h>
+#include <utils/mediaFrame.h>
 #include <utils/timer.h>
 #include <vector>
 
@@ -74,3 +81,275 @@ TEST(cache, cachedSource)
     g_reader = nullptr;
 }
 
+
+static void teeBenchmark(bool tee, const vector<unique_ptr<IAFPacket>> &packets, const vector<StreamType> &types,
+                         const vector<Stream_meta *> &metas)
+{
+    CacheFileRemuxer remuxer("/tmp/Cicada/teeBenchmark.mp4", "");
+    remuxer.setStreamMeta(&metas);
+
+    if (tee) {
+        ASSERT_TRUE(remuxer.prepare());
+        remuxer.start();
+    }
+
+    int64_t start = af_gettime_relative();
+
+    // the player loop: the demuxed packet goes to the buffer, and to the cache if enabled
+    for (auto &packet : packets) {
+        unique_ptr<IAFPacket> buffered = packet->clone();
+
+        if (tee) {
+            remuxer.addFrame(buffered.get(), types[buffered->getInfo().streamIndex]);
+        }
+    }
+
+    int64_t used = af_gettime_relative() - start;
+    AF_LOGI("cache %s: %d packets, %.3f us per packet", tee ? "on" : "off", (int) packets.size(),
+            (double) used / packets.size());
+
+    if (tee) {
+        remuxer.addFrame(nullptr, ST_TYPE_UNKNOWN);
+    }
+
+    remuxer.stop();
+}
+
+TEST(cache, teeBenchmark)
+{
+    std::string url = "http://player.alicdn.com/video/aliyunmedia.mp4";
+    auto source = dataSourcePrototype::create(url);
+    source->Open(0);
+    unique_ptr<demuxer_service> service = unique_ptr<demuxer_service>(new demuxer_service(source));
+    int ret = service->initOpen();
+    ASSERT_GE(ret, 0);
+    vector<Stream_meta *> metas;
+    vector<StreamType> types;
+
+    for (int i = 0; i < service->GetNbStreams(); i++) {
+        auto *meta = static_cast<Stream_meta *>(malloc(sizeof(Stream_meta)));
+        memset(meta, 0, sizeof(Stream_meta));
+        service->GetStreamMeta(meta, i, false);
+        types.push_back(meta->type == STREAM_TYPE_VIDEO ? ST_TYPE_VIDEO
+                                                        : meta->type == STREAM_TYPE_AUDIO ? ST_TYPE_AUDIO : ST_TYPE_UNKNOWN);
+        metas.push_back(meta);
+        service->OpenStream(i);
+    }
+
+    // demux first, measure the tee only
+    vector<unique_ptr<IAFPacket>> packets;
+
+    while (packets.size() < 5000) {
+        unique_ptr<IAFPacket> packet;
+
+        if (service->readPacket(packet) <= 0 || packet == nullptr) {
+            break;
+        }
+
+        packets.push_back(move(packet));
+    }
+
+    ASSERT_FALSE(packets.empty());
+    teeBenchmark(false, packets, types, metas);
+    teeBenchmark(true, packets, types, metas);
+    packets.clear();
+
+    for (auto &meta : metas) {
+        releaseMeta(meta);
+        free(meta);
+    }
+
+    service->close();
+    delete source;
+}
+
+static void bufferBenchmark(int batchSize, const vector<unique_ptr<IAFPacket>> &packets, const vector<BUFFER_TYPE> &types,
+                            int64_t &duration, int64_t &bytes)
+{
+    BufferController buffer;
+    vector<unique_ptr<IAFPacket>> batch[2];
+    int count = 0;
+    int64_t start = af_gettime_relative();
+
+    // the player loop: a batch of packets goes to the buffer, the buffer is checked after every batch
+    for (auto &packet : packets) {
+        BUFFER_TYPE type = types[packet->getInfo().streamIndex];
+
+        if (type != BUFFER_TYPE_VIDEO && type != BUFFER_TYPE_AUDIO) {
+            continue;
+        }
+
+        batch[type == BUFFER_TYPE_VIDEO ? 0 : 1].push_back(packet->clone());
+
+        if (++count < batchSize) {
+            continue;
+        }
+
+        buffer.AddPackets(batch[0], BUFFER_TYPE_VIDEO);
+        buffer.AddPackets(batch[1], BUFFER_TYPE_AUDIO);
+        count = 0;
+        duration = min(buffer.GetPacketDuration(BUFFER_TYPE_VIDEO), buffer.GetPacketDuration(BUFFER_TYPE_AUDIO));
+        bytes = buffer.GetPacketBytes(BUFFER_TYPE_AV);
+    }
+
+    buffer.AddPackets(batch[0], BUFFER_TYPE_VIDEO);
+    buffer.AddPackets(batch[1], BUFFER_TYPE_AUDIO);
+    duration = min(buffer.GetPacketDuration(BUFFER_TYPE_VIDEO), buffer.GetPacketDuration(BUFFER_TYPE_AUDIO));
+    bytes = buffer.GetPacketBytes(BUFFER_TYPE_AV);
+    int64_t used = af_gettime_relative() - start;
+    AF_LOGI("batch %d: %d packets, %.0f packets per second", batchSize, (int) packets.size(),
+            used > 0 ? (double) packets.size() * 1000000 / used : 0.0);
+}
+
+TEST(buffer, batchBenchmark)
+{
+    std::string url = "http://player.alicdn.com/video/aliyunmedia.mp4";
+    auto source = dataSourcePrototype::create(url);
+    source->Open(0);
+    unique_ptr<demuxer_service> service = unique_ptr<demuxer_service>(new demuxer_service(source));
+    int ret = service->initOpen();
+    ASSERT_GE(ret, 0);
+    vector<BUFFER_TYPE> types;
+
+    for (int i = 0; i < service->GetNbStreams(); i++) {
+        Stream_meta meta{};
+        service->GetStreamMeta(&meta, i, false);
+        types.push_back(meta.type == STREAM_TYPE_VIDEO ? BUFFER_TYPE_VIDEO
+                                                       : meta.type == STREAM_TYPE_AUDIO ? BUFFER_TYPE_AUDIO : BUFFER_TYPE_SUBTITLE);
+        releaseMeta(&meta);
+        service->OpenStream(i);
+    }
+
+    // demux first, measure the buffer only
+    vector<unique_ptr<IAFPacket>> packets;
+
+    while (packets.size() < 5000) {
+        unique_ptr<IAFPacket> packet;
+
+        if (service->readPacket(packet) <= 0 || packet == nullptr) {
+            break;
+        }
+
+        packets.push_back(move(packet));
+    }
+
+    ASSERT_FALSE(packets.empty());
+    int64_t duration = 0;
+    int64_t bytes = 0;
+    int64_t batchDuration = 0;
+    int64_t batchBytes = 0;
+    bufferBenchmark(1, packets, types, duration, bytes);
+    bufferBenchmark(32, packets, types, batchDuration, batchBytes);
+    ASSERT_EQ(duration, batchDuration);
+    ASSERT_EQ(bytes, batchBytes);
+    packets.clear();
+    service->close();
+    delete source;
+}
+
+TEST(buffer, spliceNotAlignedGop)
+{
+    BufferController buffer;
+    uint8_t data[16]{};
+    const int64_t frameDuration = 40000;
+
+    // the old rendition, 25 fps, a key frame every 2s
+    for (int i = 0; i < 150; i++) {
+        int64_t pos = i * frameDuration;
+        unique_ptr<IAFPacket> packet(new subTitlePacket(data, sizeof(data), pos, frameDuration));
+        packet->getInfo().timePosition = pos;
+        packet->getInfo().flags = (pos % 2000000 == 0) ? AF_PKT_FLAG_KEY : 0;
+        buffer.AddPacket(move(packet), BUFFER_TYPE_VIDEO);
+    }
+
+    // the new rendition starts with a key frame between two old frames and two old key frames
+    int64_t splicePos = 3020000;
+    ASSERT_EQ(150 - 76, buffer.ClearPacketFromTimePosition(BUFFER_TYPE_VIDEO, splicePos));
+    ASSERT_EQ(76, buffer.GetPacketSize(BUFFER_TYPE_VIDEO));
+    ASSERT_LT(buffer.GetPacketLastTimePos(BUFFER_TYPE_VIDEO), splicePos);
+    ASSERT_EQ(0, buffer.GetPacketFirstTimePos(BUFFER_TYPE_VIDEO));
+    ASSERT_EQ(76 * frameDuration, buffer.GetPacketDuration(BUFFER_TYPE_VIDEO));
+
+    // nothing after the last packet, nothing cleared
+    ASSERT_EQ(0, buffer.ClearPacketFromTimePosition(BUFFER_TYPE_VIDEO, 10000000));
+    ASSERT_EQ(76, buffer.GetPacketSize(BUFFER_TYPE_VIDEO));
+}
+
+TEST(buffer, switchClearAfterTimePosition)
+{
+    uint8_t data[16]{};
+    // decode order, the B frames are shown before the P frame decoded before them
+    const int64_t positions[] = {0, 120000, 40000, 80000, 240000, 160000, 200000};
+    BufferController switchBuffer;
+    BufferController spliceBuffer;
+
+    for (int64_t pos : positions) {
+        for (BufferController *buffer : {&switchBuffer, &spliceBuffer}) {
+            unique_ptr<IAFPacket> packet(new subTitlePacket(data, sizeof(data), pos, 40000));
+            packet->getInfo().timePosition = pos;
+            packet->getInfo().flags = pos == 0 ? AF_PKT_FLAG_KEY : 0;
+            buffer->AddPacket(move(packet), BUFFER_TYPE_VIDEO);
+        }
+    }
+
+    // SwitchVideo clears back to the packet at the position, the frames decoded before it are kept
+    switchBuffer.ClearPacketAfterTimePosition(BUFFER_TYPE_VIDEO, 160000);
+    ASSERT_EQ(5, switchBuffer.GetPacketSize(BUFFER_TYPE_VIDEO));
+    ASSERT_EQ(240000, switchBuffer.GetPacketLastTimePos(BUFFER_TYPE_VIDEO));
+
+    // the splice clears from the first packet at or after the position in decode order
+    ASSERT_EQ(3, spliceBuffer.ClearPacketFromTimePosition(BUFFER_TYPE_VIDEO, 160000));
+    ASSERT_EQ(4, spliceBuffer.GetPacketSize(BUFFER_TYPE_VIDEO));
+    ASSERT_EQ(80000, spliceBuffer.GetPacketLastTimePos(BUFFER_TYPE_VIDEO));
+}
+
+TEST(buffer, bytes)
+{
+    BufferController buffer;
+    uint8_t data[100]{};
+    const int64_t frameDuration = 40000;
+    // the packet i has 10 + i bytes
+    auto addPacket = [&](int i, BUFFER_TYPE type) {
+        int64_t pos = i * frameDuration;
+        unique_ptr<IAFPacket> packet(new subTitlePacket(data, 10 + i, pos, frameDuration));
+        packet->getInfo().timePosition = pos;
+        packet->getInfo().flags = i % 5 == 0 ? AF_PKT_FLAG_KEY : 0;
+        buffer.AddPacket(move(packet), type);
+    };
+
+    for (int i = 0; i < 10; i++) {
+        addPacket(i, BUFFER_TYPE_VIDEO);
+    }
+
+    vector<unique_ptr<IAFPacket>> batch;
+
+    for (int i = 0; i < 4; i++) {
+        batch.push_back(unique_ptr<IAFPacket>(new subTitlePacket(data, 50, i * frameDuration, frameDuration)));
+    }
+
+    buffer.AddPackets(batch, BUFFER_TYPE_AUDIO);
+    addPacket(0, BUFFER_TYPE_SUBTITLE);
+    // 10 + 11 + ... + 19
+    ASSERT_EQ(145, buffer.GetPacketBytes(BUFFER_TYPE_VIDEO));
+    ASSERT_EQ(200, buffer.GetPacketBytes(BUFFER_TYPE_AUDIO));
+    ASSERT_EQ(345, buffer.GetPacketBytes(BUFFER_TYPE_AV));
+    ASSERT_EQ(355, buffer.GetPacketBytes(BUFFER_TYPE_ALL));
+
+    // every way out of the queue takes the bytes of the packets with it
+    unique_ptr<IAFPacket> packet = buffer.getPacket(BUFFER_TYPE_VIDEO);
+    ASSERT_EQ(10, packet->getSize());
+    ASSERT_EQ(135, buffer.GetPacketBytes(BUFFER_TYPE_VIDEO));
+    ASSERT_EQ(2, buffer.ClearPacketBeforeTimePos(BUFFER_TYPE_VIDEO, 3 * frameDuration));
+    ASSERT_EQ(135 - 11 - 12, buffer.GetPacketBytes(BUFFER_TYPE_VIDEO));
+    ASSERT_EQ(3, buffer.ClearPacketFromTimePosition(BUFFER_TYPE_VIDEO, 7 * frameDuration));
+    ASSERT_EQ(13 + 14 + 15 + 16, buffer.GetPacketBytes(BUFFER_TYPE_VIDEO));
+    buffer.ClearPacketAfterTimePosition(BUFFER_TYPE_VIDEO, 5 * frameDuration);
+    ASSERT_EQ(13 + 14, buffer.GetPacketBytes(BUFFER_TYPE_VIDEO));
+    ASSERT_EQ(200, buffer.GetPacketBytes(BUFFER_TYPE_AUDIO));
+
+    buffer.ClearPacket(BUFFER_TYPE_AV);
+    ASSERT_EQ(0, buffer.GetPacketBytes(BUFFER_TYPE_AV));
+    ASSERT_EQ(10, buffer.GetPacketBytes(BUFFER_TYPE_ALL));
+    buffer.ClearPacket(BUFFER_TYPE_SUBTITLE);
+    ASSERT_EQ(0, buffer.GetPacketBytes(BUFFER_TYPE_ALL));
+}
@@ -0,0 +1,68 @@
+#include "SMPLiveLatencyController.h"
+#include "gtest/gtest.h"
+
+using namespace Cicada;
+
+TEST(liveLatency, speedAndDrop)
+{
+    SMPLiveLatencyController controller;
+    const int64_t second = 1000 * 1000;
+    int64_t now = 0;
+    ASSERT_LT(controller.update(2 * second, now), 0);
+    controller.setEnable(true);
+    // no target latency before the playlist durations are known
+    ASSERT_LT(controller.update(2 * second, now), 0);
+
+    // LL-HLS, 1s parts, the target is 3 parts
+    controller.setStreamDurations(6 * second, second);
+    ASSERT_EQ(3 * second, controller.getTargetLatency());
+    ASSERT_EQ(0.0f, controller.update(2 * second, now));
+    ASSERT_FALSE(controller.needDrop());
+
+    // 2s behind the target, speed up to the max but not more
+    float speed = 0;
+
+    for (int i = 0; i < 50; i++) {
+        now += second;
+        float ret = controller.update(4 * second, now);
+        ASSERT_LE(ret, SMPLiveLatencyController::MAX_SPEED);
+
+        if (ret > 0) {
+            speed = ret;
+        }
+    }
+
+    ASSERT_FLOAT_EQ(SMPLiveLatencyController::MAX_SPEED, speed);
+    // not corrected again before the render takes the new rate
+    ASSERT_EQ(0.0f, controller.update(0, now + 100 * 1000));
+    ASSERT_FALSE(controller.needDrop());
+
+    // the player gives the rate back, the next correction is at once
+    controller.resetSpeed();
+    ASSERT_FLOAT_EQ(1.0f, controller.getSpeed());
+    ASSERT_FLOAT_EQ(SMPLiveLatencyController::MAX_SPEED, controller.update(4 * second, now + 100 * 1000));
+
+    // too far to catch up by speed
+    controller.update(20 * second, now + second);
+    ASSERT_TRUE(controller.needDrop());
+    controller.reset();
+    ASSERT_FALSE(controller.needDrop());
+
+    // too close to the live edge, slow down to the min
+    controller.setStreamDurations(6 * second, second);
+    speed = 0;
+
+    for (int i = 0; i < 50; i++) {
+        now += second;
+        float ret = controller.update(0, now);
+        ASSERT_TRUE(ret == 0 || ret >= SMPLiveLatencyController::MIN_SPEED);
+
+        if (ret > 0) {
+            speed = ret;
+        }
+    }
+
+    ASSERT_FLOAT_EQ(SMPLiveLatencyController::MIN_SPEED, speed);
+    controller.setEnable(false);
+    ASSERT_LT(controller.update(0, now + second), 0);
+}
@@ -0,0 +1,174 @@
+#include "gtest/gtest.h"
+#include <condition_variable>
+#include <mutex>
+#include <player_notifier.h>
+#include <utils/CicadaJSON.h>
+#include <utils/timer.h>
+#include <vector>
+
+using namespace Cicada;
+using namespace std;
+
+// the callbacks of a notifier, the prepared callback blocks the notifier thread until opened
+class listenerRecorder {
+public:
+    listenerRecorder()
+    {
+        listener.userData = this;
+    }
+
+    static void onPrepared(void *userData)
+    {
+        auto *recorder = static_cast<listenerRecorder *>(userData);
+        unique_lock<mutex> lock(recorder->mMutex);
+        recorder->prepared++;
+        recorder->mCondition.notify_all();
+        recorder->mCondition.wait(lock, [recorder]() { return recorder->mOpened; });
+    }
+
+    static void onPosition(int64_t position, void *userData)
+    {
+        auto *recorder = static_cast<listenerRecorder *>(userData);
+        unique_lock<mutex> lock(recorder->mMutex);
+        recorder->positions.push_back(position);
+        recorder->mCondition.notify_all();
+    }
+
+    static void onStreamInfo(int64_t size, const void *info, void *userData)
+    {
+        auto *recorder = static_cast<listenerRecorder *>(userData);
+        unique_lock<mutex> lock(recorder->mMutex);
+        recorder->streamInfos++;
+        recorder->mCondition.notify_all();
+    }
+
+    // the notifier thread blocked in the prepared callback
+    void block(PlayerNotifier &notifier)
+    {
+        {
+            unique_lock<mutex> lock(mMutex);
+            mOpened = false;
+        }
+        notifier.NotifyPrepared();
+        unique_lock<mutex> lock(mMutex);
+        ASSERT_TRUE(mCondition.wait_for(lock, chrono::seconds(5), [this]() { return prepared > 0; }));
+    }
+
+    void open()
+    {
+        unique_lock<mutex> lock(mMutex);
+        mOpened = true;
+        mCondition.notify_all();
+    }
+
+    template<typename Predicate>
+    bool waitFor(Predicate predicate)
+    {
+        unique_lock<mutex> lock(mMutex);
+        return mCondition.wait_for(lock, chrono::seconds(5), predicate);
+    }
+
+    playerListener listener{nullptr};
+    int prepared{0};
+    int streamInfos{0};
+    vector<int64_t> positions;
+
+private:
+    mutex mMutex;
+    condition_variable mCondition;
+    bool mOpened{true};
+};
+
+TEST(notifier, subscription)
+{
+    PlayerNotifier notifier;
+    listenerRecorder recorder;
+    recorder.listener.PositionUpdate = listenerRecorder::onPosition;
+    notifier.setListener(recorder.listener);
+    // no listener, not queued
+    notifier.NotifyPrepared();
+    notifier.NotifyFirstFrame();
+    notifier.NotifyError(1, "error");
+    notifier.NotifyPosition(100);
+    ASSERT_TRUE(recorder.waitFor([&recorder]() { return recorder.positions.size() == 1u; }));
+    CicadaJSONItem stats(notifier.dumpStats());
+    ASSERT_EQ(1, stats.getInt("pushed", 0));
+    ASSERT_EQ(0, recorder.prepared);
+
+    // disabled
+    notifier.Enable(false);
+    notifier.NotifyPosition(200);
+    notifier.Enable(true);
+    notifier.NotifyPosition(300);
+    ASSERT_TRUE(recorder.waitFor([&recorder]() { return recorder.positions.size() == 2u; }));
+    ASSERT_EQ(300, recorder.positions.back());
+}
+
+TEST(notifier, coalesce)
+{
+    PlayerNotifier notifier;
+    listenerRecorder recorder;
+    recorder.listener.Prepared = listenerRecorder::onPrepared;
+    recorder.listener.PositionUpdate = listenerRecorder::onPosition;
+    notifier.setListener(recorder.listener);
+    recorder.block(notifier);
+
+    // the notifier thread is late, one event in queue takes the latest value
+    for (int i = 1; i <= 100; i++) {
+        notifier.NotifyPosition(i);
+    }
+
+    recorder.open();
+    ASSERT_TRUE(recorder.waitFor([&recorder]() { return !recorder.positions.empty(); }));
+    af_msleep(50);
+    ASSERT_EQ(1u, recorder.positions.size());
+    ASSERT_EQ(100, recorder.positions[0]);
+    CicadaJSONItem stats(notifier.dumpStats());
+    ASSERT_EQ(99, stats.getInt("coalesced", 0));
+
+    // dispatched, a new value needs a new event
+    notifier.NotifyPosition(200);
+    ASSERT_TRUE(recorder.waitFor([&recorder]() { return recorder.positions.size() == 2u; }));
+    ASSERT_EQ(200, recorder.positions[1]);
+}
+
+TEST(notifier, streamInfoCanceled)
+{
+    PlayerNotifier notifier;
+    listenerRecorder recorder;
+    recorder.listener.Prepared = listenerRecorder::onPrepared;
+    recorder.listener.PositionUpdate = listenerRecorder::onPosition;
+    recorder.listener.StreamInfoGet = listenerRecorder::onStreamInfo;
+    notifier.setListener(recorder.listener);
+    recorder.block(notifier);
+    // queued before the cancel, dropped in dispatch
+    notifier.NotifyStreamInfo(nullptr, 0);
+    notifier.CancelNotifyStreamInfo();
+    // queued after, dispatched
+    notifier.NotifyStreamInfo(nullptr, 0);
+    notifier.NotifyPosition(1);
+    recorder.open();
+    ASSERT_TRUE(recorder.waitFor([&recorder]() { return recorder.positions.size() == 1u; }));
+    ASSERT_EQ(1, recorder.streamInfos);
+    CicadaJSONItem stats(notifier.dumpStats());
+    ASSERT_EQ(1, stats.getInt("dropped", 0));
+}
+
+TEST(notifier, pool)
+{
+    PlayerNotifier notifier;
+    listenerRecorder recorder;
+    recorder.listener.PositionUpdate = listenerRecorder::onPosition;
+    notifier.setListener(recorder.listener);
+
+    // one event in flight at a time, the same one is reused
+    for (int i = 0; i < 1000; i++) {
+        notifier.NotifyPosition(i);
+        ASSERT_TRUE(recorder.waitFor([&recorder, i]() { return recorder.positions.size() == (size_t) i + 1; }));
+    }
+
+    CicadaJSONItem stats(notifier.dumpStats());
+    ASSERT_EQ(1000, stats.getInt("dispatched", 0));
+    ASSERT_LE(stats.getInt("allocated", 0), 2);
+    ASSERT_GE(stats.getDouble("maxLatencyUs", 0), stats.getDouble("avgLatencyUs", 0));
+}
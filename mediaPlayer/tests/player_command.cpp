@@ -62,10 +62,26 @@ int command_loop(Cicada::MediaPlayer *player, void *arg)
                 player->Start();
                 break;
 
+            case player_command::pause:
+                player->Pause();
+                break;
+
             case player_command::backGround:
                 player->EnterBackGround(cmd.arg0 != 0);
                 break;
 
+            case player_command::scrubEnter:
+                player->EnterScrub();
+                break;
+
+            case player_command::scrubUpdate:
+                player->UpdateScrub(cmd.arg0);
+                break;
+
+            case player_command::scrubExit:
+                player->ExitScrub(cmd.arg0 ? SEEK_MODE_ACCURATE : SEEK_MODE_INACCURATE);
+                break;
+
             default:
                 break;
         }
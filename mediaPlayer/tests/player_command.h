@@ -21,6 +21,10 @@ public:
         setVolume,
         selectStream,
         backGround,
+        scrubEnter,
+        scrubUpdate,
+        scrubExit,
+        pause,
     };
 
     player_command() = default;
@@ -3,12 +3,16 @@
 //
 
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include "tests/mediaPlayerTest.h"
 #include <utils/timer.h>
 #include "tests/player_command.h"
 #include <vector>
 #include <utils/AFUtils.h>
+#include <utils/CicadaJSON.h>
+#include <utils/frame_work_log.h>
 
 using namespace std;
 
@@ -81,3 +85,206 @@ TEST(cmd, seek)
     ASSERT_LE(seekEndTimes, count);
 }
 
+TEST(cmd, scrub)
+{
+    std::vector<player_command> commands;
+    player_command cmd;
+    int count = 50;
+    int64_t start_time = af_getsteady_ms() + 3000;
+    seekEndTimes = 0;
+    cmd.mID = player_command::scrubEnter;
+    cmd.timestamp = start_time;
+    commands.push_back(cmd);
+    cmd.mID = player_command::scrubUpdate;
+
+    // drag forward and back like a finger, 20ms a move
+    for (int i = 0; i < count; i++) {
+        cmd.timestamp = start_time + (i + 1) * 20;
+        cmd.arg0 = (i < count / 2 ? i : count - i) * 1000;
+        commands.push_back(cmd);
+    }
+
+    cmd.mID = player_command::scrubExit;
+    cmd.timestamp = start_time + (count + 1) * 20;
+    cmd.arg0 = 1;
+    commands.push_back(cmd);
+    commandsCase testCase(commands, false);
+    playerListener listener{nullptr};
+    listener.SeekEnd = onSeekEnd;
+    listener.userData = &testCase;
+    test_simple("http://player.alicdn.com/video/aliyunmedia.mp4", nullptr, command_loop, &testCase, &listener);
+    // the updates don't seek, only the exit does
+    ASSERT_EQ(seekEndTimes, 1);
+}
+
+// two positions in different gops, updating between them shows a new key frame each time
+#define SCRUB_POS_A 0
+#define SCRUB_POS_B 20000
+#define SCRUB_TOGGLES 10
+
+struct scrubLatencyCase {
+    enum step { stepPlay, stepWarm, stepMeasure, stepExit };
+    step mStep{stepPlay};
+    int64_t mStepTime{0};
+    int mUpdates{0};
+    // ms, the update sent and the frame rendered after it
+    std::atomic<int64_t> mUpdateTime{INT64_MAX};
+    std::atomic<int64_t> mFrameTime{INT64_MIN};
+    int64_t mMaxLatency{0};
+    bool mTimeout{false};
+};
+
+static bool scrubOnRenderFrame(void *userData, IAFFrame *frame)
+{
+    auto *testCase = static_cast<scrubLatencyCase *>(userData);
+
+    if (frame->getType() == IAFFrame::FrameTypeVideo && testCase->mFrameTime < testCase->mUpdateTime) {
+        testCase->mFrameTime = af_getsteady_ms();
+    }
+
+    return false;
+}
+
+static int scrubLatencyOnCreate(Cicada::MediaPlayer *player, void *arg)
+{
+    player->SetOnRenderFrameCallback(scrubOnRenderFrame, arg);
+    return 0;
+}
+
+static void scrubUpdate(Cicada::MediaPlayer *player, scrubLatencyCase *testCase)
+{
+    testCase->mUpdateTime = af_getsteady_ms();
+    player->UpdateScrub(testCase->mUpdates++ % 2 ? SCRUB_POS_B : SCRUB_POS_A);
+}
+
+static int scrubLatency_loop(Cicada::MediaPlayer *player, void *arg)
+{
+    auto *testCase = static_cast<scrubLatencyCase *>(arg);
+    int64_t now = af_getsteady_ms();
+
+    if (testCase->mStepTime == 0) {
+        testCase->mStepTime = now;
+    }
+
+    switch (testCase->mStep) {
+        case scrubLatencyCase::stepPlay:
+            if (now - testCase->mStepTime > 3000) {
+                player->EnterScrub();
+                scrubUpdate(player, testCase);
+                testCase->mStep = scrubLatencyCase::stepWarm;
+                testCase->mStepTime = now;
+            }
+
+            break;
+
+        case scrubLatencyCase::stepWarm:
+        case scrubLatencyCase::stepMeasure:
+            if (testCase->mFrameTime >= testCase->mUpdateTime) {
+                if (testCase->mStep == scrubLatencyCase::stepMeasure) {
+                    testCase->mMaxLatency = std::max(testCase->mMaxLatency, testCase->mFrameTime - testCase->mUpdateTime);
+                } else if (testCase->mUpdates == 2) {
+                    // both key frames are decoded and cached
+                    testCase->mStep = scrubLatencyCase::stepMeasure;
+                }
+
+                if (testCase->mUpdates == SCRUB_TOGGLES + 2) {
+                    player->ExitScrub(SEEK_MODE_INACCURATE);
+                    testCase->mStep = scrubLatencyCase::stepExit;
+                } else {
+                    scrubUpdate(player, testCase);
+                }
+
+                testCase->mStepTime = now;
+            } else if (now - testCase->mStepTime > 5000) {
+                testCase->mTimeout = true;
+                return -1;
+            }
+
+            break;
+
+        case scrubLatencyCase::stepExit:
+            if (seekEndTimes > 0 || now - testCase->mStepTime > 5000) {
+                return -1;
+            }
+
+            break;
+    }
+
+    af_msleep(1);
+    return 0;
+}
+
+TEST(scrub, cachedUpdateLatency)
+{
+    scrubLatencyCase testCase;
+    seekEndTimes = 0;
+    test_simple("http://player.alicdn.com/video/aliyunmedia.mp4", scrubLatencyOnCreate, scrubLatency_loop, &testCase, nullptr);
+    ASSERT_FALSE(testCase.mTimeout);
+    ASSERT_EQ(testCase.mUpdates, SCRUB_TOGGLES + 2);
+    // the key frames are in the engine cache, shown on the next player loop
+    ASSERT_LT(testCase.mMaxLatency, 50);
+    AF_LOGI("max cached scrub update latency %lld ms", (long long) testCase.mMaxLatency);
+}
+
+static int timeShiftOnCreate(Cicada::MediaPlayer *player, void *arg)
+{
+    player->SetOption("timeShiftDir", "timeShift");
+    player->SetOption("timeShiftWindow", "60000");
+    return 0;
+}
+
+static int64_t timeShiftSeekFrom = INT64_MIN;
+static std::string timeShiftInfo{};
+
+static int timeShift_loop(Cicada::MediaPlayer *player, void *arg)
+{
+    commandsCase *testCase = static_cast<commandsCase *>(arg);
+    {
+        std::lock_guard<std::mutex> lock(testCase->mMutex);
+
+        // the position the seek is from
+        if (!testCase->mCommands.empty() && testCase->mCommands.front().mID == player_command::seek &&
+            testCase->mCommands.front().timestamp < af_getsteady_ms()) {
+            timeShiftSeekFrom = player->GetCurrentPosition();
+        }
+    }
+
+    if (seekEndTimes > 0 && timeShiftInfo.empty()) {
+        timeShiftInfo = player->GetPropertyString(PROPERTY_KEY_TIME_SHIFT);
+    }
+
+    return command_loop(player, arg);
+}
+
+TEST(cmd, timeShift)
+{
+    std::vector<player_command> commands;
+    player_command cmd;
+    int64_t start_time = af_getsteady_ms();
+    seekEndTimes = 0;
+    // the live edge is recorded while paused, then rewind in the window
+    cmd.mID = player_command::pause;
+    cmd.timestamp = start_time + 8000;
+    commands.push_back(cmd);
+    cmd.mID = player_command::start;
+    cmd.timestamp = start_time + 14000;
+    commands.push_back(cmd);
+    cmd.mID = player_command::seek;
+    cmd.timestamp = start_time + 18000;
+    cmd.arg0 = -6000;
+    commands.push_back(cmd);
+    commandsCase testCase(commands, false);
+    playerListener listener{nullptr};
+    listener.SeekEnd = onSeekEnd;
+    listener.userData = &testCase;
+    test_simple("http://qt1.alivecdn.com/timeline/testshift.m3u8?auth_key=1594730859-0-0-b71fd57c57a62a3c2b014f24ca2b9da3", timeShiftOnCreate,
+                timeShift_loop, &testCase, &listener);
+    ASSERT_EQ(seekEndTimes, 1);
+    // rewound 6s in the window, not clamped to the window start or back to live
+    ASSERT_NE(timeShiftSeekFrom, INT64_MIN);
+    ASSERT_NEAR(seekEndPos, timeShiftSeekFrom - 6000, 500);
+    CicadaJSONItem info(timeShiftInfo);
+    ASSERT_TRUE(info.getBool("shifted", false));
+    ASSERT_LE(info.getInt64("start", INT64_MAX), seekEndPos);
+    ASSERT_GT(info.getInt64("end", INT64_MIN), seekEndPos);
+}
@@ -131,6 +131,94 @@ TEST(switch_stream, video)
                 &testCase, &listener, true);
 }
 
+// the video streams, index and bandwidth
+static vector<pair<int, int>> fastSwitchStreams{};
+static int fastSwitchTarget = -1;
+static int fastSwitchSucCount = 0;
+static int64_t fastSwitchSucTime = INT64_MIN;
+static int64_t fastSwitchLastPos = INT64_MIN;
+static int64_t fastSwitchMaxBack = 0;
+
+static int fastSwitchOnCreate(Cicada::MediaPlayer *player, void *arg)
+{
+    player->SetOption("fastAbrSwitch", "1");
+    return 0;
+}
+
+static void onStreamInfoGet_fastSwitch(int64_t size, const void *msg, void *userData)
+{
+    StreamInfo **info = (StreamInfo **) msg;
+
+    for (int i = 0; i < size; ++i) {
+        if (info[i]->type == ST_TYPE_VIDEO) {
+            fastSwitchStreams.emplace_back(info[i]->streamIndex, info[i]->videoBandwidth);
+        }
+    }
+}
+
+static void onStreamSwitchSuc_fastSwitch(int64_t size, const void *msg, void *userData)
+{
+    if (static_cast<StreamType>(size) == ST_TYPE_VIDEO) {
+        fastSwitchSucCount++;
+        fastSwitchSucTime = af_getsteady_ms();
+    }
+}
+
+static int fastSwitch_loop(Cicada::MediaPlayer *player, void *arg)
+{
+    int64_t startTime = *static_cast<int64_t *>(arg);
+    int64_t now = af_getsteady_ms();
+    int64_t pos = player->GetCurrentPosition();
+
+    // the old rendition is cut at the splice, the play goes on without going back
+    if (fastSwitchLastPos != INT64_MIN && fastSwitchLastPos - pos > fastSwitchMaxBack) {
+        fastSwitchMaxBack = fastSwitchLastPos - pos;
+    }
+
+    fastSwitchLastPos = pos;
+
+    // up switch when some seconds are buffered
+    if (fastSwitchTarget < 0 && now - startTime > 5000) {
+        StreamInfo *current = player->GetCurrentStreamInfo(ST_TYPE_VIDEO);
+        int bandwidth = current ? current->videoBandwidth : INT32_MAX;
+
+        for (auto &item : fastSwitchStreams) {
+            if (item.second > bandwidth) {
+                fastSwitchTarget = item.first;
+                bandwidth = item.second;
+            }
+        }
+
+        if (fastSwitchTarget < 0) {
+            AF_LOGE("no higher video stream to switch to");
+            return -1;
+        }
+
+        player->SelectTrack(fastSwitchTarget);
+    }
+
+    if ((fastSwitchSucTime != INT64_MIN && now - fastSwitchSucTime > 2000) || now - startTime > 40000) {
+        return -1;
+    }
+
+    af_msleep(10);
+    return 0;
+}
+
+TEST(switch_stream, fastAbrSwitch)
+{
+    int64_t startTime = af_getsteady_ms();
+    playerListener listener{nullptr};
+    listener.StreamInfoGet = onStreamInfoGet_fastSwitch;
+    listener.StreamSwitchSuc = onStreamSwitchSuc_fastSwitch;
+    test_simple("https://alivc-demo-vod.aliyuncs.com/59f748948daa4438b42e42db755ae01e/9d44b2b86d334c6b9df649e35ad0240f.m3u8",
+                fastSwitchOnCreate, fastSwitch_loop, &startTime, &listener);
+    ASSERT_GE(fastSwitchTarget, 0);
+    ASSERT_EQ(fastSwitchSucCount, 1);
+    // a frame duration for the position between the renditions
+    ASSERT_LE(fastSwitchMaxBack, 100);
+}
+
 TEST(switch_stream, subtitle)
 {
     std::vector<player_command> commands;
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <memory>
+#include <thumbnail/ThumbnailEngine.h>
+#include <utils/timer.h>
+
+using namespace Cicada;
+
+TEST(thumbnail, scaledAndCacheBounded)
+{
+    const int width = 160;
+    const int height = 90;
+    // two thumbnails of yuv 4:2:0
+    const int64_t cacheBytes = width * height * 3 / 2 * 2;
+    const int64_t times[] = {0, 5000000, 10000000, 15000000};
+    const int count = sizeof(times) / sizeof(times[0]);
+    std::atomic<int> done{0};
+    std::atomic<int> errors{0};
+    std::atomic<int> maxWidth{0};
+    std::atomic<int> maxHeight{0};
+    ThumbnailEngine engine("http://player.alicdn.com/video/aliyunmedia.mp4");
+    engine.setThumbnailSize(width, height);
+    engine.setCacheBytes(cacheBytes);
+    engine.setCallback([&](int64_t time, const std::shared_ptr<IAFFrame> &frame, int ret) -> void {
+        if (ret < 0 || frame == nullptr) {
+            errors++;
+        } else {
+            maxWidth = std::max(maxWidth.load(), frame->getInfo().video.width);
+            maxHeight = std::max(maxHeight.load(), frame->getInfo().video.height);
+        }
+
+        done++;
+    });
+
+    for (int64_t time : times) {
+        engine.requestThumbnail(time, false);
+    }
+
+    for (int i = 0; i < 3000 && done < count; i++) {
+        af_msleep(10);
+    }
+
+    engine.stop();
+    ASSERT_EQ(count, done);
+    ASSERT_EQ(0, errors);
+    ASSERT_GT(maxWidth, 0);
+    ASSERT_LE(maxWidth, width);
+    ASSERT_LE(maxHeight, height);
+    ASSERT_LE(engine.getCacheBytes(), cacheBytes);
+}
+
+TEST(thumbnail, scrubCanceledAndCacheHit)
+{
+    const int count = 10;
+    std::atomic<int> done{0};
+    std::atomic<int> canceled{0};
+    std::atomic<int> errors{0};
+    std::atomic<int64_t> lastTime{-1};
+    ThumbnailEngine engine("http://player.alicdn.com/video/aliyunmedia.mp4");
+    engine.setThumbnailSize(160, 90);
+    engine.setCallback([&](int64_t time, const std::shared_ptr<IAFFrame> &frame, int ret) -> void {
+        if (ret == -ECANCELED) {
+            canceled++;
+        } else if (ret < 0 || frame == nullptr) {
+            errors++;
+        } else {
+            lastTime = time;
+        }
+
+        done++;
+    });
+
+    // dragging, each request cancels the ones before it
+    for (int i = 0; i < count; i++) {
+        engine.requestThumbnail(i * 1000000);
+    }
+
+    for (int i = 0; i < 3000 && done < count; i++) {
+        af_msleep(10);
+    }
+
+    // every request is answered once, the last one with a frame
+    ASSERT_EQ(count, done);
+    ASSERT_EQ(0, errors);
+    ASSERT_GT(canceled, 0);
+    ASSERT_EQ((count - 1) * 1000000, lastTime);
+
+    // the same time hits the cache, answered in place
+    engine.requestThumbnail((count - 1) * 1000000);
+    ASSERT_EQ(count + 1, done);
+    engine.stop();
+}
@@ -0,0 +1,688 @@
+#define LOG_TAG "ThumbnailEngine"
+
+#include "ThumbnailEngine.h"
+#include <algorithm>
+#include <base/media/AVAFPacket.h>
+#include <cerrno>
+#include <codec/decoderFactory.h>
+#include <data_source/dataSourcePrototype.h>
+#include <utility>
+#include <utils/ColorConvert.h>
+#include <utils/errors/framework_error.h>
+#include <utils/frame_work_log.h>
+#include <utils/timer.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+}
+
+// don't download too much when there is no key frame before the request time
+#define MAX_SCAN_DURATION (10 * 1000 * 1000)
+#define OPEN_STREAM_TIMEOUT_MS 10000
+#define DECODE_TIMEOUT_MS 2000
+
+using namespace std;
+
+namespace Cicada {
+    namespace {
+        int64_t frameBytes(IAFFrame *frame)
+        {
+            AVFrame *avFrame = getAVFrame(frame);
+
+            if (avFrame == nullptr) {
+                return 0;
+            }
+
+            int size = av_image_get_buffer_size(static_cast<AVPixelFormat>(avFrame->format), avFrame->width, avFrame->height, 1);
+            return std::max(size, 0);
+        }
+
+        // the decoder outputs the full size, scale it before cached, the formats can't be scaled here are kept as is
+        shared_ptr<IAFFrame> scaleFrame(const shared_ptr<IAFFrame> &frame, int boxWidth, int boxHeight)
+        {
+            AVFrame *src = getAVFrame(frame.get());
+
+            if (src == nullptr || boxWidth <= 0 || boxHeight <= 0 || (src->width <= boxWidth && src->height <= boxHeight)) {
+                return frame;
+            }
+
+            auto format = static_cast<AVPixelFormat>(src->format);
+            bool planar = format == AV_PIX_FMT_YUV420P || format == AV_PIX_FMT_YUVJ420P;
+
+            if (!planar && format != AV_PIX_FMT_NV12 && format != AV_PIX_FMT_NV21) {
+                return frame;
+            }
+
+            double scale = std::min((double) boxWidth / src->width, (double) boxHeight / src->height);
+            // even sizes for the 4:2:0 chroma
+            int width = std::max(static_cast<int>(src->width * scale) & ~1, 2);
+            int height = std::max(static_cast<int>(src->height * scale) & ~1, 2);
+            AVFrame *dst = av_frame_alloc();
+
+            if (dst == nullptr) {
+                return frame;
+            }
+
+            dst->format = src->format;
+            dst->width = width;
+            dst->height = height;
+
+            if (av_frame_get_buffer(dst, 32) < 0) {
+                av_frame_free(&dst);
+                return frame;
+            }
+
+            av_frame_copy_props(dst, src);
+            int chromaWidth = (src->width + 1) / 2;
+            int chromaHeight = (src->height + 1) / 2;
+            ColorConvert::Scale(src->data[0], src->linesize[0], src->width, src->height, dst->data[0], dst->linesize[0], width, height, 1);
+
+            if (planar) {
+                for (int i = 1; i < 3; i++) {
+                    ColorConvert::Scale(src->data[i], src->linesize[i], chromaWidth, chromaHeight, dst->data[i], dst->linesize[i],
+                                        width / 2, height / 2, 1);
+                }
+            } else {
+                ColorConvert::Scale(src->data[1], src->linesize[1], chromaWidth, chromaHeight, dst->data[1], dst->linesize[1], width / 2,
+                                    height / 2, 2);
+            }
+
+            shared_ptr<IAFFrame> scaled = shared_ptr<IAFFrame>(new AVAFFrame(&dst, IAFFrame::FrameTypeVideo));
+            scaled->getInfo().timePosition = frame->getInfo().timePosition;
+            return scaled;
+        }
+    }// namespace
+
+    ThumbnailEngine::ThumbnailEngine(string url) : mUrl(std::move(url))
+    {
+    }
+
+    ThumbnailEngine::~ThumbnailEngine()
+    {
+        stop();
+        delete mThread;
+    }
+
+    void ThumbnailEngine::setCacheBytes(int64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        mMaxCacheBytes = std::max(bytes, (int64_t) 0);
+        trimCacheLocked();
+    }
+
+    int64_t ThumbnailEngine::getCacheBytes()
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        return mCacheBytes;
+    }
+
+    void ThumbnailEngine::setThumbnailSize(int width, int height)
+    {
+        mThumbnailWidth = width;
+        mThumbnailHeight = height;
+    }
+
+    void ThumbnailEngine::requestThumbnail(int64_t time, bool cancelOutdated)
+    {
+        queueRequest(time, nullptr, INT64_MIN, cancelOutdated);
+    }
+
+    void ThumbnailEngine::requestThumbnail(int64_t time, unique_ptr<IAFPacket> keyPacket, int64_t nextKeyPos, bool cancelOutdated)
+    {
+        queueRequest(time, shared_ptr<IAFPacket>(keyPacket.release()), nextKeyPos, cancelOutdated);
+    }
+
+    void ThumbnailEngine::setPacketMeta(unique_ptr<streamMeta> meta)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mNewPacketMeta = move(meta);
+    }
+
+    void ThumbnailEngine::queueRequest(int64_t time, const shared_ptr<IAFPacket> &packet, int64_t nextKeyPos, bool cancelOutdated)
+    {
+        std::shared_ptr<IAFFrame> frame = findCache(time);
+
+        if (frame != nullptr) {
+            if (cancelOutdated) {
+                cancelAll();
+            }
+
+            notify(time, frame, 0);
+            return;
+        }
+
+        std::deque<Request> canceled;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            if (mStopped) {
+                return;
+            }
+
+            uint64_t serial = ++mSerial;
+
+            if (cancelOutdated) {
+                mCancelSerial = serial;
+                canceled.swap(mRequests);
+            }
+
+            mRequests.push_back({time, serial, packet, nextKeyPos});
+
+            if (mThread == nullptr) {
+                mThread = NEW_AF_THREAD(workLoop);
+                mThread->start();
+            }
+        }
+        mCondition.notify_one();
+
+        for (auto &item : canceled) {
+            notify(item.time, nullptr, -ECANCELED);
+        }
+    }
+
+    void ThumbnailEngine::cancelAll()
+    {
+        std::deque<Request> canceled;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mCancelSerial = ++mSerial;
+            canceled.swap(mRequests);
+        }
+
+        for (auto &item : canceled) {
+            notify(item.time, nullptr, -ECANCELED);
+        }
+    }
+
+    void ThumbnailEngine::stop()
+    {
+        std::deque<Request> canceled;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopped = true;
+            canceled.swap(mRequests);
+        }
+        mCondition.notify_one();
+        {
+            std::lock_guard<std::mutex> lock(mSourceMutex);
+
+            if (mDataSource) {
+                mDataSource->Interrupt(true);
+            }
+
+            if (mDemuxer) {
+                mDemuxer->interrupt(1);
+            }
+        }
+
+        if (mThread) {
+            mThread->stop();
+        }
+
+        closeSource();
+
+        if (mPacketDecoder) {
+            mPacketDecoder->close();
+            mPacketDecoder = nullptr;
+        }
+
+        for (auto &item : canceled) {
+            notify(item.time, nullptr, -ECANCELED);
+        }
+    }
+
+    int ThumbnailEngine::workLoop()
+    {
+        Request request{};
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait_for(lock, std::chrono::milliseconds(100), [this]() { return !mRequests.empty() || mStopped; });
+
+            if (mStopped || mRequests.empty()) {
+                return 0;
+            }
+
+            request = mRequests.front();
+            mRequests.pop_front();
+        }
+        std::shared_ptr<IAFFrame> frame = findCache(request.time);
+        int ret = 0;
+
+        if (frame == nullptr) {
+            ret = request.packet ? generateFromPacket(request, frame) : generate(request, frame);
+        }
+
+        if (isOutdated(request)) {
+            frame = nullptr;
+            ret = -ECANCELED;
+        }
+
+        notify(request.time, frame, ret);
+        return 0;
+    }
+
+    int ThumbnailEngine::openSource()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mSourceMutex);
+            mDataSource = unique_ptr<IDataSource>(dataSourcePrototype::create(mUrl, mOpts));
+
+            if (mDataSource == nullptr) {
+                return FRAMEWORK_ERR_PROTOCOL_NOT_SUPPORT;
+            }
+
+            mDataSource->Interrupt(mStopped);
+        }
+        int ret = mDataSource->Open(0);
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mSourceMutex);
+            mDemuxer = unique_ptr<demuxer_service>(new demuxer_service(mDataSource.get()));
+            mDemuxer->interrupt(mStopped);
+        }
+        mDemuxer->setOptions(mOpts);
+        ret = mDemuxer->createDemuxer(demuxer_type_unknown);
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        if (mDemuxer->getDemuxerHandle()) {
+            mDemuxer->getDemuxerHandle()->setBitStreamFormat(header_type::header_type_merge, header_type::header_type_merge);
+        }
+
+        ret = mDemuxer->initOpen();
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        int nbStream = mDemuxer->GetNbStreams();
+        unique_ptr<streamMeta> smeta;
+        uint64_t minBandwidth = UINT64_MAX;
+        int index = -1;
+
+        for (int i = 0; i < nbStream; ++i) {
+            mDemuxer->GetStreamMeta(smeta, i, false);
+            auto *meta = (Stream_meta *) (*(smeta.get()));
+
+            if ((meta->type == STREAM_TYPE_VIDEO && meta->attached_pic == 0) || meta->type == STREAM_TYPE_MIXED) {
+                // the lowest rendition is good enough for thumbnails
+                if (index < 0 || meta->bandwidth < minBandwidth) {
+                    index = i;
+                    minBandwidth = meta->bandwidth;
+                    mMixed = meta->type == STREAM_TYPE_MIXED;
+                }
+            }
+        }
+
+        if (index < 0) {
+            AF_LOGE("no video stream\n");
+            return -EINVAL;
+        }
+
+        ret = mDemuxer->OpenStream(index);
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        mVideoIndex = index;
+        mDemuxer->start();
+        ret = findVideoSubStream();
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        auto *meta = (Stream_meta *) (*(mVideoMeta.get()));
+        uint64_t flags = DECFLAG_SW | DECFLAG_THUMBNAIL;
+        mDecoder = decoderFactory::create(*meta, flags, 0, nullptr);
+
+        if (mDecoder == nullptr) {
+            return gen_framework_errno(error_class_codec, codec_error_video_not_support);
+        }
+
+        return mDecoder->open(meta, nullptr, flags, nullptr);
+    }
+
+    int ThumbnailEngine::findVideoSubStream()
+    {
+        // the streams in playlists are opened asynchronously, the meta is ready after the first packet read
+        int64_t startTime = af_getsteady_ms();
+
+        while (!mStopped) {
+            unique_ptr<IAFPacket> packet{};
+            int ret = mDemuxer->readPacket(packet, -1);
+
+            if (ret == -EAGAIN) {
+                if (af_getsteady_ms() - startTime > OPEN_STREAM_TIMEOUT_MS) {
+                    return FRAMEWORK_NET_ERR_UNKNOWN;
+                }
+
+                af_msleep(10);
+                continue;
+            }
+
+            if (ret < 0) {
+                return ret;
+            }
+
+            if (packet == nullptr) {
+                return -EINVAL;
+            }
+
+            if (GEN_STREAM_INDEX(packet->getInfo().streamIndex) != mVideoIndex) {
+                continue;
+            }
+
+            if (!mMixed) {
+                return mDemuxer->GetStreamMeta(mVideoMeta, mVideoIndex, false);
+            }
+
+            int nbSubStream = mDemuxer->GetNbSubStream(mVideoIndex);
+
+            for (int i = 0; i < nbSubStream; i++) {
+                mDemuxer->GetStreamMeta(mVideoMeta, GEN_STREAM_ID(mVideoIndex, i), true);
+                auto *meta = (Stream_meta *) (*(mVideoMeta.get()));
+
+                if (meta->type == STREAM_TYPE_VIDEO && meta->height > 0 && meta->attached_pic == 0) {
+                    mVideoIndex = GEN_STREAM_ID(mVideoIndex, i);
+                    return 0;
+                }
+            }
+
+            AF_LOGE("no video stream in the mixed stream\n");
+            return -EINVAL;
+        }
+
+        return FRAMEWORK_ERR_EXIT;
+    }
+
+    void ThumbnailEngine::closeSource()
+    {
+        unique_ptr<demuxer_service> demuxer{};
+        unique_ptr<IDataSource> dataSource{};
+
+        if (mDecoder) {
+            mDecoder->close();
+            mDecoder = nullptr;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mSourceMutex);
+            demuxer = move(mDemuxer);
+            dataSource = move(mDataSource);
+        }
+
+        if (demuxer) {
+            demuxer->stop();
+            demuxer->close();
+        }
+
+        if (dataSource) {
+            dataSource->Close();
+        }
+
+        mVideoMeta = nullptr;
+        mVideoIndex = -1;
+        mMixed = false;
+        mOpened = false;
+    }
+
+    bool ThumbnailEngine::isVideoPacket(IAFPacket *packet) const
+    {
+        int streamIndex = packet->getInfo().streamIndex;
+
+        if (mMixed) {
+            return streamIndex == mVideoIndex;
+        }
+
+        return GEN_STREAM_INDEX(streamIndex) == mVideoIndex;
+    }
+
+    int ThumbnailEngine::generate(const Request &request, std::shared_ptr<IAFFrame> &frame)
+    {
+        int ret;
+
+        if (!mOpened) {
+            ret = openSource();
+
+            if (ret < 0) {
+                AF_LOGE("open source error %s\n", framework_err2_string(ret));
+                closeSource();
+                return ret;
+            }
+
+            mOpened = true;
+        }
+
+        mDemuxer->Seek(request.time, 0, -1);
+        unique_ptr<IAFPacket> keyPacket{};
+        int64_t nextKeyPos = INT64_MIN;
+        ret = readKeyFrame(request, keyPacket, nextKeyPos);
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        int64_t keyPos = keyPacket->getInfo().timePosition;
+        ret = decodeKeyFrame(request, mDecoder.get(), keyPacket, frame);
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        // all the positions before the next key frame resolve to this key frame
+        int64_t endPos = nextKeyPos != INT64_MIN ? nextKeyPos - 1 : std::max(keyPos, request.time);
+        addCache(keyPos, endPos, frame);
+        return 0;
+    }
+
+    int ThumbnailEngine::generateFromPacket(const Request &request, std::shared_ptr<IAFFrame> &frame)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            if (mNewPacketMeta) {
+                mPacketMeta = move(mNewPacketMeta);
+
+                if (mPacketDecoder) {
+                    mPacketDecoder->close();
+                    mPacketDecoder = nullptr;
+                }
+            }
+        }
+
+        if (mPacketMeta == nullptr) {
+            return -EINVAL;
+        }
+
+        if (mPacketDecoder == nullptr) {
+            auto *meta = (Stream_meta *) (*(mPacketMeta.get()));
+            uint64_t flags = DECFLAG_SW | DECFLAG_THUMBNAIL;
+            mPacketDecoder = decoderFactory::create(*meta, flags, 0, nullptr);
+
+            if (mPacketDecoder == nullptr) {
+                return gen_framework_errno(error_class_codec, codec_error_video_not_support);
+            }
+
+            int ret = mPacketDecoder->open(meta, nullptr, flags, nullptr);
+
+            if (ret < 0) {
+                mPacketDecoder = nullptr;
+                return ret;
+            }
+        }
+
+        unique_ptr<IAFPacket> keyPacket = request.packet->clone();
+        int64_t keyPos = keyPacket->getInfo().timePosition;
+        int ret = decodeKeyFrame(request, mPacketDecoder.get(), keyPacket, frame);
+
+        if (ret < 0) {
+            return ret;
+        }
+
+        int64_t endPos = request.nextKeyPos != INT64_MIN ? request.nextKeyPos - 1 : std::max(keyPos, request.time);
+        addCache(keyPos, endPos, frame);
+        return 0;
+    }
+
+    int ThumbnailEngine::readKeyFrame(const Request &request, unique_ptr<IAFPacket> &keyPacket, int64_t &nextKeyPos)
+    {
+        while (!isOutdated(request)) {
+            unique_ptr<IAFPacket> packet{};
+            int ret = mDemuxer->readPacket(packet, -1);
+
+            if (ret == -EAGAIN) {
+                af_msleep(5);
+                continue;
+            }
+
+            if (ret < 0) {
+                return ret;
+            }
+
+            if (packet == nullptr) {
+                break;
+            }
+
+            if (!isVideoPacket(packet.get())) {
+                continue;
+            }
+
+            int64_t pos = packet->getInfo().timePosition;
+
+            if (pos == INT64_MIN) {
+                pos = packet->getInfo().pts;
+            }
+
+            packet->getInfo().timePosition = pos;
+            bool key = (packet->getInfo().flags & AF_PKT_FLAG_KEY) != 0;
+
+            if (key && pos > request.time && keyPacket != nullptr) {
+                nextKeyPos = pos;
+                break;
+            }
+
+            if (key) {
+                keyPacket = move(packet);
+
+                // no key frame before the time, use the first one after it
+                if (pos > request.time) {
+                    break;
+                }
+
+                continue;
+            }
+
+            if ((keyPacket != nullptr && pos > request.time) || pos > request.time + MAX_SCAN_DURATION) {
+                break;
+            }
+        }
+
+        if (isOutdated(request)) {
+            return -ECANCELED;
+        }
+
+        if (keyPacket == nullptr) {
+            AF_LOGW("no key frame around %lld\n", request.time);
+            return -EINVAL;
+        }
+
+        return 0;
+    }
+
+    int ThumbnailEngine::decodeKeyFrame(const Request &request, IDecoder *decoder, unique_ptr<IAFPacket> &keyPacket,
+                                        std::shared_ptr<IAFFrame> &frame)
+    {
+        int64_t keyPos = keyPacket->getInfo().timePosition;
+        decoder->flush();
+        decoder->send_packet(keyPacket, 0);
+        // drain the decoder, the frame is output without waiting the following packets
+        unique_ptr<IAFPacket> eos{};
+        decoder->send_packet(eos, 0);
+        int64_t startTime = af_getsteady_ms();
+
+        while (!isOutdated(request)) {
+            unique_ptr<IAFFrame> out{};
+            int ret = decoder->getFrame(out, 0);
+
+            if (out != nullptr) {
+                out->getInfo().timePosition = keyPos;
+                frame = scaleFrame(shared_ptr<IAFFrame>(out.release()), mThumbnailWidth, mThumbnailHeight);
+                return 0;
+            }
+
+            if (ret == STATUS_EOS || af_getsteady_ms() - startTime > DECODE_TIMEOUT_MS) {
+                break;
+            }
+
+            af_msleep(2);
+        }
+
+        if (isOutdated(request)) {
+            return -ECANCELED;
+        }
+
+        AF_LOGE("decode key frame at %lld failed\n", keyPos);
+        return gen_framework_errno(error_class_codec, codec_error_video_device_error);
+    }
+
+    std::shared_ptr<IAFFrame> ThumbnailEngine::findCache(int64_t time)
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+
+        for (auto it = mCache.begin(); it != mCache.end(); ++it) {
+            if (time >= it->keyPos && time <= it->endPos) {
+                mCache.splice(mCache.begin(), mCache, it);
+                return mCache.front().frame;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void ThumbnailEngine::addCache(int64_t keyPos, int64_t endPos, const std::shared_ptr<IAFFrame> &frame)
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        int64_t bytes = frameBytes(frame.get());
+
+        for (auto it = mCache.begin(); it != mCache.end(); ++it) {
+            if (it->keyPos == keyPos) {
+                it->endPos = std::max(it->endPos, endPos);
+                it->frame = frame;
+                mCacheBytes += bytes - it->bytes;
+                it->bytes = bytes;
+                mCache.splice(mCache.begin(), mCache, it);
+                trimCacheLocked();
+                return;
+            }
+        }
+
+        mCache.push_front({keyPos, endPos, frame, bytes});
+        mCacheBytes += bytes;
+        trimCacheLocked();
+    }
+
+    void ThumbnailEngine::trimCacheLocked()
+    {
+        // the most recent one is kept even bigger than the limit, it's the one on screen
+        while (mCacheBytes > mMaxCacheBytes && mCache.size() > 1) {
+            mCacheBytes -= mCache.back().bytes;
+            mCache.pop_back();
+        }
+    }
+
+    void ThumbnailEngine::notify(int64_t time, const std::shared_ptr<IAFFrame> &frame, int ret)
+    {
+        if (mCallback) {
+            mCallback(time, frame, ret);
+        }
+    }
+}// namespace Cicada
@@ -0,0 +1,162 @@
+#ifndef CICADA_PLAYER_THUMBNAILENGINE_H
+#define CICADA_PLAYER_THUMBNAILENGINE_H
+
+#include <atomic>
+#include <base/OptionOwner.h>
+#include <base/media/IAFPacket.h>
+#include <codec/IDecoder.h>
+#include <condition_variable>
+#include <data_source/IDataSource.h>
+#include <demuxer/demuxer_service.h>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utils/afThread.h>
+
+namespace Cicada {
+    /*
+     * Scrubbing preview generated from the media itself, for the sources without thumbnail sprites
+     * (see CicadaThumbnailParser for the WebVTT sprites).
+     *
+     * A request time is resolved to the key frame before it, only that key frame is sent to a
+     * software decoder opened with DECFLAG_THUMBNAIL (key frames only, lowres when the codec
+     * supports it). Requests are served one by one on a worker thread; while the user drags, a
+     * new request cancels the pending and the running ones. The decoded frames are scaled down to
+     * the thumbnail size and kept in a LRU cache bounded by bytes, together with the time range
+     * they cover, so that the nearby requests hit the cache.
+     * A request can also carry a key packet the caller has already read (the player buffer), it's
+     * decoded directly, without seeking or downloading.
+     */
+    class ThumbnailEngine : public OptionOwner {
+    public:
+        /*
+         * time: the request time (us)
+         * frame: the key frame decoded, its timePosition is the position of the key frame, nullptr if failed
+         * ret: 0 on success, -ECANCELED if outdated by a newer request, or a framework error
+         */
+        typedef std::function<void(int64_t time, const std::shared_ptr<IAFFrame> &frame, int ret)> ThumbnailCallback;
+
+        explicit ThumbnailEngine(std::string url);
+
+        ~ThumbnailEngine();
+
+        void setCallback(const ThumbnailCallback &callback)
+        {
+            mCallback = callback;
+        }
+
+        // the max bytes of the frames cached
+        void setCacheBytes(int64_t bytes);
+
+        int64_t getCacheBytes();
+
+        // the frames are scaled down into width x height, keeping the aspect ratio, 0 not to scale
+        void setThumbnailSize(int width, int height);
+
+        /*
+         * request the thumbnail of time (us), the callback is called on the worker thread,
+         * or in place when hit the cache.
+         * cancelOutdated: cancel the requests not finished yet, use it when scrubbing.
+         */
+        void requestThumbnail(int64_t time, bool cancelOutdated = true);
+
+        /*
+         * request the thumbnail of time (us) from a key packet the caller already has (the player buffer),
+         * no seek and no download, the packet is decoded by the meta set by setPacketMeta.
+         * nextKeyPos: the position of the key frame after it, INT64_MIN if unknown.
+         */
+        void requestThumbnail(int64_t time, std::unique_ptr<IAFPacket> keyPacket, int64_t nextKeyPos, bool cancelOutdated = true);
+
+        // the stream meta of the key packets given by requestThumbnail
+        void setPacketMeta(std::unique_ptr<streamMeta> meta);
+
+        void cancelAll();
+
+        void stop();
+
+    private:
+        struct Request {
+            int64_t time;
+            uint64_t serial;
+            std::shared_ptr<IAFPacket> packet;
+            int64_t nextKeyPos;
+        };
+
+        struct CacheItem {
+            int64_t keyPos;
+            int64_t endPos;
+            std::shared_ptr<IAFFrame> frame;
+            int64_t bytes;
+        };
+
+    private:
+        void queueRequest(int64_t time, const std::shared_ptr<IAFPacket> &packet, int64_t nextKeyPos, bool cancelOutdated);
+
+        int workLoop();
+
+        int openSource();
+
+        int findVideoSubStream();
+
+        void closeSource();
+
+        int generate(const Request &request, std::shared_ptr<IAFFrame> &frame);
+
+        int readKeyFrame(const Request &request, std::unique_ptr<IAFPacket> &keyPacket, int64_t &nextKeyPos);
+
+        int generateFromPacket(const Request &request, std::shared_ptr<IAFFrame> &frame);
+
+        int decodeKeyFrame(const Request &request, IDecoder *decoder, std::unique_ptr<IAFPacket> &keyPacket,
+                           std::shared_ptr<IAFFrame> &frame);
+
+        bool isVideoPacket(IAFPacket *packet) const;
+
+        bool isOutdated(const Request &request) const
+        {
+            return mStopped || request.serial < mCancelSerial;
+        }
+
+        std::shared_ptr<IAFFrame> findCache(int64_t time);
+
+        void addCache(int64_t keyPos, int64_t endPos, const std::shared_ptr<IAFFrame> &frame);
+
+        void trimCacheLocked();
+
+        void notify(int64_t time, const std::shared_ptr<IAFFrame> &frame, int ret);
+
+    private:
+        std::string mUrl;
+        std::unique_ptr<IDataSource> mDataSource{nullptr};
+        std::unique_ptr<demuxer_service> mDemuxer{nullptr};
+        std::unique_ptr<IDecoder> mDecoder{nullptr};
+        std::unique_ptr<streamMeta> mVideoMeta{nullptr};
+        std::unique_ptr<IDecoder> mPacketDecoder{nullptr};
+        std::unique_ptr<streamMeta> mPacketMeta{nullptr};
+        std::unique_ptr<streamMeta> mNewPacketMeta{nullptr};// guarded by mMutex, taken by the worker
+        int mVideoIndex{-1};
+        bool mMixed{false};
+        bool mOpened{false};
+        std::mutex mSourceMutex;
+
+        afThread *mThread{nullptr};
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        std::deque<Request> mRequests;
+        uint64_t mSerial{0};
+        std::atomic<uint64_t> mCancelSerial{0};
+        std::atomic_bool mStopped{false};
+        ThumbnailCallback mCallback{nullptr};
+
+        std::mutex mCacheMutex;
+        std::list<CacheItem> mCache;// the most recent used at front
+        int64_t mCacheBytes{0};
+        int64_t mMaxCacheBytes{16 * 1024 * 1024};
+        std::atomic<int> mThumbnailWidth{640};
+        std::atomic<int> mThumbnailHeight{360};
+    };
+}// namespace Cicada
+
+
+#endif//CICADA_PLAYER_THUMBNAILENGINE_H